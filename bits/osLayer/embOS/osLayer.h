@@ -37,6 +37,26 @@
 #define SemaWait(a)     OS_Use(&a)
 #define SemaFree(a)     OS_Unuse(&a)
 
+// embOS has no reader/writer lock, readers take the resource semaphore too (still one per structure)
+#define RwLockDefine(a)     OS_RSEMA a
+#define RwLockInit(a)       OS_CREATERSEMA(&a)
+#define RwLockRead(a)       OS_Use(&a)
+#define RwLockWrite(a)      OS_Use(&a)
+#define RwUnlockRead(a)     OS_Unuse(&a)
+#define RwUnlockWrite(a)    OS_Unuse(&a)
+
+// Resource semaphores may always be taken again by the task that owns them
+#define RecursiveLockDefine(a)  OS_RSEMA a
+#define RecursiveLockInit(a)    OS_CREATERSEMA(&a)
+#define RecursiveLock(a)        OS_Use(&a)
+#define RecursiveUnlock(a)      OS_Unuse(&a)
+
+// Counting semaphores, for handing work from one task to others
+#define CountSemaDefine(a)      OS_CSEMA a
+#define CountSemaInit(a,count)  OS_CreateCSema(&a, count)
+#define CountSemaWait(a)        OS_WaitCSema(&a)
+#define CountSemaPost(a)        OS_SignalCSema(&a)
+
 typedef struct {
   uint32_t timeLastReset ;
 } TimerControl ;
@@ -0,0 +1,597 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include "osLayer.h"
+#include "logging.h"
+#include "eventLoop.h"
+
+// epoll_event.data is the slot in Sources[], or one of these
+#define EVENT_LOOP_TIMER    (MAX_EVENT_LOOP_FDS)
+#define EVENT_LOOP_WAKEUP   (MAX_EVENT_LOOP_FDS + 1)
+
+typedef struct
+{
+    int                 fd;         // -1 when the slot is free
+    eventLoop_Handler   handler;
+    void                *context;
+} EVENT_LOOP_SOURCE;
+
+// Sources_Lock guards Sources[] and Loop_Stopping, sources come and go from any thread
+static LockDefine(Sources_Lock);
+static EVENT_LOOP_SOURCE Sources[MAX_EVENT_LOOP_FDS];
+static bool         Loop_Stopping;
+
+static int          Epoll_Fd = -1;
+static int          Timer_Fd = -1;
+static int          Wakeup_Fd = -1;
+static unsigned     Timer_Period_ms;
+static eventLoop_Callback Timer_Callback;
+static eventLoop_Callback Wakeup_Callback;
+
+
+static bool eventLoop_Watch(int fd, uint32_t slot)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u32 = slot;
+    return (epoll_ctl(Epoll_Fd, EPOLL_CTL_ADD, fd, &event) == 0);
+}
+
+
+bool eventLoop_Init(unsigned period_ms, eventLoop_Callback timer, eventLoop_Callback wakeup)
+{
+    struct itimerspec period;
+    unsigned i;
+
+    eventLoop_Close();
+    LockTransactionInit(Sources_Lock);
+    for (i = 0; i < MAX_EVENT_LOOP_FDS; i++) {
+        Sources[i].fd = -1;
+    }
+    Loop_Stopping = false;
+    Timer_Period_ms = period_ms;
+    Timer_Callback = timer;
+    Wakeup_Callback = wakeup;
+
+    Epoll_Fd = epoll_create1(EPOLL_CLOEXEC);
+    Wakeup_Fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    Timer_Fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (Epoll_Fd < 0 || Wakeup_Fd < 0 || Timer_Fd < 0 ||
+        !eventLoop_Watch(Wakeup_Fd, EVENT_LOOP_WAKEUP) ||
+        !eventLoop_Watch(Timer_Fd, EVENT_LOOP_TIMER)) {
+        log_printf("Failed to set up the event loop, errno %d", errno);
+        eventLoop_Close();
+        return false;
+    }
+
+    if (period_ms != 0) {
+        period.it_interval.tv_sec = period_ms / 1000;
+        period.it_interval.tv_nsec = (long)(period_ms % 1000) * 1000000L;
+        period.it_value = period.it_interval;
+        if (timerfd_settime(Timer_Fd, 0, &period, NULL) != 0) {
+            log_printf("Failed to start the event loop timer, errno %d", errno);
+            eventLoop_Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void eventLoop_Timer_Within(unsigned due_ms)
+{
+    struct itimerspec timer;
+    unsigned long pending_ms;
+
+    if (Timer_Fd < 0 || timerfd_gettime(Timer_Fd, &timer) != 0) {
+        return;
+    }
+    pending_ms = (unsigned long) timer.it_value.tv_sec * 1000UL +
+        (unsigned long) (timer.it_value.tv_nsec / 1000000L);
+    // disarmed, with no period, is never
+    if ((timer.it_value.tv_sec != 0 || timer.it_value.tv_nsec != 0) && pending_ms <= due_ms) {
+        return;
+    }
+    if (due_ms == 0) {
+        // 0 would disarm it
+        due_ms = 1;
+    }
+    timer.it_interval.tv_sec = Timer_Period_ms / 1000;
+    timer.it_interval.tv_nsec = (long)(Timer_Period_ms % 1000) * 1000000L;
+    timer.it_value.tv_sec = due_ms / 1000;
+    timer.it_value.tv_nsec = (long)(due_ms % 1000) * 1000000L;
+    if (timerfd_settime(Timer_Fd, 0, &timer, NULL) != 0) {
+        log_printf("Failed to set the event loop timer, errno %d", errno);
+    }
+}
+
+
+bool eventLoop_Add(int fd, eventLoop_Handler handler, void *context)
+{
+    unsigned slot;
+    bool status = false;
+
+    if (fd < 0 || handler == NULL || Epoll_Fd < 0) {
+        return false;
+    }
+    LockTransaction(Sources_Lock);
+    for (slot = 0; slot < MAX_EVENT_LOOP_FDS; slot++) {
+        if (Sources[slot].fd < 0) {
+            break;
+        }
+    }
+    if (slot < MAX_EVENT_LOOP_FDS && eventLoop_Watch(fd, slot)) {
+        Sources[slot].fd = fd;
+        Sources[slot].handler = handler;
+        Sources[slot].context = context;
+        status = true;
+    }
+    UnlockTransaction(Sources_Lock);
+    return status;
+}
+
+
+void eventLoop_Remove(int fd)
+{
+    unsigned slot;
+
+    LockTransaction(Sources_Lock);
+    for (slot = 0; slot < MAX_EVENT_LOOP_FDS; slot++) {
+        if (Sources[slot].fd == fd) {
+            epoll_ctl(Epoll_Fd, EPOLL_CTL_DEL, fd, NULL);
+            Sources[slot].fd = -1;
+            break;
+        }
+    }
+    UnlockTransaction(Sources_Lock);
+}
+
+
+void eventLoop_Wakeup(void)
+{
+    uint64_t one = 1;
+
+    // only fails if the count would overflow, when a wakeup is pending anyway
+    if (write(Wakeup_Fd, &one, sizeof(one)) < 0) {
+        return;
+    }
+}
+
+
+int eventLoop_Fd(void)
+{
+    return Epoll_Fd;
+}
+
+
+int eventLoop_Run_Once(int timeout_ms)
+{
+    struct epoll_event events[MAX_EVENT_LOOP_FDS + 2];
+    EVENT_LOOP_SOURCE source;
+    uint64_t count;
+    int ready, i;
+
+    ready = epoll_wait(Epoll_Fd, events, MAX_EVENT_LOOP_FDS + 2, timeout_ms);
+    if (ready < 0) {
+        if (errno != EINTR) {
+            log_printf("Event loop wait failed, errno %d", errno);
+        }
+        return 0;
+    }
+    for (i = 0; i < ready; i++) {
+        switch (events[i].data.u32) {
+            case EVENT_LOOP_TIMER:
+                // the count of expirations, missed ones are not made up
+                if (read(Timer_Fd, &count, sizeof(count)) == sizeof(count) && Timer_Callback) {
+                    Timer_Callback();
+                }
+                break;
+            case EVENT_LOOP_WAKEUP:
+                if (read(Wakeup_Fd, &count, sizeof(count)) == sizeof(count) && Wakeup_Callback) {
+                    Wakeup_Callback();
+                }
+                break;
+            default:
+                // copied, the handler may remove itself or add another
+                LockTransaction(Sources_Lock);
+                source = Sources[events[i].data.u32];
+                UnlockTransaction(Sources_Lock);
+                if (source.fd >= 0) {
+                    source.handler(source.fd, source.context);
+                }
+                break;
+        }
+    }
+    return ready;
+}
+
+
+void eventLoop_Run(void)
+{
+    bool stopping = false;
+
+    while (!stopping) {
+        eventLoop_Run_Once(-1);
+        LockTransaction(Sources_Lock);
+        stopping = Loop_Stopping;
+        UnlockTransaction(Sources_Lock);
+    }
+    LockTransaction(Sources_Lock);
+    Loop_Stopping = false;
+    UnlockTransaction(Sources_Lock);
+}
+
+
+void eventLoop_Stop(void)
+{
+    LockTransaction(Sources_Lock);
+    Loop_Stopping = true;
+    UnlockTransaction(Sources_Lock);
+    eventLoop_Wakeup();
+}
+
+
+void eventLoop_Close(void)
+{
+    if (Timer_Fd >= 0) {
+        close(Timer_Fd);
+        Timer_Fd = -1;
+    }
+    if (Wakeup_Fd >= 0) {
+        close(Wakeup_Fd);
+        Wakeup_Fd = -1;
+    }
+    if (Epoll_Fd >= 0) {
+        close(Epoll_Fd);
+        Epoll_Fd = -1;
+    }
+}
+
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+#include <poll.h>
+#include <sched.h>
+#include "ctest.h"
+
+#ifdef TEST_EVENT_LOOP
+/* dummy function stubs */
+void log_printf(const char *fmt, ...)
+{
+    (void)fmt;
+}
+#endif
+
+static unsigned Test_Timers;
+static unsigned Test_Wakeups;
+static unsigned Test_Reads;
+
+static void testTimer(void)
+{
+    Test_Timers++;
+}
+
+static void testWakeup(void)
+{
+    Test_Wakeups++;
+}
+
+static void testRead(int fd, void *context)
+{
+    char c;
+
+    if (read(fd, &c, 1) == 1) {
+        Test_Reads++;
+    }
+    if (context != NULL) {
+        eventLoop_Stop();
+    }
+}
+
+static void testWaker(void *arg)
+{
+    unsigned i;
+
+    (void)arg;
+    for (i = 0; i < 100; i++) {
+        eventLoop_Wakeup();
+    }
+}
+
+
+void testEventLoop(
+    Test * pTest)
+{
+    struct pollfd pfd;
+    int pipes[2], spare[2];
+    unsigned i;
+
+    ct_test(pTest, eventLoop_Init(20, testTimer, testWakeup));
+    ct_test(pTest, pipe(pipes) == 0);
+    ct_test(pTest, eventLoop_Add(pipes[0], testRead, NULL));
+
+    // level triggered, one byte a time until there are none
+    ct_test(pTest, write(pipes[1], "abc", 3) == 3);
+    for (i = 0; i < 10 && Test_Reads < 3; i++) {
+        eventLoop_Run_Once(100);
+    }
+    ct_test(pTest, Test_Reads == 3);
+
+    // wakeups from elsewhere, folded together
+    bitsCreateThread(testWaker, NULL);
+    while (Test_Wakeups == 0) {
+        eventLoop_Run_Once(100);
+    }
+    ct_test(pTest, Test_Wakeups >= 1 && Test_Wakeups <= 100);
+
+    // the timer
+    while (Test_Timers < 3) {
+        eventLoop_Run_Once(-1);
+    }
+    ct_test(pTest, Test_Timers == 3);
+
+    // embedded in someone else's poll()
+    ct_test(pTest, write(pipes[1], "d", 1) == 1);
+    pfd.fd = eventLoop_Fd();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    ct_test(pTest, poll(&pfd, 1, 1000) == 1);
+    ct_test(pTest, (pfd.revents & POLLIN) != 0);
+    Test_Reads = 0;
+    eventLoop_Run_Once(0);
+    ct_test(pTest, Test_Reads == 1);
+
+    // stopped by a handler
+    eventLoop_Remove(pipes[0]);
+    ct_test(pTest, eventLoop_Add(pipes[0], testRead, pTest));
+    ct_test(pTest, write(pipes[1], "e", 1) == 1);
+    eventLoop_Run();
+    ct_test(pTest, Test_Reads == 2);
+
+    // gone once removed
+    eventLoop_Remove(pipes[0]);
+    ct_test(pTest, write(pipes[1], "f", 1) == 1);
+    eventLoop_Run_Once(0);
+    ct_test(pTest, Test_Reads == 2);
+
+    // no room
+    ct_test(pTest, pipe(spare) == 0);
+    for (i = 0; i < MAX_EVENT_LOOP_FDS; i++) {
+        ct_test(pTest, eventLoop_Add(dup(spare[0]), testRead, NULL));
+    }
+    ct_test(pTest, !eventLoop_Add(spare[0], testRead, NULL));
+    ct_test(pTest, !eventLoop_Add(-1, testRead, NULL));
+
+    eventLoop_Close();
+    ct_test(pTest, eventLoop_Fd() < 0);
+
+    // a long period, brought forward once, not put back
+    ct_test(pTest, eventLoop_Init(10000, testTimer, testWakeup));
+    Test_Timers = 0;
+    eventLoop_Timer_Within(20000);
+    eventLoop_Timer_Within(10);
+    eventLoop_Run_Once(1000);
+    ct_test(pTest, Test_Timers == 1);
+    eventLoop_Timer_Within(20000);
+    eventLoop_Run_Once(100);
+    ct_test(pTest, Test_Timers == 1);
+    eventLoop_Close();
+    close(pipes[0]);
+    close(pipes[1]);
+    close(spare[0]);
+    close(spare[1]);
+}
+
+
+// How long something that happens elsewhere (an application changing a value, a worker
+// finishing a request) waits for the stack's thread to notice, and how often that thread
+// wakes up while idle: eventfd and a 1 s timerfd, against BACnetIdle_Thread's 10 ms sleep.
+
+#define TEST_SAMPLES        100
+#define TEST_POLL_MS        10
+
+static LockDefine(Bench_Lock);
+static struct timespec Bench_Sent;
+static bool Bench_Flag;
+static double Bench_Total_Us;
+static unsigned Bench_Seen;
+
+static double testElapsedUs(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e6 + (end.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+static void testBenchSeen(void)
+{
+    LockTransaction(Bench_Lock);
+    if (Bench_Flag) {
+        Bench_Total_Us += testElapsedUs(&Bench_Sent);
+        Bench_Seen++;
+        Bench_Flag = false;
+    }
+    UnlockTransaction(Bench_Lock);
+}
+
+static void testBenchSignal(bool wakeup)
+{
+    LockTransaction(Bench_Lock);
+    clock_gettime(CLOCK_MONOTONIC, &Bench_Sent);
+    Bench_Flag = true;
+    UnlockTransaction(Bench_Lock);
+    if (wakeup) {
+        eventLoop_Wakeup();
+    }
+}
+
+static unsigned Bench_Timers;
+static bool Bench_Loop_Done;
+
+static void testBenchTimer(void)
+{
+    LockTransaction(Bench_Lock);
+    Bench_Timers++;
+    UnlockTransaction(Bench_Lock);
+}
+
+static void testBenchLoop(void *arg)
+{
+    (void)arg;
+    eventLoop_Run();
+    LockTransaction(Bench_Lock);
+    Bench_Loop_Done = true;
+    UnlockTransaction(Bench_Lock);
+}
+
+static bool Bench_Polling;
+static unsigned Bench_Poll_Wakeups;
+
+static void testBenchPoll(void *arg)
+{
+    bool polling = true;
+
+    (void)arg;
+    while (polling) {
+        testBenchSeen();
+        usleep(TEST_POLL_MS * 1000);
+        LockTransaction(Bench_Lock);
+        Bench_Poll_Wakeups++;
+        polling = Bench_Polling;
+        UnlockTransaction(Bench_Lock);
+    }
+}
+
+static void testBenchWait(unsigned seen)
+{
+    bool waiting = true;
+
+    while (waiting) {
+        usleep(1000);
+        LockTransaction(Bench_Lock);
+        waiting = (Bench_Seen < seen);
+        UnlockTransaction(Bench_Lock);
+    }
+}
+
+void testEventLoopBenchmark(
+    Test * pTest)
+{
+    FILE *stream = ct_getStream(pTest);
+    double loop_us, poll_us;
+    unsigned i, loop_wakeups, poll_wakeups;
+    bool running = true;
+
+    // the event loop on its own thread
+    ct_test(pTest, eventLoop_Init(1000, testBenchTimer, testBenchSeen));
+    bitsCreateThread(testBenchLoop, NULL);
+    for (i = 0; i < TEST_SAMPLES; i++) {
+        testBenchSignal(true);
+        testBenchWait(i + 1);
+    }
+    loop_us = Bench_Total_Us / Bench_Seen;
+    ct_test(pTest, Bench_Seen == TEST_SAMPLES);
+    LockTransaction(Bench_Lock);
+    Bench_Timers = 0;
+    UnlockTransaction(Bench_Lock);
+    usleep(1000 * 1000);
+    LockTransaction(Bench_Lock);
+    loop_wakeups = Bench_Timers;
+    UnlockTransaction(Bench_Lock);
+    eventLoop_Stop();
+    while (running) {
+        usleep(1000);
+        LockTransaction(Bench_Lock);
+        running = !Bench_Loop_Done;
+        UnlockTransaction(Bench_Lock);
+    }
+    eventLoop_Close();
+
+    // the sleep-poll
+    Bench_Total_Us = 0;
+    Bench_Seen = 0;
+    Bench_Polling = true;
+    bitsCreateThread(testBenchPoll, NULL);
+    for (i = 0; i < TEST_SAMPLES / 4; i++) {
+        usleep((i % TEST_POLL_MS) * 1000);
+        testBenchSignal(false);
+        testBenchWait(i + 1);
+    }
+    poll_us = Bench_Total_Us / Bench_Seen;
+    LockTransaction(Bench_Lock);
+    Bench_Poll_Wakeups = 0;
+    UnlockTransaction(Bench_Lock);
+    usleep(1000 * 1000);
+    LockTransaction(Bench_Lock);
+    Bench_Polling = false;
+    poll_wakeups = Bench_Poll_Wakeups;
+    UnlockTransaction(Bench_Lock);
+
+    fprintf(stream, "\n  %-22s %16s %18s\n", "", "latency (us)", "idle wakeups/s");
+    fprintf(stream, "  %-22s %16.1f %18u\n", "event loop", loop_us, loop_wakeups);
+    fprintf(stream, "  %-22s %16.1f %18u\n", "sleep-poll 10 ms", poll_us, poll_wakeups);
+    ct_test(pTest, loop_us < poll_us);
+    ct_test(pTest, loop_wakeups < poll_wakeups);
+}
+
+
+#ifdef TEST_EVENT_LOOP
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Event Loop", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testEventLoop);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testEventLoopBenchmark);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_EVENT_LOOP */
+#endif /* TEST */
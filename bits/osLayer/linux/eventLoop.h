@@ -0,0 +1,72 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include "config.h"
+
+// An epoll event loop for Linux. Sockets, a timerfd for periodic work and an eventfd that any
+// thread can use to wake it, all handled on whichever thread runs the loop, which sleeps until
+// one of them is ready.
+//
+// Run it on a thread of its own with eventLoop_Run(), or drive it from an application's own
+// loop: eventLoop_Fd() becomes readable when there is something to do, and
+// eventLoop_Run_Once(0) then does it.
+
+// Called on the loop's thread when fd is readable
+typedef void (*eventLoop_Handler)(int fd, void *context);
+typedef void (*eventLoop_Callback)(void);
+
+// Sets up the loop. timer is called every period_ms (none if 0), wakeup once for each run of
+// eventLoop_Wakeup() calls. False if the kernel refused any of the descriptors.
+bool eventLoop_Init(unsigned period_ms, eventLoop_Callback timer, eventLoop_Callback wakeup);
+
+// On the loop's thread: the next timer call comes within due_ms, sooner than the period would
+// have it, then every period_ms again. For work that is due between the periodic calls.
+void eventLoop_Timer_Within(unsigned due_ms);
+
+// Watches fd, one of MAX_EVENT_LOOP_FDS. False if there is no room or fd is no good.
+bool eventLoop_Add(int fd, eventLoop_Handler handler, void *context);
+void eventLoop_Remove(int fd);
+
+// From any thread. Wakeups that come in before the loop gets to them are folded into one.
+void eventLoop_Wakeup(void);
+
+// The epoll descriptor, for an application's own poll() or epoll
+int  eventLoop_Fd(void);
+
+// Waits up to timeout_ms (-1 for as long as it takes) and handles what is ready.
+// Returns the number of events handled.
+int  eventLoop_Run_Once(int timeout_ms);
+
+// Handles events until eventLoop_Stop(), which may be called from any thread or a handler
+void eventLoop_Run(void);
+void eventLoop_Stop(void);
+
+// Closes the loop's descriptors, not the ones that were added
+void eventLoop_Close(void);
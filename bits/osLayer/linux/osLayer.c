@@ -52,6 +52,16 @@ void bitsCreateThread( void (*threadFunc) (void *arg), void *argListPtr)
     pthread_detach(threadvar);
 }
 
+void bitsRecursiveLockInit(pthread_mutex_t *mutex)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
 
 static struct termios g_old_kbd_mode;
 
@@ -32,6 +32,7 @@
 #include <stdio.h>
 
 #include <pthread.h>
+#include <semaphore.h>
 
 typedef unsigned uint;
 
@@ -54,10 +55,35 @@ void bitsCreateThread(void(*threadFunc)(void *arg), void *argListPtr);
 #define LockTransaction(mutexName) 			pthread_mutex_lock( &mutexName )
 #define UnlockTransaction(mutexName) 		pthread_mutex_unlock( &mutexName )
 
-void *bitsCreateThread(
-    bitsThreadVar threadId, 
-    void *(*threadFunc)(void *arg),
-	void *argListPtr);
+// Same semantics as the Windows and embOS versions, a plain mutex (the sem_t version in bacTarget.h starts locked)
+#ifndef SemaDefine
+#define SemaDefine(a)   pthread_mutex_t a = PTHREAD_MUTEX_INITIALIZER
+#define SemaInit(a)
+#define SemaWait(a)     pthread_mutex_lock( &a )
+#define SemaFree(a)     pthread_mutex_unlock( &a );
+#endif
+
+// Reader/writer locks, for read-mostly structures such as the object lists
+#define RwLockDefine(a)     pthread_rwlock_t a
+#define RwLockInit(a)       pthread_rwlock_init( &a, NULL )
+#define RwLockRead(a)       pthread_rwlock_rdlock( &a )
+#define RwLockWrite(a)      pthread_rwlock_wrlock( &a )
+#define RwUnlockRead(a)     pthread_rwlock_unlock( &a )
+#define RwUnlockWrite(a)    pthread_rwlock_unlock( &a )
+
+// Recursive locks, the owning thread may take them again (as Windows mutexes and embOS resource semaphores always allow)
+#define RecursiveLockDefine(a)  pthread_mutex_t a
+#define RecursiveLockInit(a)    bitsRecursiveLockInit( &a )
+#define RecursiveLock(a)        pthread_mutex_lock( &a )
+#define RecursiveUnlock(a)      pthread_mutex_unlock( &a )
+
+void bitsRecursiveLockInit(pthread_mutex_t *mutex);
+
+// Counting semaphores, for handing work from one thread to others
+#define CountSemaDefine(a)      sem_t a
+#define CountSemaInit(a,count)  sem_init( &a, 0, count )
+#define CountSemaWait(a)        sem_wait( &a )
+#define CountSemaPost(a)        sem_post( &a )
 
 bool read_config(char *filepath) ;
 bool parse_cmd(int argc, char *argv[]) ;
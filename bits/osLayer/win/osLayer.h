@@ -62,6 +62,26 @@ typedef HANDLE bits_mutex_t ;
 #define SemaWait(a)     WaitForSingleObject(a, INFINITE)
 #define SemaFree(a)     ReleaseMutex(a);
 
+// Reader/writer locks, for read-mostly structures such as the object lists (slim, in-process, no thread affinity)
+#define RwLockDefine(a)     SRWLOCK a
+#define RwLockInit(a)       InitializeSRWLock( &a )
+#define RwLockRead(a)       AcquireSRWLockShared( &a )
+#define RwLockWrite(a)      AcquireSRWLockExclusive( &a )
+#define RwUnlockRead(a)     ReleaseSRWLockShared( &a )
+#define RwUnlockWrite(a)    ReleaseSRWLockExclusive( &a )
+
+// Recursive locks, a Windows mutex may always be taken again by the thread that owns it
+#define RecursiveLockDefine(a)  HANDLE a
+#define RecursiveLockInit(a)    a = CreateMutex(NULL, FALSE, NULL)
+#define RecursiveLock(a)        WaitForSingleObject(a, INFINITE)
+#define RecursiveUnlock(a)      ReleaseMutex(a)
+
+// Counting semaphores, for handing work from one thread to others
+#define CountSemaDefine(a)      HANDLE a
+#define CountSemaInit(a,count)  a = CreateSemaphore(NULL, count, 0x7fffffff, NULL)
+#define CountSemaWait(a)        WaitForSingleObject(a, INFINITE)
+#define CountSemaPost(a)        ReleaseSemaphore(a, 1, NULL)
+
 // Note, the convoluted * defeferencing is to allow the calls to closely match the linux mutex locks... keep it that way
 #define bits_mutex_init(mutexName)        *mutexName = CreateMutex(NULL, FALSE, NULL)
 #define bits_mutex_lock(mutexName)        sys_bits_mutex_lock( mutexName, INFINITE )
@@ -26,22 +26,50 @@
 ****************************************************************************************/
 
 #include <stdint.h>
+#include <stdlib.h>
+#include "config.h"
 #include "bacstr.h"
 #include "BACnetObject.h"
+#include "propertyCache.h"
 #include "debug.h"
 #include "bitsDebug.h"
 #include "llist.h"
 
+static uint32_t Generic_Object_Key(
+    void *listitem)
+{
+    return ((BACNET_OBJECT *)listitem)->objectInstance;
+}
+
+
+bool Generic_Object_List_Init(
+    LLIST_HDR *objectHdr,
+    const uint max)
+{
+    return ll_InitIndexed(objectHdr, max, Generic_Object_Key);
+}
+
+
 BACNET_OBJECT *Generic_Instance_To_Object(
     LLIST_HDR *objectHdr,
     const uint32_t objectInstance)
 {
-    BACNET_OBJECT *bacnetObject = (BACNET_OBJECT *) objectHdr->first;
-    while (bacnetObject != NULL) {
-        if (bacnetObject->objectInstance == objectInstance) return bacnetObject;
-        bacnetObject = (BACNET_OBJECT *)bacnetObject->llist.next;
+    BACNET_OBJECT *bacnetObject;
+
+    if (objectHdr->index != NULL) {
+        bacnetObject = (BACNET_OBJECT *)ll_Find(objectHdr, objectInstance);
+    }
+    else {
+        // list set up with plain ll_Init(), walk it
+        bacnetObject = (BACNET_OBJECT *)objectHdr->first;
+        while (bacnetObject != NULL) {
+            if (bacnetObject->objectInstance == objectInstance) break;
+            bacnetObject = (BACNET_OBJECT *)bacnetObject->llist.next;
+        }
+    }
+    if (bacnetObject == NULL) {
+        dbTraffic(DBD_ALL, DB_BTC_ERROR, "Illegal Instance, %d", objectInstance);
     }
-    dbTraffic(DBD_ALL, DB_BTC_ERROR, "Illegal Instance, %d", objectInstance );
     return bacnetObject;
 }
 
@@ -54,17 +82,203 @@ bool Generic_Instance_To_Object_Name(
     BACNET_OBJECT *bacnetObject = Generic_Instance_To_Object(objectHdr, objectInstance);
     if (bacnetObject == NULL) return false;
     
-    return characterstring_copy(object_name, &bacnetObject->objectName);
+    return sp_ToCharacterString(bacnetObject->objectName, object_name);
+}
+
+
+// Device wide object name -> object index, so Who-Has and the Object_Name uniqueness check
+// do not have to fetch and compare the name of every object in the device.
+// Names are interned (stringPool.h), so an entry is keyed on the name handle and a lookup
+// is one sp_Lookup() plus handle compares. Objects with an empty name are not entered.
+// Open addressing, linear probing, at most half full, the same scheme as the llist instance
+// index. Duplicate names are tolerated (a configuration error, but not ours to refuse here),
+// a lookup returns the first match. calloc() rather than emm, it has to grow past the emm
+// block limit.
+
+static BACNET_OBJECT **Name_Slots;
+static uint Name_Size;      // number of slots, always a power of two
+static uint Name_Count;
+static uint8_t Name_Types[MAX_BACNET_OBJECT_TYPE / 8];
+
+
+static bool Generic_Object_Name_Grow(
+    void)
+{
+    BACNET_OBJECT **oldSlots = Name_Slots;
+    uint oldSize = Name_Size;
+    uint newSize = (oldSize) ? oldSize * 2 : 64;
+    uint mask = newSize - 1;
+    uint i, slot;
+
+    Name_Slots = (BACNET_OBJECT **)calloc(newSize, sizeof(BACNET_OBJECT *));
+    if (Name_Slots == NULL) {
+        Name_Slots = oldSlots;
+        return false;
+    }
+    Name_Size = newSize;
+    for (i = 0; i < oldSize; i++) {
+        if (oldSlots[i] != NULL) {
+            slot = sp_Hash(oldSlots[i]->objectName) & mask;
+            while (Name_Slots[slot] != NULL) {
+                slot = (slot + 1) & mask;
+            }
+            Name_Slots[slot] = oldSlots[i];
+        }
+    }
+    free(oldSlots);
+    return true;
+}
+
+
+static void Generic_Object_Name_Add(
+    BACNET_OBJECT *bacnetObject)
+{
+    uint mask, slot;
+
+    if ((unsigned)bacnetObject->objectType < MAX_BACNET_OBJECT_TYPE) {
+        Name_Types[bacnetObject->objectType / 8] |= (uint8_t)(1 << (bacnetObject->objectType % 8));
+    }
+    if (bacnetObject->objectName == NULL) {
+        return;
+    }
+    if ((Name_Count + 1) * 2 > Name_Size) {
+        if (!Generic_Object_Name_Grow()) {
+            panic();
+            return;
+        }
+    }
+    mask = Name_Size - 1;
+    slot = sp_Hash(bacnetObject->objectName) & mask;
+    while (Name_Slots[slot] != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    Name_Slots[slot] = bacnetObject;
+    Name_Count++;
+}
+
+
+static void Generic_Object_Name_Unindex(
+    BACNET_OBJECT *bacnetObject)
+{
+    uint mask, slot, next;
+
+    if (Name_Size == 0 || bacnetObject->objectName == NULL) {
+        return;
+    }
+    mask = Name_Size - 1;
+    slot = sp_Hash(bacnetObject->objectName) & mask;
+    while (Name_Slots[slot] != bacnetObject) {
+        if (Name_Slots[slot] == NULL) {
+            // not indexed
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    Name_Slots[slot] = NULL;
+    Name_Count--;
+
+    // backward shift deletion, so lookups never need tombstones
+    next = (slot + 1) & mask;
+    while (Name_Slots[next] != NULL) {
+        uint home = sp_Hash(Name_Slots[next]->objectName) & mask;
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            Name_Slots[slot] = Name_Slots[next];
+            Name_Slots[next] = NULL;
+            slot = next;
+        }
+        next = (next + 1) & mask;
+    }
+}
+
+
+// Also when the object is renamed, or deleted: what was cached for it is out of date
+void Generic_Object_Name_Remove(
+    BACNET_OBJECT *bacnetObject)
+{
+    Generic_Object_Name_Unindex(bacnetObject);
+    sp_Release(bacnetObject->objectName);
+    bacnetObject->objectName = NULL;
+#if (BACNET_PROPERTY_CACHE == 1)
+    pc_InvalidateObject(bacnetObject->objectType, bacnetObject->objectInstance);
+#endif
+}
+
+
+bool Generic_Object_Name_Find(
+    BACNET_CHARACTER_STRING *objectName,
+    BACNET_OBJECT_TYPE *objectType,
+    uint32_t *objectInstance)
+{
+    SP_HANDLE handle;
+    uint mask, slot;
+
+    if (Name_Count == 0) {
+        return false;
+    }
+    // a name nobody has interned cannot belong to an object
+    handle = sp_Lookup(objectName);
+    if (handle == NULL) {
+        return false;
+    }
+    mask = Name_Size - 1;
+    for (slot = sp_Hash(handle) & mask; Name_Slots[slot] != NULL; slot = (slot + 1) & mask) {
+        if (Name_Slots[slot]->objectName == handle) {
+            if (objectType) {
+                *objectType = Name_Slots[slot]->objectType;
+            }
+            if (objectInstance) {
+                *objectInstance = Name_Slots[slot]->objectInstance;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool Generic_Object_Name_Type_Indexed(
+    const BACNET_OBJECT_TYPE objectType)
+{
+    if ((unsigned)objectType >= MAX_BACNET_OBJECT_TYPE) {
+        return false;
+    }
+    return (Name_Types[objectType / 8] & (1 << (objectType % 8))) != 0;
 }
 
 
 void Generic_Object_Init(
     BACNET_OBJECT       *bacnetObject,
+    const   BACNET_OBJECT_TYPE objectType,
     const   uint32_t    objectInstance,
     const   char        *objectName)
 {
+    bacnetObject->objectType = objectType;
     bacnetObject->objectInstance = objectInstance;
-    characterstring_init_ansi(&bacnetObject->objectName, objectName);
+    if (!sp_InternAnsi(&bacnetObject->objectName, objectName)) {
+        // too long, or out of memory
+        panic();
+    }
+    Generic_Object_Name_Add(bacnetObject);
+#if (BACNET_PROPERTY_CACHE == 1)
+    // an object deleted and created again with the same identifier starts afresh
+    pc_InvalidateObject(objectType, objectInstance);
+#endif
+}
+
+
+bool Generic_Object_Set_Name(
+    BACNET_OBJECT *bacnetObject,
+    BACNET_CHARACTER_STRING *objectName)
+{
+    SP_HANDLE handle;
+
+    if (!sp_InternCharacterString(&handle, objectName)) {
+        return false;
+    }
+    Generic_Object_Name_Remove(bacnetObject);
+    bacnetObject->objectName = handle;
+    Generic_Object_Name_Add(bacnetObject);
+    return true;
 }
 
 
@@ -72,6 +286,13 @@ uint32_t Generic_Index_To_Instance(
     LLIST_HDR *objectHdr,
     uint32_t objectIndex )
 {
+    if (objectHdr->index != NULL) {
+        // O(1), ll_GetPtr() panics if out of range
+        BACNET_OBJECT *indexedObject = (BACNET_OBJECT *)ll_GetPtr(objectHdr, objectIndex);
+        if (indexedObject == NULL) return objectHdr->count;
+        return indexedObject->objectInstance;
+    }
+
     unsigned count = 0;
     BACNET_OBJECT *bacnetObject = (BACNET_OBJECT *)objectHdr->first;
     while (bacnetObject != NULL) {
@@ -92,3 +313,593 @@ BACNET_OBJECT *Generic_Index_To_Object(
 }
 
 
+#ifdef TEST
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "ctest.h"
+
+#ifdef TEST_BACNET_OBJECT
+/* dummy function stubs */
+void sys_panic(const char *file, const int line)
+{
+    (void)file;
+    (void)line;
+}
+
+void sys_dbTraffic(DBD_DebugDomain domain, DB_LEVEL lev, const char *format, ...)
+{
+    (void)domain;
+    (void)lev;
+    (void)format;
+}
+#endif
+
+
+static bool testMatchObject(void *listitem, void *matchitem)
+{
+    return listitem == matchitem;
+}
+
+
+// sparse, non-sequential instances, like a real gateway configuration
+static uint32_t testInstance(unsigned i)
+{
+    return i * 7919u + 3u;
+}
+
+
+static BACNET_OBJECT *testCreateObjects(LLIST_HDR *hdr, unsigned count, bool indexed)
+{
+    BACNET_OBJECT *objects = (BACNET_OBJECT *)calloc(count, sizeof(BACNET_OBJECT));
+    unsigned i;
+
+    if (indexed) {
+        Generic_Object_List_Init(hdr, count);
+    }
+    else {
+        ll_Init(hdr, count);
+    }
+    for (i = 0; i < count; i++) {
+        char name[32];
+        sprintf(name, "Test Object %u", i);
+        Generic_Object_Init(&objects[i], OBJECT_ANALOG_VALUE, testInstance(i), name);
+        ll_Enqueue(hdr, &objects[i]);
+    }
+    return objects;
+}
+
+
+static void testDestroyObjects(LLIST_HDR *hdr, BACNET_OBJECT *objects, unsigned count)
+{
+    unsigned i;
+
+    for (i = 0; i < count; i++) {
+        Generic_Object_Name_Remove(&objects[i]);
+    }
+    if (hdr->index != NULL) {
+        free(hdr->index->slots);
+        free(hdr->index->items);
+        free(hdr->index);
+    }
+    free(objects);
+}
+
+
+void testInstanceIndex(
+    Test * pTest)
+{
+    LLIST_HDR hdr;
+    BACNET_OBJECT extra;
+    BACNET_OBJECT *objects;
+    BACNET_CHARACTER_STRING name;
+    unsigned count = 1000;
+    unsigned i;
+
+    objects = testCreateObjects(&hdr, count, true);
+    ct_test(pTest, hdr.count == count);
+
+    for (i = 0; i < count; i++) {
+        ct_test(pTest, Generic_Instance_To_Object(&hdr, testInstance(i)) == &objects[i]);
+    }
+    ct_test(pTest, Generic_Instance_To_Object(&hdr, 1) == NULL);
+    ct_test(pTest, Generic_Instance_To_Object_Name(&hdr, testInstance(5), &name));
+    ct_test(pTest, !Generic_Instance_To_Object_Name(&hdr, 1, &name));
+
+    // duplicate instances are refused
+    hdr.max = count + 1;
+    Generic_Object_Init(&extra, OBJECT_ANALOG_VALUE, testInstance(10), "Duplicate");
+    ct_test(pTest, !ll_Enqueue(&hdr, &extra));
+    ct_test(pTest, hdr.count == count);
+    Generic_Object_Name_Remove(&extra);
+
+    // pluck every third object, the rest must still be found (exercises the backward shift)
+    for (i = 0; i < count; i += 3) {
+        ct_test(pTest, ll_Pluck(&hdr, &objects[i], testMatchObject) == &objects[i]);
+    }
+    for (i = 0; i < count; i++) {
+        if (i % 3 == 0) {
+            ct_test(pTest, Generic_Instance_To_Object(&hdr, testInstance(i)) == NULL);
+        }
+        else {
+            ct_test(pTest, Generic_Instance_To_Object(&hdr, testInstance(i)) == &objects[i]);
+        }
+    }
+
+    // the removed instance is available again, and the tail of the list is still intact
+    ct_test(pTest, ll_Enqueue(&hdr, &objects[0]));
+    ct_test(pTest, Generic_Instance_To_Object(&hdr, testInstance(0)) == &objects[0]);
+    ct_test(pTest, hdr.last == &objects[0].llist);
+
+    // dequeue drops the index entry too
+    while (hdr.count) {
+        BACNET_OBJECT *obj = (BACNET_OBJECT *)ll_Dequeue(&hdr);
+        ct_test(pTest, Generic_Instance_To_Object(&hdr, obj->objectInstance) == NULL);
+    }
+
+    testDestroyObjects(&hdr, objects, count);
+}
+
+
+void testIndexToInstance(
+    Test * pTest)
+{
+    LLIST_HDR hdr;
+    BACNET_OBJECT *objects;
+    unsigned count = 100;
+    unsigned i, expect;
+
+    objects = testCreateObjects(&hdr, count, true);
+    for (i = 0; i < count; i++) {
+        ct_test(pTest, Generic_Index_To_Instance(&hdr, i) == testInstance(i));
+        ct_test(pTest, Generic_Index_To_Object(&hdr, i) == &objects[i]);
+    }
+
+    // removing from the middle keeps the remaining objects in creation order
+    ct_test(pTest, ll_Pluck(&hdr, &objects[50], testMatchObject) == &objects[50]);
+    ct_test(pTest, ll_Dequeue(&hdr) == &objects[0]);
+    ct_test(pTest, hdr.count == count - 2);
+    for (i = 0, expect = 1; i < hdr.count; i++, expect++) {
+        if (expect == 50) expect++;
+        ct_test(pTest, Generic_Index_To_Instance(&hdr, i) == testInstance(expect));
+    }
+
+    // and new ones go on the end
+    ct_test(pTest, ll_Enqueue(&hdr, &objects[50]));
+    ct_test(pTest, Generic_Index_To_Instance(&hdr, hdr.count - 1) == testInstance(50));
+
+    testDestroyObjects(&hdr, objects, count);
+}
+
+
+static double testEnumerateNs(LLIST_HDR *hdr, unsigned count, bool *inOrder)
+{
+    struct timespec start, end;
+    unsigned i;
+
+    *inOrder = true;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < count; i++) {
+        if (Generic_Index_To_Instance(hdr, i) != testInstance(i)) {
+            *inOrder = false;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / count;
+}
+
+
+// Cost per object of walking a whole object list by index, as Device_Object_List_Identifier() does
+void testEnumerateBenchmark(
+    Test * pTest)
+{
+    LLIST_HDR hdr;
+    BACNET_OBJECT *objects;
+    FILE *stream = ct_getStream(pTest);
+    unsigned count;
+    bool inOrder;
+    double ns;
+
+    fprintf(stream, "\n  %8s %18s %18s\n", "objects", "indexed ns/object", "list walk ns/object");
+    for (count = 10; count <= 100000; count *= 10) {
+        objects = testCreateObjects(&hdr, count, true);
+        ns = testEnumerateNs(&hdr, count, &inOrder);
+        ct_test(pTest, inOrder);
+        testDestroyObjects(&hdr, objects, count);
+        fprintf(stream, "  %8u %18.1f", count, ns);
+
+        // quadratic, stop at 10k
+        if (count <= 10000) {
+            objects = testCreateObjects(&hdr, count, false);
+            ns = testEnumerateNs(&hdr, count, &inOrder);
+            ct_test(pTest, inOrder);
+            testDestroyObjects(&hdr, objects, count);
+            fprintf(stream, " %18.1f", ns);
+        }
+        fprintf(stream, "\n");
+    }
+}
+
+
+void testNameIndex(
+    Test * pTest)
+{
+    LLIST_HDR hdr;
+    BACNET_OBJECT *objects;
+    BACNET_OBJECT twin;
+    BACNET_CHARACTER_STRING name;
+    BACNET_OBJECT_TYPE type;
+    uint32_t instance;
+    unsigned count = 1000;
+    unsigned i;
+
+    objects = testCreateObjects(&hdr, count, true);
+    ct_test(pTest, Generic_Object_Name_Type_Indexed(OBJECT_ANALOG_VALUE));
+    ct_test(pTest, !Generic_Object_Name_Type_Indexed(OBJECT_DEVICE));
+
+    for (i = 0; i < count; i++) {
+        char text[32];
+        sprintf(text, "Test Object %u", i);
+        characterstring_init_ansi(&name, text);
+        ct_test(pTest, Generic_Object_Name_Find(&name, &type, &instance));
+        ct_test(pTest, type == OBJECT_ANALOG_VALUE);
+        ct_test(pTest, instance == testInstance(i));
+    }
+    characterstring_init_ansi(&name, "No Such Object");
+    ct_test(pTest, !Generic_Object_Name_Find(&name, NULL, NULL));
+    // names are case sensitive
+    characterstring_init_ansi(&name, "test object 1");
+    ct_test(pTest, !Generic_Object_Name_Find(&name, NULL, NULL));
+
+    // renaming moves the entry, the old name is free again
+    characterstring_init_ansi(&name, "Renamed");
+    ct_test(pTest, Generic_Object_Set_Name(&objects[7], &name));
+    ct_test(pTest, Generic_Object_Name_Find(&name, NULL, &instance));
+    ct_test(pTest, instance == testInstance(7));
+    characterstring_init_ansi(&name, "Test Object 7");
+    ct_test(pTest, !Generic_Object_Name_Find(&name, NULL, NULL));
+
+    // a duplicate name is still found once the first holder goes (exercises the backward shift)
+    Generic_Object_Init(&twin, OBJECT_BINARY_VALUE, 5, "Test Object 8");
+    ct_test(pTest, Generic_Object_Name_Type_Indexed(OBJECT_BINARY_VALUE));
+    Generic_Object_Name_Remove(&objects[8]);
+    characterstring_init_ansi(&name, "Test Object 8");
+    ct_test(pTest, Generic_Object_Name_Find(&name, &type, &instance));
+    ct_test(pTest, type == OBJECT_BINARY_VALUE && instance == 5);
+    Generic_Object_Name_Remove(&twin);
+    ct_test(pTest, !Generic_Object_Name_Find(&name, NULL, NULL));
+
+    // removing every other object leaves the rest reachable
+    for (i = 0; i < count; i += 2) {
+        Generic_Object_Name_Remove(&objects[i]);
+    }
+    for (i = 1; i < count; i += 2) {
+        sp_ToCharacterString(objects[i].objectName, &name);
+        ct_test(pTest, Generic_Object_Name_Find(&name, NULL, &instance));
+        ct_test(pTest, instance == testInstance(i));
+    }
+
+    // and every name goes back to the pool
+    testDestroyObjects(&hdr, objects, count);
+    sp_Stats(&i, NULL);
+    ct_test(pTest, i == 0);
+}
+
+
+#if (BACNET_PROPERTY_CACHE == 1)
+// Stores, or looks for, a cached Object_Name as Device_Read_Property() does
+static bool testNameCached(BACNET_OBJECT *bacnetObject, bool store)
+{
+    static uint8_t encoded[] = { 0x75, 0x03, 0x00, 'O', 'K' };
+    uint8_t apdu[sizeof(encoded)];
+    BACNET_READ_PROPERTY_DATA rpdata;
+    int len;
+
+    rpdata.object_type = bacnetObject->objectType;
+    rpdata.object_instance = bacnetObject->objectInstance;
+    rpdata.object_property = PROP_OBJECT_NAME;
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    if (store) {
+        rpdata.application_data = encoded;
+        rpdata.application_data_len = sizeof(encoded);
+        pc_Store(&rpdata, sizeof(encoded));
+        return true;
+    }
+    rpdata.application_data = apdu;
+    rpdata.application_data_len = sizeof(apdu);
+    return pc_Read(&rpdata, &len);
+}
+
+
+void testNameCache(
+    Test * pTest)
+{
+    BACNET_OBJECT bacnetObject;
+    BACNET_CHARACTER_STRING name;
+
+    pc_Init();
+    Generic_Object_Init(&bacnetObject, OBJECT_ANALOG_VALUE, 42, "Cached");
+    testNameCached(&bacnetObject, true);
+    ct_test(pTest, testNameCached(&bacnetObject, false));
+
+    // renamed
+    characterstring_init_ansi(&name, "Renamed");
+    ct_test(pTest, Generic_Object_Set_Name(&bacnetObject, &name));
+    ct_test(pTest, !testNameCached(&bacnetObject, false));
+
+    // deleted
+    testNameCached(&bacnetObject, true);
+    Generic_Object_Name_Remove(&bacnetObject);
+    ct_test(pTest, !testNameCached(&bacnetObject, false));
+
+    // created again with the same identifier, over what an older one left behind
+    testNameCached(&bacnetObject, true);
+    Generic_Object_Init(&bacnetObject, OBJECT_ANALOG_VALUE, 42, "Cached Again");
+    ct_test(pTest, !testNameCached(&bacnetObject, false));
+    Generic_Object_Name_Remove(&bacnetObject);
+}
+#endif
+
+
+// what Device_Valid_Object_Name() used to do, copy and compare every name
+static bool testNameScan(LLIST_HDR *hdr, BACNET_CHARACTER_STRING *name)
+{
+    BACNET_CHARACTER_STRING copy;
+    unsigned i;
+
+    for (i = 0; i < hdr->count; i++) {
+        BACNET_OBJECT *bacnetObject = Generic_Index_To_Object(hdr, i);
+        sp_ToCharacterString(bacnetObject->objectName, &copy);
+        if (characterstring_same(name, &copy)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Cost of a Who-Has by name, index vs. scan, for a hit and a miss
+void testNameLookupBenchmark(
+    Test * pTest)
+{
+    LLIST_HDR hdr;
+    BACNET_OBJECT *objects;
+    BACNET_CHARACTER_STRING hit, miss;
+    FILE *stream = ct_getStream(pTest);
+    struct timespec start, end;
+    unsigned count, lookups, i;
+    bool found;
+    double indexNs, scanNs;
+
+    characterstring_init_ansi(&miss, "No Such Object");
+    fprintf(stream, "\n  %8s %14s %14s %14s %14s\n", "objects", "index hit ns", "index miss ns", "scan hit ns", "scan miss ns");
+    for (count = 10; count <= 100000; count *= 10) {
+        char text[32];
+        objects = testCreateObjects(&hdr, count, true);
+        sprintf(text, "Test Object %u", count / 2);
+        characterstring_init_ansi(&hit, text);
+        fprintf(stream, "  %8u", count);
+
+        lookups = 1000000;
+        found = true;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < lookups; i++) {
+            found &= Generic_Object_Name_Find(&hit, NULL, NULL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ct_test(pTest, found);
+        indexNs = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / lookups;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < lookups; i++) {
+            found |= Generic_Object_Name_Find(&miss, NULL, NULL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ct_test(pTest, found);
+        fprintf(stream, " %14.1f %14.1f", indexNs,
+            ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / lookups);
+
+        // the scan is O(n), keep the run time sensible
+        lookups = 10000000 / (count * 10);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < lookups; i++) {
+            found &= testNameScan(&hdr, &hit);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ct_test(pTest, found);
+        scanNs = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / lookups;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < lookups; i++) {
+            found |= testNameScan(&hdr, &miss);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        fprintf(stream, " %14.1f %14.1f\n", scanNs,
+            ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / lookups);
+
+        testDestroyObjects(&hdr, objects, count);
+    }
+}
+
+
+static double testLookupNs(LLIST_HDR *hdr, unsigned count, unsigned lookups, bool *allFound)
+{
+    struct timespec start, end;
+    unsigned i;
+
+    *allFound = true;
+    srand(count);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < lookups; i++) {
+        if (Generic_Instance_To_Object(hdr, testInstance((unsigned)rand() % count)) == NULL) {
+            *allFound = false;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / lookups;
+}
+
+
+// Lookup cost, indexed vs. the plain list walk, from 10 to 100k objects per type
+void testInstanceLookupBenchmark(
+    Test * pTest)
+{
+    LLIST_HDR hdr;
+    BACNET_OBJECT *objects;
+    FILE *stream = ct_getStream(pTest);
+    unsigned count;
+    bool allFound;
+    double ns;
+
+    fprintf(stream, "\n  %8s %14s %14s\n", "objects", "indexed ns", "list walk ns");
+    for (count = 10; count <= 100000; count *= 10) {
+        objects = testCreateObjects(&hdr, count, true);
+        ns = testLookupNs(&hdr, count, 1000000, &allFound);
+        ct_test(pTest, allFound);
+        testDestroyObjects(&hdr, objects, count);
+        fprintf(stream, "  %8u %14.1f", count, ns);
+
+        // the walk is O(n), keep the run time sensible
+        objects = testCreateObjects(&hdr, count, false);
+        ns = testLookupNs(&hdr, count, 100000000 / (count * 10), &allFound);
+        ct_test(pTest, allFound);
+        testDestroyObjects(&hdr, objects, count);
+        fprintf(stream, " %14.1f\n", ns);
+    }
+}
+
+
+#define TEST_READ_THREADS_MAX    8
+#define TEST_READ_OBJECTS       10000
+#define TEST_READ_LOOKUPS       2000000
+
+typedef struct
+{
+    LLIST_HDR       *hdr;
+    pthread_mutex_t *globalMutex;       // non NULL to serialize every read, as the old global llistMutex did
+    unsigned        seed;
+    bool            allFound;
+} TEST_READER;
+
+
+static void *testReader(void *arg)
+{
+    TEST_READER *reader = (TEST_READER *)arg;
+    unsigned seed = reader->seed;
+    unsigned i;
+
+    reader->allFound = true;
+    for (i = 0; i < TEST_READ_LOOKUPS; i++) {
+        BACNET_OBJECT *bacnetObject;
+        seed = seed * 1103515245u + 12345u;
+        if (reader->globalMutex) pthread_mutex_lock(reader->globalMutex);
+        bacnetObject = Generic_Instance_To_Object(reader->hdr, testInstance((seed >> 8) % TEST_READ_OBJECTS));
+        if (reader->globalMutex) pthread_mutex_unlock(reader->globalMutex);
+        if (bacnetObject == NULL) {
+            reader->allFound = false;
+        }
+    }
+    return NULL;
+}
+
+
+// Millions of lookups per second across all threads. Each thread reads its own list
+// (one object type each) or all threads read the same list.
+static double testReadRate(LLIST_HDR *hdrs, unsigned threads, bool sharedList, pthread_mutex_t *globalMutex, bool *allFound)
+{
+    pthread_t tid[TEST_READ_THREADS_MAX];
+    TEST_READER readers[TEST_READ_THREADS_MAX];
+    struct timespec start, end;
+    unsigned t;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (t = 0; t < threads; t++) {
+        readers[t].hdr = (sharedList) ? &hdrs[0] : &hdrs[t];
+        readers[t].globalMutex = globalMutex;
+        readers[t].seed = t + 1;
+        pthread_create(&tid[t], NULL, testReader, &readers[t]);
+    }
+    *allFound = true;
+    for (t = 0; t < threads; t++) {
+        pthread_join(tid[t], NULL);
+        *allFound &= readers[t].allFound;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // lookups per microsecond
+    return (threads * (double)TEST_READ_LOOKUPS) /
+        ((end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3);
+}
+
+
+// Concurrent readers, per list reader/writer locks vs. one process wide mutex
+void testConcurrentReadBenchmark(
+    Test * pTest)
+{
+    LLIST_HDR hdrs[TEST_READ_THREADS_MAX];
+    BACNET_OBJECT *objects[TEST_READ_THREADS_MAX];
+    pthread_mutex_t globalMutex = PTHREAD_MUTEX_INITIALIZER;
+    FILE *stream = ct_getStream(pTest);
+    unsigned threads, t;
+    bool allFound;
+
+    for (t = 0; t < TEST_READ_THREADS_MAX; t++) {
+        objects[t] = testCreateObjects(&hdrs[t], TEST_READ_OBJECTS, true);
+    }
+
+    fprintf(stream, "\n  Mlookups/s, %u objects per list\n", TEST_READ_OBJECTS);
+    fprintf(stream, "  %8s %14s %14s %14s\n", "threads", "list per type", "shared list", "global mutex");
+    for (threads = 1; threads <= TEST_READ_THREADS_MAX; threads *= 2) {
+        fprintf(stream, "  %8u", threads);
+        fprintf(stream, " %14.1f", testReadRate(hdrs, threads, false, NULL, &allFound));
+        ct_test(pTest, allFound);
+        fprintf(stream, " %14.1f", testReadRate(hdrs, threads, true, NULL, &allFound));
+        ct_test(pTest, allFound);
+        fprintf(stream, " %14.1f\n", testReadRate(hdrs, threads, false, &globalMutex, &allFound));
+        ct_test(pTest, allFound);
+    }
+
+    for (t = 0; t < TEST_READ_THREADS_MAX; t++) {
+        testDestroyObjects(&hdrs[t], objects[t], TEST_READ_OBJECTS);
+    }
+}
+
+
+#ifdef TEST_BACNET_OBJECT
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Object Instance Index", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testInstanceIndex);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testInstanceLookupBenchmark);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testIndexToInstance);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testEnumerateBenchmark);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testNameIndex);
+    assert(rc);
+#if (BACNET_PROPERTY_CACHE == 1)
+    rc = ct_addTestFunction(pTest, testNameCache);
+    assert(rc);
+#endif
+    rc = ct_addTestFunction(pTest, testNameLookupBenchmark);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testConcurrentReadBenchmark);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_BACNET_OBJECT */
+#endif /* TEST */
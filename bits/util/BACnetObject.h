@@ -28,18 +28,26 @@
 #pragma once
 
 #include "llist.h"
+#include "bacenum.h"
 #include "bacstr.h"
+#include "stringPool.h"
 
 typedef struct
 {
     LLIST_LB                llist;                     // must be first
 
+    BACNET_OBJECT_TYPE      objectType;
     uint32_t                objectInstance;
-    BACNET_CHARACTER_STRING objectName;
+    SP_HANDLE               objectName;                // interned, see stringPool.h
 
 } BACNET_OBJECT ;
 
 
+// Sets up an object descriptor list with an instance index, so Generic_Instance_To_Object() is O(1)
+bool Generic_Object_List_Init(
+    LLIST_HDR *objectHdr,
+    const uint max);
+
 BACNET_OBJECT *Generic_Instance_To_Object(
     LLIST_HDR *objectHdr,
     uint32_t object_instance);
@@ -49,11 +57,40 @@ bool Generic_Instance_To_Object_Name(
     uint32_t objectInstance,
     BACNET_CHARACTER_STRING *object_name);
 
+// The object name index is covered by the object store lock, like the objects
+// themselves: Generic_Object_Init(), _Set_Name() and _Name_Remove() are called under the
+// write lock (Device_Objects_Lock(true), or from an Object_Write_Property), the lookups
+// under either.
+
+// Also enters the object in the device wide object name index
 void Generic_Object_Init(
     BACNET_OBJECT       *bacnetObject,
+    const   BACNET_OBJECT_TYPE objectType,
     const   uint32_t    objectInstance,
     const   char        *objectName);
 
+// Renames an object, keeping the object name index up to date. Object_Name write
+// handlers must use this rather than writing objectName directly.
+bool Generic_Object_Set_Name(
+    BACNET_OBJECT *bacnetObject,
+    BACNET_CHARACTER_STRING *objectName);
+
+// Drops the object from the object name index and releases its name, before it is freed
+void Generic_Object_Name_Remove(
+    BACNET_OBJECT *bacnetObject);
+
+// Object name index lookup, used by Device_Valid_Object_Name() for Who-Has and by
+// Device_Valid_Object_Name_Locked() for the name uniqueness check. Either out parameter may be NULL.
+bool Generic_Object_Name_Find(
+    BACNET_CHARACTER_STRING *objectName,
+    BACNET_OBJECT_TYPE *objectType,
+    uint32_t *objectInstance);
+
+// True once an object of this type has been entered in the object name index, i.e.
+// the type is built on Generic_Object_Init() and its names need not be scanned.
+bool Generic_Object_Name_Type_Indexed(
+    const BACNET_OBJECT_TYPE objectType);
+
 uint32_t Generic_Index_To_Instance(
     LLIST_HDR *objectHdr,
     uint32_t objectIndex);
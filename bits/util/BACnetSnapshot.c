@@ -0,0 +1,893 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "BACnetSnapshot.h"
+#include "propertyCache.h"
+#include "bitsDebug.h"
+
+// File layout, all in host byte order
+//
+//  header      "BSNP", uint16 version, uint16 type count, uint32 byte order mark
+//  per type    uint16 object type, uint32 descriptor size, uint32 object count
+//  per object  uint32 instance, uint8 name encoding, uint16 name length, name,
+//              descriptor bytes following the BACNET_OBJECT header
+//  trailer     uint32 checksum of everything before it
+
+#define SNAPSHOT_MAX_TYPES  16
+#define SNAPSHOT_BOM        0x01020304u
+
+typedef struct
+{
+    BACNET_OBJECT_TYPE          objectType;
+    LLIST_HDR                   *objectHdr;
+    EMM_SLAB                    *slab;
+    size_t                      descrSize;
+    snapshot_restore_function   restore;
+} SNAPSHOT_TYPE;
+
+static SNAPSHOT_TYPE Snapshot_Types[SNAPSHOT_MAX_TYPES];
+static unsigned Snapshot_Type_Count;
+
+typedef struct
+{
+    uint8_t     *p;
+} SNAPSHOT_WRITER;
+
+typedef struct
+{
+    const uint8_t   *p;
+    const uint8_t   *end;
+} SNAPSHOT_READER;
+
+
+// Fletcher style, over 32 bit words, two running sums. A byte at a time hash would cost more
+// than everything else the load does.
+static uint32_t Snapshot_Checksum(
+    const uint8_t *data,
+    const size_t length)
+{
+    uint64_t sumA = 1, sumB = 0;
+    uint32_t word;
+    size_t i;
+
+    for (i = 0; i + sizeof(word) <= length; i += sizeof(word)) {
+        memcpy(&word, data + i, sizeof(word));
+        sumA += word;
+        sumB += sumA;
+    }
+    if (i < length) {
+        word = 0;
+        memcpy(&word, data + i, length - i);
+        sumA += word;
+        sumB += sumA;
+    }
+    return (uint32_t)(sumB ^ (sumB >> 32)) ^ (uint32_t)sumA;
+}
+
+
+static SNAPSHOT_TYPE *Snapshot_Find_Type(
+    const BACNET_OBJECT_TYPE objectType)
+{
+    unsigned i;
+
+    for (i = 0; i < Snapshot_Type_Count; i++) {
+        if (Snapshot_Types[i].objectType == objectType) {
+            return &Snapshot_Types[i];
+        }
+    }
+    return NULL;
+}
+
+
+bool Snapshot_Register_Type(
+    const BACNET_OBJECT_TYPE objectType,
+    LLIST_HDR *objectHdr,
+    EMM_SLAB *slab,
+    const size_t descrSize,
+    snapshot_restore_function restore)
+{
+    SNAPSHOT_TYPE *snapType = Snapshot_Find_Type(objectType);
+
+    if (descrSize < sizeof(BACNET_OBJECT)) {
+        panic();
+        return false;
+    }
+    if (snapType == NULL) {
+        if (Snapshot_Type_Count >= SNAPSHOT_MAX_TYPES) {
+            panic();
+            return false;
+        }
+        snapType = &Snapshot_Types[Snapshot_Type_Count++];
+    }
+    snapType->objectType = objectType;
+    snapType->objectHdr = objectHdr;
+    snapType->slab = slab;
+    snapType->descrSize = descrSize;
+    snapType->restore = restore;
+    return true;
+}
+
+
+static void Snapshot_Write(
+    SNAPSHOT_WRITER *writer,
+    const void *data,
+    const size_t length)
+{
+    memcpy(writer->p, data, length);
+    writer->p += length;
+}
+
+
+static void Snapshot_Write_U8(SNAPSHOT_WRITER *writer, const uint8_t value)
+{
+    Snapshot_Write(writer, &value, sizeof(value));
+}
+
+
+static void Snapshot_Write_U16(SNAPSHOT_WRITER *writer, const uint16_t value)
+{
+    Snapshot_Write(writer, &value, sizeof(value));
+}
+
+
+static void Snapshot_Write_U32(SNAPSHOT_WRITER *writer, const uint32_t value)
+{
+    Snapshot_Write(writer, &value, sizeof(value));
+}
+
+
+static size_t Snapshot_Size(
+    void)
+{
+    size_t size = 4 + 2 + 2 + 4 + 4;
+    unsigned i, j, count;
+
+    for (i = 0; i < Snapshot_Type_Count; i++) {
+        SNAPSHOT_TYPE *snapType = &Snapshot_Types[i];
+
+        count = ll_GetCount(snapType->objectHdr);
+        size += 2 + 4 + 4;
+        size += count * (4 + 1 + 2 + (snapType->descrSize - sizeof(BACNET_OBJECT)));
+        for (j = 0; j < count; j++) {
+            BACNET_OBJECT *bacnetObject = (BACNET_OBJECT *)ll_GetPtr(snapType->objectHdr, j);
+            size += sp_Length(bacnetObject->objectName);
+        }
+    }
+    return size;
+}
+
+
+bool Snapshot_Save(
+    const char *filename)
+{
+    SNAPSHOT_WRITER writer;
+    char tmpname[260];
+    uint8_t *data;
+    size_t length;
+    unsigned i, j, count;
+    FILE *fp;
+    bool ok;
+
+    if (strlen(filename) + 5 > sizeof(tmpname)) {
+        return false;
+    }
+    // the image is built in memory and written in one go
+    length = Snapshot_Size();
+    data = (uint8_t *)malloc(length);
+    if (data == NULL) {
+        return false;
+    }
+    writer.p = data;
+
+    Snapshot_Write(&writer, "BSNP", 4);
+    Snapshot_Write_U16(&writer, SNAPSHOT_VERSION);
+    Snapshot_Write_U16(&writer, (uint16_t)Snapshot_Type_Count);
+    Snapshot_Write_U32(&writer, SNAPSHOT_BOM);
+
+    for (i = 0; i < Snapshot_Type_Count; i++) {
+        SNAPSHOT_TYPE *snapType = &Snapshot_Types[i];
+        size_t bodySize = snapType->descrSize - sizeof(BACNET_OBJECT);
+
+        count = ll_GetCount(snapType->objectHdr);
+        Snapshot_Write_U16(&writer, (uint16_t)snapType->objectType);
+        Snapshot_Write_U32(&writer, (uint32_t)snapType->descrSize);
+        Snapshot_Write_U32(&writer, count);
+
+        for (j = 0; j < count; j++) {
+            BACNET_OBJECT *bacnetObject = (BACNET_OBJECT *)ll_GetPtr(snapType->objectHdr, j);
+            size_t nameLength = sp_Length(bacnetObject->objectName);
+
+            Snapshot_Write_U32(&writer, bacnetObject->objectInstance);
+            Snapshot_Write_U8(&writer, sp_Encoding(bacnetObject->objectName));
+            Snapshot_Write_U16(&writer, (uint16_t)nameLength);
+            Snapshot_Write(&writer, sp_Value(bacnetObject->objectName), nameLength);
+            Snapshot_Write(&writer, (uint8_t *)bacnetObject + sizeof(BACNET_OBJECT), bodySize);
+        }
+    }
+    Snapshot_Write_U32(&writer, Snapshot_Checksum(data, length - 4));
+
+    sprintf(tmpname, "%s.tmp", filename);
+    fp = fopen(tmpname, "wb");
+    if (fp == NULL) {
+        dbTraffic(DBD_ALL, DB_ERROR, "Snapshot: could not create %s", tmpname);
+        free(data);
+        return false;
+    }
+    ok = fwrite(data, 1, length, fp) == length;
+    if (fclose(fp) != 0) {
+        ok = false;
+    }
+    free(data);
+    if (!ok) {
+        dbTraffic(DBD_ALL, DB_ERROR, "Snapshot: could not write %s", tmpname);
+        remove(tmpname);
+        return false;
+    }
+
+    // rename() will not replace an existing file on Windows
+    remove(filename);
+    if (rename(tmpname, filename) != 0) {
+        dbTraffic(DBD_ALL, DB_ERROR, "Snapshot: could not rename %s", tmpname);
+        remove(tmpname);
+        return false;
+    }
+    return true;
+}
+
+
+static bool Snapshot_Read(
+    SNAPSHOT_READER *reader,
+    void *data,
+    const size_t length)
+{
+    if ((size_t)(reader->end - reader->p) < length) {
+        return false;
+    }
+    memcpy(data, reader->p, length);
+    reader->p += length;
+    return true;
+}
+
+
+static bool Snapshot_Skip(
+    SNAPSHOT_READER *reader,
+    const size_t length)
+{
+    if ((size_t)(reader->end - reader->p) < length) {
+        return false;
+    }
+    reader->p += length;
+    return true;
+}
+
+
+static bool Snapshot_Read_Header(
+    SNAPSHOT_READER *reader,
+    uint16_t *typeCount)
+{
+    char magic[4];
+    uint16_t version;
+    uint32_t bom;
+
+    if (!Snapshot_Read(reader, magic, sizeof(magic)) ||
+        !Snapshot_Read(reader, &version, sizeof(version)) ||
+        !Snapshot_Read(reader, typeCount, sizeof(*typeCount)) ||
+        !Snapshot_Read(reader, &bom, sizeof(bom))) {
+        return false;
+    }
+    return memcmp(magic, "BSNP", 4) == 0 &&
+        version == SNAPSHOT_VERSION &&
+        bom == SNAPSHOT_BOM;
+}
+
+
+static bool Snapshot_Read_Type(
+    SNAPSHOT_READER *reader,
+    SNAPSHOT_TYPE **snapType,
+    uint32_t *count)
+{
+    uint16_t objectType;
+    uint32_t descrSize;
+
+    if (!Snapshot_Read(reader, &objectType, sizeof(objectType)) ||
+        !Snapshot_Read(reader, &descrSize, sizeof(descrSize)) ||
+        !Snapshot_Read(reader, count, sizeof(*count))) {
+        return false;
+    }
+    *snapType = Snapshot_Find_Type((BACNET_OBJECT_TYPE)objectType);
+    if (*snapType == NULL) {
+        dbTraffic(DBD_ALL, DB_ERROR, "Snapshot: object type %u not registered", objectType);
+        return false;
+    }
+    if (descrSize != (*snapType)->descrSize) {
+        // built with a different descriptor layout
+        dbTraffic(DBD_ALL, DB_ERROR, "Snapshot: object type %u descriptor size %u, expected %u",
+            objectType, descrSize, (unsigned)(*snapType)->descrSize);
+        return false;
+    }
+    return true;
+}
+
+
+static bool Snapshot_Read_Object(
+    SNAPSHOT_READER *reader,
+    SNAPSHOT_TYPE *snapType,
+    uint32_t *instance,
+    BACNET_CHARACTER_STRING *objectName,
+    const uint8_t **body)
+{
+    uint8_t encoding;
+    uint16_t nameLength;
+    const uint8_t *name;
+
+    if (!Snapshot_Read(reader, instance, sizeof(*instance)) ||
+        !Snapshot_Read(reader, &encoding, sizeof(encoding)) ||
+        !Snapshot_Read(reader, &nameLength, sizeof(nameLength))) {
+        return false;
+    }
+    name = reader->p;
+    if (!Snapshot_Skip(reader, nameLength)) {
+        return false;
+    }
+    *body = reader->p;
+    if (!Snapshot_Skip(reader, snapType->descrSize - sizeof(BACNET_OBJECT))) {
+        return false;
+    }
+    if (objectName != NULL) {
+        return characterstring_init(objectName, encoding, (const char *)name, nameLength);
+    }
+    return nameLength < MAX_CHARACTER_STRING_BYTES;
+}
+
+
+// First pass, nothing is created unless the whole file is good
+static bool Snapshot_Validate(
+    const uint8_t *data,
+    const size_t length)
+{
+    SNAPSHOT_READER reader;
+    SNAPSHOT_TYPE *snapType;
+    uint16_t typeCount;
+    uint32_t count, instance, hash;
+    const uint8_t *body;
+    unsigned i, j;
+
+    if (length < sizeof(hash)) {
+        return false;
+    }
+    memcpy(&hash, data + length - sizeof(hash), sizeof(hash));
+    if (hash != Snapshot_Checksum(data, length - sizeof(hash))) {
+        dbTraffic(DBD_ALL, DB_ERROR, "Snapshot: checksum mismatch");
+        return false;
+    }
+
+    reader.p = data;
+    reader.end = data + length - sizeof(hash);
+    if (!Snapshot_Read_Header(&reader, &typeCount)) {
+        dbTraffic(DBD_ALL, DB_ERROR, "Snapshot: bad header");
+        return false;
+    }
+    for (i = 0; i < typeCount; i++) {
+        if (!Snapshot_Read_Type(&reader, &snapType, &count)) {
+            return false;
+        }
+        if (ll_GetCount(snapType->objectHdr) != 0 ||
+            count > snapType->objectHdr->max) {
+            return false;
+        }
+        for (j = 0; j < count; j++) {
+            if (!Snapshot_Read_Object(&reader, snapType, &instance, NULL, &body)) {
+                return false;
+            }
+        }
+    }
+    return reader.p == reader.end;
+}
+
+
+// Back to the state before Snapshot_Load() started, empty lists
+static void Snapshot_Discard(
+    void)
+{
+    BACNET_OBJECT *bacnetObject;
+    unsigned i;
+
+    for (i = 0; i < Snapshot_Type_Count; i++) {
+        while ((bacnetObject = (BACNET_OBJECT *)ll_Dequeue(Snapshot_Types[i].objectHdr)) != NULL) {
+            Generic_Object_Name_Remove(bacnetObject);
+            emm_slab_free(Snapshot_Types[i].slab, bacnetObject);
+        }
+    }
+}
+
+
+static bool Snapshot_Populate(
+    const uint8_t *data,
+    const size_t length)
+{
+    SNAPSHOT_READER reader;
+    SNAPSHOT_TYPE *snapType;
+    BACNET_CHARACTER_STRING objectName;
+    BACNET_OBJECT *bacnetObject;
+    uint16_t typeCount;
+    uint32_t count, instance;
+    const uint8_t *body;
+    unsigned i, j;
+
+    reader.p = data;
+    reader.end = data + length - sizeof(uint32_t);
+    Snapshot_Read_Header(&reader, &typeCount);
+
+    for (i = 0; i < typeCount; i++) {
+        Snapshot_Read_Type(&reader, &snapType, &count);
+        for (j = 0; j < count; j++) {
+            Snapshot_Read_Object(&reader, snapType, &instance, &objectName, &body);
+
+            bacnetObject = (BACNET_OBJECT *)emm_slab_calloc(snapType->slab);
+            if (bacnetObject == NULL) {
+                panic();
+                return false;
+            }
+            memcpy((uint8_t *)bacnetObject + sizeof(BACNET_OBJECT), body,
+                snapType->descrSize - sizeof(BACNET_OBJECT));
+
+            // as the Create functions do, the instance (and name) index entries first
+            Generic_Object_Init(bacnetObject, snapType->objectType, instance, "");
+            if (!Generic_Object_Set_Name(bacnetObject, &objectName) ||
+                !ll_Enqueue(snapType->objectHdr, bacnetObject)) {
+                // duplicate instance, or out of memory
+                Generic_Object_Name_Remove(bacnetObject);
+                emm_slab_free(snapType->slab, bacnetObject);
+                return false;
+            }
+            if (snapType->restore != NULL) {
+                snapType->restore(bacnetObject);
+            }
+        }
+    }
+    return true;
+}
+
+
+bool Snapshot_Load(
+    const char *filename)
+{
+    FILE *fp;
+    uint8_t *data;
+    long length;
+    bool ok;
+
+    fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+    if (fseek(fp, 0, SEEK_END) != 0 ||
+        (length = ftell(fp)) <= 0 ||
+        fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return false;
+    }
+    data = (uint8_t *)malloc((size_t)length);
+    if (data == NULL) {
+        fclose(fp);
+        return false;
+    }
+    ok = fread(data, 1, (size_t)length, fp) == (size_t)length;
+    fclose(fp);
+
+    if (ok) {
+        ok = Snapshot_Validate(data, (size_t)length);
+    }
+    if (ok) {
+        ok = Snapshot_Populate(data, (size_t)length);
+        if (!ok) {
+            Snapshot_Discard();
+        }
+#if (BACNET_PROPERTY_CACHE == 1)
+        // the descriptors were replaced wholesale, not through the _Set functions
+        pc_InvalidateAll();
+#endif
+    }
+    if (!ok) {
+        dbTraffic(DBD_ALL, DB_ERROR, "Snapshot: %s refused", filename);
+    }
+    free(data);
+    return ok;
+}
+
+
+#ifdef TEST
+#include <assert.h>
+#include <time.h>
+#include "ctest.h"
+
+#ifdef TEST_SNAPSHOT
+/* dummy function stubs */
+void sys_panic(const char *file, const int line)
+{
+    (void)file;
+    (void)line;
+}
+
+void sys_dbTraffic(DBD_DebugDomain domain, DB_LEVEL lev, const char *format, ...)
+{
+    (void)domain;
+    (void)lev;
+    (void)format;
+}
+#endif
+
+#define TEST_SNAPSHOT_FILE  "snapshot_test.bin"
+#define TEST_OBJECTS        20000
+
+// about an ANALOG_VALUE_DESCR with COV and intrinsic reporting
+typedef struct
+{
+    BACNET_OBJECT   common;             // must be first
+    float           Present_Value;
+    float           Priority_Array[BACNET_MAX_PRIORITY];
+    uint16_t        Priority_Active;    // bit per priority
+    float           Relinquish_Default;
+    float           COV_Increment;
+    float           Prior_Value;
+    bool            Out_Of_Service;
+    uint16_t        Units;
+    uint32_t        Notification_Class;
+    uint32_t        Time_Delay;
+    float           High_Limit;
+    float           Low_Limit;
+    float           Deadband;
+    uint8_t         Limit_Enable;
+    uint8_t         Event_Enable;
+} TEST_SNAP_DESCR;
+
+typedef struct
+{
+    BACNET_OBJECT   common;             // must be first
+    bool            Present_Value;
+    bool            Restored;           // set by the restore hook
+} TEST_SNAP_BV_DESCR;
+
+static LLIST_HDR Test_AV_List;
+static LLIST_HDR Test_BV_List;
+static EMM_SLAB Test_AV_Slab;
+static EMM_SLAB Test_BV_Slab;
+
+
+static void testRestoreBV(BACNET_OBJECT *bacnetObject)
+{
+    ((TEST_SNAP_BV_DESCR *)bacnetObject)->Restored = true;
+}
+
+
+static void testSetup(void)
+{
+    static bool initialized;
+
+    if (!initialized) {
+        Generic_Object_List_Init(&Test_AV_List, TEST_OBJECTS);
+        Generic_Object_List_Init(&Test_BV_List, 100);
+        emm_slab_init(&Test_AV_Slab, sizeof(TEST_SNAP_DESCR), 32);
+        emm_slab_init(&Test_BV_Slab, sizeof(TEST_SNAP_BV_DESCR), 32);
+        initialized = true;
+    }
+    Snapshot_Register_Type(OBJECT_ANALOG_VALUE, &Test_AV_List, &Test_AV_Slab, sizeof(TEST_SNAP_DESCR), NULL);
+    Snapshot_Register_Type(OBJECT_BINARY_VALUE, &Test_BV_List, &Test_BV_Slab, sizeof(TEST_SNAP_BV_DESCR), testRestoreBV);
+}
+
+
+// What a Create function does
+static TEST_SNAP_DESCR *testCreateAV(const uint32_t instance, const char *name)
+{
+    TEST_SNAP_DESCR *descr = (TEST_SNAP_DESCR *)emm_slab_calloc(&Test_AV_Slab);
+    unsigned i;
+
+    Generic_Object_Init(&descr->common, OBJECT_ANALOG_VALUE, instance, name);
+    if (!ll_Enqueue(&Test_AV_List, descr)) {
+        Generic_Object_Name_Remove(&descr->common);
+        emm_slab_free(&Test_AV_Slab, descr);
+        return NULL;
+    }
+    for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
+        descr->Priority_Array[i] = 0.0f;
+    }
+    descr->Priority_Active = 0;
+    descr->Relinquish_Default = 0.0f;
+    descr->COV_Increment = 1.0f;
+    descr->Units = UNITS_PERCENT;
+    descr->Notification_Class = BACNET_MAX_INSTANCE;
+    descr->High_Limit = 100.0f;
+    descr->Low_Limit = 0.0f;
+    descr->Deadband = 1.0f;
+    return descr;
+}
+
+
+// ... and then the site configuration, applied one property at a time as the
+// WriteProperty handlers (or a configuration file loader) would
+static void testConfigureAV(TEST_SNAP_DESCR *descr, const uint32_t instance)
+{
+    static const BACNET_PROPERTY_ID properties[] = {
+        PROP_UNITS, PROP_COV_INCREMENT, PROP_RELINQUISH_DEFAULT, PROP_NOTIFICATION_CLASS,
+        PROP_TIME_DELAY, PROP_HIGH_LIMIT, PROP_LOW_LIMIT, PROP_DEADBAND,
+        PROP_LIMIT_ENABLE, PROP_EVENT_ENABLE, PROP_PRIORITY_ARRAY, PROP_PRESENT_VALUE
+    };
+    TEST_SNAP_DESCR *found;
+    unsigned i;
+
+    for (i = 0; i < sizeof(properties) / sizeof(properties[0]); i++) {
+        found = (TEST_SNAP_DESCR *)Generic_Instance_To_Object(&Test_AV_List, instance);
+        if (found != descr) {
+            return;
+        }
+        switch (properties[i]) {
+        case PROP_UNITS: found->Units = UNITS_DEGREES_CELSIUS; break;
+        case PROP_COV_INCREMENT: found->COV_Increment = 0.1f * (instance % 10 + 1); break;
+        case PROP_RELINQUISH_DEFAULT: found->Relinquish_Default = 21.0f; break;
+        case PROP_NOTIFICATION_CLASS: found->Notification_Class = instance % 8; break;
+        case PROP_TIME_DELAY: found->Time_Delay = 30; break;
+        case PROP_HIGH_LIMIT: found->High_Limit = 26.0f; break;
+        case PROP_LOW_LIMIT: found->Low_Limit = 16.0f; break;
+        case PROP_DEADBAND: found->Deadband = 0.5f; break;
+        case PROP_LIMIT_ENABLE: found->Limit_Enable = 3; break;
+        case PROP_EVENT_ENABLE: found->Event_Enable = 7; break;
+        case PROP_PRIORITY_ARRAY:
+            found->Priority_Array[7] = (float)instance;
+            found->Priority_Active |= 1 << 7;
+            break;
+        case PROP_PRESENT_VALUE: found->Present_Value = (float)instance; break;
+        default: break;
+        }
+    }
+}
+
+
+static bool testCreateConfiguration(const unsigned count)
+{
+    char name[32];
+    unsigned i;
+
+    for (i = 0; i < count; i++) {
+        TEST_SNAP_DESCR *descr;
+        sprintf(name, "Zone %u Setpoint", i);
+        descr = testCreateAV(i + 1, name);
+        if (descr == NULL) return false;
+        testConfigureAV(descr, i + 1);
+    }
+    return true;
+}
+
+
+void testSnapshotRoundTrip(
+    Test * pTest)
+{
+    TEST_SNAP_DESCR *descr;
+    TEST_SNAP_BV_DESCR *bv;
+    BACNET_CHARACTER_STRING objectName;
+    BACNET_OBJECT_TYPE objectType;
+    uint32_t objectInstance;
+
+    testSetup();
+    ct_test(pTest, testCreateConfiguration(50));
+    bv = (TEST_SNAP_BV_DESCR *)emm_slab_calloc(&Test_BV_Slab);
+    Generic_Object_Init(&bv->common, OBJECT_BINARY_VALUE, 7, "Fan Enable");
+    ct_test(pTest, ll_Enqueue(&Test_BV_List, bv));
+    bv->Present_Value = true;
+    // a name in another encoding survives too
+    descr = (TEST_SNAP_DESCR *)Generic_Instance_To_Object(&Test_AV_List, 3);
+    characterstring_init(&objectName, CHARACTER_ISO8859, "Zone \xB0 3", 8);
+    ct_test(pTest, Generic_Object_Set_Name(&descr->common, &objectName));
+
+    ct_test(pTest, Snapshot_Save(TEST_SNAPSHOT_FILE));
+    // only into empty lists
+    ct_test(pTest, !Snapshot_Load(TEST_SNAPSHOT_FILE));
+    ct_test(pTest, ll_GetCount(&Test_AV_List) == 50);
+
+    Snapshot_Discard();
+    ct_test(pTest, ll_GetCount(&Test_AV_List) == 0);
+    characterstring_init_ansi(&objectName, "Fan Enable");
+    ct_test(pTest, !Generic_Object_Name_Find(&objectName, NULL, NULL));
+
+    ct_test(pTest, Snapshot_Load(TEST_SNAPSHOT_FILE));
+    ct_test(pTest, ll_GetCount(&Test_AV_List) == 50);
+    ct_test(pTest, ll_GetCount(&Test_BV_List) == 1);
+
+    descr = (TEST_SNAP_DESCR *)Generic_Instance_To_Object(&Test_AV_List, 42);
+    ct_test(pTest, descr != NULL);
+    if (descr != NULL) {
+        ct_test(pTest, descr->common.objectType == OBJECT_ANALOG_VALUE);
+        ct_test(pTest, descr->Present_Value == 42.0f);
+        ct_test(pTest, descr->Priority_Array[7] == 42.0f);
+        ct_test(pTest, descr->Priority_Active == (1 << 7));
+        ct_test(pTest, descr->COV_Increment == 0.1f * 3);
+        ct_test(pTest, descr->Notification_Class == 42 % 8);
+        ct_test(pTest, descr->Units == UNITS_DEGREES_CELSIUS);
+    }
+    // list order is kept
+    ct_test(pTest, Generic_Index_To_Instance(&Test_AV_List, 0) == 1);
+    ct_test(pTest, Generic_Index_To_Instance(&Test_AV_List, 49) == 50);
+
+    // and the name index is rebuilt
+    characterstring_init_ansi(&objectName, "Zone 9 Setpoint");
+    ct_test(pTest, Generic_Object_Name_Find(&objectName, &objectType, &objectInstance));
+    ct_test(pTest, objectType == OBJECT_ANALOG_VALUE && objectInstance == 10);
+    characterstring_init(&objectName, CHARACTER_ISO8859, "Zone \xB0 3", 8);
+    ct_test(pTest, Generic_Object_Name_Find(&objectName, NULL, &objectInstance));
+    ct_test(pTest, objectInstance == 3);
+
+    bv = (TEST_SNAP_BV_DESCR *)Generic_Instance_To_Object(&Test_BV_List, 7);
+    ct_test(pTest, bv != NULL);
+    if (bv != NULL) {
+        ct_test(pTest, bv->Present_Value);
+        ct_test(pTest, bv->Restored);
+    }
+
+    Snapshot_Discard();
+    remove(TEST_SNAPSHOT_FILE);
+}
+
+
+static bool testRewrite(const uint8_t *data, const size_t length)
+{
+    FILE *fp = fopen(TEST_SNAPSHOT_FILE, "wb");
+    bool ok;
+
+    if (fp == NULL) return false;
+    ok = fwrite(data, 1, length, fp) == length;
+    fclose(fp);
+    return ok;
+}
+
+
+void testSnapshotRefused(
+    Test * pTest)
+{
+    static uint8_t data[64 * 1024];
+    FILE *fp;
+    size_t length;
+
+    testSetup();
+    ct_test(pTest, testCreateConfiguration(20));
+    ct_test(pTest, Snapshot_Save(TEST_SNAPSHOT_FILE));
+    Snapshot_Discard();
+
+    fp = fopen(TEST_SNAPSHOT_FILE, "rb");
+    ct_test(pTest, fp != NULL);
+    if (fp == NULL) return;
+    length = fread(data, 1, sizeof(data), fp);
+    fclose(fp);
+    ct_test(pTest, length > 20 * sizeof(TEST_SNAP_DESCR));
+
+    // one flipped bit in a descriptor
+    data[length / 2] ^= 0x10;
+    ct_test(pTest, testRewrite(data, length));
+    ct_test(pTest, !Snapshot_Load(TEST_SNAPSHOT_FILE));
+    ct_test(pTest, ll_GetCount(&Test_AV_List) == 0);
+    data[length / 2] ^= 0x10;
+
+    // truncated
+    ct_test(pTest, testRewrite(data, length - 10));
+    ct_test(pTest, !Snapshot_Load(TEST_SNAPSHOT_FILE));
+    ct_test(pTest, ll_GetCount(&Test_AV_List) == 0);
+
+    // missing
+    remove(TEST_SNAPSHOT_FILE);
+    ct_test(pTest, !Snapshot_Load(TEST_SNAPSHOT_FILE));
+
+    // written by a build with a different descriptor layout
+    ct_test(pTest, testRewrite(data, length));
+    Snapshot_Register_Type(OBJECT_ANALOG_VALUE, &Test_AV_List, &Test_AV_Slab, sizeof(TEST_SNAP_DESCR) + 4, NULL);
+    ct_test(pTest, !Snapshot_Load(TEST_SNAPSHOT_FILE));
+    ct_test(pTest, ll_GetCount(&Test_AV_List) == 0);
+
+    // and good again
+    testSetup();
+    ct_test(pTest, Snapshot_Load(TEST_SNAPSHOT_FILE));
+    ct_test(pTest, ll_GetCount(&Test_AV_List) == 20);
+
+    Snapshot_Discard();
+    remove(TEST_SNAPSHOT_FILE);
+}
+
+
+static double testElapsedMs(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e3 + (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+
+// Startup time for a large configuration, Create calls plus configuration vs. the snapshot
+void testSnapshotStartupBenchmark(
+    Test * pTest)
+{
+    FILE *stream = ct_getStream(pTest);
+    struct timespec start;
+    double createMs = 1e9, saveMs = 1e9, loadMs = 1e9, ms;
+    unsigned pass;
+
+    testSetup();
+    for (pass = 0; pass < 5; pass++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ct_test(pTest, testCreateConfiguration(TEST_OBJECTS));
+        ms = testElapsedMs(&start);
+        if (ms < createMs) createMs = ms;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ct_test(pTest, Snapshot_Save(TEST_SNAPSHOT_FILE));
+        ms = testElapsedMs(&start);
+        if (ms < saveMs) saveMs = ms;
+        Snapshot_Discard();
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ct_test(pTest, Snapshot_Load(TEST_SNAPSHOT_FILE));
+        ms = testElapsedMs(&start);
+        if (ms < loadMs) loadMs = ms;
+        ct_test(pTest, ll_GetCount(&Test_AV_List) == TEST_OBJECTS);
+        Snapshot_Discard();
+    }
+    remove(TEST_SNAPSHOT_FILE);
+
+    fprintf(stream, "\n  %u objects of %u bytes, best of 5\n", TEST_OBJECTS, (unsigned)sizeof(TEST_SNAP_DESCR));
+    fprintf(stream, "  %-32s %10.2f ms\n", "create calls + configuration", createMs);
+    fprintf(stream, "  %-32s %10.2f ms\n", "snapshot load", loadMs);
+    fprintf(stream, "  %-32s %10.2f ms\n", "snapshot save", saveMs);
+}
+
+
+#ifdef TEST_SNAPSHOT
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Object Snapshot", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testSnapshotRoundTrip);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testSnapshotRefused);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testSnapshotStartupBenchmark);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_SNAPSHOT */
+#endif /* TEST */
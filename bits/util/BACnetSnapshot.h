@@ -0,0 +1,75 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "BACnetObject.h"
+#include "emm.h"
+
+// Binary snapshot of the object database, so a device with thousands of objects can restart
+// from one bulk read instead of replaying its Create calls and configuration writes.
+//
+// Each object type that wants to be in the snapshot registers its descriptor list and slab
+// from its _Init() function. The snapshot holds, per object, the instance, the object name
+// and the raw descriptor after the common BACNET_OBJECT header, so priority arrays, COV
+// increments, event settings and so on all come back exactly as they were saved.
+//
+// The file is in host byte order and host structure layout. It is only good for the build
+// that wrote it: the version, byte order and every descriptor size are checked, and the
+// whole file is checksummed, and a snapshot that does not match is refused. The caller then
+// falls back to creating the objects the long way. Bump SNAPSHOT_VERSION when a descriptor
+// changes meaning without changing size.
+//
+// Not locked. Save at runtime with the stack lock held (or from the stack thread).
+
+#define SNAPSHOT_VERSION    1
+
+#ifndef SNAPSHOT_FILENAME
+#define SNAPSHOT_FILENAME   "BACnetObjects.snp"
+#endif
+
+// Descriptors must be pointer free after the common header. A type with pointers (e.g. the
+// 'next' of BACNET_APPLICATION_DATA_VALUE) registers a hook to repair them after loading.
+typedef void (*snapshot_restore_function)(BACNET_OBJECT *bacnetObject);
+
+bool Snapshot_Register_Type(
+    const BACNET_OBJECT_TYPE objectType,
+    LLIST_HDR *objectHdr,
+    EMM_SLAB *slab,
+    const size_t descrSize,
+    snapshot_restore_function restore);
+
+// Written to filename.tmp, then renamed over filename
+bool Snapshot_Save(
+    const char *filename);
+
+// Only into empty lists, i.e. at startup after the object _Init() calls. Nothing is created
+// unless the whole file checks out, false (and no objects) if it does not.
+bool Snapshot_Load(
+    const char *filename);
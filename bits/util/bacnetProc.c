@@ -37,6 +37,7 @@
 #include "handlers.h"
 #include "bitsUtil.h"
 #include "dcc.h"
+#include "device.h"
 #include "dlenv.h"
 #include "logging/logging.h"
 #include "net.h"
@@ -44,9 +45,52 @@
 #include "bacTarget.h"
 #include "nc.h"
 #include "tsm.h"
+#include "BACnetSnapshot.h"
+#if (BACNET_WORKER_THREADS > 0)
+#include "npduWorkers.h"
+#endif
+#if (BACNET_EVENT_LOOP == 1)
+#include "eventLoop.h"
+#endif
+
+// The concurrency model.
+//
+// There are two ways into the stack, the datalink thread (DatalinkListen()) with what it
+// receives, and the idle thread (TickBACnet()) with the timers. Each owns some state outright,
+// the rest is shared through the handoff points below.
+//
+//  - The datalink thread owns the datalink: the BBMD tables and foreign device registration are
+//    changed by the BVLC messages it receives, so it runs bvlc_maintenance_timer() and
+//    dlenv_maintenance_timer() itself, and nobody locks them.
+//
+//  - stackLock is the outermost lock. The tick holds it throughout, and so does anything else
+//    that wants the whole stack held still (SaveBACnetSnapshot()).
+//
+//  - With no worker threads (BACNET_WORKER_THREADS 0) the datalink thread takes stackLock
+//    around npdu_handler() too, so received messages and the tick take turns, and the
+//    subsystem locks are compiled away.
+//
+//  - With worker threads the datalink thread only copies each message into the npduWorkers
+//    queue. The workers run npdu_handler() without stackLock, side by side with each other
+//    and with the tick, and the subsystems lock themselves (BACNET_STACK_LOCKS, see
+//    bacnet_lock.h). What the tick does to the objects directly, rather than through the
+//    Device_ functions, it does under Device_Objects_Lock().
+//
+//  - With BACNET_EVENT_LOOP the datalink thread and the idle thread are one, the thread that
+//    runs eventLoop_Run(). It receives when the socket is readable, runs the timers when the
+//    timerfd fires, and ticks again when eventLoop_Wakeup() is called: after each received
+//    message, and by the application when it has changed something. The rules above still
+//    hold, there is just no one to take turns with but the workers.
+//
+// So locks are taken in this order, and released in reverse:
+//
+//      stackLock -> object store -> COV subscriptions -> TSM -> address cache -> DCC
+//
+// No lock is held across a blocking receive, and the workers never take stackLock.
 
 LockDefine(stackLock);
 
+#if (BACNET_EVENT_LOOP == 0)
 #ifdef _MSC_VER
 void BACnetIdle_Thread(void *pArgs)
 #else
@@ -83,21 +127,116 @@ static void Init_BACnetIdle_Thread(void) {
 #endif
 
 }
+#endif
+
+#if (BACNET_EVENT_LOOP == 1)
+// the datalink socket is readable
+static void BACnetEventLoop_Receive(int fd, void *context) {
+	(void) fd;
+	(void) context;
+	// with no workers the message has been handled by now, tick for what it changed
+	if (DatalinkReceive(0) && BACNET_WORKER_THREADS == 0) {
+		eventLoop_Wakeup();
+	}
+}
 
-void InitBACnet(void) {
+#if (BACNET_WORKER_THREADS > 0)
+// a worker has handled a message, tick for what it changed
+static void BACnetEventLoop_Handler(BACNET_ADDRESS *src, uint8_t *pdu, uint16_t pdu_len) {
+	npdu_handler(src, pdu, pdu_len);
+	eventLoop_Wakeup();
+}
+#endif
+
+// The TSM times its retries to the millisecond, so the timer comes no later than the next of them
+static void BACnetEventLoop_Schedule(void) {
+#if (MAX_TSM_TRANSACTIONS) && (( BACNET_CLIENT == 1 ) || ( BACNET_SVC_COV_B == 1 ) || ( BACNET_SEGMENTATION_TRANSMIT == 1 ) || ( BACNET_SEGMENTATION_RECEIVE == 1 ))
+	uint32_t due_ms = tsm_timer_next_milliseconds();
+	if (due_ms < BACNET_EVENT_LOOP_TIMER_MS) {
+		eventLoop_Timer_Within(due_ms);
+	}
+#endif
+}
+
+static void BACnetEventLoop_Timer(void) {
+	DatalinkMaintenance();
+	TickBACnet();
+	BACnetEventLoop_Schedule();
+}
+
+static void BACnetEventLoop_Wakeup(void) {
+	TickBACnet();
+	BACnetEventLoop_Schedule();
+}
+
+static void BACnetEventLoop_Thread(void *pArgs) {
+	(void) pArgs;
+	eventLoop_Run();
+}
+#endif
+
+static void InitBACnetStack(void) {
 	// no longer Device_Tables_Init();
 
 	/* load any static address bindings to show up
 	 in our device bindings list */
 	address_init();
+	dcc_init();
+#if (MAX_TSM_TRANSACTIONS)
+	tsm_init();
+#endif
+#if ( BACNET_SVC_COV_B == 1 )
+	handler_cov_init();
+#endif
 
 	atexit(datalink_cleanup);
 
 	LockTransactionInit(stackLock);
 
+#if (BACNET_WORKER_THREADS > 0)
+	// the workers call npdu_handler() without stackLock, the TSM, COV, address cache, DCC and
+	// object store lock themselves (BACNET_STACK_LOCKS)
+#if (BACNET_EVENT_LOOP == 1)
+	npduWorkers_Init(BACNET_WORKER_THREADS, BACnetEventLoop_Handler);
+#else
+	npduWorkers_Init(BACNET_WORKER_THREADS, npdu_handler);
+#endif
+#endif
+}
+
+#if (BACNET_EVENT_LOOP == 1)
+#if !defined(BACDL_BIP)
+#error BACNET_EVENT_LOOP needs a datalink with a socket to wait on, BACnet/IP
+#endif
+
+// Sets up the stack on an event loop, but leaves running it to the application, with
+// eventLoop_Run() on a thread of its own, or eventLoop_Run_Once() when eventLoop_Fd() is readable
+bool InitBACnetEventLoop(void) {
+	InitBACnetStack();
+	dlenv_init();
+	if (!eventLoop_Init(BACNET_EVENT_LOOP_TIMER_MS, BACnetEventLoop_Timer, BACnetEventLoop_Wakeup)) {
+		return false;
+	}
+	if (!eventLoop_Add(bip_socket(), BACnetEventLoop_Receive, NULL)) {
+		log_printf("Failed to add the datalink to the event loop");
+		eventLoop_Close();
+		return false;
+	}
+	return true;
+}
+
+void InitBACnet(void) {
+	if (InitBACnetEventLoop()) {
+		bitsCreateThread(BACnetEventLoop_Thread, NULL);
+	}
+}
+#else
+void InitBACnet(void) {
+	InitBACnetStack();
 	Init_Datalink_Thread();
 	Init_BACnetIdle_Thread();
 }
+#endif
 
 static void TickBACnetDevice(void) {
 	LockTransaction(stackLock);
@@ -105,7 +244,6 @@ static void TickBACnetDevice(void) {
 	/* input */
 	time_t current_seconds = time(NULL);
 	static time_t last_seconds ;
-	static uint32_t address_binding_tmr = 0;
 
 	// bad- cancels our timer. remove last_seconds = current_seconds ;
 
@@ -122,6 +260,20 @@ static void TickBACnetDevice(void) {
 	//    src.portParams = &ourDatalink;
 	//    // todo1 npdu_handler(&src, &ourDevice);
 	//}
+#if ( BACNET_CLIENT == 1 ) || ( BACNET_SVC_COV_B == 1 ) || ( BACNET_SEGMENTATION_TRANSMIT == 1 ) || ( BACNET_SEGMENTATION_RECEIVE == 1 )
+	/* the APDU timeouts to the millisecond, on every tick. The first tick
+	   only starts the clock, timer_get_time() is not an elapsed time. */
+	static bool have_last_milliseconds;
+	static uint32_t last_milliseconds;
+	uint32_t current_milliseconds = timer_get_time();
+	if (have_last_milliseconds) {
+		uint32_t elapsed_milliseconds = current_milliseconds - last_milliseconds;
+		tsm_timer_milliseconds((uint16_t) ((elapsed_milliseconds > UINT16_MAX) ? UINT16_MAX : elapsed_milliseconds));
+	}
+	have_last_milliseconds = true;
+	last_milliseconds = current_milliseconds;
+#endif
+
 	/* at least one second has passed */
 	uint32_t elapsed_seconds = (uint32_t) (current_seconds - last_seconds);
 	if (elapsed_seconds) {
@@ -130,54 +282,57 @@ static void TickBACnetDevice(void) {
 
 		dcc_timer_seconds(elapsed_seconds);
 
-        // Note: These two functions will be handled by the datalink threads in the Multiple
-        // datalink model.
-#if defined(BACDL_BIP) && BBMD_ENABLED
-		bvlc_maintenance_timer( elapsed_seconds);
-#endif
-		dlenv_maintenance_timer((uint16_t) elapsed_seconds);
+		// bvlc_maintenance_timer() and dlenv_maintenance_timer() are run by the datalink thread
 
 #if defined (LOAD_CONTROL)
+		Device_Objects_Lock(true);
 		Load_Control_State_Machine_Handler();
+		Device_Objects_Unlock(true);
 #endif
 
 #if ( BACNET_SVC_COV_B == 1 )
 		handler_cov_timer_seconds(elapsed_seconds);
 #endif
 
-#if ( BACNET_CLIENT == 1 ) || ( BACNET_SVC_COV_B == 1 )
-		tsm_timer_milliseconds(elapsed_seconds * 1000);
-#endif
-
 #ifdef todo2
+		// reads the logged properties and changes the logs
+		Device_Objects_Lock(true);
 		trend_log_timer(elapsed_seconds);
+		Device_Objects_Unlock(true);
 #endif
 
+		// the timers are on wheels, so this costs only the entries that expire
+		address_cache_timer(elapsed_seconds);
+
 #if (INTRINSIC_REPORTING_B == 1)
 		//    // todo1  Device_local_reporting(&ourDevice);
 #endif
 
 #if (BACNET_TIME_MASTER == 1)
+		Device_Objects_Lock(false);
 		Device_getCurrentDateTime(&bdatetime);
 		handler_timesync_task(&bdatetime);
+		Device_Objects_Unlock(false);
 #endif
 	}
 
 #if ( BACNET_SVC_COV_B == 1 )
+#if (BACNET_EVENT_LOOP == 1)
+	// nobody comes back in 10 ms, so a whole pass over the subscriptions now
+	while (!handler_cov_fsm()) {
+	}
+#else
 	handler_cov_task();
 #endif
+#endif
 
-	/* scan cache address */
-	address_binding_tmr += elapsed_seconds;
-	if (address_binding_tmr >= 60) {
-		address_cache_timer(address_binding_tmr);
-		address_binding_tmr = 0;
-	}
 #if (INTRINSIC_REPORTING_B==1)
 	/* try to find addresses of recipients */
 	recipient_scan_tmr += elapsed_seconds;
 	if (recipient_scan_tmr >= NC_RESCAN_RECIPIENTS_SECS) {
+		Device_Objects_Lock(false);
 		Notification_Class_find_recipient();
+		Device_Objects_Unlock(false);
 		recipient_scan_tmr = 0;
 	}
 #endif
@@ -185,6 +340,18 @@ static void TickBACnetDevice(void) {
 	UnlockTransaction(stackLock);
 }
 
+// Object database snapshot, with the stack held still while it is taken
+bool SaveBACnetSnapshot(void) {
+	bool ok;
+
+	LockTransaction(stackLock);
+	Device_Objects_Lock(false);
+	ok = Snapshot_Save(SNAPSHOT_FILENAME);
+	Device_Objects_Unlock(false);
+	UnlockTransaction(stackLock);
+	return ok;
+}
+
 // If this returns false, time to shutdown
 bool TickBACnet(void) {
 
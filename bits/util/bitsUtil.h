@@ -57,7 +57,9 @@ char *ipep_address_sprintf(
 // no longer void Device_Tables_Init(void);
 
 void InitBACnet(void);
+bool InitBACnetEventLoop(void);     // BACNET_EVENT_LOOP only
 bool TickBACnet(void);
+bool SaveBACnetSnapshot(void);
 
 bool isMatchCaseInsensitive(const char *stringA, const char *stringB);
 
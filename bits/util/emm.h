@@ -67,6 +67,29 @@ void *emm_sys_safe_calloc(uint16_t size);
 #define emm_calloc(size) emm_sys_safe_calloc(size)
 #endif
 
+// Slab allocator for object descriptors, one slab per object type. Items are handed out,
+// zeroed, from contiguous chunks of perChunk items, so objects of a type sit together in
+// memory, and freed items are recycled. Chunks are only returned by emm_slab_release().
+// Not locked. The object slabs are covered by the object store lock, creates and deletes
+// go under Device_Objects_Lock(true) or a Device_Write_Property().
+typedef struct _EMM_SLAB_CHUNK EMM_SLAB_CHUNK;
+
+typedef struct
+{
+    unsigned        itemSize;       // rounded up so every item is suitably aligned
+    unsigned        perChunk;
+    unsigned        remaining;      // never used items left at the end of the newest chunk
+    unsigned        inUse;
+    uint8_t         *next;          // next never used item
+    void            *freeList;      // recycled items, linked through their first word
+    EMM_SLAB_CHUNK  *chunks;
+} EMM_SLAB;
+
+void emm_slab_init(EMM_SLAB *slab, unsigned itemSize, unsigned perChunk);
+void *emm_slab_calloc(EMM_SLAB *slab);
+void emm_slab_free(EMM_SLAB *slab, void *item);
+void emm_slab_release(EMM_SLAB *slab);
+
 #if ( EMM_MEM_TEST == 1 )		// Set this project wide, and then running emulation will launch mem test
 void test_mem(void);
 #endif
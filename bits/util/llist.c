@@ -29,40 +29,218 @@ along with this program.If not, see <http://www.gnu.org/licenses/>.
 #include <assert.h>
 #endif
 
+#include <stdlib.h>
+#include <string.h>
 #include "llist.h"
 #include "osLayer.h"
 #include "bitsDebug.h"
 
-static SemaDefine(llistMutex);
+// The index is allocated with calloc(), not emm, since it has to grow past the emm block limit
+// for the larger object lists.
+
+static uint ll_IndexHash(LLIST_INDEX *index, const uint32_t key)
+{
+    // Fibonacci (multiplicative) hash, the top bits are the best mixed
+    return (uint)((key * 2654435769u) >> index->shift);
+}
+
+
+static bool ll_IndexAlloc(LLIST_INDEX *index, const uint size)
+{
+    uint shift = 32;
+    uint n;
+
+    for (n = size; n > 1; n >>= 1) {
+        shift--;
+    }
+    index->slots = (LLIST_LB **)calloc(size, sizeof(LLIST_LB *));
+    if (index->slots == NULL) {
+        return false;
+    }
+    index->size = size;
+    index->shift = shift;
+    return true;
+}
+
+
+// returns the slot holding key, or the empty slot where it would go
+static uint ll_IndexSlot(LLIST_INDEX *index, const uint32_t key)
+{
+    uint mask = index->size - 1;
+    uint slot = ll_IndexHash(index, key);
+
+    while (index->slots[slot] != NULL) {
+        if (index->key(index->slots[slot]) == key) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+
+static bool ll_IndexGrow(LLIST_INDEX *index)
+{
+    LLIST_LB **oldSlots = index->slots;
+    uint oldSize = index->size;
+    uint i;
+
+    if (!ll_IndexAlloc(index, oldSize * 2)) {
+        index->slots = oldSlots;
+        return false;
+    }
+    for (i = 0; i < oldSize; i++) {
+        if (oldSlots[i] != NULL) {
+            index->slots[ll_IndexSlot(index, index->key(oldSlots[i]))] = oldSlots[i];
+        }
+    }
+    free(oldSlots);
+    return true;
+}
+
+
+// caller holds the list write lock
+static bool ll_IndexInsert(LLIST_HDR *llhdr, LLIST_LB *item)
+{
+    LLIST_INDEX *index = llhdr->index;
+    uint slot;
+
+    // keep the table at most half full so probe sequences stay short
+    if ((llhdr->count + 1) * 2 > index->size) {
+        if (!ll_IndexGrow(index)) {
+            return false;
+        }
+    }
+    slot = ll_IndexSlot(index, index->key(item));
+    if (index->slots[slot] != NULL) {
+        // duplicate key
+        return false;
+    }
+    if (llhdr->count == index->itemsSize) {
+        uint newSize = (index->itemsSize) ? index->itemsSize * 2 : 16;
+        LLIST_LB **items = (LLIST_LB **)realloc(index->items, newSize * sizeof(LLIST_LB *));
+        if (items == NULL) {
+            return false;
+        }
+        index->items = items;
+        index->itemsSize = newSize;
+    }
+    index->slots[slot] = item;
+    index->items[llhdr->count] = item;
+    return true;
+}
+
+
+// caller holds the list write lock
+static void ll_IndexRemove(LLIST_HDR *llhdr, LLIST_LB *item)
+{
+    LLIST_INDEX *index = llhdr->index;
+    uint mask = index->size - 1;
+    uint slot = ll_IndexSlot(index, index->key(item));
+    uint next;
+
+    uint i;
+
+    if (index->slots[slot] != item) {
+        // not indexed
+        return;
+    }
+    index->slots[slot] = NULL;
+
+    // close the gap in items[], keeping list order. Deletes are rare, creates just append.
+    for (i = 0; i < llhdr->count; i++) {
+        if (index->items[i] == item) {
+            memmove(&index->items[i], &index->items[i + 1], (llhdr->count - i - 1) * sizeof(LLIST_LB *));
+            break;
+        }
+    }
+
+    // backward shift deletion, so lookups never need tombstones
+    next = (slot + 1) & mask;
+    while (index->slots[next] != NULL) {
+        uint home = ll_IndexHash(index, index->key(index->slots[next]));
+        // move the entry into the hole if its home slot is not between the hole and its current slot
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            index->slots[slot] = index->slots[next];
+            index->slots[next] = NULL;
+            slot = next;
+        }
+        next = (next + 1) & mask;
+    }
+}
+
 
 void ll_Init(LLIST_HDR *llhdr, const uint max)
 {
-    SemaInit(llistMutex);
     memset(llhdr, 0, sizeof(LLIST_HDR));
+    RwLockInit(llhdr->lock);
     llhdr->max = max;
 }
 
 
+bool ll_InitIndexed(LLIST_HDR *llhdr, const uint max, ll_key_function key)
+{
+    ll_Init(llhdr, max);
+
+    LLIST_INDEX *index = (LLIST_INDEX *)calloc(1, sizeof(LLIST_INDEX));
+    if (index == NULL) {
+        panic();
+        return false;
+    }
+    index->key = key;
+    if (!ll_IndexAlloc(index, 16)) {
+        free(index);
+        panic();
+        return false;
+    }
+    llhdr->index = index;
+    return true;
+}
+
+
+void* ll_Find(LLIST_HDR *llhdr, const uint32_t key)
+{
+    LLIST_LB *item;
+
+    RwLockRead(llhdr->lock);
+    if (llhdr->index == NULL) {
+        RwUnlockRead(llhdr->lock);
+        panic();
+        return NULL;
+    }
+    item = llhdr->index->slots[ll_IndexSlot(llhdr->index, key)];
+    RwUnlockRead(llhdr->lock);
+    return item;
+}
+
+
 uint ll_GetCount(LLIST_HDR *llhdr)
 {
-    SemaWait(llistMutex);
+    RwLockRead(llhdr->lock);
     uint r = llhdr->count;
-    SemaFree(llistMutex);
+    RwUnlockRead(llhdr->lock);
     return r;
 }
 
 
 bool ll_Enqueue(LLIST_HDR *llhdr, void *newitem)
 {
-    SemaWait(llistMutex);
+    RwLockWrite(llhdr->lock);
 
     if (llhdr->count >= llhdr->max) {
-        SemaFree(llistMutex);
+        RwUnlockWrite(llhdr->lock);
         // todo3 throw a panic here?
         return false;
     }
 
     LLIST_LB *newllb = (LLIST_LB *)newitem;
+
+    if (llhdr->index != NULL && !ll_IndexInsert(llhdr, newllb)) {
+        // duplicate key (or out of memory)
+        RwUnlockWrite(llhdr->lock);
+        return false;
+    }
+
     newllb->next = NULL;
 
     if (llhdr->count == 0) {
@@ -75,20 +253,20 @@ bool ll_Enqueue(LLIST_HDR *llhdr, void *newitem)
         llhdr->last = newllb;
     }
     llhdr->count++;
-    SemaFree(llistMutex);
+    RwUnlockWrite(llhdr->lock);
     return true;
 }
 
 
 void* ll_Dequeue(LLIST_HDR *llhdr)
 {
-    SemaWait(llistMutex);
+    RwLockWrite(llhdr->lock);
     LLIST_LB *firstblk = llhdr->first;
 
     switch (llhdr->count) {
     case 0:
         // throw panic
-        SemaFree(llistMutex);
+        RwUnlockWrite(llhdr->lock);
         return NULL;
 
     case 1:
@@ -101,8 +279,11 @@ void* ll_Dequeue(LLIST_HDR *llhdr)
         break;
     }
 
+    if (llhdr->index != NULL) {
+        ll_IndexRemove(llhdr, firstblk);
+    }
     llhdr->count--;
-    SemaFree(llistMutex);
+    RwUnlockWrite(llhdr->lock);
     return firstblk;
 }
 
@@ -112,7 +293,6 @@ void* ll_Dequeue(LLIST_HDR *llhdr)
 
 static void ll_Remove(LLIST_HDR *llhdr, LLIST_LB *toRemove)
 {
-    SemaWait(llistMutex);
     if (llhdr->prior == NULL) {
         // we know we are removing the first block.
         llhdr->first = toRemove->next;
@@ -121,20 +301,25 @@ static void ll_Remove(LLIST_HDR *llhdr, LLIST_LB *toRemove)
         // we are removing 2... could also be 2nd and last...
         llhdr->prior->next = toRemove->next;
     }
+    if (llhdr->last == toRemove) {
+        llhdr->last = llhdr->prior;
+    }
+    if (llhdr->index != NULL) {
+        ll_IndexRemove(llhdr, toRemove);
+    }
     llhdr->count--;
-    SemaFree(llistMutex);
 }
 
 
 void* ll_Pluck(LLIST_HDR *llhdr, void *matchitem, bool(match)(void *listitem, void *matchitem))
 {
-    SemaWait(llistMutex);
+    RwLockWrite(llhdr->lock);
 
     llhdr->prior = NULL;
 
     if (llhdr->count == 0) {
         // dont throw a panic, this will happen often while watching a queue for an item to arrive
-        SemaFree(llistMutex);
+        RwUnlockWrite(llhdr->lock);
         return NULL;
     }
 
@@ -144,7 +329,7 @@ void* ll_Pluck(LLIST_HDR *llhdr, void *matchitem, bool(match)(void *listitem, vo
         if (match(examineblk, matchitem)) {
             // we have one, remove from list and return
             ll_Remove(llhdr, examineblk);
-            SemaFree(llistMutex);
+            RwUnlockWrite(llhdr->lock);
             return examineblk;
         }
         llhdr->prior = examineblk;
@@ -152,26 +337,32 @@ void* ll_Pluck(LLIST_HDR *llhdr, void *matchitem, bool(match)(void *listitem, vo
     } while (examineblk != NULL);
 
 
-    SemaFree(llistMutex);
+    RwUnlockWrite(llhdr->lock);
     return examineblk;
 }
 
 
 void* ll_GetPtr(LLIST_HDR *llhdr, const uint index)
 {
-    SemaWait(llistMutex);
+    RwLockRead(llhdr->lock);
 
     if (llhdr->count == 0 || index >= llhdr->count ) {
-        SemaFree(llistMutex);
+        RwUnlockRead(llhdr->lock);
         panic();
         return NULL;
     }
 
+    if (llhdr->index != NULL) {
+        LLIST_LB *item = llhdr->index->items[index];
+        RwUnlockRead(llhdr->lock);
+        return item;
+    }
+
     uint count = 0;
     LLIST_LB *examineblk = llhdr->first;
     do {
         if ( count == index ) {
-            SemaFree(llistMutex);
+            RwUnlockRead(llhdr->lock);
             return examineblk;
         }
         examineblk = examineblk->next;
@@ -179,7 +370,7 @@ void* ll_GetPtr(LLIST_HDR *llhdr, const uint index)
     } while ( count < llhdr->count );
     
     panic();
-    SemaFree(llistMutex);
+    RwUnlockRead(llhdr->lock);
     return NULL ;
 }
 
@@ -43,13 +43,32 @@ struct _LLIST_LB
 	LLIST_LB *next;
 } ;
 
-typedef struct 
+// Returns the lookup key of a list item (e.g. the object instance of a BACNET_OBJECT)
+typedef uint32_t (*ll_key_function)(void *listitem);
+
+// Optional key -> item hash index, maintained by ll_Enqueue(), ll_Dequeue() and ll_Pluck()
+// Open addressing, linear probing, always at most half full.
+// Also keeps the items in list order in a dense array, so ll_GetPtr() is O(1) and walking
+// a whole object list by index (e.g. for the Device Object_List) is linear, not quadratic.
+typedef struct
+{
+	uint			size;           // number of slots, always a power of two
+	uint			shift;          // 32 - log2(size), for the multiplicative hash
+	ll_key_function	key;
+	LLIST_LB		**slots;
+	uint			itemsSize;      // capacity of items[], grows by doubling
+	LLIST_LB		**items;        // items[0..count-1] in list order
+} LLIST_INDEX;
+
+typedef struct
 {
 	uint		count;          // turns out ARM uint8_t operations are not atomic. (confirmation required)
 	uint		max;            // regardless, these are now fully protected, so can be any size.
 	LLIST_LB	*first;
 	LLIST_LB	*last;
 	LLIST_LB	*prior;
+	LLIST_INDEX	*index;         // NULL unless the list was set up with ll_InitIndexed()
+	RwLockDefine(lock);         // per list, readers (ll_Find, ll_GetPtr, ll_GetCount) share it
 } LLIST_HDR, QUEUE_HDR;
 
 void    ll_Init(LLIST_HDR *cb, const uint max);
@@ -57,6 +76,11 @@ uint    ll_GetCount(LLIST_HDR *cb ) ;
 bool    ll_Enqueue(LLIST_HDR *cb, void *newitem);
 void   *ll_Dequeue(LLIST_HDR *cb);
 void   *ll_Pluck(LLIST_HDR *llhdr, void *matchitem, bool (match)(void *listitem, void *matchitem));
+
+// Keyed lists. Keys must be unique, ll_Enqueue() refuses an item whose key is already present,
+// and the key of an item must not change while it is in the list.
+bool    ll_InitIndexed(LLIST_HDR *cb, const uint max, ll_key_function key);
+void   *ll_Find(LLIST_HDR *cb, const uint32_t key);
 
 // gets a pointer to the nth item in the list - This pointer will no longer be protected by a critical section !!!
 void   *ll_GetPtr(LLIST_HDR *llhdr, const uint index);
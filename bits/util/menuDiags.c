@@ -49,6 +49,7 @@ void ShowMenuHelp(void)
     log_printf("      I) Show IPC handshake (%s)", showIPChandshake ? "On" : "Off" );
     log_printf("      A) Address cache   T)SM cache");
     log_printf("      C) Create Test Configuration");
+    log_printf("      S) Save object snapshot");
     log_printf("");
 }
 
@@ -78,6 +79,12 @@ bool doUserMenu(void) {
         case 'O':
             ShowNextObject();
             break;
+        case 'S':
+            if (SaveBACnetSnapshot())
+                log_printf("Object snapshot saved");
+            else
+                log_printf("Object snapshot failed");
+            break;
         case 'Q':
             return false;
         default:
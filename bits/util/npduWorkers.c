@@ -0,0 +1,781 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "config.h"
+#include "datalink.h"
+#include "osLayer.h"
+#include "bitsDebug.h"
+#include "npduWorkers.h"
+
+// One queue entry, owned by the queue while on the free list or a worker's pending FIFO, and
+// by whoever took it off in between (the datalink thread filling it, or a worker handling it)
+typedef struct
+{
+    BACNET_ADDRESS  src;
+    uint16_t        pdu_len;
+    uint8_t         pdu[MAX_MPDU];
+} NPDU_WORK;
+
+// One worker thread and the NPDUs waiting for it. Every NPDU from one source goes to the same
+// worker, so a peer's messages (segments, a request and its retry) are handled in the order
+// they arrived, and only different peers are handled side by side.
+typedef struct
+{
+    unsigned        Pending_Slots[MAX_WORKER_QUEUE];
+    unsigned        Pending_Head;
+    unsigned        Pending_Count;
+    CountSemaDefine(Work_Ready);        // one count per pending NPDU, plus one to stop
+} NPDU_WORKER;
+
+static NPDU_WORK    Work[MAX_WORKER_QUEUE];
+static NPDU_WORKER  Workers[MAX_WORKER_THREADS];
+
+// Queue_Lock guards the free list, the pending FIFOs and the counts, never the entries themselves
+static LockDefine(Queue_Lock);
+static unsigned     Free_Slots[MAX_WORKER_QUEUE];
+static unsigned     Free_Count;
+static unsigned     Workers_Running;
+static bool         Workers_Stopping;
+
+static CountSemaDefine(Worker_Exited);
+
+static npduWorkers_Handler Worker_Handler;
+static bool         Workers_Initialized;
+
+
+// FNV-1a over the source address, as the TSM hashes its peers
+static uint32_t npduWorkers_Hash(BACNET_ADDRESS *src)
+{
+    uint32_t hash = 2166136261u;
+    unsigned i;
+
+    for (i = 0; i < src->mac_len && i < MAX_MAC_LEN; i++) {
+        hash = (hash ^ src->mac[i]) * 16777619u;
+    }
+    hash = (hash ^ (uint8_t)src->net) * 16777619u;
+    hash = (hash ^ (uint8_t)(src->net >> 8)) * 16777619u;
+    for (i = 0; i < src->len && i < MAX_MAC_LEN; i++) {
+        hash = (hash ^ src->adr[i]) * 16777619u;
+    }
+    return hash;
+}
+
+
+static void npduWorkers_Thread(void *arg)
+{
+    NPDU_WORKER *worker = (NPDU_WORKER *)arg;
+    unsigned slot;
+
+    for (;;) {
+        CountSemaWait(worker->Work_Ready);
+        LockTransaction(Queue_Lock);
+        if (worker->Pending_Count == 0) {
+            if (Workers_Stopping) {
+                Workers_Running--;
+                UnlockTransaction(Queue_Lock);
+                CountSemaPost(Worker_Exited);
+                return;
+            }
+            UnlockTransaction(Queue_Lock);
+            continue;
+        }
+        slot = worker->Pending_Slots[worker->Pending_Head];
+        worker->Pending_Head = (worker->Pending_Head + 1) % MAX_WORKER_QUEUE;
+        worker->Pending_Count--;
+        UnlockTransaction(Queue_Lock);
+
+        Worker_Handler(&Work[slot].src, &Work[slot].pdu[0], Work[slot].pdu_len);
+
+        LockTransaction(Queue_Lock);
+        Free_Slots[Free_Count++] = slot;
+        UnlockTransaction(Queue_Lock);
+    }
+}
+
+
+void npduWorkers_Init(unsigned count, npduWorkers_Handler handler)
+{
+    unsigned i;
+
+    if (!Workers_Initialized) {
+        LockTransactionInit(Queue_Lock);
+        for (i = 0; i < MAX_WORKER_THREADS; i++) {
+            CountSemaInit(Workers[i].Work_Ready, 0);
+        }
+        CountSemaInit(Worker_Exited, 0);
+        Workers_Initialized = true;
+    }
+    if (handler == NULL || count == 0 || count > MAX_WORKER_THREADS) {
+        panic();
+        return;
+    }
+
+    LockTransaction(Queue_Lock);
+    if (Workers_Running != 0) {
+        // the pool is sized once, or a source would move to another worker mid-conversation
+        UnlockTransaction(Queue_Lock);
+        panic();
+        return;
+    }
+    Worker_Handler = handler;
+    Workers_Stopping = false;
+    for (i = 0; i < MAX_WORKER_QUEUE; i++) {
+        Free_Slots[i] = i;
+    }
+    Free_Count = MAX_WORKER_QUEUE;
+    for (i = 0; i < count; i++) {
+        Workers[i].Pending_Head = 0;
+        Workers[i].Pending_Count = 0;
+    }
+    Workers_Running = count;
+    UnlockTransaction(Queue_Lock);
+
+    for (i = 0; i < count; i++) {
+        bitsCreateThread(npduWorkers_Thread, &Workers[i]);
+    }
+}
+
+
+bool npduWorkers_Dispatch(BACNET_ADDRESS *src, uint8_t *pdu, uint16_t pdu_len)
+{
+    NPDU_WORKER *worker;
+    unsigned slot;
+
+    if (pdu_len > MAX_MPDU) {
+        return false;
+    }
+    LockTransaction(Queue_Lock);
+    if (Free_Count == 0 || Workers_Running == 0 || Workers_Stopping) {
+        UnlockTransaction(Queue_Lock);
+        return false;
+    }
+    slot = Free_Slots[--Free_Count];
+    worker = &Workers[npduWorkers_Hash(src) % Workers_Running];
+    UnlockTransaction(Queue_Lock);
+
+    // the slot is ours until it is on the pending FIFO, copy outside the lock
+    Work[slot].src = *src;
+    Work[slot].pdu_len = pdu_len;
+    memcpy(&Work[slot].pdu[0], pdu, pdu_len);
+
+    LockTransaction(Queue_Lock);
+    if (Workers_Stopping) {
+        // stopped while we copied, the worker may be gone already
+        Free_Slots[Free_Count++] = slot;
+        UnlockTransaction(Queue_Lock);
+        return false;
+    }
+    worker->Pending_Slots[(worker->Pending_Head + worker->Pending_Count) % MAX_WORKER_QUEUE] = slot;
+    worker->Pending_Count++;
+    UnlockTransaction(Queue_Lock);
+    CountSemaPost(worker->Work_Ready);
+
+    return true;
+}
+
+
+unsigned npduWorkers_Pending(void)
+{
+    unsigned count;
+
+    LockTransaction(Queue_Lock);
+    count = MAX_WORKER_QUEUE - Free_Count;
+    UnlockTransaction(Queue_Lock);
+    return count;
+}
+
+
+void npduWorkers_Stop(void)
+{
+    unsigned count, i;
+
+    LockTransaction(Queue_Lock);
+    count = Workers_Running;
+    Workers_Stopping = true;
+    UnlockTransaction(Queue_Lock);
+
+    // each worker exits when it finds its queue empty after this
+    for (i = 0; i < count; i++) {
+        CountSemaPost(Workers[i].Work_Ready);
+    }
+    for (i = 0; i < count; i++) {
+        CountSemaWait(Worker_Exited);
+    }
+}
+
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include "ctest.h"
+#include "bacdcode.h"
+#include "bacstr.h"
+#include "rp.h"
+
+#if defined(TEST_NPDU_WORKERS) || defined(TEST_STACK_STRESS)
+/* dummy function stubs */
+void sys_panic(const char *file, const int line)
+{
+    (void)file;
+    (void)line;
+}
+
+void log_printf(const char *fmt, ...)
+{
+    (void)fmt;
+}
+#endif
+
+static void testWaitIdle(void)
+{
+    while (npduWorkers_Pending() != 0) {
+        sched_yield();
+    }
+}
+
+
+static LockDefine(Test_Lock);
+static unsigned Test_Handled;
+static unsigned Test_Sum;
+static CountSemaDefine(Test_Gate);
+static bool Test_Gated;
+
+static void testCountingHandler(BACNET_ADDRESS *src, uint8_t *pdu, uint16_t pdu_len)
+{
+    if (Test_Gated) {
+        CountSemaWait(Test_Gate);
+    }
+    LockTransaction(Test_Lock);
+    Test_Handled++;
+    if (pdu_len == 2 && src->mac_len == 1 && src->mac[0] == pdu[0]) {
+        Test_Sum += pdu[0] + pdu[1];
+    }
+    UnlockTransaction(Test_Lock);
+}
+
+
+void testNpduWorkers(
+    Test * pTest)
+{
+    BACNET_ADDRESS src = { 0 };
+    uint8_t pdu[MAX_MPDU + 1] = { 0 };
+    unsigned i, expected = 0;
+
+    LockTransactionInit(Test_Lock);
+    CountSemaInit(Test_Gate, 0);
+
+    npduWorkers_Init(3, testCountingHandler);
+    src.mac_len = 1;
+    for (i = 0; i < 200; i++) {
+        src.mac[0] = pdu[0] = (uint8_t)i;
+        pdu[1] = 1;
+        while (!npduWorkers_Dispatch(&src, pdu, 2)) {
+            sched_yield();
+        }
+        expected += (uint8_t)i + 1;
+    }
+    testWaitIdle();
+    ct_test(pTest, Test_Handled == 200);
+    ct_test(pTest, Test_Sum == expected);
+    ct_test(pTest, !npduWorkers_Dispatch(&src, pdu, MAX_MPDU + 1));
+
+    // hold the workers, the queue fills and then drops
+    Test_Gated = true;
+    Test_Handled = 0;
+    for (i = 0; i < MAX_WORKER_QUEUE; i++) {
+        ct_test(pTest, npduWorkers_Dispatch(&src, pdu, 2));
+    }
+    ct_test(pTest, !npduWorkers_Dispatch(&src, pdu, 2));
+    ct_test(pTest, npduWorkers_Pending() == MAX_WORKER_QUEUE);
+    for (i = 0; i < MAX_WORKER_QUEUE; i++) {
+        CountSemaPost(Test_Gate);
+    }
+    // what is queued is still handled, then nothing more is taken
+    npduWorkers_Stop();
+    Test_Gated = false;
+    ct_test(pTest, Test_Handled == MAX_WORKER_QUEUE);
+    ct_test(pTest, npduWorkers_Pending() == 0);
+    ct_test(pTest, !npduWorkers_Dispatch(&src, pdu, 2));
+
+    // and it starts again
+    npduWorkers_Init(1, testCountingHandler);
+    ct_test(pTest, npduWorkers_Dispatch(&src, pdu, 2));
+    testWaitIdle();
+    ct_test(pTest, Test_Handled == MAX_WORKER_QUEUE + 1);
+    npduWorkers_Stop();
+}
+
+
+#define TEST_ORDER_SOURCES  16
+#define TEST_ORDER_MESSAGES 2000
+
+static uint8_t Test_Next[TEST_ORDER_SOURCES];
+static unsigned Test_Out_Of_Order;
+
+static void testOrderHandler(BACNET_ADDRESS *src, uint8_t *pdu, uint16_t pdu_len)
+{
+    // each source's messages are numbered, and only its worker touches its counter
+    if (pdu_len == 1 && src->mac[0] < TEST_ORDER_SOURCES) {
+        if (pdu[0] != Test_Next[src->mac[0]]) {
+            LockTransaction(Test_Lock);
+            Test_Out_Of_Order++;
+            UnlockTransaction(Test_Lock);
+        }
+        Test_Next[src->mac[0]] = (uint8_t)(pdu[0] + 1);
+    }
+    sched_yield();
+}
+
+
+void testNpduWorkersOrder(
+    Test * pTest)
+{
+    BACNET_ADDRESS src = { 0 };
+    uint8_t pdu[1];
+    uint8_t sequence[TEST_ORDER_SOURCES] = { 0 };
+    unsigned i;
+
+    LockTransactionInit(Test_Lock);
+    npduWorkers_Init(4, testOrderHandler);
+    src.mac_len = 6;
+    for (i = 0; i < TEST_ORDER_MESSAGES; i++) {
+        src.mac[0] = (uint8_t)((i * 7) % TEST_ORDER_SOURCES);
+        pdu[0] = sequence[src.mac[0]];
+        while (!npduWorkers_Dispatch(&src, pdu, 1)) {
+            sched_yield();
+        }
+        sequence[src.mac[0]]++;
+    }
+    testWaitIdle();
+    npduWorkers_Stop();
+    ct_test(pTest, Test_Out_Of_Order == 0);
+    for (i = 0; i < TEST_ORDER_SOURCES; i++) {
+        ct_test(pTest, Test_Next[i] == sequence[i]);
+    }
+}
+
+
+// The loopback server: a store of objects and a "datalink" that counts what is sent back.
+// With one big lock each request is handled under it, as npdu_handler() is under stackLock.
+// Split, the object store is read locked just for the lookup and encode and the datalink
+// has a lock of its own, as the stack does with BACNET_STACK_LOCKS.
+
+#define TEST_OBJECTS        1000
+#define TEST_REQUESTS       50000
+#define TEST_NPDU_HEADER    2
+
+static float Test_Values[TEST_OBJECTS];
+static LockDefine(Test_Big_Lock);
+static RwLockDefine(Test_Object_Lock);
+static LockDefine(Test_Send_Lock);
+static bool Test_Split_Locks;
+static unsigned Test_Replies;
+static unsigned long Test_Reply_Bytes;
+
+static int testEncodeValue(BACNET_READ_PROPERTY_DATA *rpdata)
+{
+    BACNET_CHARACTER_STRING name;
+    char text[32];
+    uint8_t *apdu = rpdata->application_data;
+    int len = 0;
+
+    switch (rpdata->object_property) {
+        case PROP_PRESENT_VALUE:
+            len = encode_application_real(&apdu[0], Test_Values[rpdata->object_instance]);
+            break;
+        case PROP_OBJECT_NAME:
+            sprintf(text, "Zone %u Supply Air Temperature", rpdata->object_instance);
+            characterstring_init_ansi(&name, text);
+            len = encode_application_character_string(&apdu[0], &name);
+            break;
+        default:
+            len = encode_application_enumerated(&apdu[0], 0);
+            break;
+    }
+    return len;
+}
+
+// What h_rp.c does with a confirmed ReadProperty, less the error paths
+static void testServerHandler(BACNET_ADDRESS *src, uint8_t *pdu, uint16_t pdu_len)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    uint8_t value[MAX_APDU];
+    uint8_t reply[MAX_PDU];
+    uint8_t *apdu = &pdu[TEST_NPDU_HEADER];
+    uint8_t invoke_id = apdu[2];
+    int len;
+
+    (void)src;
+    if (!Test_Split_Locks) {
+        LockTransaction(Test_Big_Lock);
+    }
+    len = rp_decode_service_request(&apdu[4], pdu_len - TEST_NPDU_HEADER - 4, &rpdata);
+    if (len > 0 && rpdata.object_instance < TEST_OBJECTS) {
+        rpdata.application_data = &value[0];
+        if (Test_Split_Locks) {
+            RwLockRead(Test_Object_Lock);
+        }
+        rpdata.application_data_len = testEncodeValue(&rpdata);
+        if (Test_Split_Locks) {
+            RwUnlockRead(Test_Object_Lock);
+        }
+        reply[0] = BACNET_PROTOCOL_VERSION;
+        reply[1] = 0;
+        len = rp_ack_encode_apdu(&reply[TEST_NPDU_HEADER], invoke_id, &rpdata);
+        if (Test_Split_Locks) {
+            LockTransaction(Test_Send_Lock);
+        }
+        Test_Replies++;
+        Test_Reply_Bytes += TEST_NPDU_HEADER + len;
+        if (Test_Split_Locks) {
+            UnlockTransaction(Test_Send_Lock);
+        }
+    }
+    if (!Test_Split_Locks) {
+        UnlockTransaction(Test_Big_Lock);
+    }
+}
+
+
+static double testElapsedMs(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e3 + (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+
+void testNpduWorkersBenchmark(
+    Test * pTest)
+{
+    static const BACNET_PROPERTY_ID properties[] = {
+        PROP_PRESENT_VALUE, PROP_OBJECT_NAME, PROP_PRESENT_VALUE, PROP_STATUS_FLAGS
+    };
+    static const unsigned workers[] = { 1, 2, 4, 8 };
+    static uint8_t requests[64][MAX_PDU];
+    static uint16_t request_len[64];
+    FILE *stream = ct_getStream(pTest);
+    BACNET_READ_PROPERTY_DATA rpdata;
+    BACNET_ADDRESS src = { 0 };
+    struct timespec start;
+    unsigned i, w, split;
+    double ms;
+
+    LockTransactionInit(Test_Big_Lock);
+    LockTransactionInit(Test_Send_Lock);
+    RwLockInit(Test_Object_Lock);
+    for (i = 0; i < TEST_OBJECTS; i++) {
+        Test_Values[i] = 20.0f + (float)i / 100.0f;
+    }
+    // what the client puts on the wire, a round of 64 different requests
+    for (i = 0; i < 64; i++) {
+        rpdata.object_type = OBJECT_ANALOG_INPUT;
+        rpdata.object_instance = (i * 37) % TEST_OBJECTS;
+        rpdata.object_property = properties[i % 4];
+        rpdata.array_index = BACNET_ARRAY_ALL;
+        requests[i][0] = BACNET_PROTOCOL_VERSION;
+        requests[i][1] = 0x04;          // expecting reply
+        request_len[i] = (uint16_t)(TEST_NPDU_HEADER +
+            rp_encode_apdu(&requests[i][TEST_NPDU_HEADER], (uint8_t)(i + 1), &rpdata));
+    }
+    src.mac_len = 6;
+
+    fprintf(stream, "\n  %u ReadProperty requests over a loopback datalink, %ld core(s) online\n",
+        TEST_REQUESTS, sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(stream, "  %-8s %18s %18s\n", "workers", "one big lock", "split locks");
+    for (w = 0; w < sizeof(workers) / sizeof(workers[0]); w++) {
+        fprintf(stream, "  %-8u", workers[w]);
+        for (split = 0; split < 2; split++) {
+            Test_Split_Locks = (split == 1);
+            Test_Replies = 0;
+            Test_Reply_Bytes = 0;
+            npduWorkers_Init(workers[w], testServerHandler);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (i = 0; i < TEST_REQUESTS; i++) {
+                // 64 clients, each always handled by the same worker
+                src.mac[5] = (uint8_t)(i % 64);
+                // the client retries what the full queue drops
+                while (!npduWorkers_Dispatch(&src, requests[i % 64], request_len[i % 64])) {
+                    sched_yield();
+                }
+            }
+            testWaitIdle();
+            ms = testElapsedMs(&start);
+            npduWorkers_Stop();
+            ct_test(pTest, Test_Replies == TEST_REQUESTS);
+            fprintf(stream, " %10.0f req/s   ", TEST_REQUESTS * 1000.0 / ms);
+        }
+        fprintf(stream, "\n");
+    }
+}
+
+
+#ifdef TEST_STACK_STRESS
+#include "tsm.h"
+#include "address.h"
+#include "dcc.h"
+#include "datalink.h"
+#include "npdu.h"
+
+// The stack's own receive path and tick, driven against each other, to be run under
+// ThreadSanitizer (test/stackstress.mak). A "datalink" thread hands messages to the workers,
+// which learn bindings, start and answer confirmed requests and take DeviceCommunicationControl,
+// while this thread runs the timers that TickBACnetDevice() does.
+
+#define STRESS_MESSAGES     20000
+#define STRESS_DEVICES      64
+
+static LockDefine(Stress_Lock);
+static unsigned Stress_Handled;
+static unsigned Stress_Accepted;
+static unsigned Stress_Sent;
+static unsigned Stress_Timeouts;
+static bool Stress_Datalink_Done;
+
+/* dummy function stubs */
+int datalink_send_pdu(
+    BACNET_ADDRESS * dest,
+    BACNET_NPCI_DATA * npci_data,
+    uint8_t * pdu,
+    unsigned pdu_len)
+{
+    (void)dest;
+    (void)npci_data;
+    (void)pdu;
+    LockTransaction(Stress_Lock);
+    Stress_Sent++;
+    UnlockTransaction(Stress_Lock);
+    return (int)pdu_len;
+}
+
+void datalink_get_my_address(
+    BACNET_ADDRESS * my_address)
+{
+    memset(my_address, 0, sizeof(*my_address));
+}
+
+void datalink_get_broadcast_address(
+    BACNET_ADDRESS * dest)
+{
+    memset(dest, 0, sizeof(*dest));
+}
+
+uint16_t apdu_timeout(
+    void)
+{
+    return 1000;
+}
+
+uint8_t apdu_retries(
+    void)
+{
+    return 1;
+}
+
+uint16_t apdu_segment_timeout(
+    void)
+{
+    return 1000;
+}
+
+// called by tsm_timer_milliseconds() once it has let go of the TSM, as an application's would be
+static void testStressTimeout(uint8_t invoke_id)
+{
+    tsm_free_invoke_id(invoke_id);
+    LockTransaction(Stress_Lock);
+    Stress_Timeouts++;
+    UnlockTransaction(Stress_Lock);
+}
+
+// What a worker does with a message: [0..1] the sending device, [2] what to do with it
+static void testStressHandler(BACNET_ADDRESS *src, uint8_t *pdu, uint16_t pdu_len)
+{
+    BACNET_NPCI_DATA npci_data;
+    BACNET_ADDRESS dest;
+    unsigned max_apdu = 0;
+    uint32_t device_id = ((uint32_t)pdu[0] << 8) | pdu[1];
+    uint8_t invoke_id;
+
+    address_add(device_id, MAX_APDU, src);
+    if (address_bind_request(device_id, &max_apdu, &dest) &&
+        !dcc_communication_initiation_disabled()) {
+        invoke_id = tsm_next_free_invokeID();
+        if (invoke_id) {
+            npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
+            tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest, &npci_data, pdu, pdu_len);
+            datalink_send_pdu(&dest, &npci_data, pdu, pdu_len);
+            // most are answered, the rest are left for the tick to time out
+            if (pdu[2] & 3) {
+                tsm_free_invoke_id(invoke_id);
+            }
+        }
+    }
+    if (pdu[2] == 0x40) {
+        dcc_set_status_duration(COMMUNICATION_DISABLE_INITIATION, 1);
+    } else if (pdu[2] == 0x80) {
+        dcc_set_status_duration(COMMUNICATION_ENABLE, 0);
+    }
+    (void)dcc_duration_seconds();
+
+    LockTransaction(Stress_Lock);
+    Stress_Handled++;
+    UnlockTransaction(Stress_Lock);
+}
+
+static void testStressDatalink(void *pArgs)
+{
+    BACNET_ADDRESS src = { 0 };
+    uint8_t pdu[3];
+    unsigned i, accepted = 0;
+
+    (void)pArgs;
+    src.mac_len = 1;
+    for (i = 0; i < STRESS_MESSAGES; i++) {
+        src.mac[0] = (uint8_t)(i % STRESS_DEVICES);
+        pdu[0] = 0;
+        pdu[1] = src.mac[0];
+        pdu[2] = (uint8_t)(i * 7);
+        if (npduWorkers_Dispatch(&src, pdu, sizeof(pdu))) {
+            accepted++;
+        } else {
+            // a full queue drops, as a busy datalink would
+            sched_yield();
+        }
+    }
+    LockTransaction(Stress_Lock);
+    Stress_Accepted = accepted;
+    Stress_Datalink_Done = true;
+    UnlockTransaction(Stress_Lock);
+}
+
+static void testStressTick(void)
+{
+    tsm_timer_milliseconds(10);
+    dcc_timer_seconds(1);
+    address_cache_timer(1);
+}
+
+void testStackStress(
+    Test * pTest)
+{
+    BACNET_ADDRESS dest;
+    unsigned max_apdu = 0;
+    unsigned i, ticks = 0;
+    bool done = false;
+
+    address_init();
+    dcc_init();
+    tsm_init();
+    tsm_set_timeout_handler(testStressTimeout);
+
+    npduWorkers_Init(4, testStressHandler);
+    bitsCreateThread(testStressDatalink, NULL);
+    while (!done || npduWorkers_Pending() != 0) {
+        testStressTick();
+        ticks++;
+        sched_yield();
+        LockTransaction(Stress_Lock);
+        done = Stress_Datalink_Done;
+        UnlockTransaction(Stress_Lock);
+    }
+    npduWorkers_Stop();
+    fprintf(ct_getStream(pTest), "\n  %u of %u messages handled, %u ticks alongside\n",
+        Stress_Handled, STRESS_MESSAGES, ticks);
+
+    // everything that was taken was handled once
+    ct_test(pTest, Stress_Accepted > 0);
+    ct_test(pTest, Stress_Handled == Stress_Accepted);
+    ct_test(pTest, Stress_Sent > 0);
+
+    // what was left to time out does, and the TSM ends up empty
+    for (i = 0; i < (apdu_retries() + 1u) * apdu_timeout() / 10u; i++) {
+        testStressTick();
+    }
+    ct_test(pTest, tsm_transaction_idle_count() == MAX_TSM_TRANSACTIONS);
+
+    // the bindings are all there
+    for (i = 0; i < STRESS_DEVICES; i++) {
+        ct_test(pTest, address_get_by_device(i, &max_apdu, &dest));
+    }
+    ct_test(pTest, dcc_set_status_duration(COMMUNICATION_ENABLE, 0));
+    ct_test(pTest, dcc_communication_enabled());
+    tsm_set_timeout_handler(NULL);
+}
+
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Stack Stress", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testStackStress);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_STACK_STRESS */
+
+#ifdef TEST_NPDU_WORKERS
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet NPDU Workers", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testNpduWorkers);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testNpduWorkersOrder);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testNpduWorkersBenchmark);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_NPDU_WORKERS */
+#endif /* TEST */
@@ -0,0 +1,54 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacdef.h"
+
+// A pool of threads that handle received NPDUs, so that one slow request (or one busy core)
+// does not hold up the rest. The datalink thread copies each NPDU into a queue of
+// MAX_WORKER_QUEUE entries and goes back to receiving; a full queue drops the NPDU, as a busy
+// network would, and the client retries. The worker is picked by a hash of the source address,
+// so the NPDUs from one source are handled one at a time, in the order they arrived.
+
+// The signature of npdu_handler()
+typedef void (*npduWorkers_Handler)(BACNET_ADDRESS *src, uint8_t *pdu, uint16_t pdu_len);
+
+// Starts count threads (at most MAX_WORKER_THREADS), each taking NPDUs from its queue and
+// passing them to handler. Not again until npduWorkers_Stop() has returned.
+void     npduWorkers_Init(unsigned count, npduWorkers_Handler handler);
+
+// Copies the NPDU to the queue. False if it was dropped, the queue being full or the NPDU too long.
+bool     npduWorkers_Dispatch(BACNET_ADDRESS *src, uint8_t *pdu, uint16_t pdu_len);
+
+// NPDUs queued or being handled
+unsigned npduWorkers_Pending(void);
+
+// Lets the workers finish what is queued, and returns once they have all exited
+void     npduWorkers_Stop(void);
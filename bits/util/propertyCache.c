@@ -0,0 +1,640 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "propertyCache.h"
+#include "osLayer.h"
+#include "bitsDebug.h"
+
+typedef struct _PC_FRAGMENT PC_FRAGMENT;
+
+struct _PC_FRAGMENT
+{
+    PC_FRAGMENT         *next;
+    BACNET_PROPERTY_ID  property;
+    uint32_t            arrayIndex;
+    uint16_t            length;
+    uint8_t             data[1];
+};
+
+// One slot per object that has been read, keyed on type and instance. Open addressing, linear
+// probing, at most half full. Invalidating an object frees its fragments but keeps its slot,
+// it will most likely be read again.
+typedef struct
+{
+    uint32_t        key;
+    bool            used;
+    PC_FRAGMENT     *fragments;
+} PC_SLOT;
+
+static PC_SLOT *Cache_Slots;
+static unsigned Cache_Size;         // always a power of two
+static unsigned Cache_Shift;        // 32 - log2(Cache_Size)
+static unsigned Cache_Count;
+static size_t Cache_Bytes;
+static unsigned long Cache_Hits;
+static unsigned long Cache_Misses;
+static RwLockDefine(Cache_Lock);
+
+
+static uint32_t pc_Key(
+    const BACNET_OBJECT_TYPE objectType,
+    const uint32_t objectInstance)
+{
+    return ((uint32_t)objectType << 22) | (objectInstance & BACNET_MAX_INSTANCE);
+}
+
+
+static PC_SLOT *pc_Slot(
+    const uint32_t key)
+{
+    unsigned mask = Cache_Size - 1;
+    unsigned slot;
+
+    if (Cache_Size == 0) {
+        return NULL;
+    }
+    slot = (key * 2654435769u) >> Cache_Shift;
+    while (Cache_Slots[slot].used) {
+        if (Cache_Slots[slot].key == key) {
+            return &Cache_Slots[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+
+static bool pc_Grow(
+    void)
+{
+    PC_SLOT *oldSlots = Cache_Slots;
+    unsigned oldSize = Cache_Size;
+    unsigned newSize = (oldSize) ? oldSize * 2 : 256;
+    unsigned mask = newSize - 1;
+    unsigned shift = 32;
+    unsigned i, slot;
+
+    for (i = newSize; i > 1; i >>= 1) {
+        shift--;
+    }
+    Cache_Slots = (PC_SLOT *)calloc(newSize, sizeof(PC_SLOT));
+    if (Cache_Slots == NULL) {
+        Cache_Slots = oldSlots;
+        return false;
+    }
+    Cache_Size = newSize;
+    Cache_Shift = shift;
+    for (i = 0; i < oldSize; i++) {
+        if (oldSlots[i].used) {
+            slot = (oldSlots[i].key * 2654435769u) >> shift;
+            while (Cache_Slots[slot].used) {
+                slot = (slot + 1) & mask;
+            }
+            Cache_Slots[slot] = oldSlots[i];
+        }
+    }
+    free(oldSlots);
+    return true;
+}
+
+
+static PC_SLOT *pc_Add(
+    const uint32_t key)
+{
+    PC_SLOT *entry = pc_Slot(key);
+    unsigned mask, slot;
+
+    if (entry != NULL) {
+        return entry;
+    }
+    if ((Cache_Count + 1) * 2 > Cache_Size) {
+        if (!pc_Grow()) {
+            return NULL;
+        }
+    }
+    mask = Cache_Size - 1;
+    slot = (key * 2654435769u) >> Cache_Shift;
+    while (Cache_Slots[slot].used) {
+        slot = (slot + 1) & mask;
+    }
+    Cache_Slots[slot].used = true;
+    Cache_Slots[slot].key = key;
+    Cache_Slots[slot].fragments = NULL;
+    Cache_Count++;
+    return &Cache_Slots[slot];
+}
+
+
+static void pc_Free(
+    PC_SLOT *entry)
+{
+    PC_FRAGMENT *fragment = entry->fragments;
+
+    while (fragment != NULL) {
+        PC_FRAGMENT *next = fragment->next;
+        Cache_Bytes -= sizeof(PC_FRAGMENT) + fragment->length;
+        free(fragment);
+        fragment = next;
+    }
+    entry->fragments = NULL;
+}
+
+
+void pc_Init(
+    void)
+{
+    RwLockInit(Cache_Lock);
+}
+
+
+bool pc_Cacheable(
+    const BACNET_OBJECT_TYPE objectType,
+    const BACNET_PROPERTY_ID property)
+{
+    if (objectType == OBJECT_DEVICE) {
+        return false;
+    }
+    switch (property) {
+    case PROP_OBJECT_IDENTIFIER:
+    case PROP_OBJECT_NAME:
+    case PROP_OBJECT_TYPE:
+    case PROP_DESCRIPTION:
+    case PROP_UNITS:
+    case PROP_PROPERTY_LIST:
+    case PROP_ACTIVE_TEXT:
+    case PROP_INACTIVE_TEXT:
+    case PROP_STATE_TEXT:
+    case PROP_NUMBER_OF_STATES:
+    case PROP_PROFILE_NAME:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+bool pc_Read(
+    BACNET_READ_PROPERTY_DATA *rpdata,
+    int *apdu_len)
+{
+    PC_SLOT *entry;
+    PC_FRAGMENT *fragment;
+    bool found = false;
+
+    if (!pc_Cacheable(rpdata->object_type, rpdata->object_property)) {
+        return false;
+    }
+    RwLockRead(Cache_Lock);
+    entry = pc_Slot(pc_Key(rpdata->object_type, rpdata->object_instance));
+    if (entry != NULL) {
+        for (fragment = entry->fragments; fragment != NULL; fragment = fragment->next) {
+            if (fragment->property == rpdata->object_property &&
+                fragment->arrayIndex == rpdata->array_index) {
+                // too big for what is left of the APDU, the read handler reports that
+                if (fragment->length <= rpdata->application_data_len) {
+                    memcpy(rpdata->application_data, fragment->data, fragment->length);
+                    *apdu_len = fragment->length;
+                    found = true;
+                }
+                break;
+            }
+        }
+    }
+    RwUnlockRead(Cache_Lock);
+
+    // statistics only, a lost update does not matter
+    if (found) {
+        Cache_Hits++;
+    }
+    else {
+        Cache_Misses++;
+    }
+    return found;
+}
+
+
+void pc_Store(
+    const BACNET_READ_PROPERTY_DATA *rpdata,
+    const int apdu_len)
+{
+    PC_SLOT *entry;
+    PC_FRAGMENT *fragment;
+
+    if (apdu_len <= 0 || apdu_len > PROPERTY_CACHE_MAX_FRAGMENT ||
+        !pc_Cacheable(rpdata->object_type, rpdata->object_property)) {
+        return;
+    }
+    RwLockWrite(Cache_Lock);
+    if (Cache_Bytes + sizeof(PC_FRAGMENT) + apdu_len > PROPERTY_CACHE_MAX_BYTES) {
+        RwUnlockWrite(Cache_Lock);
+        return;
+    }
+    entry = pc_Add(pc_Key(rpdata->object_type, rpdata->object_instance));
+    if (entry == NULL) {
+        RwUnlockWrite(Cache_Lock);
+        return;
+    }
+    // another reader may have got here first
+    for (fragment = entry->fragments; fragment != NULL; fragment = fragment->next) {
+        if (fragment->property == rpdata->object_property &&
+            fragment->arrayIndex == rpdata->array_index) {
+            RwUnlockWrite(Cache_Lock);
+            return;
+        }
+    }
+    fragment = (PC_FRAGMENT *)malloc(sizeof(PC_FRAGMENT) + apdu_len);
+    if (fragment != NULL) {
+        fragment->property = rpdata->object_property;
+        fragment->arrayIndex = rpdata->array_index;
+        fragment->length = (uint16_t)apdu_len;
+        memcpy(fragment->data, rpdata->application_data, apdu_len);
+        fragment->next = entry->fragments;
+        entry->fragments = fragment;
+        Cache_Bytes += sizeof(PC_FRAGMENT) + apdu_len;
+    }
+    RwUnlockWrite(Cache_Lock);
+}
+
+
+void pc_InvalidateObject(
+    const BACNET_OBJECT_TYPE objectType,
+    const uint32_t objectInstance)
+{
+    PC_SLOT *entry;
+
+    RwLockWrite(Cache_Lock);
+    entry = pc_Slot(pc_Key(objectType, objectInstance));
+    if (entry != NULL) {
+        pc_Free(entry);
+    }
+    RwUnlockWrite(Cache_Lock);
+}
+
+
+void pc_InvalidateAll(
+    void)
+{
+    unsigned i;
+
+    RwLockWrite(Cache_Lock);
+    for (i = 0; i < Cache_Size; i++) {
+        if (Cache_Slots[i].used) {
+            pc_Free(&Cache_Slots[i]);
+        }
+    }
+    RwUnlockWrite(Cache_Lock);
+}
+
+
+void pc_Stats(
+    unsigned long *hits,
+    unsigned long *misses,
+    size_t *bytes)
+{
+    if (hits) {
+        *hits = Cache_Hits;
+    }
+    if (misses) {
+        *misses = Cache_Misses;
+    }
+    if (bytes) {
+        *bytes = Cache_Bytes + Cache_Size * sizeof(PC_SLOT);
+    }
+}
+
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+#include "ctest.h"
+#include "bacdcode.h"
+#include "bacstr.h"
+
+#ifdef TEST_PROPERTY_CACHE
+/* dummy function stubs */
+void sys_panic(const char *file, const int line)
+{
+    (void)file;
+    (void)line;
+}
+
+void sys_dbTraffic(DBD_DebugDomain domain, DB_LEVEL lev, const char *format, ...)
+{
+    (void)domain;
+    (void)lev;
+    (void)format;
+}
+#endif
+
+#define TEST_OBJECTS    1000
+
+static const BACNET_PROPERTY_ID Test_Required[] = {
+    PROP_OBJECT_IDENTIFIER, PROP_OBJECT_NAME, PROP_OBJECT_TYPE, PROP_PRESENT_VALUE,
+    PROP_STATUS_FLAGS, PROP_EVENT_STATE, PROP_OUT_OF_SERVICE, PROP_UNITS,
+    MAX_BACNET_PROPERTY_ID
+};
+
+static const BACNET_PROPERTY_ID Test_Optional[] = {
+    PROP_DESCRIPTION, PROP_RELIABILITY, PROP_COV_INCREMENT, PROP_TIME_DELAY,
+    PROP_NOTIFICATION_CLASS, PROP_HIGH_LIMIT, PROP_LOW_LIMIT, PROP_DEADBAND,
+    PROP_LIMIT_ENABLE, PROP_EVENT_ENABLE, PROP_ACKED_TRANSITIONS, PROP_NOTIFY_TYPE,
+    PROP_EVENT_TIME_STAMPS, PROP_EVENT_DETECTION_ENABLE,
+    MAX_BACNET_PROPERTY_ID
+};
+
+static const BACNET_PROPERTY_ID Test_Proprietary[] = {
+    MAX_BACNET_PROPERTY_ID
+};
+
+static struct {
+    char        name[32];
+    uint16_t    units;
+    float       presentValue;
+} Test_Objects[TEST_OBJECTS];
+
+
+// as property_list_encode() does it, count the lists, then encode all but the three
+// properties that are always present
+static int testPropertyListEncode(BACNET_READ_PROPERTY_DATA *rpdata)
+{
+    const BACNET_PROPERTY_ID *lists[3] = { Test_Required, Test_Optional, Test_Proprietary };
+    uint8_t *apdu = rpdata->application_data;
+    uint32_t count = 0;
+    int apdu_len = 0;
+    unsigned l, i;
+
+    for (l = 0; l < 3; l++) {
+        for (i = 0; lists[l][i] != MAX_BACNET_PROPERTY_ID; i++) {
+            count++;
+        }
+    }
+    count -= 3;
+    if (rpdata->array_index == 0) {
+        return encode_application_unsigned(&apdu[0], count);
+    }
+    for (l = 0; l < 3; l++) {
+        for (i = 0; lists[l][i] != MAX_BACNET_PROPERTY_ID; i++) {
+            if (lists[l][i] == PROP_OBJECT_TYPE ||
+                lists[l][i] == PROP_OBJECT_IDENTIFIER ||
+                lists[l][i] == PROP_OBJECT_NAME) {
+                continue;
+            }
+            apdu_len += encode_application_enumerated(&apdu[apdu_len], lists[l][i]);
+        }
+    }
+    return apdu_len;
+}
+
+
+// The shape of Analog_Input_Read_Property(), plus the Property_List Device_Read_Property() does
+static int testReadProperty(BACNET_READ_PROPERTY_DATA *rpdata)
+{
+    BACNET_CHARACTER_STRING char_string;
+    uint8_t *apdu = rpdata->application_data;
+    int apdu_len = BACNET_STATUS_ERROR;
+
+    if (rpdata->object_instance >= TEST_OBJECTS) {
+        return BACNET_STATUS_ERROR;
+    }
+    switch (rpdata->object_property) {
+    case PROP_OBJECT_IDENTIFIER:
+        apdu_len = encode_application_object_id(&apdu[0], rpdata->object_type, rpdata->object_instance);
+        break;
+    case PROP_OBJECT_NAME:
+    case PROP_DESCRIPTION:
+        characterstring_init_ansi(&char_string, Test_Objects[rpdata->object_instance].name);
+        apdu_len = encode_application_character_string(&apdu[0], &char_string);
+        break;
+    case PROP_OBJECT_TYPE:
+        apdu_len = encode_application_enumerated(&apdu[0], rpdata->object_type);
+        break;
+    case PROP_UNITS:
+        apdu_len = encode_application_enumerated(&apdu[0], Test_Objects[rpdata->object_instance].units);
+        break;
+    case PROP_PRESENT_VALUE:
+        apdu_len = encode_application_real(&apdu[0], Test_Objects[rpdata->object_instance].presentValue);
+        break;
+    case PROP_PROPERTY_LIST:
+        apdu_len = testPropertyListEncode(rpdata);
+        break;
+    default:
+        rpdata->error_class = ERROR_CLASS_PROPERTY;
+        rpdata->error_code = ERROR_CODE_UNKNOWN_PROPERTY;
+        break;
+    }
+    return apdu_len;
+}
+
+
+// What Device_Read_Property() does with the cache
+static int testDeviceReadProperty(BACNET_READ_PROPERTY_DATA *rpdata, const bool useCache)
+{
+    int apdu_len;
+
+    if (useCache && pc_Read(rpdata, &apdu_len)) {
+        return apdu_len;
+    }
+    apdu_len = testReadProperty(rpdata);
+    if (useCache) {
+        pc_Store(rpdata, apdu_len);
+    }
+    return apdu_len;
+}
+
+
+static void testSetup(void)
+{
+    unsigned i;
+
+    for (i = 0; i < TEST_OBJECTS; i++) {
+        sprintf(Test_Objects[i].name, "AHU%02u.Zone %03u Temp", i / 100, i);
+        Test_Objects[i].units = UNITS_DEGREES_CELSIUS;
+        Test_Objects[i].presentValue = 21.0f;
+    }
+}
+
+
+static void testRead(BACNET_READ_PROPERTY_DATA *rpdata, uint8_t *apdu, const int apduSize,
+    const BACNET_OBJECT_TYPE objectType, const uint32_t instance, const BACNET_PROPERTY_ID property)
+{
+    rpdata->object_type = objectType;
+    rpdata->object_instance = instance;
+    rpdata->object_property = property;
+    rpdata->array_index = BACNET_ARRAY_ALL;
+    rpdata->application_data = apdu;
+    rpdata->application_data_len = apduSize;
+}
+
+
+void testPropertyCache(
+    Test * pTest)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    uint8_t apdu[MAX_APDU], expected[MAX_APDU];
+    unsigned long hits, misses;
+    int len, expectedLen;
+
+    testSetup();
+    pc_Init();
+
+    // a miss, then a hit with the same bytes
+    testRead(&rpdata, expected, sizeof(expected), OBJECT_ANALOG_INPUT, 5, PROP_OBJECT_NAME);
+    expectedLen = testReadProperty(&rpdata);
+    testRead(&rpdata, apdu, sizeof(apdu), OBJECT_ANALOG_INPUT, 5, PROP_OBJECT_NAME);
+    ct_test(pTest, !pc_Read(&rpdata, &len));
+    len = testDeviceReadProperty(&rpdata, true);
+    ct_test(pTest, len == expectedLen);
+    memset(apdu, 0, sizeof(apdu));
+    ct_test(pTest, pc_Read(&rpdata, &len));
+    ct_test(pTest, len == expectedLen && memcmp(apdu, expected, len) == 0);
+    pc_Stats(&hits, &misses, NULL);
+    ct_test(pTest, hits == 1 && misses == 2);
+
+    // keyed on type, instance, property and array index
+    testRead(&rpdata, apdu, sizeof(apdu), OBJECT_ANALOG_VALUE, 5, PROP_OBJECT_NAME);
+    ct_test(pTest, !pc_Read(&rpdata, &len));
+    testRead(&rpdata, apdu, sizeof(apdu), OBJECT_ANALOG_INPUT, 6, PROP_OBJECT_NAME);
+    ct_test(pTest, !pc_Read(&rpdata, &len));
+    testRead(&rpdata, apdu, sizeof(apdu), OBJECT_ANALOG_INPUT, 5, PROP_PROPERTY_LIST);
+    len = testDeviceReadProperty(&rpdata, true);
+    rpdata.array_index = 0;
+    expectedLen = testDeviceReadProperty(&rpdata, true);
+    ct_test(pTest, pc_Read(&rpdata, &len));
+    ct_test(pTest, len == expectedLen && apdu[0] == 0x21);
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    ct_test(pTest, pc_Read(&rpdata, &len));
+    ct_test(pTest, len > expectedLen);
+
+    // dynamic properties and the Device object are never cached
+    testRead(&rpdata, apdu, sizeof(apdu), OBJECT_ANALOG_INPUT, 5, PROP_PRESENT_VALUE);
+    ct_test(pTest, testDeviceReadProperty(&rpdata, true) > 0);
+    ct_test(pTest, !pc_Read(&rpdata, &len));
+    testRead(&rpdata, apdu, sizeof(apdu), OBJECT_DEVICE, 5, PROP_OBJECT_NAME);
+    ct_test(pTest, testDeviceReadProperty(&rpdata, true) > 0);
+    ct_test(pTest, !pc_Read(&rpdata, &len));
+
+    // nor are errors
+    testRead(&rpdata, apdu, sizeof(apdu), OBJECT_ANALOG_INPUT, TEST_OBJECTS, PROP_OBJECT_NAME);
+    ct_test(pTest, testDeviceReadProperty(&rpdata, true) < 0);
+    ct_test(pTest, !pc_Read(&rpdata, &len));
+
+    // a fragment that does not fit what is left of the APDU is left to the read handler
+    testRead(&rpdata, apdu, 4, OBJECT_ANALOG_INPUT, 5, PROP_OBJECT_NAME);
+    ct_test(pTest, !pc_Read(&rpdata, &len));
+
+    // a write drops the object's fragments, and the next read picks up the new value
+    strcpy(Test_Objects[5].name, "Renamed");
+    pc_InvalidateObject(OBJECT_ANALOG_INPUT, 5);
+    testRead(&rpdata, apdu, sizeof(apdu), OBJECT_ANALOG_INPUT, 5, PROP_OBJECT_NAME);
+    ct_test(pTest, !pc_Read(&rpdata, &len));
+    len = testDeviceReadProperty(&rpdata, true);
+    ct_test(pTest, pc_Read(&rpdata, &len));
+    ct_test(pTest, len == 10 && memcmp(&apdu[3], "Renamed", 7) == 0);
+    testRead(&rpdata, apdu, sizeof(apdu), OBJECT_ANALOG_INPUT, 5, PROP_PROPERTY_LIST);
+    ct_test(pTest, !pc_Read(&rpdata, &len));
+
+    pc_InvalidateAll();
+    testRead(&rpdata, apdu, sizeof(apdu), OBJECT_ANALOG_INPUT, 5, PROP_OBJECT_NAME);
+    ct_test(pTest, !pc_Read(&rpdata, &len));
+}
+
+
+static double testElapsedMs(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e3 + (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+
+// A SCADA metadata poll, the static properties of every object, over and over
+void testPropertyCacheBenchmark(
+    Test * pTest)
+{
+    static const BACNET_PROPERTY_ID properties[] = {
+        PROP_OBJECT_NAME, PROP_OBJECT_TYPE, PROP_DESCRIPTION, PROP_UNITS, PROP_PROPERTY_LIST
+    };
+    FILE *stream = ct_getStream(pTest);
+    BACNET_READ_PROPERTY_DATA rpdata;
+    uint8_t apdu[MAX_APDU];
+    struct timespec start;
+    double ms[2];
+    size_t bytes;
+    unsigned pass, round, i, p;
+    long total[2] = { 0, 0 };
+
+    testSetup();
+    pc_InvalidateAll();
+    for (pass = 0; pass < 2; pass++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (round = 0; round < 100; round++) {
+            for (i = 0; i < TEST_OBJECTS; i++) {
+                for (p = 0; p < sizeof(properties) / sizeof(properties[0]); p++) {
+                    testRead(&rpdata, apdu, sizeof(apdu), OBJECT_ANALOG_INPUT, i, properties[p]);
+                    total[pass] += testDeviceReadProperty(&rpdata, pass == 1);
+                }
+            }
+        }
+        ms[pass] = testElapsedMs(&start);
+    }
+    ct_test(pTest, total[0] == total[1]);
+    pc_Stats(NULL, NULL, &bytes);
+
+    fprintf(stream, "\n  %u objects x 5 static properties x 100 polls\n", TEST_OBJECTS);
+    fprintf(stream, "  %-20s %10.2f ms\n", "encode every read", ms[0]);
+    fprintf(stream, "  %-20s %10.2f ms (%lu bytes cached)\n", "fragment cache", ms[1], (unsigned long)bytes);
+}
+
+
+#ifdef TEST_PROPERTY_CACHE
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Property Cache", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testPropertyCache);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testPropertyCacheBenchmark);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_PROPERTY_CACHE */
+#endif /* TEST */
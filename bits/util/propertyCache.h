@@ -0,0 +1,70 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacenum.h"
+#include "rp.h"
+
+// Pre-encoded APDU fragments for properties that rarely change (Object_Name, Units,
+// Property_List, ...), kept per object. Device_Read_Property() copies a cached fragment
+// instead of calling the object's read handler, and stores what the handler encoded on a miss.
+// Device_Write_Property() drops the cached fragments of an object on every successful write,
+// so a write of one property also refreshes those derived from it (e.g. a Description that
+// returns the Object_Name).
+// Code that changes a cached property other than through WriteProperty must call
+// pc_InvalidateObject(). The local _Set() functions of the objects do, and so do
+// Generic_Object_Init(), Generic_Object_Set_Name() and Generic_Object_Name_Remove(), for
+// objects created, renamed or deleted. Snapshot_Load() drops the whole cache.
+// The Device object is never cached, much of it is maintained locally.
+
+#ifndef PROPERTY_CACHE_MAX_FRAGMENT
+#define PROPERTY_CACHE_MAX_FRAGMENT     128         // larger encodings are not cached
+#endif
+
+#ifndef PROPERTY_CACHE_MAX_BYTES
+#define PROPERTY_CACHE_MAX_BYTES        (512 * 1024)
+#endif
+
+void    pc_Init(void);
+
+// True, and *apdu_len set, if the fragment was cached and copied to rpdata->application_data
+bool    pc_Read(BACNET_READ_PROPERTY_DATA *rpdata, int *apdu_len);
+
+// Caches the apdu_len bytes just encoded for rpdata, if the property is one we cache
+void    pc_Store(const BACNET_READ_PROPERTY_DATA *rpdata, const int apdu_len);
+
+void    pc_InvalidateObject(const BACNET_OBJECT_TYPE objectType, const uint32_t objectInstance);
+void    pc_InvalidateAll(void);
+
+bool    pc_Cacheable(const BACNET_OBJECT_TYPE objectType, const BACNET_PROPERTY_ID property);
+
+// hits and misses since pc_Init(), and the bytes held. Any parameter may be NULL.
+void    pc_Stats(unsigned long *hits, unsigned long *misses, size_t *bytes);
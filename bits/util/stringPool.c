@@ -0,0 +1,417 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "stringPool.h"
+#include "emm.h"
+#include "bitsDebug.h"
+
+struct _SP_STRING
+{
+    uint32_t    hash;
+    uint32_t    refCount;
+    uint16_t    length;
+    uint8_t     encoding;
+    char        value[1];           // length characters, then a NUL
+};
+
+// Open addressing, linear probing, at most half full, backward shift deletion.
+// The table is calloc()ed, it grows past the emm block limit, the entries come from emm.
+static SP_STRING **Pool_Slots;
+static unsigned Pool_Size;          // always a power of two
+static unsigned Pool_Count;
+static size_t Pool_Bytes;
+
+
+// FNV-1a over the encoding and the characters
+static uint32_t sp_HashString(const uint8_t encoding, const char *value, const size_t length)
+{
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    hash = (hash ^ encoding) * 16777619u;
+    for (i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)value[i]) * 16777619u;
+    }
+    return hash;
+}
+
+
+// the slot holding the string, or the empty slot where it would go
+static unsigned sp_Slot(const uint32_t hash, const uint8_t encoding, const char *value, const size_t length)
+{
+    unsigned mask = Pool_Size - 1;
+    unsigned slot = hash & mask;
+
+    while (Pool_Slots[slot] != NULL) {
+        SP_STRING *entry = Pool_Slots[slot];
+        if (entry->hash == hash &&
+            entry->length == length &&
+            entry->encoding == encoding &&
+            memcmp(entry->value, value, length) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+
+static bool sp_Grow(void)
+{
+    SP_STRING **oldSlots = Pool_Slots;
+    unsigned oldSize = Pool_Size;
+    unsigned newSize = (oldSize) ? oldSize * 2 : 64;
+    unsigned i, slot;
+
+    Pool_Slots = (SP_STRING **)calloc(newSize, sizeof(SP_STRING *));
+    if (Pool_Slots == NULL) {
+        Pool_Slots = oldSlots;
+        return false;
+    }
+    Pool_Size = newSize;
+    for (i = 0; i < oldSize; i++) {
+        if (oldSlots[i] != NULL) {
+            slot = oldSlots[i]->hash & (newSize - 1);
+            while (Pool_Slots[slot] != NULL) {
+                slot = (slot + 1) & (newSize - 1);
+            }
+            Pool_Slots[slot] = oldSlots[i];
+        }
+    }
+    free(oldSlots);
+    Pool_Bytes += (newSize - oldSize) * sizeof(SP_STRING *);
+    return true;
+}
+
+
+bool sp_Intern(SP_HANDLE *handle, const uint8_t encoding, const char *value, const size_t length)
+{
+    SP_STRING *entry;
+    uint32_t hash;
+    unsigned slot;
+
+    *handle = NULL;
+    if (length == 0) {
+        return true;
+    }
+    // the characterstring_init() limit, so every entry converts back
+    if (length > MAX_CHARACTER_STRING_BYTES - 1) {
+        return false;
+    }
+    if ((Pool_Count + 1) * 2 > Pool_Size) {
+        if (!sp_Grow()) {
+            return false;
+        }
+    }
+    hash = sp_HashString(encoding, value, length);
+    slot = sp_Slot(hash, encoding, value, length);
+    entry = Pool_Slots[slot];
+    if (entry == NULL) {
+        entry = (SP_STRING *)emm_smalloc('s', (uint16_t)(offsetof(SP_STRING, value) + length + 1));
+        if (entry == NULL) {
+            return false;
+        }
+        entry->hash = hash;
+        entry->refCount = 0;
+        entry->length = (uint16_t)length;
+        entry->encoding = encoding;
+        memcpy(entry->value, value, length);
+        entry->value[length] = 0;
+        Pool_Slots[slot] = entry;
+        Pool_Count++;
+        Pool_Bytes += offsetof(SP_STRING, value) + length + 1;
+    }
+    entry->refCount++;
+    *handle = entry;
+    return true;
+}
+
+
+bool sp_InternAnsi(SP_HANDLE *handle, const char *value)
+{
+    return sp_Intern(handle, CHARACTER_ANSI_X34, value, (value) ? strlen(value) : 0);
+}
+
+
+bool sp_InternCharacterString(SP_HANDLE *handle, BACNET_CHARACTER_STRING *charString)
+{
+    return sp_Intern(handle, charString->encoding, charString->value, charString->length);
+}
+
+
+SP_HANDLE sp_Retain(SP_HANDLE handle)
+{
+    if (handle != NULL) {
+        ((SP_STRING *)handle)->refCount++;
+    }
+    return handle;
+}
+
+
+void sp_Release(SP_HANDLE handle)
+{
+    SP_STRING *entry = (SP_STRING *)handle;
+    unsigned mask, slot, next;
+
+    if (entry == NULL) {
+        return;
+    }
+    if (entry->refCount == 0) {
+        panic();
+        return;
+    }
+    if (--entry->refCount != 0) {
+        return;
+    }
+
+    mask = Pool_Size - 1;
+    slot = sp_Slot(entry->hash, entry->encoding, entry->value, entry->length);
+    if (Pool_Slots[slot] != entry) {
+        panic();
+        return;
+    }
+    Pool_Slots[slot] = NULL;
+    Pool_Count--;
+    Pool_Bytes -= offsetof(SP_STRING, value) + entry->length + 1;
+    emm_free(entry);
+
+    next = (slot + 1) & mask;
+    while (Pool_Slots[next] != NULL) {
+        unsigned home = Pool_Slots[next]->hash & mask;
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            Pool_Slots[slot] = Pool_Slots[next];
+            Pool_Slots[next] = NULL;
+            slot = next;
+        }
+        next = (next + 1) & mask;
+    }
+}
+
+
+SP_HANDLE sp_Lookup(BACNET_CHARACTER_STRING *charString)
+{
+    uint32_t hash;
+
+    if (Pool_Count == 0 || charString->length == 0) {
+        return NULL;
+    }
+    hash = sp_HashString(charString->encoding, charString->value, charString->length);
+    return Pool_Slots[sp_Slot(hash, charString->encoding, charString->value, charString->length)];
+}
+
+
+bool sp_ToCharacterString(SP_HANDLE handle, BACNET_CHARACTER_STRING *charString)
+{
+    if (handle == NULL) {
+        return characterstring_init_ansi(charString, "");
+    }
+    return characterstring_init(charString, (BACNET_CHARACTER_STRING_ENCODING)handle->encoding,
+        handle->value, handle->length);
+}
+
+
+const char *sp_Value(SP_HANDLE handle)
+{
+    return (handle) ? handle->value : "";
+}
+
+
+size_t sp_Length(SP_HANDLE handle)
+{
+    return (handle) ? handle->length : 0;
+}
+
+
+uint8_t sp_Encoding(SP_HANDLE handle)
+{
+    return (handle) ? handle->encoding : CHARACTER_ANSI_X34;
+}
+
+
+uint32_t sp_Hash(SP_HANDLE handle)
+{
+    return (handle) ? handle->hash : sp_HashString(CHARACTER_ANSI_X34, "", 0);
+}
+
+
+void sp_Stats(unsigned *count, size_t *bytes)
+{
+    if (count) *count = Pool_Count;
+    if (bytes) *bytes = Pool_Bytes;
+}
+
+
+#ifdef TEST
+#include <assert.h>
+#include <stdio.h>
+#include "ctest.h"
+
+#ifdef TEST_STRING_POOL
+/* dummy function stubs */
+void sys_panic(const char *file, const int line)
+{
+    (void)file;
+    (void)line;
+}
+
+void sys_dbTraffic(DBD_DebugDomain domain, DB_LEVEL lev, const char *format, ...)
+{
+    (void)domain;
+    (void)lev;
+    (void)format;
+}
+#endif
+
+
+void testStringPool(
+    Test * pTest)
+{
+    SP_HANDLE a, b, c, empty;
+    BACNET_CHARACTER_STRING charString;
+    char tooLong[MAX_CHARACTER_STRING_BYTES + 1];
+    unsigned count;
+
+    ct_test(pTest, sp_InternAnsi(&a, "Zone Temp"));
+    ct_test(pTest, sp_InternAnsi(&b, "Zone Temp"));
+    ct_test(pTest, a == b);
+    ct_test(pTest, sp_InternAnsi(&c, "Zone Temp 2"));
+    ct_test(pTest, a != c);
+    sp_Stats(&count, NULL);
+    ct_test(pTest, count == 2);
+
+    ct_test(pTest, strcmp(sp_Value(a), "Zone Temp") == 0);
+    ct_test(pTest, sp_Length(a) == 9);
+    ct_test(pTest, sp_Encoding(a) == CHARACTER_ANSI_X34);
+
+    // the encoding is part of the string
+    characterstring_init(&charString, CHARACTER_ISO8859, "Zone Temp", 9);
+    ct_test(pTest, sp_Lookup(&charString) == NULL);
+    characterstring_init_ansi(&charString, "Zone Temp");
+    ct_test(pTest, sp_Lookup(&charString) == a);
+
+    // and back again at the encode boundary
+    ct_test(pTest, sp_ToCharacterString(c, &charString));
+    ct_test(pTest, characterstring_ansi_same(&charString, "Zone Temp 2"));
+
+    // the empty string is the NULL handle
+    ct_test(pTest, sp_InternAnsi(&empty, ""));
+    ct_test(pTest, empty == NULL);
+    ct_test(pTest, sp_ToCharacterString(empty, &charString));
+    ct_test(pTest, characterstring_length(&charString) == 0);
+
+    // same limit as characterstring_init()
+    memset(tooLong, 'x', sizeof(tooLong));
+    ct_test(pTest, !sp_Intern(&empty, CHARACTER_ANSI_X34, tooLong, sizeof(tooLong)));
+    ct_test(pTest, sp_Intern(&empty, CHARACTER_ANSI_X34, tooLong, sizeof(tooLong) - 2));
+    sp_Release(empty);
+
+    // the last reference frees the entry
+    ct_test(pTest, sp_Retain(a) == a);
+    sp_Release(a);
+    sp_Release(b);
+    characterstring_init_ansi(&charString, "Zone Temp");
+    ct_test(pTest, sp_Lookup(&charString) == a);
+    sp_Release(a);
+    ct_test(pTest, sp_Lookup(&charString) == NULL);
+    sp_Release(c);
+    sp_Stats(&count, NULL);
+    ct_test(pTest, count == 0);
+}
+
+
+#define TEST_POINTS     50000
+
+// Memory for the names and descriptions of a 50k point gateway, embedded strings vs. the pool
+void testStringPoolFootprint(
+    Test * pTest)
+{
+    static SP_HANDLE names[TEST_POINTS];
+    static SP_HANDLE descriptions[TEST_POINTS];
+    FILE *stream = ct_getStream(pTest);
+    BACNET_CHARACTER_STRING charString;
+    char text[32];
+    unsigned i, count;
+    size_t bytes;
+
+    for (i = 0; i < TEST_POINTS; i++) {
+        sprintf(text, "AHU%02u.ZN%03u.T", i / 1000, i % 1000);
+        ct_test(pTest, sp_InternAnsi(&names[i], text));
+        // descriptions repeat across equipment
+        sprintf(text, "Zone temperature %u", i % 100);
+        ct_test(pTest, sp_InternAnsi(&descriptions[i], text));
+    }
+    sp_Stats(&count, &bytes);
+    ct_test(pTest, count == TEST_POINTS + 100);
+
+    fprintf(stream, "\n  %u points, name and description each\n", TEST_POINTS);
+    fprintf(stream, "  %-34s %10lu bytes\n", "embedded BACNET_CHARACTER_STRING",
+        (unsigned long)(2 * TEST_POINTS * sizeof(BACNET_CHARACTER_STRING)));
+    fprintf(stream, "  %-34s %10lu bytes (%u distinct strings)\n", "interned, handles + pool",
+        (unsigned long)(2 * TEST_POINTS * sizeof(SP_HANDLE) + bytes), count);
+
+    for (i = 0; i < TEST_POINTS; i++) {
+        sprintf(text, "AHU%02u.ZN%03u.T", i / 1000, i % 1000);
+        characterstring_init_ansi(&charString, text);
+        if (sp_Lookup(&charString) != names[i]) {
+            ct_test(pTest, false);
+            break;
+        }
+    }
+    for (i = 0; i < TEST_POINTS; i++) {
+        sp_Release(names[i]);
+        sp_Release(descriptions[i]);
+    }
+    sp_Stats(&count, NULL);
+    ct_test(pTest, count == 0);
+}
+
+
+#ifdef TEST_STRING_POOL
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet String Pool", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testStringPool);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testStringPoolFootprint);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_STRING_POOL */
+#endif /* TEST */
@@ -0,0 +1,65 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "bacstr.h"
+
+// Interned, reference counted strings for object names (and any other per object text).
+// Equal strings (same encoding, same characters) share one entry, and a descriptor holds an
+// SP_HANDLE, the size of a pointer, instead of a full BACNET_CHARACTER_STRING.
+// A NULL handle is the empty string. Convert to a BACNET_CHARACTER_STRING with
+// sp_ToCharacterString() at the encode boundary.
+// Not locked. The object names are covered by the object store lock: interning and
+// releasing happen under its write lock (object creation, deletion and Object_Name
+// writes), lookups and reads, which do not modify the pool, under its read lock.
+
+typedef struct _SP_STRING SP_STRING;
+typedef const SP_STRING *SP_HANDLE;
+
+// *handle gets a reference to the interned copy of the string, false if out of memory or too long
+bool        sp_Intern(SP_HANDLE *handle, const uint8_t encoding, const char *value, const size_t length);
+bool        sp_InternAnsi(SP_HANDLE *handle, const char *value);
+bool        sp_InternCharacterString(SP_HANDLE *handle, BACNET_CHARACTER_STRING *charString);
+
+SP_HANDLE   sp_Retain(SP_HANDLE handle);
+void        sp_Release(SP_HANDLE handle);
+
+// The existing entry for a string, without taking a reference. NULL if the string is not in the pool.
+SP_HANDLE   sp_Lookup(BACNET_CHARACTER_STRING *charString);
+
+bool        sp_ToCharacterString(SP_HANDLE handle, BACNET_CHARACTER_STRING *charString);
+const char *sp_Value(SP_HANDLE handle);             // NUL terminated
+size_t      sp_Length(SP_HANDLE handle);
+uint8_t     sp_Encoding(SP_HANDLE handle);
+uint32_t    sp_Hash(SP_HANDLE handle);
+
+// number of distinct strings, and the bytes they occupy (entries plus the pool's table)
+void        sp_Stats(unsigned *count, size_t *bytes);
@@ -234,7 +234,7 @@ void MyAbortHandler(
 #endif
         Error_Detected = true;
         Last_Error_Class = ERROR_CLASS_SERVICES;
-        if (abort_reason < MAX_BACNET_ABORT_REASON)
+        if (abort_reason <= ABORT_REASON_SEGMENTATION_NOT_SUPPORTED)
             Last_Error_Code =
                 (ERROR_CODE_ABORT_BUFFER_OVERFLOW - 1) + abort_reason;
         else
@@ -0,0 +1,724 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "config.h"
+#include "bacdef.h"
+#include "apdu.h"
+#include "tsm.h"
+#include "bacnet_lock.h"
+#include "client_async.h"
+
+/** @file client_async.c  Completions of asynchronous confirmed requests */
+
+/* what the TSM keeps with the transaction, see tsm_set_transaction_context() */
+typedef struct Client_Async_Request {
+    client_async_callback callback;
+    void *context;
+    BACNET_CONFIRMED_SERVICE service;
+    /* the free list */
+    struct Client_Async_Request *next;
+} CLIENT_ASYNC_REQUEST;
+
+/* allocated as they are needed and kept for reuse, so that a client that
+   keeps the same number of requests going does not allocate at all */
+static CLIENT_ASYNC_REQUEST *Request_Free;
+static unsigned Request_Pending;
+
+/* the two above. It is taken from the replies and the timeouts, and
+   nothing else is taken under it. */
+BACNET_LOCK_DEFINE(Client_Async_Lock);
+
+static CLIENT_ASYNC_REQUEST *client_async_request_alloc(
+    void)
+{
+    CLIENT_ASYNC_REQUEST *request;
+
+    BACNET_LOCK(Client_Async_Lock);
+    request = Request_Free;
+    if (request != NULL) {
+        Request_Free = request->next;
+    } else {
+        request =
+            (CLIENT_ASYNC_REQUEST *) malloc(sizeof(CLIENT_ASYNC_REQUEST));
+    }
+    if (request != NULL) {
+        Request_Pending++;
+    }
+    BACNET_UNLOCK(Client_Async_Lock);
+
+    return request;
+}
+
+static void client_async_request_free(
+    CLIENT_ASYNC_REQUEST * request)
+{
+    BACNET_LOCK(Client_Async_Lock);
+    request->next = Request_Free;
+    Request_Free = request;
+    Request_Pending--;
+    BACNET_UNLOCK(Client_Async_Lock);
+}
+
+uint8_t client_async_invoke_id(
+    BACNET_ADDRESS * dest,
+    BACNET_CONFIRMED_SERVICE service,
+    client_async_callback callback,
+    void *context)
+{
+    CLIENT_ASYNC_REQUEST *request;
+    uint8_t invoke_id;
+
+    if (callback == NULL) {
+        return tsm_next_free_invokeID();
+    }
+    request = client_async_request_alloc();
+    if (request == NULL) {
+        return 0;
+    }
+    request->callback = callback;
+    request->context = context;
+    request->service = service;
+    invoke_id = tsm_next_free_invokeID_peer(dest);
+    if (invoke_id == 0) {
+        client_async_request_free(request);
+        return 0;
+    }
+    /* before the request goes, so the reply cannot beat it */
+    (void) tsm_set_transaction_context(dest, invoke_id, request);
+
+    return invoke_id;
+}
+
+void client_async_free_invoke_id(
+    BACNET_ADDRESS * dest,
+    uint8_t invoke_id)
+{
+    CLIENT_ASYNC_REQUEST *request;
+
+    request =
+        (CLIENT_ASYNC_REQUEST *) tsm_take_transaction_context(dest,
+        invoke_id);
+    if (request != NULL) {
+        client_async_request_free(request);
+    }
+    tsm_free_invoke_id_peer(dest, invoke_id);
+}
+
+#if ( BACNET_CLIENT == 1 )
+/* the handlers Client_Async_Init() took over, which get the replies and
+   timeouts of requests that are not ours */
+static confirmed_ack_function Prior_RP_Ack;
+static confirmed_ack_function Prior_RPM_Ack;
+static confirmed_simple_ack_function Prior_WP_Ack;
+static error_function Prior_RP_Error;
+static error_function Prior_RPM_Error;
+static error_function Prior_WP_Error;
+static abort_function Prior_Abort;
+static reject_function Prior_Reject;
+static tsm_peer_timeout_function Prior_Timeout;
+
+/* makes the callback, if the transaction is one of ours that has not
+   had it yet. The invoke ID is freed after it returns, by apdu_handler()
+   for a reply, so that a request sent from the callback cannot get it.
+   Returns false if there was nothing to call back. */
+static bool client_async_complete(
+    CLIENT_ASYNC_COMPLETION * completion)
+{
+    CLIENT_ASYNC_REQUEST *request;
+    client_async_callback callback;
+    void *context;
+
+    request =
+        (CLIENT_ASYNC_REQUEST *) tsm_take_transaction_context(completion->src,
+        completion->invoke_id);
+    if (request == NULL) {
+        return false;
+    }
+    if ((completion->result == CLIENT_ASYNC_ACK) &&
+        (completion->service != request->service)) {
+        /* an ACK for something else: what the TSM of a client does with
+           an unexpected PDU, 5.4.4.3 */
+        completion->result = CLIENT_ASYNC_ABORT;
+        completion->reason = ABORT_REASON_INVALID_APDU_IN_THIS_STATE;
+        completion->service_request = NULL;
+        completion->service_len = 0;
+    }
+    completion->service = request->service;
+    callback = request->callback;
+    context = request->context;
+    client_async_request_free(request);
+    callback(completion, context);
+
+    return true;
+}
+
+static void client_async_init_completion(
+    CLIENT_ASYNC_COMPLETION * completion,
+    CLIENT_ASYNC_RESULT result,
+    BACNET_ADDRESS * src,
+    uint8_t invoke_id)
+{
+    completion->result = result;
+    completion->src = src;
+    completion->invoke_id = invoke_id;
+    completion->service = MAX_BACNET_CONFIRMED_SERVICE;
+    completion->service_request = NULL;
+    completion->service_len = 0;
+    completion->error_class = ERROR_CLASS_SERVICES;
+    completion->error_code = ERROR_CODE_OTHER;
+    completion->reason = 0;
+}
+
+static void client_async_complex_ack(
+    BACNET_CONFIRMED_SERVICE service,
+    confirmed_ack_function prior,
+    uint8_t * service_request,
+    uint16_t service_len,
+    BACNET_ADDRESS * src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data)
+{
+    CLIENT_ASYNC_COMPLETION completion;
+
+    client_async_init_completion(&completion, CLIENT_ASYNC_ACK, src,
+        service_data->invoke_id);
+    completion.service = service;
+    completion.service_request = service_request;
+    completion.service_len = service_len;
+    if (!client_async_complete(&completion) && prior) {
+        prior(service_request, service_len, src, service_data);
+    }
+}
+
+static void client_async_rp_ack(
+    uint8_t * service_request,
+    uint16_t service_len,
+    BACNET_ADDRESS * src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data)
+{
+    client_async_complex_ack(SERVICE_CONFIRMED_READ_PROPERTY, Prior_RP_Ack,
+        service_request, service_len, src, service_data);
+}
+
+static void client_async_rpm_ack(
+    uint8_t * service_request,
+    uint16_t service_len,
+    BACNET_ADDRESS * src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data)
+{
+    client_async_complex_ack(SERVICE_CONFIRMED_READ_PROP_MULTIPLE,
+        Prior_RPM_Ack, service_request, service_len, src, service_data);
+}
+
+static void client_async_wp_ack(
+    BACNET_ADDRESS * src,
+    uint8_t invoke_id)
+{
+    CLIENT_ASYNC_COMPLETION completion;
+
+    client_async_init_completion(&completion, CLIENT_ASYNC_ACK, src,
+        invoke_id);
+    completion.service = SERVICE_CONFIRMED_WRITE_PROPERTY;
+    if (!client_async_complete(&completion) && Prior_WP_Ack) {
+        Prior_WP_Ack(src, invoke_id);
+    }
+}
+
+static void client_async_error(
+    error_function prior,
+    BACNET_ADDRESS * src,
+    uint8_t invoke_id,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    CLIENT_ASYNC_COMPLETION completion;
+
+    client_async_init_completion(&completion, CLIENT_ASYNC_ERROR, src,
+        invoke_id);
+    completion.error_class = error_class;
+    completion.error_code = error_code;
+    if (!client_async_complete(&completion) && prior) {
+        prior(src, invoke_id, error_class, error_code);
+    }
+}
+
+static void client_async_rp_error(
+    BACNET_ADDRESS * src,
+    uint8_t invoke_id,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    client_async_error(Prior_RP_Error, src, invoke_id, error_class,
+        error_code);
+}
+
+static void client_async_rpm_error(
+    BACNET_ADDRESS * src,
+    uint8_t invoke_id,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    client_async_error(Prior_RPM_Error, src, invoke_id, error_class,
+        error_code);
+}
+
+static void client_async_wp_error(
+    BACNET_ADDRESS * src,
+    uint8_t invoke_id,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    client_async_error(Prior_WP_Error, src, invoke_id, error_class,
+        error_code);
+}
+
+static void client_async_abort(
+    BACNET_ADDRESS * src,
+    uint8_t invoke_id,
+    BACNET_ABORT_REASON abort_reason,
+    bool server)
+{
+    CLIENT_ASYNC_COMPLETION completion;
+
+    client_async_init_completion(&completion, CLIENT_ASYNC_ABORT, src,
+        invoke_id);
+    completion.reason = (uint8_t) abort_reason;
+    if (!client_async_complete(&completion) && Prior_Abort) {
+        Prior_Abort(src, invoke_id, abort_reason, server);
+    }
+}
+
+static void client_async_reject(
+    BACNET_ADDRESS * src,
+    uint8_t invoke_id,
+    BACNET_REJECT_REASON reject_reason)
+{
+    CLIENT_ASYNC_COMPLETION completion;
+
+    client_async_init_completion(&completion, CLIENT_ASYNC_REJECT, src,
+        invoke_id);
+    completion.reason = (uint8_t) reject_reason;
+    if (!client_async_complete(&completion) && Prior_Reject) {
+        Prior_Reject(src, invoke_id, reject_reason);
+    }
+}
+
+/* the TSM gave up */
+static void client_async_timeout(
+    BACNET_ADDRESS * dest,
+    uint8_t invoke_id)
+{
+    CLIENT_ASYNC_COMPLETION completion;
+
+    client_async_init_completion(&completion, CLIENT_ASYNC_TIMEOUT, dest,
+        invoke_id);
+    /* nobody else frees a request that timed out */
+    if (client_async_complete(&completion)) {
+        tsm_free_invoke_id_peer(dest, invoke_id);
+    } else if (Prior_Timeout) {
+        Prior_Timeout(dest, invoke_id);
+    }
+}
+
+void Client_Async_Init(
+    void)
+{
+    /* once only, so that a second call does not pass on to itself, nor
+       set up the lock again under those holding it */
+    if (apdu_abort_handler() == client_async_abort) {
+        return;
+    }
+    BACNET_LOCK_INIT(Client_Async_Lock);
+    Prior_RP_Ack = apdu_confirmed_ack_handler(SERVICE_CONFIRMED_READ_PROPERTY);
+    Prior_RPM_Ack =
+        apdu_confirmed_ack_handler(SERVICE_CONFIRMED_READ_PROP_MULTIPLE);
+    Prior_WP_Ack =
+        apdu_confirmed_simple_ack_handler(SERVICE_CONFIRMED_WRITE_PROPERTY);
+    Prior_RP_Error = apdu_error_handler(SERVICE_CONFIRMED_READ_PROPERTY);
+    Prior_RPM_Error = apdu_error_handler(SERVICE_CONFIRMED_READ_PROP_MULTIPLE);
+    Prior_WP_Error = apdu_error_handler(SERVICE_CONFIRMED_WRITE_PROPERTY);
+    Prior_Abort = apdu_abort_handler();
+    Prior_Reject = apdu_reject_handler();
+    Prior_Timeout = tsm_peer_timeout_handler();
+    apdu_set_confirmed_ack_handler(SERVICE_CONFIRMED_READ_PROPERTY,
+        client_async_rp_ack);
+    apdu_set_confirmed_ack_handler(SERVICE_CONFIRMED_READ_PROP_MULTIPLE,
+        client_async_rpm_ack);
+    apdu_set_confirmed_simple_ack_handler(SERVICE_CONFIRMED_WRITE_PROPERTY,
+        client_async_wp_ack);
+    apdu_set_error_handler(SERVICE_CONFIRMED_READ_PROPERTY,
+        client_async_rp_error);
+    apdu_set_error_handler(SERVICE_CONFIRMED_READ_PROP_MULTIPLE,
+        client_async_rpm_error);
+    apdu_set_error_handler(SERVICE_CONFIRMED_WRITE_PROPERTY,
+        client_async_wp_error);
+    apdu_set_abort_handler(client_async_abort);
+    apdu_set_reject_handler(client_async_reject);
+    tsm_set_peer_timeout_handler(client_async_timeout);
+}
+
+unsigned Client_Async_Pending(
+    void)
+{
+    unsigned count;
+
+    BACNET_LOCK(Client_Async_Lock);
+    count = Request_Pending;
+    BACNET_UNLOCK(Client_Async_Lock);
+
+    return count;
+}
+#endif
+
+#ifdef TEST
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include "ctest.h"
+#include "client.h"
+#include "bacaddr.h"
+#include "address.h"
+#include "npdu.h"
+#include "rp.h"
+#include "bacerror.h"
+#include "abort.h"
+#include "reject.h"
+
+/* a head-end with two reads going to each of a couple of thousand
+   controllers at once, from the one thread */
+#define TEST_DEVICES 2000
+#define TEST_READS 2
+
+typedef struct {
+    unsigned calls;
+    CLIENT_ASYNC_RESULT result;
+    uint8_t reason;
+    bool value_ok;
+} TEST_READ;
+
+static TEST_READ Test_Reads[TEST_DEVICES * TEST_READS];
+
+/* the requests as they went out, for the devices to answer */
+typedef struct {
+    BACNET_ADDRESS dest;
+    uint8_t invoke_id;
+    uint32_t object_instance;
+} TEST_SENT;
+
+static TEST_SENT Test_Sent[TEST_DEVICES * TEST_READS + 1];
+static unsigned Test_Sent_Count;
+static bool Test_Recording;
+
+int datalink_send_pdu(
+    BACNET_ADDRESS * dest,
+    BACNET_NPCI_DATA * npci_data,
+    uint8_t * pdu,
+    unsigned pdu_len)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    BACNET_NPCI_DATA npci;
+    int offset;
+
+    (void) npci_data;
+    offset = npci_decode(pdu, NULL, NULL, &npci);
+    if (Test_Recording && (offset > 0) &&
+        ((pdu[offset] & 0xF0) == PDU_TYPE_CONFIRMED_SERVICE_REQUEST) &&
+        (Test_Sent_Count < (TEST_DEVICES * TEST_READS + 1))) {
+        rp_decode_service_request(&pdu[offset + 4],
+            pdu_len - (unsigned) offset - 4, &rpdata);
+        bacnet_address_copy(&Test_Sent[Test_Sent_Count].dest, dest);
+        Test_Sent[Test_Sent_Count].invoke_id = pdu[offset + 2];
+        Test_Sent[Test_Sent_Count].object_instance = rpdata.object_instance;
+        Test_Sent_Count++;
+    }
+
+    return (int) pdu_len;
+}
+
+void datalink_get_my_address(
+    BACNET_ADDRESS * my_address)
+{
+    memset(my_address, 0, sizeof(*my_address));
+}
+
+bool address_get_by_device(
+    uint32_t device_id,
+    unsigned *max_apdu,
+    BACNET_ADDRESS * src)
+{
+    (void) device_id;
+    (void) max_apdu;
+    (void) src;
+    return false;
+}
+
+bool address_learned_get(
+    BACNET_ADDRESS * src,
+    unsigned *max_apdu,
+    BACNET_ADDRESS_LEARNED * learned)
+{
+    (void) src;
+    (void) max_apdu;
+    (void) learned;
+    return false;
+}
+
+void address_learned_set(
+    BACNET_ADDRESS * src,
+    BACNET_ADDRESS_LEARNED * learned)
+{
+    (void) src;
+    (void) learned;
+}
+
+/* a B/IP device, n of them on the one network */
+static void testClientAsyncAddress(
+    BACNET_ADDRESS * address,
+    unsigned n)
+{
+    memset(address, 0, sizeof(*address));
+    address->mac_len = 6;
+    address->mac[0] = 10;
+    address->mac[2] = (uint8_t) (n >> 8);
+    address->mac[3] = (uint8_t) n;
+    address->mac[4] = 0xBA;
+    address->mac[5] = 0xC0;
+}
+
+/* the read is told which of Test_Reads it is, and checks that the value
+   that comes back is the one it asked for */
+static void testClientAsyncDone(
+    CLIENT_ASYNC_COMPLETION * completion,
+    void *context)
+{
+    TEST_READ *read = (TEST_READ *) context;
+    BACNET_READ_PROPERTY_DATA rpdata;
+
+    read->calls++;
+    read->result = completion->result;
+    read->reason = completion->reason;
+    if ((completion->result == CLIENT_ASYNC_ACK) &&
+        (completion->service == SERVICE_CONFIRMED_READ_PROPERTY) &&
+        (rp_ack_decode_service_request(completion->service_request,
+                completion->service_len, &rpdata) > 0)) {
+        read->value_ok =
+            (rpdata.object_instance == (uint32_t) (read - &Test_Reads[0]));
+    }
+}
+
+/* what the device at sent->dest says to the request */
+static void testClientAsyncAnswer(
+    TEST_SENT * sent,
+    unsigned how)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    uint8_t apdu[MAX_APDU];
+    uint8_t value[8];
+    int apdu_len = 0;
+
+    switch (how) {
+        case 0:
+        case 1:
+        case 2:
+            rpdata.object_type = OBJECT_ANALOG_INPUT;
+            rpdata.object_instance = sent->object_instance;
+            rpdata.object_property = PROP_PRESENT_VALUE;
+            rpdata.array_index = BACNET_ARRAY_ALL;
+            rpdata.application_data_len = encode_application_real(value, 1.5f);
+            rpdata.application_data = value;
+            apdu_len = rp_ack_encode_apdu(apdu, sent->invoke_id, &rpdata);
+            break;
+        case 3:
+            apdu_len =
+                bacerror_encode_apdu(apdu, sent->invoke_id,
+                SERVICE_CONFIRMED_READ_PROPERTY, ERROR_CLASS_OBJECT,
+                ERROR_CODE_UNKNOWN_OBJECT);
+            break;
+        case 4:
+            apdu_len =
+                abort_encode_apdu(apdu, sent->invoke_id,
+                ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
+            break;
+        default:
+            apdu_len =
+                reject_encode_apdu(apdu, sent->invoke_id,
+                REJECT_REASON_UNRECOGNIZED_SERVICE);
+            break;
+    }
+    apdu_handler(&sent->dest, apdu, (uint16_t) apdu_len);
+}
+
+/* the application's own ReadProperty-ACK handler, from before */
+static unsigned Test_Prior_Acks;
+
+static void testClientAsyncPriorAck(
+    uint8_t * service_request,
+    uint16_t service_len,
+    BACNET_ADDRESS * src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data)
+{
+    (void) service_request;
+    (void) service_len;
+    (void) src;
+    (void) service_data;
+    Test_Prior_Acks++;
+}
+
+void testClientAsync(
+    Test * pTest)
+{
+    FILE *stream = ct_getStream(pTest);
+    BACNET_ADDRESS dest;
+    struct timespec start, end;
+    unsigned counts[CLIENT_ASYNC_TIMEOUT + 1] = { 0 };
+    unsigned i, k;
+    unsigned quiet = 0;
+    bool once = true;
+    bool value_ok = true;
+    uint8_t invoke_id;
+    double ns;
+
+    apdu_set_confirmed_ack_handler(SERVICE_CONFIRMED_READ_PROPERTY,
+        testClientAsyncPriorAck);
+    Client_Async_Init();
+    /* and again, which changes nothing */
+    Client_Async_Init();
+    Test_Recording = true;
+    Test_Sent_Count = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < TEST_DEVICES; i++) {
+        testClientAsyncAddress(&dest, i);
+        for (k = 0; k < TEST_READS; k++) {
+            invoke_id =
+                Send_Read_Property_Request_Address_Async(&dest, MAX_APDU,
+                OBJECT_ANALOG_INPUT, i * TEST_READS + k, PROP_PRESENT_VALUE,
+                BACNET_ARRAY_ALL, testClientAsyncDone,
+                &Test_Reads[i * TEST_READS + k]);
+            ct_test(pTest, invoke_id != 0);
+        }
+    }
+    Test_Recording = false;
+    ct_test(pTest, Test_Sent_Count == (TEST_DEVICES * TEST_READS));
+    ct_test(pTest, Client_Async_Pending() == (TEST_DEVICES * TEST_READS));
+    ct_test(pTest,
+        tsm_peer_transaction_count() == (TEST_DEVICES * TEST_READS));
+
+    /* every tenth device never answers, the rest answer in all ways */
+    for (k = 0; k < Test_Sent_Count; k++) {
+        if ((Test_Sent[k].dest.mac[3] % 10) == 9) {
+            quiet++;
+        } else {
+            testClientAsyncAnswer(&Test_Sent[k], k % 6);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ct_test(pTest, Client_Async_Pending() == quiet);
+    ct_test(pTest, Test_Prior_Acks == 0);
+    /* a second answer gets no second callback, it is not ours any more */
+    testClientAsyncAnswer(&Test_Sent[0], 0);
+    ct_test(pTest, Test_Prior_Acks == 1);
+    for (i = 0; i <= apdu_retries(); i++) {
+        /* as long as a retry can wait, backed off or not */
+        tsm_timer_milliseconds(UINT16_MAX);
+    }
+    ct_test(pTest, Client_Async_Pending() == 0);
+    ct_test(pTest, tsm_peer_transaction_count() == 0);
+
+    for (i = 0; i < (TEST_DEVICES * TEST_READS); i++) {
+        once &= (Test_Reads[i].calls == 1);
+        counts[Test_Reads[i].result]++;
+        if (Test_Reads[i].result == CLIENT_ASYNC_ACK) {
+            value_ok &= Test_Reads[i].value_ok;
+        }
+    }
+    ct_test(pTest, once);
+    ct_test(pTest, value_ok);
+    ct_test(pTest, counts[CLIENT_ASYNC_TIMEOUT] == quiet);
+    ct_test(pTest, counts[CLIENT_ASYNC_ACK] > counts[CLIENT_ASYNC_ERROR]);
+    ct_test(pTest, counts[CLIENT_ASYNC_ERROR] > 0);
+    ct_test(pTest, counts[CLIENT_ASYNC_ABORT] > 0);
+    ct_test(pTest, counts[CLIENT_ASYNC_REJECT] > 0);
+    ct_test(pTest, (counts[CLIENT_ASYNC_ACK] + counts[CLIENT_ASYNC_ERROR] +
+            counts[CLIENT_ASYNC_ABORT] + counts[CLIENT_ASYNC_REJECT] +
+            quiet) == (TEST_DEVICES * TEST_READS));
+
+    /* without a callback it is the request it always was */
+    Test_Recording = true;
+    Test_Sent_Count = 0;
+    testClientAsyncAddress(&dest, 1);
+    invoke_id =
+        Send_Read_Property_Request_Address(&dest, MAX_APDU,
+        OBJECT_ANALOG_INPUT, 0, PROP_PRESENT_VALUE, BACNET_ARRAY_ALL);
+    Test_Recording = false;
+    ct_test(pTest, invoke_id != 0);
+    ct_test(pTest, !tsm_invoke_id_free(invoke_id));
+    ct_test(pTest, Client_Async_Pending() == 0);
+    testClientAsyncAnswer(&Test_Sent[0], 0);
+    ct_test(pTest, tsm_invoke_id_free(invoke_id));
+    ct_test(pTest, Test_Reads[0].calls == 1);
+    ct_test(pTest, Test_Prior_Acks == 2);
+
+    ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec -
+            start.tv_nsec)) / (TEST_DEVICES * TEST_READS);
+    fprintf(stream, "\n  %u reads in flight to %u devices, %.0f ns per "
+        "read sent and answered\n", TEST_DEVICES * TEST_READS, TEST_DEVICES,
+        ns);
+}
+
+#ifdef TEST_CLIENT_ASYNC
+void sys_panic(
+    const char *file,
+    const int line)
+{
+    (void) file;
+    (void) line;
+}
+
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    tsm_init();
+    pTest = ct_create("BACnet Client Async", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testClientAsync);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_CLIENT_ASYNC */
+#endif /* TEST */
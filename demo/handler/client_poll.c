@@ -0,0 +1,1401 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacdcode.h"
+#include "bacapp.h"
+#include "bacerror.h"
+#include "address.h"
+#include "rp.h"
+#include "rpm.h"
+#include "timer_wheel.h"
+#include "bacnet_lock.h"
+#include "client.h"
+#include "client_poll.h"
+
+/** @file client_poll.c  Polls points, packing the reads into ReadPropertyMultiple */
+
+#if ( BACNET_CLIENT == 1 )
+
+typedef struct Client_Poll_Device CLIENT_POLL_DEVICE;
+
+struct Client_Poll_Point {
+    /* when it is next due */
+    BACNET_TIMER Timer;
+    CLIENT_POLL_DEVICE *device;
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t object_instance;
+    BACNET_PROPERTY_ID object_property;
+    uint32_t array_index;
+    uint32_t period;
+    client_poll_callback callback;
+    void *context;
+    /* how long the value was the last time, to pack the next read */
+    uint16_t value_len;
+    /* on the device's due list, in a request, due again while it was in
+       one, removed while it was either */
+    bool due;
+    bool in_flight;
+    bool due_again;
+    bool removed;
+    /* the due list */
+    struct Client_Poll_Point *next;
+};
+
+struct Client_Poll_Device {
+    uint32_t device_id;
+    unsigned points;
+    unsigned in_flight;
+    /* the reads that are due, in the order they came due */
+    CLIENT_POLL_POINT *due_head;
+    CLIENT_POLL_POINT *due_tail;
+    /* the most reads in a request, fewer after an Abort of a reply that
+       was too long for it */
+    unsigned max_reads;
+    /* it rejected ReadPropertyMultiple */
+    bool read_property;
+    /* on the ready list, with reads due */
+    bool ready;
+    CLIENT_POLL_DEVICE *ready_next;
+    /* the hash chain */
+    CLIENT_POLL_DEVICE *next;
+};
+
+/* a request in flight, the context of its completion */
+typedef struct Client_Poll_Request {
+    CLIENT_POLL_DEVICE *device;
+    uint32_t device_id;
+    bool read_property;
+    unsigned count;
+    /* in the order they are in the request, object by object */
+    CLIENT_POLL_POINT *points[CLIENT_POLL_MAX_READS];
+    /* the free list, or the requests to send */
+    struct Client_Poll_Request *next;
+} CLIENT_POLL_REQUEST;
+
+#define CLIENT_POLL_HASH 256
+
+static CLIENT_POLL_DEVICE *Device_Table[CLIENT_POLL_HASH];
+static CLIENT_POLL_DEVICE *Ready_Head;
+static CLIENT_POLL_DEVICE *Ready_Tail;
+static CLIENT_POLL_REQUEST *Request_Free;
+static BACNET_TIMER_WHEEL Poll_Wheel;
+static unsigned Poll_Requests;
+
+/* all of the above. Nothing else is taken under it but the address cache,
+   and the requests are sent and the points called back without it, so
+   that it can be taken from a completion. */
+BACNET_LOCK_DEFINE(Client_Poll_Lock);
+
+/* held while the points are called back, and by Client_Poll_Remove(), so
+   that no callback of a point is running or to come once it is removed.
+   It is taken before Client_Poll_Lock. */
+BACNET_LOCK_DEFINE(Client_Poll_Report_Lock);
+
+static CLIENT_POLL_DEVICE *client_poll_device(
+    uint32_t device_id,
+    bool create)
+{
+    CLIENT_POLL_DEVICE **slot = &Device_Table[device_id % CLIENT_POLL_HASH];
+    CLIENT_POLL_DEVICE *device;
+
+    for (device = *slot; device != NULL; device = device->next) {
+        if (device->device_id == device_id) {
+            return device;
+        }
+    }
+    if (create) {
+        device = (CLIENT_POLL_DEVICE *) calloc(1, sizeof(CLIENT_POLL_DEVICE));
+        if (device != NULL) {
+            device->device_id = device_id;
+            device->max_reads = CLIENT_POLL_MAX_READS;
+            device->next = *slot;
+            *slot = device;
+        }
+    }
+
+    return device;
+}
+
+/* frees the device once nothing refers to it */
+static void client_poll_device_release(
+    CLIENT_POLL_DEVICE * device)
+{
+    CLIENT_POLL_DEVICE **slot;
+
+    if ((device->points > 0) || (device->in_flight > 0) ||
+        (device->due_head != NULL) || device->ready) {
+        return;
+    }
+    slot = &Device_Table[device->device_id % CLIENT_POLL_HASH];
+    while (*slot != device) {
+        slot = &(*slot)->next;
+    }
+    *slot = device->next;
+    free(device);
+}
+
+static void client_poll_ready(
+    CLIENT_POLL_DEVICE * device)
+{
+    if (device->ready) {
+        return;
+    }
+    device->ready = true;
+    device->ready_next = NULL;
+    if (Ready_Tail != NULL) {
+        Ready_Tail->ready_next = device;
+    } else {
+        Ready_Head = device;
+    }
+    Ready_Tail = device;
+}
+
+static void client_poll_due(
+    CLIENT_POLL_POINT * point)
+{
+    CLIENT_POLL_DEVICE *device = point->device;
+
+    if (point->removed || point->due) {
+        return;
+    }
+    if (point->in_flight) {
+        /* it goes again as soon as the read it is in is done */
+        point->due_again = true;
+        return;
+    }
+    point->due = true;
+    point->next = NULL;
+    if (device->due_tail != NULL) {
+        device->due_tail->next = point;
+    } else {
+        device->due_head = point;
+    }
+    device->due_tail = point;
+    client_poll_ready(device);
+}
+
+/* from timer_wheel_advance(), locked */
+static void client_poll_expired(
+    BACNET_TIMER * timer)
+{
+    CLIENT_POLL_POINT *point = (CLIENT_POLL_POINT *) timer->context;
+
+    /* every period from when it was due, however long the read takes */
+    timer_wheel_start(&Poll_Wheel, &point->Timer, point->period,
+        client_poll_expired, point);
+    client_poll_due(point);
+}
+
+/* the length of a context tagged enumeration or unsigned */
+static unsigned client_poll_tag_len(
+    uint32_t value)
+{
+    if (value < 0x100) {
+        return 2;
+    } else if (value < 0x10000) {
+        return 3;
+    } else if (value < 0x1000000) {
+        return 4;
+    }
+
+    return 5;
+}
+
+/* takes the due reads that fit in a request, and in its reply, to a device
+   that takes max_apdu. Locked. */
+static CLIENT_POLL_REQUEST *client_poll_request_build(
+    CLIENT_POLL_DEVICE * device,
+    unsigned max_apdu)
+{
+    CLIENT_POLL_REQUEST *request;
+    CLIENT_POLL_POINT *taken[CLIENT_POLL_MAX_READS];
+    unsigned object[CLIENT_POLL_MAX_READS];
+    unsigned objects = 0;
+    unsigned count = 0;
+    unsigned request_limit;
+    unsigned reply_limit;
+    /* the confirmed request header, the ComplexACK header */
+    unsigned request_len = 4;
+    unsigned reply_len = 3;
+    unsigned property_len;
+    unsigned value_len;
+    unsigned max_reads;
+    unsigned i, j, n;
+    CLIENT_POLL_POINT *point;
+
+    /* the request goes with its NPDU in max_apdu, see rpm_send_request(),
+       and the reply comes back in as much as both ends take */
+    reply_limit = (max_apdu < MAX_APDU) ? max_apdu : MAX_APDU;
+    request_limit = (max_apdu > MAX_NPDU) ? (max_apdu - MAX_NPDU) : 0;
+    max_reads = device->read_property ? 1 : device->max_reads;
+    while ((point = device->due_head) != NULL) {
+        if (point->removed) {
+            device->due_head = point->next;
+            free(point);
+            continue;
+        }
+        if (count == max_reads) {
+            break;
+        }
+        for (j = 0; j < count; j++) {
+            if ((taken[j]->object_type == point->object_type) &&
+                (taken[j]->object_instance == point->object_instance)) {
+                break;
+            }
+        }
+        property_len = client_poll_tag_len(point->object_property);
+        if (point->array_index != BACNET_ARRAY_ALL) {
+            property_len += client_poll_tag_len(point->array_index);
+        }
+        /* a value in its opening and closing tags, or an error as long */
+        value_len = 2 + ((point->value_len > 6) ? point->value_len : 6);
+        if (j == count) {
+            /* the object identifier and the list's opening and closing */
+            property_len += 5 + 2;
+        }
+        if ((count > 0) &&
+            (((request_len + property_len) > request_limit) ||
+                ((reply_len + property_len + value_len) > reply_limit))) {
+            break;
+        }
+        request_len += property_len;
+        reply_len += property_len + value_len;
+        object[count] = (j == count) ? objects++ : object[j];
+        taken[count++] = point;
+        device->due_head = point->next;
+        point->due = false;
+        point->in_flight = true;
+    }
+    if (device->due_head == NULL) {
+        device->due_tail = NULL;
+    }
+    if (count == 0) {
+        return NULL;
+    }
+    request = Request_Free;
+    if (request != NULL) {
+        Request_Free = request->next;
+    } else {
+        request =
+            (CLIENT_POLL_REQUEST *) malloc(sizeof(CLIENT_POLL_REQUEST));
+    }
+    if (request == NULL) {
+        /* back on the list, to go when there is memory */
+        for (i = count; i > 0; i--) {
+            point = taken[i - 1];
+            point->in_flight = false;
+            point->due = true;
+            point->next = device->due_head;
+            device->due_head = point;
+            if (device->due_tail == NULL) {
+                device->due_tail = point;
+            }
+        }
+        return NULL;
+    }
+    request->device = device;
+    request->device_id = device->device_id;
+    request->read_property = device->read_property;
+    request->count = count;
+    request->next = NULL;
+    /* the reads of an object together, in the order the objects came due */
+    n = 0;
+    for (i = 0; i < objects; i++) {
+        for (j = 0; j < count; j++) {
+            if (object[j] == i) {
+                request->points[n++] = taken[j];
+            }
+        }
+    }
+    device->in_flight++;
+
+    return request;
+}
+
+/* Client_Poll_Report_Lock is held */
+static void client_poll_report(
+    CLIENT_POLL_POINT * point,
+    CLIENT_POLL_VALUE * value)
+{
+    bool removed;
+
+    BACNET_LOCK(Client_Poll_Lock);
+    removed = point->removed;
+    BACNET_UNLOCK(Client_Poll_Lock);
+    if (removed) {
+        return;
+    }
+    value->device_id = point->device->device_id;
+    value->object_type = point->object_type;
+    value->object_instance = point->object_instance;
+    value->object_property = point->object_property;
+    value->array_index = point->array_index;
+    point->callback(value, point->context);
+}
+
+static void client_poll_value_init(
+    CLIENT_POLL_VALUE * value,
+    CLIENT_ASYNC_RESULT result)
+{
+    value->result = result;
+    value->application_data = NULL;
+    value->application_data_len = 0;
+    value->error_class = ERROR_CLASS_SERVICES;
+    value->error_code = ERROR_CODE_OTHER;
+    value->reason = 0;
+}
+
+/* the read in the request that a result is for, which is almost always
+   the next one. count if there is none. */
+static unsigned client_poll_match(
+    CLIENT_POLL_REQUEST * request,
+    bool *done,
+    unsigned *cursor,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index)
+{
+    CLIENT_POLL_POINT *point;
+    unsigned i, n;
+
+    for (n = 0; n < request->count; n++) {
+        i = (*cursor + n) % request->count;
+        point = request->points[i];
+        if (!done[i] && (point->object_type == object_type) &&
+            (point->object_instance == object_instance) &&
+            (point->object_property == object_property) &&
+            (point->array_index == array_index)) {
+            *cursor = i + 1;
+            return i;
+        }
+    }
+
+    return request->count;
+}
+
+/* hands each value or property access error of a ReadPropertyMultiple-ACK
+   to its point, in place */
+static void client_poll_rpm_ack(
+    CLIENT_POLL_REQUEST * request,
+    bool *done,
+    uint8_t * apdu,
+    int apdu_len)
+{
+    CLIENT_POLL_VALUE value;
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t object_instance;
+    BACNET_PROPERTY_ID object_property;
+    uint32_t array_index;
+    unsigned cursor = 0;
+    unsigned i;
+    int len;
+
+    while (apdu_len > 0) {
+        len =
+            rpm_ack_decode_object_id(apdu, (unsigned) apdu_len, &object_type,
+            &object_instance);
+        if (len <= 0) {
+            return;
+        }
+        apdu += len;
+        apdu_len -= len;
+        while (apdu_len > 0) {
+            len = rpm_ack_decode_object_end(apdu, (unsigned) apdu_len);
+            if (len > 0) {
+                apdu += len;
+                apdu_len -= len;
+                break;
+            }
+            len =
+                rpm_ack_decode_object_property(apdu, (unsigned) apdu_len,
+                &object_property, &array_index);
+            if ((len <= 0) || (len >= apdu_len)) {
+                return;
+            }
+            apdu += len;
+            apdu_len -= len;
+            if (decode_is_opening_tag_number(apdu, 4)) {
+                len =
+                    bacapp_data_len(apdu, (unsigned) apdu_len,
+                    object_property);
+                if ((len < 0) || ((len + 2) > apdu_len) ||
+                    !decode_is_closing_tag_number(&apdu[len + 1], 4)) {
+                    return;
+                }
+                client_poll_value_init(&value, CLIENT_ASYNC_ACK);
+                value.application_data = &apdu[1];
+                value.application_data_len = len;
+                len += 2;
+            } else if (decode_is_opening_tag_number(apdu, 5)) {
+                client_poll_value_init(&value, CLIENT_ASYNC_ERROR);
+                len =
+                    bacerror_decode_error_class_and_code(&apdu[1],
+                    (unsigned) apdu_len - 1, &value.error_class,
+                    &value.error_code);
+                if ((len <= 0) || ((len + 2) > apdu_len) ||
+                    !decode_is_closing_tag_number(&apdu[len + 1], 5)) {
+                    return;
+                }
+                len += 2;
+            } else {
+                return;
+            }
+            i = client_poll_match(request, done, &cursor, object_type,
+                object_instance, object_property, array_index);
+            if (i < request->count) {
+                done[i] = true;
+                if (value.result == CLIENT_ASYNC_ACK) {
+                    request->points[i]->value_len =
+                        (uint16_t) value.application_data_len;
+                }
+                client_poll_report(request->points[i], &value);
+            }
+            apdu += len;
+            apdu_len -= len;
+        }
+    }
+}
+
+static void client_poll_rp_ack(
+    CLIENT_POLL_REQUEST * request,
+    bool *done,
+    uint8_t * apdu,
+    int apdu_len)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    CLIENT_POLL_VALUE value;
+    CLIENT_POLL_POINT *point = request->points[0];
+
+    if ((rp_ack_decode_service_request(apdu, apdu_len, &rpdata) > 0) &&
+        (rpdata.object_type == point->object_type) &&
+        (rpdata.object_instance == point->object_instance) &&
+        (rpdata.object_property == point->object_property) &&
+        (rpdata.array_index == point->array_index)) {
+        client_poll_value_init(&value, CLIENT_ASYNC_ACK);
+        value.application_data = rpdata.application_data;
+        value.application_data_len = rpdata.application_data_len;
+        point->value_len = (uint16_t) rpdata.application_data_len;
+        done[0] = true;
+        client_poll_report(point, &value);
+    }
+}
+
+static void client_poll_send_ready(
+    void);
+
+/* the request is done, completion NULL if it could not be sent. Each of
+   its points is told how, unless it is to be read again another way. */
+static void client_poll_request_done(
+    CLIENT_POLL_REQUEST * request,
+    CLIENT_ASYNC_COMPLETION * completion)
+{
+    CLIENT_POLL_DEVICE *device = request->device;
+    CLIENT_POLL_POINT *point;
+    CLIENT_POLL_VALUE value;
+    bool done[CLIENT_POLL_MAX_READS] = { false };
+    bool again = false;
+    unsigned i;
+
+    BACNET_LOCK(Client_Poll_Report_Lock);
+    client_poll_value_init(&value,
+        completion ? completion->result : CLIENT_ASYNC_TIMEOUT);
+    if (completion == NULL) {
+        /* not bound, or no invoke ID: as if there had been no answer */
+    } else if (completion->result == CLIENT_ASYNC_ACK) {
+        if (request->read_property) {
+            client_poll_rp_ack(request, done, completion->service_request,
+                completion->service_len);
+        } else {
+            client_poll_rpm_ack(request, done, completion->service_request,
+                completion->service_len);
+        }
+        /* a read the ACK left out */
+        client_poll_value_init(&value, CLIENT_ASYNC_ERROR);
+    } else if (completion->result == CLIENT_ASYNC_ERROR) {
+        value.error_class = completion->error_class;
+        value.error_code = completion->error_code;
+    } else if ((completion->result == CLIENT_ASYNC_REJECT) &&
+        !request->read_property &&
+        (completion->reason == REJECT_REASON_UNRECOGNIZED_SERVICE)) {
+        /* no ReadPropertyMultiple, read them one at a time */
+        BACNET_LOCK(Client_Poll_Lock);
+        device->read_property = true;
+        BACNET_UNLOCK(Client_Poll_Lock);
+        again = true;
+    } else if ((completion->result == CLIENT_ASYNC_ABORT) &&
+        (request->count > 1) &&
+        ((completion->reason == ABORT_REASON_SEGMENTATION_NOT_SUPPORTED) ||
+            (completion->reason == ABORT_REASON_BUFFER_OVERFLOW))) {
+        /* the reply was too long for it, ask for half as much */
+        BACNET_LOCK(Client_Poll_Lock);
+        if (device->max_reads > (request->count / 2)) {
+            device->max_reads = request->count / 2;
+        }
+        BACNET_UNLOCK(Client_Poll_Lock);
+        again = true;
+    } else {
+        value.reason = completion->reason;
+    }
+    if (!again) {
+        for (i = 0; i < request->count; i++) {
+            if (!done[i]) {
+                client_poll_report(request->points[i], &value);
+            }
+        }
+    }
+    BACNET_UNLOCK(Client_Poll_Report_Lock);
+
+    BACNET_LOCK(Client_Poll_Lock);
+    for (i = 0; i < request->count; i++) {
+        point = request->points[i];
+        point->in_flight = false;
+        if (point->removed) {
+            free(point);
+        } else if (again || point->due_again) {
+            point->due_again = false;
+            client_poll_due(point);
+        }
+    }
+    device->in_flight--;
+    if (device->due_head != NULL) {
+        client_poll_ready(device);
+    }
+    client_poll_device_release(device);
+    request->next = Request_Free;
+    Request_Free = request;
+    BACNET_UNLOCK(Client_Poll_Lock);
+
+    client_poll_send_ready();
+}
+
+static void client_poll_complete(
+    CLIENT_ASYNC_COMPLETION * completion,
+    void *context)
+{
+    client_poll_request_done((CLIENT_POLL_REQUEST *) context, completion);
+}
+
+static void client_poll_request_send(
+    CLIENT_POLL_REQUEST * request)
+{
+    BACNET_READ_ACCESS_DATA objects[CLIENT_POLL_MAX_READS];
+    BACNET_PROPERTY_REFERENCE properties[CLIENT_POLL_MAX_READS];
+    BACNET_READ_ACCESS_DATA *object = NULL;
+    CLIENT_POLL_POINT *point;
+    uint8_t pdu[MAX_PDU];
+    uint8_t invoke_id;
+    unsigned i;
+
+    if (request->read_property) {
+        point = request->points[0];
+        invoke_id =
+            Send_Read_Property_Request_Async(request->device_id,
+            point->object_type, point->object_instance,
+            point->object_property, point->array_index,
+            client_poll_complete, request);
+    } else {
+        for (i = 0; i < request->count; i++) {
+            point = request->points[i];
+            if ((object == NULL) ||
+                (object->object_type != point->object_type) ||
+                (object->object_instance != point->object_instance)) {
+                object = (object == NULL) ? &objects[0] : (object + 1);
+                object->object_type = point->object_type;
+                object->object_instance = point->object_instance;
+                object->listOfProperties = &properties[i];
+                object->next = NULL;
+                if (object != &objects[0]) {
+                    (object - 1)->next = object;
+                }
+            } else {
+                properties[i - 1].next = &properties[i];
+            }
+            properties[i].propertyIdentifier = point->object_property;
+            properties[i].propertyArrayIndex = point->array_index;
+            properties[i].value = NULL;
+            properties[i].next = NULL;
+        }
+        invoke_id =
+            Send_Read_Property_Multiple_Request_Async(pdu, sizeof(pdu),
+            request->device_id, &objects[0], client_poll_complete, request);
+    }
+    if (invoke_id == 0) {
+        client_poll_request_done(request, NULL);
+    } else {
+        BACNET_LOCK(Client_Poll_Lock);
+        Poll_Requests++;
+        BACNET_UNLOCK(Client_Poll_Lock);
+    }
+}
+
+/* sends what the devices with reads due have room for */
+static void client_poll_send_ready(
+    void)
+{
+    CLIENT_POLL_DEVICE *device;
+    CLIENT_POLL_REQUEST *request;
+    CLIENT_POLL_REQUEST *send_head = NULL;
+    CLIENT_POLL_REQUEST **send_tail = &send_head;
+    BACNET_ADDRESS dest;
+    unsigned max_apdu;
+
+    BACNET_LOCK(Client_Poll_Lock);
+    while ((device = Ready_Head) != NULL) {
+        Ready_Head = device->ready_next;
+        if (Ready_Head == NULL) {
+            Ready_Tail = NULL;
+        }
+        device->ready = false;
+        max_apdu = 0;
+        /* asks the application for a Who-Is if it is not bound */
+        if (!address_bind_request(device->device_id, &max_apdu, &dest) ||
+            (max_apdu == 0)) {
+            max_apdu = MAX_APDU;
+        }
+        while ((device->due_head != NULL) &&
+            (device->in_flight < CLIENT_POLL_DEVICE_REQUESTS)) {
+            request = client_poll_request_build(device, max_apdu);
+            if (request == NULL) {
+                break;
+            }
+            *send_tail = request;
+            send_tail = &request->next;
+        }
+        client_poll_device_release(device);
+    }
+    BACNET_UNLOCK(Client_Poll_Lock);
+
+    while ((request = send_head) != NULL) {
+        send_head = request->next;
+        client_poll_request_send(request);
+    }
+}
+
+void Client_Poll_Init(
+    void)
+{
+    BACNET_LOCK_INIT(Client_Poll_Lock);
+    BACNET_LOCK_INIT(Client_Poll_Report_Lock);
+    Client_Async_Init();
+    timer_wheel_init(&Poll_Wheel);
+    Poll_Requests = 0;
+}
+
+CLIENT_POLL_POINT *Client_Poll_Add(
+    uint32_t device_id,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index,
+    uint32_t period_ms,
+    client_poll_callback callback,
+    void *context)
+{
+    CLIENT_POLL_POINT *point;
+
+    point = (CLIENT_POLL_POINT *) calloc(1, sizeof(CLIENT_POLL_POINT));
+    if (point == NULL) {
+        return NULL;
+    }
+    point->object_type = object_type;
+    point->object_instance = object_instance;
+    point->object_property = object_property;
+    point->array_index = array_index;
+    point->period = (period_ms > 0) ? period_ms : 1;
+    point->callback = callback;
+    point->context = context;
+    point->value_len = CLIENT_POLL_VALUE_SIZE;
+    BACNET_LOCK(Client_Poll_Lock);
+    point->device = client_poll_device(device_id, true);
+    if (point->device == NULL) {
+        BACNET_UNLOCK(Client_Poll_Lock);
+        free(point);
+        return NULL;
+    }
+    point->device->points++;
+    /* points added together come due together, and go together */
+    timer_wheel_start(&Poll_Wheel, &point->Timer, 1, client_poll_expired,
+        point);
+    BACNET_UNLOCK(Client_Poll_Lock);
+
+    return point;
+}
+
+void Client_Poll_Remove(
+    CLIENT_POLL_POINT * point)
+{
+    CLIENT_POLL_DEVICE *device;
+
+    if (point == NULL) {
+        return;
+    }
+    /* waits for a callback on another thread */
+    BACNET_LOCK(Client_Poll_Report_Lock);
+    BACNET_LOCK(Client_Poll_Lock);
+    device = point->device;
+    timer_wheel_stop(&Poll_Wheel, &point->Timer);
+    device->points--;
+    point->removed = true;
+    /* otherwise it is freed as it comes off the due list, or its read is
+       done */
+    if (!point->due && !point->in_flight) {
+        free(point);
+    }
+    client_poll_device_release(device);
+    BACNET_UNLOCK(Client_Poll_Lock);
+    BACNET_UNLOCK(Client_Poll_Report_Lock);
+}
+
+void Client_Poll_Timer(
+    uint16_t milliseconds)
+{
+    BACNET_LOCK(Client_Poll_Lock);
+    timer_wheel_advance(&Poll_Wheel, milliseconds);
+    BACNET_UNLOCK(Client_Poll_Lock);
+    client_poll_send_ready();
+}
+
+uint32_t Client_Poll_Next_Milliseconds(
+    void)
+{
+    uint32_t milliseconds;
+
+    BACNET_LOCK(Client_Poll_Lock);
+    milliseconds = timer_wheel_next(&Poll_Wheel);
+    BACNET_UNLOCK(Client_Poll_Lock);
+
+    return milliseconds;
+}
+
+unsigned Client_Poll_Requests(
+    void)
+{
+    unsigned count;
+
+    BACNET_LOCK(Client_Poll_Lock);
+    count = Poll_Requests;
+    BACNET_UNLOCK(Client_Poll_Lock);
+
+    return count;
+}
+#endif
+
+#ifdef TEST
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include "ctest.h"
+#include "bacaddr.h"
+#include "npdu.h"
+#include "apdu.h"
+#include "tsm.h"
+#include "abort.h"
+#include "reject.h"
+
+/* the simulated devices, device_id n is Test_Devices[n] */
+typedef struct {
+    bool bound;
+    bool silent;
+    bool no_rpm;
+    unsigned max_apdu;
+    /* the longest reply it can send, it aborts the rest */
+    unsigned reply_limit;
+    unsigned requests;
+} TEST_DEVICE;
+
+#define TEST_MAX_DEVICES 64
+static TEST_DEVICE Test_Devices[TEST_MAX_DEVICES];
+
+/* the requests on their way to the devices */
+typedef struct {
+    BACNET_ADDRESS dest;
+    uint8_t *pdu;
+    unsigned pdu_len;
+} TEST_PACKET;
+
+static TEST_PACKET *Test_Packets;
+static unsigned Test_Packet_Count;
+static unsigned Test_Packet_Size;
+static unsigned long Test_Octets;
+
+static void testClientPollAddress(
+    BACNET_ADDRESS * address,
+    uint32_t device_id)
+{
+    memset(address, 0, sizeof(*address));
+    address->mac_len = 6;
+    address->mac[0] = 10;
+    address->mac[3] = (uint8_t) device_id;
+    address->mac[4] = 0xBA;
+    address->mac[5] = 0xC0;
+}
+
+int datalink_send_pdu(
+    BACNET_ADDRESS * dest,
+    BACNET_NPCI_DATA * npci_data,
+    uint8_t * pdu,
+    unsigned pdu_len)
+{
+    TEST_PACKET *packet;
+
+    (void) npci_data;
+    if (Test_Packet_Count == Test_Packet_Size) {
+        Test_Packet_Size = Test_Packet_Size ? (Test_Packet_Size * 2) : 64;
+        Test_Packets =
+            (TEST_PACKET *) realloc(Test_Packets,
+            Test_Packet_Size * sizeof(TEST_PACKET));
+    }
+    packet = &Test_Packets[Test_Packet_Count++];
+    bacnet_address_copy(&packet->dest, dest);
+    packet->pdu = (uint8_t *) malloc(pdu_len);
+    memcpy(packet->pdu, pdu, pdu_len);
+    packet->pdu_len = pdu_len;
+    Test_Octets += pdu_len;
+
+    return (int) pdu_len;
+}
+
+void datalink_get_my_address(
+    BACNET_ADDRESS * my_address)
+{
+    memset(my_address, 0, sizeof(*my_address));
+}
+
+bool address_get_by_device(
+    uint32_t device_id,
+    unsigned *max_apdu,
+    BACNET_ADDRESS * src)
+{
+    if ((device_id >= TEST_MAX_DEVICES) || !Test_Devices[device_id].bound) {
+        return false;
+    }
+    *max_apdu = Test_Devices[device_id].max_apdu;
+    testClientPollAddress(src, device_id);
+
+    return true;
+}
+
+bool address_bind_request(
+    uint32_t device_id,
+    unsigned *max_apdu,
+    BACNET_ADDRESS * src)
+{
+    return address_get_by_device(device_id, max_apdu, src);
+}
+
+bool address_learned_get(
+    BACNET_ADDRESS * src,
+    unsigned *max_apdu,
+    BACNET_ADDRESS_LEARNED * learned)
+{
+    (void) src;
+    (void) max_apdu;
+    (void) learned;
+    return false;
+}
+
+void address_learned_set(
+    BACNET_ADDRESS * src,
+    BACNET_ADDRESS_LEARNED * learned)
+{
+    (void) src;
+    (void) learned;
+}
+
+/* what a device with each analog input's present value its instance
+   number, and no description, says to a ReadProperty */
+static int testClientPollRp(
+    uint8_t * apdu,
+    uint8_t invoke_id,
+    uint8_t * request,
+    unsigned request_len)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    uint8_t value[8];
+
+    rp_decode_service_request(request, request_len, &rpdata);
+    if (rpdata.object_property == PROP_DESCRIPTION) {
+        return bacerror_encode_apdu(apdu, invoke_id,
+            SERVICE_CONFIRMED_READ_PROPERTY, ERROR_CLASS_PROPERTY,
+            ERROR_CODE_UNKNOWN_PROPERTY);
+    }
+    rpdata.application_data_len =
+        encode_application_real(value, (float) rpdata.object_instance);
+    rpdata.application_data = value;
+
+    return rp_ack_encode_apdu(apdu, invoke_id, &rpdata);
+}
+
+/* and to a ReadPropertyMultiple */
+static int testClientPollRpm(
+    uint8_t * apdu,
+    uint8_t invoke_id,
+    uint8_t * request,
+    unsigned request_len)
+{
+    BACNET_RPM_DATA rpmdata;
+    uint8_t value[8];
+    unsigned len = 0;
+    int apdu_len;
+    int value_len;
+    int n;
+
+    apdu_len = rpm_ack_encode_apdu_init(apdu, invoke_id);
+    while (len < request_len) {
+        n = rpm_decode_object_id(&request[len], request_len - len, &rpmdata);
+        if (n <= 0) {
+            break;
+        }
+        len += n;
+        apdu_len += rpm_ack_encode_apdu_object_begin(&apdu[apdu_len],
+            &rpmdata);
+        while (len < request_len) {
+            n = rpm_decode_object_end(&request[len], request_len - len);
+            if (n > 0) {
+                len += n;
+                break;
+            }
+            n = rpm_decode_object_property(&request[len], request_len - len,
+                &rpmdata);
+            if (n <= 0) {
+                return -1;
+            }
+            len += n;
+            apdu_len +=
+                rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+                rpmdata.object_property, rpmdata.array_index);
+            if (rpmdata.object_property == PROP_DESCRIPTION) {
+                apdu_len +=
+                    rpm_ack_encode_apdu_object_property_error(&apdu
+                    [apdu_len], ERROR_CLASS_PROPERTY,
+                    ERROR_CODE_UNKNOWN_PROPERTY);
+            } else {
+                value_len =
+                    encode_application_real(value,
+                    (float) rpmdata.object_instance);
+                apdu_len +=
+                    rpm_ack_encode_apdu_object_property_value(&apdu
+                    [apdu_len], value, (unsigned) value_len);
+            }
+        }
+        apdu_len += rpm_ack_encode_apdu_object_end(&apdu[apdu_len]);
+    }
+
+    return apdu_len;
+}
+
+/* the devices answer everything sent so far, and what that sends,
+   returns the number of requests */
+static unsigned testClientPollAnswer(
+    void)
+{
+    TEST_PACKET packet;
+    TEST_DEVICE *device;
+    BACNET_NPCI_DATA npci;
+    uint8_t apdu[MAX_APDU * 4];
+    unsigned requests = 0;
+    unsigned n = 0;
+    uint8_t *request;
+    unsigned request_len;
+    int offset;
+    int apdu_len;
+
+    while (n < Test_Packet_Count) {
+        packet = Test_Packets[n++];
+        device = &Test_Devices[packet.dest.mac[3]];
+        offset = npci_decode(packet.pdu, NULL, NULL, &npci);
+        if ((offset <= 0) || device->silent ||
+            ((packet.pdu[offset] & 0xF0) !=
+                PDU_TYPE_CONFIRMED_SERVICE_REQUEST)) {
+            free(packet.pdu);
+            continue;
+        }
+        requests++;
+        device->requests++;
+        request = &packet.pdu[offset + 4];
+        request_len = packet.pdu_len - (unsigned) offset - 4;
+        if (packet.pdu[offset + 3] == SERVICE_CONFIRMED_READ_PROPERTY) {
+            apdu_len =
+                testClientPollRp(apdu, packet.pdu[offset + 2], request,
+                request_len);
+        } else if (device->no_rpm) {
+            apdu_len =
+                reject_encode_apdu(apdu, packet.pdu[offset + 2],
+                REJECT_REASON_UNRECOGNIZED_SERVICE);
+        } else {
+            apdu_len =
+                testClientPollRpm(apdu, packet.pdu[offset + 2], request,
+                request_len);
+            if ((apdu_len < 0) || ((unsigned) apdu_len > device->reply_limit)) {
+                apdu_len =
+                    abort_encode_apdu(apdu, packet.pdu[offset + 2],
+                    ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
+            }
+        }
+        free(packet.pdu);
+        Test_Octets += (unsigned) apdu_len;
+        apdu_handler(&packet.dest, apdu, (uint16_t) apdu_len);
+    }
+    Test_Packet_Count = 0;
+
+    return requests;
+}
+
+static void testClientPollTimeouts(
+    void)
+{
+    unsigned i;
+
+    for (i = 0; i <= apdu_retries(); i++) {
+        /* as long as a retry can wait, backed off or not */
+        tsm_timer_milliseconds(UINT16_MAX);
+        (void) testClientPollAnswer();
+    }
+}
+
+/* what the callback was told about a point */
+typedef struct TEST_Point {
+    CLIENT_POLL_POINT *point;
+    uint32_t device_id;
+    uint32_t instance;
+    unsigned calls;
+    CLIENT_ASYNC_RESULT result;
+    BACNET_ERROR_CODE error_code;
+    bool value_ok;
+    /* a point the callback removes */
+    struct TEST_Point *remove;
+} TEST_POINT;
+
+static void testClientPollValue(
+    CLIENT_POLL_VALUE * value,
+    void *context)
+{
+    TEST_POINT *test = (TEST_POINT *) context;
+    BACNET_APPLICATION_DATA_VALUE decoded;
+
+    test->calls++;
+    if (test->remove != NULL) {
+        Client_Poll_Remove(test->remove->point);
+        test->remove->point = NULL;
+        test->remove->remove = NULL;
+        test->remove = NULL;
+    }
+    test->result = value->result;
+    test->error_code = value->error_code;
+    test->value_ok = false;
+    if ((value->result == CLIENT_ASYNC_ACK) &&
+        (value->device_id == test->device_id) &&
+        (value->object_instance == test->instance) &&
+        (bacapp_decode_application_data(value->application_data,
+                (unsigned) value->application_data_len, &decoded) > 0) &&
+        (decoded.tag == BACNET_APPLICATION_TAG_REAL)) {
+        test->value_ok = (decoded.type.Real == (float) test->instance);
+    }
+}
+
+static TEST_POINT *testClientPollAdd(
+    TEST_POINT * test,
+    uint32_t device_id,
+    uint32_t instance,
+    BACNET_PROPERTY_ID property,
+    uint32_t period)
+{
+    memset(test, 0, sizeof(*test));
+    test->device_id = device_id;
+    test->instance = instance;
+    test->point =
+        Client_Poll_Add(device_id, OBJECT_ANALOG_INPUT, instance, property,
+        BACNET_ARRAY_ALL, period, testClientPollValue, test);
+
+    return test;
+}
+
+static void testClientPollDevice(
+    uint32_t device_id,
+    unsigned max_apdu)
+{
+    memset(&Test_Devices[device_id], 0, sizeof(TEST_DEVICE));
+    Test_Devices[device_id].bound = true;
+    Test_Devices[device_id].max_apdu = max_apdu;
+    Test_Devices[device_id].reply_limit = max_apdu;
+}
+
+/* 1: reads 300 values and a description that is not there, 2: rejects
+   ReadPropertyMultiple, 3: says 480 octets but aborts replies over 200,
+   4: not bound, 5: never answers */
+#define TEST_POINTS (301 + 10 + 60 + 5 + 5)
+
+void testClientPoll(
+    Test * pTest)
+{
+    static TEST_POINT points[TEST_POINTS];
+    unsigned n = 0;
+    unsigned i;
+    unsigned requests;
+    bool ok;
+
+    Client_Poll_Init();
+    testClientPollDevice(1, 1476);
+    testClientPollDevice(2, 480);
+    Test_Devices[2].no_rpm = true;
+    testClientPollDevice(3, 480);
+    Test_Devices[3].reply_limit = 200;
+    testClientPollDevice(5, 480);
+    Test_Devices[5].silent = true;
+    for (i = 0; i < 300; i++) {
+        testClientPollAdd(&points[n++], 1, i, PROP_PRESENT_VALUE, 1000);
+    }
+    testClientPollAdd(&points[n++], 1, 7, PROP_DESCRIPTION, 1000);
+    for (i = 0; i < 10; i++) {
+        testClientPollAdd(&points[n++], 2, i, PROP_PRESENT_VALUE, 1000);
+    }
+    for (i = 0; i < 60; i++) {
+        testClientPollAdd(&points[n++], 3, i, PROP_PRESENT_VALUE, 1000);
+    }
+    for (i = 0; i < 5; i++) {
+        testClientPollAdd(&points[n++], 4, i, PROP_PRESENT_VALUE, 1000);
+    }
+    for (i = 0; i < 5; i++) {
+        testClientPollAdd(&points[n++], 5, i, PROP_PRESENT_VALUE, 1000);
+    }
+    ct_test(pTest, n == TEST_POINTS);
+    ct_test(pTest, Client_Poll_Next_Milliseconds() == 1);
+
+    Client_Poll_Timer(1);
+    (void) testClientPollAnswer();
+    testClientPollTimeouts();
+    ok = true;
+    for (i = 0; i < n; i++) {
+        ok &= (points[i].calls == 1);
+        if (points[i].device_id >= 4) {
+            ok &= (points[i].result == CLIENT_ASYNC_TIMEOUT);
+        } else if (i == 300) {
+            ok &= (points[i].result == CLIENT_ASYNC_ERROR) &&
+                (points[i].error_code == ERROR_CODE_UNKNOWN_PROPERTY);
+        } else {
+            ok &= (points[i].result == CLIENT_ASYNC_ACK) && points[i].value_ok;
+        }
+    }
+    ct_test(pTest, ok);
+    /* 301 reads in a few requests, not 301 */
+    ct_test(pTest, Test_Devices[1].requests < (301 / 10));
+    /* one ReadPropertyMultiple, then ReadProperty */
+    ct_test(pTest, Test_Devices[2].requests == 11);
+    ct_test(pTest, Client_Async_Pending() == 0);
+    ct_test(pTest, tsm_peer_transaction_count() == 0);
+
+    /* the next period: device 3 is sent what it can answer straight away,
+       and device 2 is not asked for ReadPropertyMultiple again */
+    for (i = 1; i <= 5; i++) {
+        Test_Devices[i].requests = 0;
+    }
+    requests = Client_Poll_Requests();
+    /* due a period after they first were */
+    Client_Poll_Timer(999);
+    ct_test(pTest, Test_Packet_Count == 0);
+    Client_Poll_Timer(1);
+    (void) testClientPollAnswer();
+    testClientPollTimeouts();
+    ok = true;
+    for (i = 0; i < n; i++) {
+        ok &= (points[i].calls == 2);
+    }
+    ct_test(pTest, ok);
+    ct_test(pTest, Test_Devices[2].requests == 10);
+    ct_test(pTest, Test_Devices[3].requests <= ((60 + 1) / 2));
+    /* and the one to device 5, that is never answered */
+    ct_test(pTest, (Client_Poll_Requests() - requests) ==
+        (Test_Devices[1].requests + Test_Devices[2].requests +
+            Test_Devices[3].requests + 1));
+
+    /* removed in flight, it is not reported, nor when the callback of
+       another removes it: whichever of the two is first */
+    Client_Poll_Timer(1000);
+    Client_Poll_Remove(points[0].point);
+    points[1].remove = &points[2];
+    points[2].remove = &points[1];
+    (void) testClientPollAnswer();
+    testClientPollTimeouts();
+    ct_test(pTest, points[0].calls == 2);
+    ct_test(pTest, (points[1].calls + points[2].calls) == (2 + 2 + 1));
+    ct_test(pTest, points[3].calls == 3);
+    for (i = 1; i < n; i++) {
+        Client_Poll_Remove(points[i].point);
+    }
+    ct_test(pTest, Client_Poll_Next_Milliseconds() == UINT32_MAX);
+    Client_Poll_Timer(1000);
+    ct_test(pTest, Test_Packet_Count == 0);
+}
+
+static double testClientPollSeconds(
+    struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec -
+        start->tv_nsec) / 1e9;
+}
+
+/* the naive poll, a ReadProperty for each point */
+static void testClientPollNaiveDone(
+    CLIENT_ASYNC_COMPLETION * completion,
+    void *context)
+{
+    unsigned *done = (unsigned *) context;
+
+    if (completion->result == CLIENT_ASYNC_ACK) {
+        (*done)++;
+    }
+}
+
+#define TEST_BENCH_DEVICES 50
+#define TEST_BENCH_POINTS 200
+/* a round trip to a controller, for the time the requests take on the
+   wire when each device has one at a time */
+#define TEST_BENCH_RTT_MS 20
+
+void testClientPollBenchmark(
+    Test * pTest)
+{
+    FILE *stream = ct_getStream(pTest);
+    static TEST_POINT points[TEST_BENCH_DEVICES * TEST_BENCH_POINTS];
+    struct timespec start;
+    unsigned requests[2];
+    unsigned long octets[2];
+    unsigned most[2] = { 0, 0 };
+    double seconds[2];
+    unsigned done = 0;
+    unsigned d, i;
+    bool ok = true;
+
+    Client_Poll_Init();
+    for (d = 1; d <= TEST_BENCH_DEVICES; d++) {
+        testClientPollDevice(d, 1476);
+    }
+
+    /* naive */
+    Test_Octets = 0;
+    requests[0] = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (d = 1; d <= TEST_BENCH_DEVICES; d++) {
+        for (i = 0; i < TEST_BENCH_POINTS; i++) {
+            ok &= (Send_Read_Property_Request_Async(d, OBJECT_ANALOG_INPUT,
+                    i, PROP_PRESENT_VALUE, BACNET_ARRAY_ALL,
+                    testClientPollNaiveDone, &done) != 0);
+        }
+        requests[0] += testClientPollAnswer();
+    }
+    seconds[0] = testClientPollSeconds(&start);
+    octets[0] = Test_Octets;
+    for (d = 1; d <= TEST_BENCH_DEVICES; d++) {
+        if (Test_Devices[d].requests > most[0]) {
+            most[0] = Test_Devices[d].requests;
+        }
+        Test_Devices[d].requests = 0;
+    }
+    ct_test(pTest, ok);
+    ct_test(pTest, done == (TEST_BENCH_DEVICES * TEST_BENCH_POINTS));
+
+    /* batched */
+    for (d = 1; d <= TEST_BENCH_DEVICES; d++) {
+        for (i = 0; i < TEST_BENCH_POINTS; i++) {
+            testClientPollAdd(&points[(d - 1) * TEST_BENCH_POINTS + i], d, i,
+                PROP_PRESENT_VALUE, 1000);
+        }
+    }
+    Test_Octets = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Client_Poll_Timer(1);
+    requests[1] = testClientPollAnswer();
+    seconds[1] = testClientPollSeconds(&start);
+    octets[1] = Test_Octets;
+    for (d = 1; d <= TEST_BENCH_DEVICES; d++) {
+        if (Test_Devices[d].requests > most[1]) {
+            most[1] = Test_Devices[d].requests;
+        }
+    }
+    for (i = 0; i < (TEST_BENCH_DEVICES * TEST_BENCH_POINTS); i++) {
+        ok &= (points[i].calls == 1) && points[i].value_ok;
+        Client_Poll_Remove(points[i].point);
+    }
+    ct_test(pTest, ok);
+    ct_test(pTest, requests[1] == Client_Poll_Requests());
+    ct_test(pTest, (requests[1] * 20) < requests[0]);
+    ct_test(pTest, Client_Async_Pending() == 0);
+
+    fprintf(stream, "\n  %u points on %u devices, one poll:\n",
+        TEST_BENCH_DEVICES * TEST_BENCH_POINTS, TEST_BENCH_DEVICES);
+    for (i = 0; i < 2; i++) {
+        fprintf(stream,
+            "  %-20s %5u requests %8lu octets %7.2f ms cpu, "
+            "%6u ms on the wire at %u ms a round trip\n",
+            i ? "ReadPropertyMultiple" : "ReadProperty", requests[i],
+            octets[i], seconds[i] * 1000.0, most[i] * TEST_BENCH_RTT_MS,
+            TEST_BENCH_RTT_MS);
+    }
+}
+
+#ifdef TEST_CLIENT_POLL
+void sys_panic(
+    const char *file,
+    const int line)
+{
+    (void) file;
+    (void) line;
+}
+
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    tsm_init();
+    pTest = ct_create("BACnet Client Poll", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testClientPoll);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testClientPollBenchmark);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_CLIENT_POLL */
+#endif /* TEST */
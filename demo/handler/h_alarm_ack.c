@@ -102,17 +102,23 @@ void handler_alarm_ack(
     BACNET_NPCI_DATA npci_data;
     BACNET_ALARM_ACK_DATA data;
     BACNET_ERROR_CODE error_code = ERROR_CODE_OTHER ; // todo2 placeholder
+    uint8_t *pdu = NULL;
 
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
         dbTraffic(DBD_ALL, DB_BTC_ERROR, "Alarm Ack: Segmented message.  Sending Abort!\n");
@@ -128,7 +134,7 @@ void handler_alarm_ack(
     if (len < 0) {
         /* bad decoding - send an abort */
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
         dbTraffic(DBD_ALL, DB_BTC_ERROR, "Alarm Ack: Bad Encoding.  Sending Abort!\n");
         goto AA_ABORT;
@@ -147,7 +153,7 @@ void handler_alarm_ack(
 	if (!Device_Valid_Object_Id(data.eventObjectIdentifier.type, data.eventObjectIdentifier.instance))
 	{
         len =
-			bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+			bacerror_encode_apdu(&pdu[pdu_len],
 				service_data->invoke_id,
 				SERVICE_CONFIRMED_ACKNOWLEDGE_ALARM, ERROR_CLASS_OBJECT, ERROR_CODE_UNKNOWN_OBJECT);
 	}
@@ -160,7 +166,7 @@ void handler_alarm_ack(
         switch (ack_result) {
             case 1:
                 len =
-                    encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+                    encode_simple_ack(&pdu[pdu_len],
                     service_data->invoke_id,
                     SERVICE_CONFIRMED_ACKNOWLEDGE_ALARM);
                 dbTraffic(DBD_ALL, DB_BTC_ERROR, "Alarm Acknowledge: " "Sending Simple Ack!\n");
@@ -168,7 +174,7 @@ void handler_alarm_ack(
 
             case -1:
                 len =
-                    bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                    bacerror_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id,
                     SERVICE_CONFIRMED_ACKNOWLEDGE_ALARM, ERROR_CLASS_OBJECT,
                     error_code);
@@ -178,14 +184,14 @@ void handler_alarm_ack(
 
             default:
                 len =
-                    abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                    abort_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id, ABORT_REASON_OTHER, true);
                 dbTraffic(DBD_ALL, DB_BTC_ERROR, "Alarm Acknowledge: abort other!\n");
             break;
         }
     } else {
         len =
-            bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            bacerror_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_ACKNOWLEDGE_ALARM,
             ERROR_CLASS_OBJECT, ERROR_CODE_NO_ALARM_CONFIGURED);
         dbTraffic(DBD_ALL, DB_BTC_ERROR, "Alarm Acknowledge: error %s!\n",
@@ -195,12 +201,13 @@ void handler_alarm_ack(
 AA_ABORT:
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr, "Alarm Acknowledge: " "Failed to send PDU (%s)!\n",
             strerror(errno));
 #endif
+    txbuf_release(pdu);
 
 }
@@ -128,18 +128,24 @@ void handler_atomic_read_file(
     BACNET_ADDRESS my_address;
     BACNET_ERROR_CLASS error_class = ERROR_CLASS_OBJECT;
     BACNET_ERROR_CODE error_code = ERROR_CODE_UNKNOWN_OBJECT;
+    uint8_t *pdu = NULL;
 
 
     dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "Received Atomic-Read-File Request!\n");
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     if (service_data->segmented_message) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
         dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "ARF: Segmented Message. Sending Abort!\n");
@@ -149,7 +155,7 @@ void handler_atomic_read_file(
     /* bad decoding - send an abort */
     if (len < 0) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
         dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "Bad Encoding. Sending Abort!\n");
         goto ARF_ABORT;
@@ -167,11 +173,11 @@ void handler_atomic_read_file(
 					data.type.stream.requestedOctetCount);
 #endif
 				len =
-					arf_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+					arf_ack_encode_apdu(&pdu[pdu_len],
 					service_data->invoke_id, &data);
             } else {
                 len =
-                    abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                    abort_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id,
                     ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
                 dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "Too Big To Send (%d >= %d). Sending Abort!\n",
@@ -189,7 +195,7 @@ void handler_atomic_read_file(
                     data.type.record.fileStartRecord,
                     data.type.record.RecordCount);
                 len =
-                    arf_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                    arf_ack_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id, &data);
             } else {
                 error = true;
@@ -209,20 +215,21 @@ void handler_atomic_read_file(
     }
     if (error) {
         len =
-            bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            bacerror_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_ATOMIC_READ_FILE,
             error_class, error_code);
     }
   ARF_ABORT:
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0) {
         fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
     }
 #endif
+    txbuf_release(pdu);
 
 }
 #endif
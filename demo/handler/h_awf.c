@@ -106,6 +106,7 @@ void handler_atomic_write_file(
     BACNET_ADDRESS my_address;
     BACNET_ERROR_CLASS error_class = ERROR_CLASS_OBJECT;
     BACNET_ERROR_CODE error_code = ERROR_CODE_UNKNOWN_OBJECT;
+    uint8_t *pdu = NULL;
 
 #if PRINT_ENABLED
     fprintf(stderr, "Received AtomicWriteFile Request!\n");
@@ -113,12 +114,17 @@ void handler_atomic_write_file(
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     if (service_data->segmented_message) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -130,7 +136,7 @@ void handler_atomic_write_file(
     /* bad decoding - send an abort */
     if (len < 0) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr, "Bad Encoding. Sending Abort!\n");
@@ -148,7 +154,7 @@ void handler_atomic_write_file(
                     (int)octetstring_length(&data.fileData[0]));
 #endif
                 len =
-                    awf_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                    awf_ack_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id, &data);
             } else {
                 error = true;
@@ -163,7 +169,7 @@ void handler_atomic_write_file(
                     data.type.record.returnedRecordCount);
 #endif
                 len =
-                    awf_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                    awf_ack_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id, &data);
             } else {
                 error = true;
@@ -185,20 +191,21 @@ void handler_atomic_write_file(
     }
     if (error) {
         len =
-            bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            bacerror_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_ATOMIC_WRITE_FILE,
             error_class, error_code);
     }
   AWF_ABORT:
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0) {
         fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
     }
 #endif
+    txbuf_release(pdu);
 
 }
 #endif
@@ -89,6 +89,7 @@ void handler_ccov_notification(
     int pdu_len = 0;
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     /* create linked list to store data if more
        than one property value is expected */
@@ -106,15 +107,20 @@ void handler_ccov_notification(
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
 #if PRINT_ENABLED
     fprintf(stderr, "CCOV: Received Notification!\n");
 #endif
     if (service_data->segmented_message) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -157,7 +163,7 @@ void handler_ccov_notification(
     /* bad decoding or something we didn't understand - send an abort */
     if (len <= 0) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr, "CCOV: Bad Encoding. Sending Abort!\n");
@@ -165,7 +171,7 @@ void handler_ccov_notification(
         goto CCOV_ABORT;
     } else {
         len =
-            encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+            encode_simple_ack(&pdu[pdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_COV_NOTIFICATION);
 #if PRINT_ENABLED
         fprintf(stderr, "CCOV: Sending Simple Ack!\n");
@@ -174,7 +180,7 @@ void handler_ccov_notification(
   CCOV_ABORT:
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0) {
@@ -183,5 +189,6 @@ void handler_ccov_notification(
 #else
     bytes_sent = bytes_sent;
 #endif
+    txbuf_release(pdu);
 
 }
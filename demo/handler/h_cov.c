@@ -64,6 +64,7 @@
 /* demo objects */
 #include "device.h"
 #include "handlers.h"
+#include "bacnet_lock.h"
 
 /** @file h_cov.c  Handles Change of Value (COV) services. */
 
@@ -98,6 +99,34 @@ static BACNET_COV_SUBSCRIPTION COV_Subscriptions[MAX_COV_SUBCRIPTIONS];
 #define MAX_COV_ADDRESSES 16
 #endif
 static BACNET_COV_ADDRESS COV_Addresses[MAX_COV_ADDRESSES];
+/* both lists. ReadProperty of Active_COV_Subscriptions takes it with the
+   object store locked, so it is let go while the objects are looked at */
+BACNET_LOCK_DEFINE(COV_Lock);
+/* the lifetimes of the subscriptions that have one, in seconds */
+static BACNET_TIMER_WHEEL COV_Wheel;
+
+static void cov_lifetime_expired(
+    BACNET_TIMER * timer);
+
+/* (re)starts the lifetime of a subscription, 0 is indefinite */
+static void cov_lifetime_start(
+    BACNET_COV_SUBSCRIPTION * cov_subscription)
+{
+    if (cov_subscription->lifetime) {
+        timer_wheel_start(&COV_Wheel, &cov_subscription->timer,
+            cov_subscription->lifetime, cov_lifetime_expired,
+            cov_subscription);
+    } else {
+        timer_wheel_stop(&COV_Wheel, &cov_subscription->timer);
+    }
+}
+
+/* seconds left of the subscription, 0 is indefinite */
+static uint32_t cov_time_remaining(
+    BACNET_COV_SUBSCRIPTION * cov_subscription)
+{
+    return timer_wheel_remaining(&COV_Wheel, &cov_subscription->timer);
+}
 
 /**
 * Gets the address from the list of COV addresses
@@ -302,7 +331,7 @@ static int cov_encode_subscription(
     /* TimeRemaining [3] Unsigned, */
     len =
         encode_context_unsigned(&apdu[apdu_len], 3,
-        cov_subscription->lifetime);
+        cov_time_remaining(cov_subscription));
     apdu_len += len;
 
     return apdu_len;
@@ -328,6 +357,7 @@ int handler_cov_encode_subscriptions(
     unsigned index = 0;
 
     if (apdu) {
+        BACNET_LOCK(COV_Lock);
         for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
             if (COV_Subscriptions[index].flag.valid) {
                 len =
@@ -336,10 +366,12 @@ int handler_cov_encode_subscriptions(
                 apdu_len += len;
                 /* TODO: too late here to notice that we overran the buffer */
                 if (apdu_len > max_apdu) {
-                    return -2;
+                    apdu_len = -2;
+                    break;
                 }
             }
         }
+        BACNET_UNLOCK(COV_Lock);
     }
 
     return apdu_len;
@@ -353,6 +385,8 @@ void handler_cov_init(
 {
     unsigned index = 0;
 
+    BACNET_LOCK_INIT(COV_Lock);
+    BACNET_LOCK(COV_Lock);
     for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
         COV_Subscriptions[index].flag.valid = false;
         COV_Subscriptions[index].dest_index = -1;
@@ -363,11 +397,13 @@ void handler_cov_init(
         COV_Subscriptions[index].flag.issueConfirmedNotifications = false;
         COV_Subscriptions[index].invokeID = 0;
         COV_Subscriptions[index].lifetime = 0;
+        timer_wheel_stop(&COV_Wheel, &COV_Subscriptions[index].timer);
         COV_Subscriptions[index].flag.send_requested = false;
     }
     for (index = 0; index < MAX_COV_ADDRESSES; index++) {
         COV_Addresses[index].valid = false;
     }
+    BACNET_UNLOCK(COV_Lock);
 }
 
 static bool cov_list_subscribe(
@@ -404,6 +440,8 @@ static bool cov_list_subscribe(
                     cov_data->subscriberProcessIdentifier) && address_match) {
                 existing_entry = true;
                 if (cov_data->cancellationRequest) {
+                    timer_wheel_stop(&COV_Wheel,
+                        &COV_Subscriptions[index].timer);
                     COV_Subscriptions[index].flag.valid = false;
                     COV_Subscriptions[index].dest_index = -1;
                     cov_address_remove_unused();
@@ -412,6 +450,7 @@ static bool cov_list_subscribe(
                     COV_Subscriptions[index].flag.issueConfirmedNotifications =
                         cov_data->issueConfirmedNotifications;
                     COV_Subscriptions[index].lifetime = cov_data->lifetime;
+                    cov_lifetime_start(&COV_Subscriptions[index]);
                     COV_Subscriptions[index].flag.send_requested = true;
                 }
                 if (COV_Subscriptions[index].invokeID) {
@@ -442,6 +481,7 @@ static bool cov_list_subscribe(
             cov_data->issueConfirmedNotifications;
         COV_Subscriptions[index].invokeID = 0;
         COV_Subscriptions[index].lifetime = cov_data->lifetime;
+        cov_lifetime_start(&COV_Subscriptions[index]);
         COV_Subscriptions[index].flag.send_requested = true;
     } else if (!existing_entry) {
         if (first_invalid_index < 0) {
@@ -475,6 +515,7 @@ static bool cov_send_request(
     bool status = false;        /* return value */
     BACNET_COV_DATA cov_data;
     BACNET_ADDRESS *dest = NULL;
+    uint8_t *pdu = NULL;
 
     if (!dcc_communication_enabled()) {
         return status;
@@ -494,8 +535,12 @@ static bool cov_send_request(
     }
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return false;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], dest, &my_address,
+        npdu_encode_pdu(&pdu[0], dest, &my_address,
         &npci_data);
     /* load the COV data structure for outgoing message */
     cov_data.subscriberProcessIdentifier =
@@ -505,7 +550,7 @@ static bool cov_send_request(
         cov_subscription->monitoredObjectIdentifier.type;
     cov_data.monitoredObjectIdentifier.instance =
         cov_subscription->monitoredObjectIdentifier.instance;
-    cov_data.timeRemaining = cov_subscription->lifetime;
+    cov_data.timeRemaining = cov_time_remaining(cov_subscription);
     cov_data.listOfValues = value_list;
     if (cov_subscription->flag.issueConfirmedNotifications) {
         npci_data.data_expecting_reply = true;
@@ -513,23 +558,23 @@ static bool cov_send_request(
         if (invoke_id) {
             cov_subscription->invokeID = invoke_id;
             len =
-                ccov_notify_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
-                sizeof(Handler_Transmit_Buffer) - pdu_len, invoke_id, &cov_data);
+                ccov_notify_encode_apdu(&pdu[pdu_len],
+                MAX_PDU - pdu_len, invoke_id, &cov_data);
         } else {
             goto COV_FAILED;
         }
     } else {
         len =
-            ucov_notify_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
-            sizeof(Handler_Transmit_Buffer) - pdu_len, &cov_data);
+            ucov_notify_encode_apdu(&pdu[pdu_len],
+            MAX_PDU - pdu_len, &cov_data);
     }
     pdu_len += len;
     if (cov_subscription->flag.issueConfirmedNotifications) {
         tsm_set_confirmed_unsegmented_transaction(invoke_id, dest, &npci_data,
-            &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
+            &pdu[0], (uint16_t) pdu_len);
     }
     bytes_sent =
-        datalink_send_pdu(dest, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(dest, &npci_data, &pdu[0],
         pdu_len);
     if (bytes_sent > 0) {
         status = true;
@@ -540,47 +585,35 @@ static bool cov_send_request(
 
   COV_FAILED:
 
+    txbuf_release(pdu);
     return status;
 }
 
-static void cov_lifetime_expiration_handler(
-    unsigned index,
-    uint32_t elapsed_seconds,
-    uint32_t lifetime_seconds)
+/* COV_Lock is held, from handler_cov_timer_seconds() */
+static void cov_lifetime_expired(
+    BACNET_TIMER * timer)
 {
-    if (index < MAX_COV_SUBCRIPTIONS) {
-        /* handle lifetime expiration */
-        if (lifetime_seconds >= elapsed_seconds) {
-            COV_Subscriptions[index].lifetime -= elapsed_seconds;
-#if 0
-            fprintf(stderr, "COVtimer: subscription[%d].lifetime=%lu\n", index,
-                (unsigned long) COV_Subscriptions[index].lifetime);
-#endif
-        } else {
-            COV_Subscriptions[index].lifetime = 0;
-        }
-        if (COV_Subscriptions[index].lifetime == 0) {
-            /* expire the subscription */
+    BACNET_COV_SUBSCRIPTION *cov_subscription =
+        (BACNET_COV_SUBSCRIPTION *) timer->context;
+
+    /* expire the subscription */
 #if PRINT_ENABLED
-            fprintf(stderr, "COVtimer: PID=%u ",
-                COV_Subscriptions[index].subscriberProcessIdentifier);
-            fprintf(stderr, "%s %u ",
-                bactext_object_type_name(COV_Subscriptions[index].
-                    monitoredObjectIdentifier.type),
-                COV_Subscriptions[index].monitoredObjectIdentifier.instance);
-            fprintf(stderr, "time remaining=%u seconds ",
-                COV_Subscriptions[index].lifetime);
-            fprintf(stderr, "\n");
+    fprintf(stderr, "COVtimer: PID=%u ",
+        cov_subscription->subscriberProcessIdentifier);
+    fprintf(stderr, "%s %u ",
+        bactext_object_type_name(cov_subscription->
+            monitoredObjectIdentifier.type),
+        cov_subscription->monitoredObjectIdentifier.instance);
+    fprintf(stderr, "lifetime=%u seconds ", cov_subscription->lifetime);
+    fprintf(stderr, "\n");
 #endif
-            COV_Subscriptions[index].flag.valid = false;
-            COV_Subscriptions[index].dest_index = -1;
-            cov_address_remove_unused();
-            if (COV_Subscriptions[index].flag.issueConfirmedNotifications) {
-                if (COV_Subscriptions[index].invokeID) {
-                    tsm_free_invoke_id(COV_Subscriptions[index].invokeID);
-                    COV_Subscriptions[index].invokeID = 0;
-                }
-            }
+    cov_subscription->flag.valid = false;
+    cov_subscription->dest_index = -1;
+    cov_address_remove_unused();
+    if (cov_subscription->flag.issueConfirmedNotifications) {
+        if (cov_subscription->invokeID) {
+            tsm_free_invoke_id(cov_subscription->invokeID);
+            cov_subscription->invokeID = 0;
         }
     }
 }
@@ -609,24 +642,31 @@ static void cov_lifetime_expiration_handler(
 void handler_cov_timer_seconds(
     uint32_t elapsed_seconds)
 {
-    unsigned index = 0;
-    uint32_t lifetime_seconds = 0;
-
     if (elapsed_seconds) {
-        /* handle the subscription timeouts */
-        for (index = 0; index < MAX_COV_SUBCRIPTIONS; index++) {
-            if (COV_Subscriptions[index].flag.valid) {
-                lifetime_seconds = COV_Subscriptions[index].lifetime;
-                if (lifetime_seconds) {
-                    /* only expire COV with definite lifetimes */
-                    cov_lifetime_expiration_handler(index, elapsed_seconds,
-                        lifetime_seconds);
-                }
-            }
-        }
+        /* handle the subscription timeouts, only those with definite
+           lifetimes are on the wheel */
+        BACNET_LOCK(COV_Lock);
+        timer_wheel_advance(&COV_Wheel, elapsed_seconds);
+        BACNET_UNLOCK(COV_Lock);
     }
 }
 
+/* COV_Lock is held. The subscription is still the one copied before the
+   lock was let go: not cancelled, expired, or taken by another since */
+static bool cov_subscription_same(
+    BACNET_COV_SUBSCRIPTION * cov_subscription,
+    BACNET_COV_SUBSCRIPTION * copy)
+{
+    return cov_subscription->flag.valid &&
+        (cov_subscription->dest_index == copy->dest_index) &&
+        (cov_subscription->subscriberProcessIdentifier ==
+        copy->subscriberProcessIdentifier) &&
+        (cov_subscription->monitoredObjectIdentifier.type ==
+        copy->monitoredObjectIdentifier.type) &&
+        (cov_subscription->monitoredObjectIdentifier.instance ==
+        copy->monitoredObjectIdentifier.instance);
+}
+
 bool handler_cov_fsm(
     void)
 {
@@ -636,6 +676,7 @@ bool handler_cov_fsm(
     bool status = false;
     bool send = false;
     BACNET_PROPERTY_VALUE value_list[2];
+    BACNET_COV_SUBSCRIPTION subscription;
     /* states for transmitting */
     static enum {
         COV_STATE_IDLE = 0,
@@ -644,7 +685,9 @@ bool handler_cov_fsm(
         COV_STATE_FREE,
         COV_STATE_SEND
     } cov_task_state = COV_STATE_IDLE;
+    bool idle;
 
+    BACNET_LOCK(COV_Lock);
     switch (cov_task_state) {
         case COV_STATE_IDLE:
             index = 0;
@@ -658,8 +701,13 @@ bool handler_cov_fsm(
                 object_instance =
                     COV_Subscriptions[index].
                     monitoredObjectIdentifier.instance;
+                subscription = COV_Subscriptions[index];
+                BACNET_UNLOCK(COV_Lock);
                 status = Device_COV(object_type, object_instance);
-                if (status) {
+                BACNET_LOCK(COV_Lock);
+                if (status &&
+                    cov_subscription_same(&COV_Subscriptions[index],
+                        &subscription)) {
                     COV_Subscriptions[index].flag.send_requested = true;
 #if PRINT_ENABLED
                     fprintf(stderr, "COVtask: Marking...\n");
@@ -681,7 +729,9 @@ bool handler_cov_fsm(
                 object_instance =
                     COV_Subscriptions[index].
                     monitoredObjectIdentifier.instance;
+                BACNET_UNLOCK(COV_Lock);
                 Device_COV_Clear(object_type, object_instance);
+                BACNET_LOCK(COV_Lock);
             }
             index++;
             if (index >= MAX_COV_SUBCRIPTIONS) {
@@ -737,8 +787,16 @@ bool handler_cov_fsm(
                     /* configure the linked list for the two properties */
                     value_list[0].next = &value_list[1];
                     value_list[1].next = NULL;
+                    subscription = COV_Subscriptions[index];
+                    BACNET_UNLOCK(COV_Lock);
                     status = Device_Encode_Value_List(object_type,
                         object_instance, &value_list[0]);
+                    BACNET_LOCK(COV_Lock);
+                    if (!cov_subscription_same(&COV_Subscriptions[index],
+                            &subscription)) {
+                        /* gone while the values were read */
+                        status = false;
+                    }
                     if (status) {
                         status =
                             cov_send_request(&COV_Subscriptions[index],
@@ -760,7 +818,10 @@ bool handler_cov_fsm(
             cov_task_state = COV_STATE_IDLE;
             break;
     }
-    return (cov_task_state == COV_STATE_IDLE);
+    idle = (cov_task_state == COV_STATE_IDLE);
+    BACNET_UNLOCK(COV_Lock);
+
+    return idle;
 }
 
 void handler_cov_task(
@@ -787,8 +848,10 @@ static bool cov_subscribe(
     if (status) {
         status = Device_Value_List_Supported(object_type);
         if (status) {
+            BACNET_LOCK(COV_Lock);
             status =
                 cov_list_subscribe(src, cov_data, error_class, error_code);
+            BACNET_UNLOCK(COV_Lock);
         } else {
             *error_class = ERROR_CLASS_OBJECT;
             *error_code = ERROR_CODE_OPTIONAL_FUNCTIONALITY_NOT_SUPPORTED;
@@ -835,14 +898,20 @@ void handler_cov_subscribe(
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
     bool error = false;
+    uint8_t *pdu = NULL;
 
     /* initialize a common abort code */
     cov_data.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     npdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
@@ -871,7 +940,7 @@ void handler_cov_subscribe(
         &cov_data.error_code);
     if (success) {
         apdu_len =
-            encode_simple_ack(&Handler_Transmit_Buffer[npdu_len],
+            encode_simple_ack(&pdu[npdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_SUBSCRIBE_COV);
 #if PRINT_ENABLED
         fprintf(stderr, "SubscribeCOV: Sending Simple Ack!\n");
@@ -887,7 +956,7 @@ void handler_cov_subscribe(
     if (error) {
         if (len == BACNET_STATUS_ABORT) {
             apdu_len =
-                abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                abort_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 abort_convert_error_code(cov_data.error_code), true);
 #if PRINT_ENABLED
@@ -895,7 +964,7 @@ void handler_cov_subscribe(
 #endif
         } else if (len == BACNET_STATUS_ERROR) {
             apdu_len =
-                bacerror_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                bacerror_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id, SERVICE_CONFIRMED_SUBSCRIBE_COV,
                 cov_data.error_class, cov_data.error_code);
 #if PRINT_ENABLED
@@ -903,7 +972,7 @@ void handler_cov_subscribe(
 #endif
         } else if (len == BACNET_STATUS_REJECT) {
             apdu_len =
-                reject_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                reject_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 reject_convert_error_code(cov_data.error_code));
 #if PRINT_ENABLED
@@ -913,7 +982,7 @@ void handler_cov_subscribe(
     }
     pdu_len = npdu_len + apdu_len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
@@ -921,6 +990,7 @@ void handler_cov_subscribe(
             strerror(errno));
 #endif
     }
+    txbuf_release(pdu);
 
 
 }
@@ -52,7 +52,7 @@
 #include "abort.h"
 #include "reject.h"
 #include "dcc.h"
-// #include "handlers.h"
+#include "handlers.h"
 // #include "device.h"
 #include "bitsDebug.h"
 #include "datalink.h"
@@ -125,17 +125,23 @@ void handler_device_communication_control(
     int pdu_len = 0;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     /* encode the NPDU portion of the reply packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "DeviceCommunicationControl!\n");
     if (service_data->segmented_message) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
         dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR,
@@ -155,7 +161,7 @@ void handler_device_communication_control(
     /* bad decoding or something we didn't understand - send an abort */
     if (len < 0) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
         dbTraffic(DBD_ALL, DB_ERROR,
             "DeviceCommunicationControl: "
@@ -164,7 +170,7 @@ void handler_device_communication_control(
     }
     if (state >= MAX_BACNET_COMMUNICATION_ENABLE_DISABLE) {
         len =
-            reject_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            reject_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, REJECT_REASON_UNDEFINED_ENUMERATION);
         dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR,
             "DeviceCommunicationControl: "
@@ -175,14 +181,14 @@ void handler_device_communication_control(
         len =
             Routed_Device_Service_Approval
             (SERVICE_CONFIRMED_DEVICE_COMMUNICATION_CONTROL, (int) state,
-            &Handler_Transmit_Buffer[pdu_len], service_data->invoke_id);
+            &pdu[pdu_len], service_data->invoke_id);
         if (len > 0)
             goto DCC_ABORT;
 #endif
 
         if (characterstring_ansi_same(&password, My_Password)) {
             len =
-                encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+                encode_simple_ack(&pdu[pdu_len],
                 service_data->invoke_id,
                 SERVICE_CONFIRMED_DEVICE_COMMUNICATION_CONTROL);
             dbTraffic(DBD_ALL, DB_INFO,
@@ -190,7 +196,7 @@ void handler_device_communication_control(
             dcc_set_status_duration(state, timeDuration);
         } else {
             len =
-                bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                bacerror_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id,
                 SERVICE_CONFIRMED_DEVICE_COMMUNICATION_CONTROL,
                 ERROR_CLASS_SECURITY, ERROR_CODE_PASSWORD_FAILURE);
@@ -202,7 +208,7 @@ void handler_device_communication_control(
   DCC_ABORT:
     pdu_len += len;
     len =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
     if (len <= 0) {
 #if PRINT_ENABLED
@@ -211,5 +217,6 @@ void handler_device_communication_control(
             strerror(errno));
 #endif
     }
+    txbuf_release(pdu);
 
 }
@@ -82,19 +82,25 @@ void handler_get_alarm_summary(
     BACNET_ADDRESS my_address;
     BACNET_NPCI_DATA npci_data;
     BACNET_GET_ALARM_SUMMARY_DATA getalarm_data;
+    uint8_t *pdu = NULL;
 
 
 
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
         apdu_len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
                               service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
                               true);
 #if PRINT_ENABLED
@@ -106,7 +112,7 @@ void handler_get_alarm_summary(
 
     /* init header */
     apdu_len =
-        get_alarm_summary_ack_encode_apdu_init(&Handler_Transmit_Buffer
+        get_alarm_summary_ack_encode_apdu_init(&pdu
                 [pdu_len], service_data->invoke_id);
 
 
@@ -117,7 +123,7 @@ void handler_get_alarm_summary(
                 if (alarm_value > 0) {
                     len =
                         get_alarm_summary_ack_encode_apdu_data
-                        (&Handler_Transmit_Buffer[pdu_len + apdu_len],
+                        (&pdu[pdu_len + apdu_len],
                          service_data->max_resp - apdu_len, &getalarm_data);
                     if (len <= 0) {
                         error = true;
@@ -141,7 +147,7 @@ GET_ALARM_SUMMARY_ERROR:
         if (len == BACNET_STATUS_ABORT) {
             /* BACnet APDU too small to fit data, so proper response is Abort */
             apdu_len =
-                abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                abort_encode_apdu(&pdu[pdu_len],
                                   service_data->invoke_id,
                                   ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
 #if PRINT_ENABLED
@@ -150,7 +156,7 @@ GET_ALARM_SUMMARY_ERROR:
 #endif
         } else {
             apdu_len =
-                bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                bacerror_encode_apdu(&pdu[pdu_len],
                                      service_data->invoke_id, SERVICE_CONFIRMED_GET_ALARM_SUMMARY,
                                      ERROR_CLASS_PROPERTY, ERROR_CODE_OTHER);
 #if PRINT_ENABLED
@@ -163,7 +169,7 @@ GET_ALARM_SUMMARY_ERROR:
 GET_ALARM_SUMMARY_ABORT:
     pdu_len += apdu_len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0) {
@@ -172,5 +178,6 @@ GET_ALARM_SUMMARY_ABORT:
 #else
     bytes_sent = bytes_sent;
 #endif
+    txbuf_release(pdu);
 
 }
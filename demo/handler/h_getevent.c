@@ -53,6 +53,7 @@
 #include "event.h"
 #include "getevent.h"
 #include "handlers.h"
+#include "tsm.h"
 #include "debug.h"
 #include "bitsDebug.h"
 
@@ -117,6 +118,36 @@ void handler_get_event_information(
     unsigned i = 0, j = 0;      /* counter */
     BACNET_GET_EVENT_INFORMATION_DATA getevent_data;
     int valid_event = 0;
+    int npdu_len = 0;
+    uint8_t *pdu = NULL;
+    int pdu_size = MAX_PDU;
+    int max_apdu = MAX_APDU;
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    BACNET_ABORT_REASON abort_reason;
+#endif
+
+    if (service_data->max_resp < max_apdu) {
+        max_apdu = service_data->max_resp;
+    }
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    if (service_data->segmented_response_accepted) {
+        /* fill the whole reply, the TSM segments it if it has to */
+        pdu = txbuf_acquire_segmented();
+        if (pdu != NULL) {
+            pdu_size = MAX_NPDU + MAX_SEGMENTED_APDU;
+            max_apdu =
+                tsm_segmented_complex_ack_max(service_data->max_segs,
+                service_data->max_resp);
+        }
+    }
+#endif
+    if (pdu == NULL) {
+        pdu = txbuf_acquire();
+        if (pdu == NULL) {
+            handler_out_of_resources(src, service_data);
+            return;
+        }
+    }
 
     /* initialize type of 'Last Received Object Identifier' using max value */
     object_id.type = MAX_BACNET_OBJECT_TYPE;
@@ -125,12 +156,13 @@ void handler_get_event_information(
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
                         &npci_data);
+    npdu_len = pdu_len;
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
                               service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
                               true);
         dbTraffic(DBD_ALL, DB_BTC_ERROR,
@@ -144,15 +176,15 @@ void handler_get_event_information(
     if (len < 0) {
         /* bad decoding - send an abort */
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
                               service_data->invoke_id, ABORT_REASON_OTHER, true);
         dbTraffic(DBD_ALL, DB_BTC_ERROR,
             "GetEventInformation: Bad Encoding.  Sending Abort!\n");
         goto GET_EVENT_ABORT;
     }
     len =
-        getevent_ack_encode_apdu_init(&Handler_Transmit_Buffer[pdu_len],
-        sizeof(Handler_Transmit_Buffer) - pdu_len, service_data->invoke_id);
+        getevent_ack_encode_apdu_init(&pdu[pdu_len],
+        pdu_size - pdu_len, service_data->invoke_id);
     if (len <= 0) {
         error = true;
         goto GET_EVENT_ERROR;
@@ -179,16 +211,14 @@ void handler_get_event_information(
 
                     getevent_data.next = NULL;
                     len =
-                        getevent_ack_encode_apdu_data(&Handler_Transmit_Buffer
-                        [pdu_len], sizeof(Handler_Transmit_Buffer) - pdu_len,
+                        getevent_ack_encode_apdu_data(&pdu[pdu_len], pdu_size - pdu_len,
                         &getevent_data);
                     if (len <= 0) {
                         error = true;
                         goto GET_EVENT_ERROR;
                     }
                     apdu_len += len;
-                    if ((apdu_len >= service_data->max_resp - 2)  ||
-                        (apdu_len >= MAX_APDU - 2)) {
+                    if (apdu_len >= max_apdu - 2) {
                         /* Device must be able to fit minimum
                            one event information.
                            Length of one event informations needs
@@ -209,26 +239,46 @@ void handler_get_event_information(
                     break;
                 }
             }
+            if (more_events) {
+                break;
+            }
         }
     }
     len =
-        getevent_ack_encode_apdu_end(&Handler_Transmit_Buffer[pdu_len],
-        sizeof(Handler_Transmit_Buffer) - pdu_len, more_events);
+        getevent_ack_encode_apdu_end(&pdu[pdu_len],
+        pdu_size - pdu_len, more_events);
     if (len <= 0) {
         error = true;
         goto GET_EVENT_ERROR;
     }
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    apdu_len = pdu_len + len - npdu_len;
+    if ((apdu_len > service_data->max_resp) || (apdu_len > MAX_APDU)) {
+        if (tsm_set_segmented_complex_ack(src, &npci_data,
+                service_data->max_segs, service_data->max_resp,
+                &pdu[npdu_len], apdu_len, &abort_reason)) {
+            /* the TSM sends it from here */
+            txbuf_release(pdu);
+            return;
+        }
+        pdu_len = npdu_len;
+        len =
+            abort_encode_apdu(&pdu[pdu_len], service_data->invoke_id,
+            abort_reason, true);
+        goto GET_EVENT_ABORT;
+    }
+#endif
     dbTraffic(DBD_ALL, DB_BTC_ERROR, "Got a GetEventInformation request: Sending Ack!\n");
 GET_EVENT_ERROR:
     if (error) {
         pdu_len =
-            npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+            npdu_encode_pdu(&pdu[0], src, &my_address,
                             &npci_data);
 
         if (len == -2) {
             /* BACnet APDU too small to fit data, so proper response is Abort */
             len =
-                abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                abort_encode_apdu(&pdu[pdu_len],
                                   service_data->invoke_id,
                                   ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
             dbTraffic(DBD_ALL, DB_BTC_ERROR,
@@ -236,7 +286,7 @@ GET_EVENT_ERROR:
         }
         else {
             len =
-                bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                bacerror_encode_apdu(&pdu[pdu_len],
                                      service_data->invoke_id, SERVICE_CONFIRMED_READ_PROPERTY,
                                      error_class, error_code);
             dbTraffic(DBD_ALL, DB_BTC_ERROR, "GetEventInformation: Sending Error!\n");
@@ -245,12 +295,12 @@ GET_EVENT_ERROR:
 GET_EVENT_ABORT:
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
 #endif
-
+    txbuf_release(pdu);
 }
 #endif // INTRINSIC_REPORTING_B
\ No newline at end of file
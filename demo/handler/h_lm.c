@@ -86,6 +86,7 @@ void handler_add_list_element(
     BACNET_ROUTE * src,
     BACNET_CONFIRMED_SERVICE_DATA * service_data)
 {
+    uint8_t *pdu = NULL;
     BACNET_LIST_MANIPULATION_DATA lmdata ;
     int len = 0;
     int pdu_len = 0;
@@ -101,8 +102,12 @@ void handler_add_list_element(
     /* encode the NPDU portion of the packet */
     //datalink_get_my_address(&my_address);
     npdu_setup_npdu_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     npdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], &src->bacnetPath->adr, NULL,
+        npdu_encode_pdu(&pdu[0], &src->bacnetPath->adr, NULL,
                         &npci_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
@@ -133,7 +138,7 @@ void handler_add_list_element(
         if (decode_is_closing_tag_number(lmdata.application_data +
                                          lmdata.application_data_len, 3)) {
             apdu_len =
-                encode_simple_ack(&Handler_Transmit_Buffer[npdu_len],
+                encode_simple_ack(&pdu[npdu_len],
                                   service_data->invoke_id, SERVICE_CONFIRMED_ADD_LIST_ELEMENT);
 #if PRINT_ENABLED
             fprintf(stderr, "ALE: Sending Ack!\n");
@@ -159,7 +164,7 @@ LM_FAILURE:
     if (error) {
         if (len == BACNET_STATUS_ABORT) {
             apdu_len =
-                abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                abort_encode_apdu(&pdu[npdu_len],
                                   service_data->invoke_id,
                                   abort_convert_error_code(lmdata.error_code), true);
 #if PRINT_ENABLED
@@ -167,18 +172,18 @@ LM_FAILURE:
 #endif
         } else if (len == BACNET_STATUS_ERROR) {
             apdu_len =
-                bacerror_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                bacerror_encode_apdu(&pdu[npdu_len],
                                      service_data->invoke_id, SERVICE_CONFIRMED_ADD_LIST_ELEMENT,
                                      lmdata.error_class, lmdata.error_code);
             apdu_len +=
-                encode_application_unsigned(&Handler_Transmit_Buffer[npdu_len +
+                encode_application_unsigned(&pdu[npdu_len +
                                             apdu_len], lmdata.first_failed_element + 1);
 #if PRINT_ENABLED
             fprintf(stderr, "ALE: Sending Error!\n");
 #endif
         } else if (len == BACNET_STATUS_REJECT) {
             apdu_len =
-                reject_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                reject_encode_apdu(&pdu[npdu_len],
                                    service_data->invoke_id,
                                    reject_convert_error_code(lmdata.error_code));
 #if PRINT_ENABLED
@@ -188,9 +193,10 @@ LM_FAILURE:
     }
     pdu_len = npdu_len + apdu_len;
         
-    src->portParams->SendPdu(src->portParams, pDev, &src->bacnetPath->localMac, &npci_data, &Handler_Transmit_Buffer[0],
+    src->portParams->SendPdu(src->portParams, pDev, &src->bacnetPath->localMac, &npci_data, &pdu[0],
                           pdu_len);
 
+    txbuf_release(pdu);
     return;
 }
 
@@ -228,6 +234,7 @@ void handler_remove_list_element(
     BACNET_NPCI_DATA npci_data;
     bool error = true;  /* assume that there is an error */
     int bytes_sent = 0;
+    uint8_t *pdu = NULL;
     //BACNET_GLOBAL_ADDRESS my_address;
 
     /* configure default error code as an abort since it is common */
@@ -235,8 +242,12 @@ void handler_remove_list_element(
     /* encode the NPDU portion of the packet */
     //datalink_get_my_address(&my_address);
     npdu_setup_npdu_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     npdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], &src->bacnetPath->adr, NULL,
+        npdu_encode_pdu(&pdu[0], &src->bacnetPath->adr, NULL,
                         &npci_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
@@ -266,7 +277,7 @@ void handler_remove_list_element(
         if (decode_is_closing_tag_number(lmdata.application_data +
                                          lmdata.application_data_len, 3)) {
             apdu_len =
-                encode_simple_ack(&Handler_Transmit_Buffer[npdu_len],
+                encode_simple_ack(&pdu[npdu_len],
                                   service_data->invoke_id,
                                   SERVICE_CONFIRMED_REMOVE_LIST_ELEMENT);
 #if PRINT_ENABLED
@@ -293,7 +304,7 @@ LM_FAILURE:
     if (error) {
         if (len == BACNET_STATUS_ABORT) {
             apdu_len =
-                abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                abort_encode_apdu(&pdu[npdu_len],
                                   service_data->invoke_id,
                                   abort_convert_error_code(lmdata.error_code), true);
 #if PRINT_ENABLED
@@ -301,18 +312,18 @@ LM_FAILURE:
 #endif
         } else if (len == BACNET_STATUS_ERROR) {
             apdu_len =
-                bacerror_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                bacerror_encode_apdu(&pdu[npdu_len],
                                      service_data->invoke_id, SERVICE_CONFIRMED_REMOVE_LIST_ELEMENT,
                                      lmdata.error_class, lmdata.error_code);
             apdu_len +=
-                encode_application_unsigned(&Handler_Transmit_Buffer[npdu_len +
+                encode_application_unsigned(&pdu[npdu_len +
                                             apdu_len], lmdata.first_failed_element + 1);
 #if PRINT_ENABLED
             fprintf(stderr, "RLE: Sending Error!\n");
 #endif
         } else if (len == BACNET_STATUS_REJECT) {
             apdu_len =
-                reject_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                reject_encode_apdu(&pdu[npdu_len],
                                    service_data->invoke_id,
                                    reject_convert_error_code(lmdata.error_code));
 #if PRINT_ENABLED
@@ -321,8 +332,9 @@ LM_FAILURE:
         }
     }
     pdu_len = npdu_len + apdu_len;
-    src->portParams->SendPdu(src->portParams, pDev, &src->bacnetPath->localMac, &npci_data, &Handler_Transmit_Buffer[0],
+    src->portParams->SendPdu(src->portParams, pDev, &src->bacnetPath->localMac, &npci_data, &pdu[0],
                           pdu_len);
+    txbuf_release(pdu);
 }
 
 #endif
\ No newline at end of file
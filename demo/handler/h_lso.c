@@ -67,17 +67,23 @@ void handler_lso(
     BACNET_NPCI_DATA npci_data;
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -94,7 +100,7 @@ void handler_lso(
     if (len < 0) {
         /* bad decoding - send an abort */
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr, "LSO: Bad Encoding.  Sending Abort!\n");
@@ -113,7 +119,7 @@ void handler_lso(
 #endif
 
     len =
-        encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+        encode_simple_ack(&pdu[pdu_len],
         service_data->invoke_id, SERVICE_CONFIRMED_LIFE_SAFETY_OPERATION);
 #if PRINT_ENABLED
     fprintf(stderr, "Life Safety Operation: " "Sending Simple Ack!\n");
@@ -122,12 +128,13 @@ void handler_lso(
   LSO_ABORT:
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr, "Life Safety Operation: " "Failed to send PDU (%s)!\n",
             strerror(errno));
 #endif
+    txbuf_release(pdu);
 
 }
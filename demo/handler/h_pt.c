@@ -231,6 +231,7 @@ void handler_conf_private_trans(
     BACNET_ADDRESS my_address;
     BACNET_ERROR_CLASS error_class;
     BACNET_ERROR_CODE error_code;
+    uint8_t *pdu = NULL;
 
     len = 0;
     pdu_len = 0;
@@ -247,13 +248,18 @@ void handler_conf_private_trans(
 
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
             &npci_data);
 
     if (service_data->segmented_message) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
                 true);
 #if PRINT_ENABLED
@@ -267,7 +273,7 @@ void handler_conf_private_trans(
     /* bad decoding - send an abort */
     if (len < 0) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr, "CPT: Bad Encoding. Sending Abort!\n");
@@ -296,7 +302,7 @@ void handler_conf_private_trans(
 #endif
         }
         len =
-            ptransfer_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            ptransfer_ack_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, &data);
     } else {    /* Not our vendor ID or bad service parameter */
 
@@ -310,14 +316,15 @@ void handler_conf_private_trans(
 
     if (error) {
         len =
-            ptransfer_error_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            ptransfer_error_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, error_class, error_code, &data);
     }
 CPT_ABORT:
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
+    txbuf_release(pdu);
 
 
 }
@@ -89,19 +89,25 @@ void handler_reinitialize_device(
     int pdu_len = 0;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
             &npci_data);
 #if PRINT_ENABLED
     fprintf(stderr, "ReinitializeDevice!\n");
 #endif
     if (service_data->segmented_message) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
                 true);
 #if PRINT_ENABLED
@@ -126,7 +132,7 @@ void handler_reinitialize_device(
     /* bad decoding or something we didn't understand - send an abort */
     if (len < 0) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr,
@@ -137,7 +143,7 @@ void handler_reinitialize_device(
     /* check the data from the request */
     if (rd_data.state >= MAX_BACNET_REINITIALIZED_STATE) {
         len =
-            reject_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            reject_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, REJECT_REASON_UNDEFINED_ENUMERATION);
 #if PRINT_ENABLED
         fprintf(stderr,
@@ -149,14 +155,14 @@ void handler_reinitialize_device(
         len =
             Routed_Device_Service_Approval
             (SERVICE_CONFIRMED_REINITIALIZE_DEVICE, (int) rd_data.state,
-            &Handler_Transmit_Buffer[pdu_len], service_data->invoke_id);
+            &pdu[pdu_len], service_data->invoke_id);
         if (len > 0)
             goto RD_ABORT;
 #endif
 
         if (Device_Reinitialize(&rd_data)) {
             len =
-                encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+                encode_simple_ack(&pdu[pdu_len],
                     service_data->invoke_id,
                     SERVICE_CONFIRMED_REINITIALIZE_DEVICE);
 #if PRINT_ENABLED
@@ -164,7 +170,7 @@ void handler_reinitialize_device(
 #endif
         } else {
             len =
-                bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                bacerror_encode_apdu(&pdu[pdu_len],
                     service_data->invoke_id, SERVICE_CONFIRMED_REINITIALIZE_DEVICE,
                     rd_data.error_class, rd_data.error_code);
 #if PRINT_ENABLED
@@ -176,7 +182,7 @@ void handler_reinitialize_device(
 RD_ABORT:
     pdu_len += len;
     len =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
     if (len <= 0) {
 #if PRINT_ENABLED
@@ -184,5 +190,6 @@ RD_ABORT:
             strerror(errno));
 #endif
     }
+    txbuf_release(pdu);
 
 }
@@ -95,14 +95,20 @@ void handler_read_property(
     bool error = true;  /* assume that there is an error */
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     /* configure default error code as an abort since it is common */
     rpdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     npdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
@@ -127,18 +133,18 @@ void handler_read_property(
     }
 
     apdu_len =
-        rp_ack_encode_apdu_init(&Handler_Transmit_Buffer[npdu_len],
+        rp_ack_encode_apdu_init(&pdu[npdu_len],
         service_data->invoke_id, &rpdata);
     /* configure our storage */
-    rpdata.application_data = &Handler_Transmit_Buffer[npdu_len + apdu_len];
+    rpdata.application_data = &pdu[npdu_len + apdu_len];
     rpdata.application_data_len =
-        sizeof(Handler_Transmit_Buffer) - (npdu_len + apdu_len);
+        MAX_PDU - (npdu_len + apdu_len);
     len = Device_Read_Property(&rpdata);
     if (len >= 0) {
         apdu_len += len;
         len =
-            rp_ack_encode_apdu_object_property_end(&Handler_Transmit_Buffer
-            [npdu_len + apdu_len]);
+            rp_ack_encode_apdu_object_property_end(&pdu[npdu_len +
+                apdu_len]);
         apdu_len += len;
         if (apdu_len > service_data->max_resp) {
             /* too big for the sender - send an abort
@@ -170,19 +176,19 @@ void handler_read_property(
     if (error) {
         if (len == BACNET_STATUS_ABORT) {
             apdu_len =
-                abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                abort_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 abort_convert_error_code(rpdata.error_code), true);
             dbTraffic(DBD_ALL, DB_UNUSUAL_TRAFFIC, "RP: Sending Abort!");
         } else if (len == BACNET_STATUS_ERROR) {
             apdu_len =
-                bacerror_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                bacerror_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id, SERVICE_CONFIRMED_READ_PROPERTY,
                 rpdata.error_class, rpdata.error_code);
             dbTraffic(DBD_ALL, DB_EXPECTED_ERROR_TRAFFIC, "RP: Sending Error!");
         } else if (len == BACNET_STATUS_REJECT) {
             apdu_len =
-                reject_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                reject_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 reject_convert_error_code(rpdata.error_code));
             dbTraffic(DBD_ALL, DB_UNUSUAL_TRAFFIC, "RP: Sending Reject!");
@@ -191,12 +197,13 @@ void handler_read_property(
 
     pdu_len = npdu_len + apdu_len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
         fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
 #endif
     }
+    txbuf_release(pdu);
 
 }
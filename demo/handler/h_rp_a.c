@@ -39,6 +39,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include "config.h"
 #include "txbuf.h"
@@ -52,6 +53,7 @@
 #include "datalink.h"
 #include "bactext.h"
 #include "rp.h"
+#include "decode_arena.h"
 /* some demo stuff needed */
 #include "handlers.h"
 #include "txbuf.h"
@@ -168,6 +170,30 @@ int rp_ack_fully_decode_service_request(
     uint8_t * apdu,
     int apdu_len,
     BACNET_READ_ACCESS_DATA * read_access_data)
+{
+    return rp_ack_fully_decode_service_request_arena(apdu, apdu_len, NULL,
+        read_access_data);
+}
+
+/** Decode the received RP data into a linked list of the results, as
+ *  rp_ack_fully_decode_service_request() does, with the property and its
+ *  value(s) allocated from the arena, or from the heap if it is NULL.
+ *  With an arena, the list is given back with one decode_arena_release().
+ * @ingroup DSRP
+ *
+ * @param apdu [in] The received apdu data.
+ * @param apdu_len [in] Total length of the apdu.
+ * @param arena [in] The arena for this ACK, or NULL.
+ * @param read_access_data [out] Pointer to the head of the linked list
+ * 			where the RP data is to be stored.
+ * @return Number of decoded bytes (could be less than apdu_len),
+ * 			or -1 on decoding error.
+ */
+int rp_ack_fully_decode_service_request_arena(
+    uint8_t * apdu,
+    int apdu_len,
+    DECODE_ARENA * arena,
+    BACNET_READ_ACCESS_DATA * read_access_data)
 {
     int decoded_len = 0;        /* return value */
     BACNET_READ_PROPERTY_DATA rp1data;
@@ -183,10 +209,12 @@ int rp_ack_fully_decode_service_request(
          */
         read_access_data->object_type = rp1data.object_type;
         read_access_data->object_instance = rp1data.object_instance;
-        rp1_property = (BACNET_PROPERTY_REFERENCE *) calloc(1, sizeof(BACNET_PROPERTY_REFERENCE));
+        rp1_property =
+            (BACNET_PROPERTY_REFERENCE *) decode_arena_calloc(arena,
+            sizeof(BACNET_PROPERTY_REFERENCE));
         read_access_data->listOfProperties = rp1_property;
         if (rp1_property == NULL) {
-            /* can't proceed if calloc failed. */
+            /* can't proceed if the allocation failed. */
             return BACNET_STATUS_ERROR;
         }
         rp1_property->propertyIdentifier = rp1data.object_property;
@@ -199,7 +227,9 @@ int rp_ack_fully_decode_service_request(
          more than one element to decode */
         vdata = rp1data.application_data;
         vlen = rp1data.application_data_len;
-        value = (BACNET_APPLICATION_DATA_VALUE *) calloc(1, sizeof(BACNET_APPLICATION_DATA_VALUE));
+        value =
+            (BACNET_APPLICATION_DATA_VALUE *) decode_arena_calloc(arena,
+            sizeof(BACNET_APPLICATION_DATA_VALUE));
         rp1_property->value = value;
         old_value = value;
         while (value && vdata && (vlen > 0)) {
@@ -212,13 +242,14 @@ int rp_ack_fully_decode_service_request(
             }
             if (len < 0) {
                 /* unable to decode the data */
+                value = rp1_property->value;
                 while (value) {
                     /* free the linked list of values */
                     old_value = value;
                     value = value->next;
-                    free(old_value);
+                    decode_arena_free(arena, old_value);
                 }
-                free(rp1_property);
+                decode_arena_free(arena, rp1_property);
                 read_access_data->listOfProperties = NULL;
                 return len;
             }
@@ -234,20 +265,24 @@ int rp_ack_fully_decode_service_request(
             } else {
                 if (len == 0) {
                     /* nothing decoded and no closing tag, so malformed */
+                    value = rp1_property->value;
                     while (value) {
                         /* free the linked list of values */
                         old_value = value;
                         value = value->next;
-                        free(old_value);
+                        decode_arena_free(arena, old_value);
                     }
-                    free(rp1_property);
+                    decode_arena_free(arena, rp1_property);
                     read_access_data->listOfProperties = NULL;
                     return BACNET_STATUS_ERROR;
                 }
                 if (vlen > 0) {
                     /* If more values */
                     old_value = value;
-                    value = (BACNET_APPLICATION_DATA_VALUE *) calloc(1, sizeof(BACNET_APPLICATION_DATA_VALUE));
+                    value =
+                        (BACNET_APPLICATION_DATA_VALUE *)
+                        decode_arena_calloc(arena,
+                        sizeof(BACNET_APPLICATION_DATA_VALUE));
                     old_value->next = value;
                 }
             }
@@ -256,3 +291,102 @@ int rp_ack_fully_decode_service_request(
 
     return decoded_len;
 }
+
+#ifdef TEST
+#include <string.h>
+#include "ctest.h"
+
+/* a ReadProperty-ACK for a Priority_Array sized list of REALs, followed
+   by the bytes in tail; returns the length of the service request, which
+   follows the 3 byte APDU header */
+static int testRPAckEncode(
+    uint8_t * apdu,
+    uint8_t * tail,
+    int tail_len)
+{
+    BACNET_READ_PROPERTY_DATA rpdata;
+    uint8_t application_data[MAX_APDU];
+    int len = 0;
+    unsigned i;
+
+    for (i = 0; i < BACNET_MAX_PRIORITY; i++) {
+        len += encode_application_real(&application_data[len], (float) i);
+    }
+    memcpy(&application_data[len], tail, tail_len);
+    rpdata.object_type = OBJECT_ANALOG_OUTPUT;
+    rpdata.object_instance = 1;
+    rpdata.object_property = PROP_PRIORITY_ARRAY;
+    rpdata.array_index = BACNET_ARRAY_ALL;
+    rpdata.application_data = application_data;
+    rpdata.application_data_len = len + tail_len;
+
+    return rp_ack_encode_apdu(&apdu[0], 1, &rpdata) - 3;
+}
+
+void testReadPropertyAckArena(
+    Test * pTest)
+{
+    uint8_t apdu[MAX_APDU];
+    /* a context opening tag where a value should be */
+    uint8_t malformed[] = { 0x0E };
+    DECODE_ARENA arena;
+    BACNET_READ_ACCESS_DATA rp_data;
+    BACNET_READ_ACCESS_DATA test_data;
+    BACNET_APPLICATION_DATA_VALUE *value, *test_value;
+    int apdu_len, len, test_len;
+    unsigned count = 0;
+
+    apdu_len = testRPAckEncode(&apdu[0], NULL, 0);
+    memset(&rp_data, 0, sizeof(rp_data));
+    len = rp_ack_fully_decode_service_request(&apdu[3], apdu_len, &rp_data);
+    ct_test(pTest, len > 0);
+    memset(&test_data, 0, sizeof(test_data));
+    decode_arena_init(&arena, DECODE_ARENA_BLOCK_SIZE);
+    test_len =
+        rp_ack_fully_decode_service_request_arena(&apdu[3], apdu_len,
+        &arena, &test_data);
+    ct_test(pTest, test_len == len);
+    ct_test(pTest, arena.block_count == 1);
+    ct_test(pTest, test_data.object_type == OBJECT_ANALOG_OUTPUT);
+    ct_test(pTest, test_data.object_instance == 1);
+    ct_test(pTest, test_data.listOfProperties != NULL);
+    ct_test(pTest, test_data.listOfProperties->next == NULL);
+    ct_test(pTest, test_data.listOfProperties->propertyIdentifier ==
+        PROP_PRIORITY_ARRAY);
+    value = rp_data.listOfProperties->value;
+    test_value = test_data.listOfProperties->value;
+    while (value && test_value) {
+        ct_test(pTest, bacapp_same_value(value, test_value));
+        ct_test(pTest, test_value->type.Real == (float) count);
+        count++;
+        value = value->next;
+        test_value = test_value->next;
+    }
+    ct_test(pTest, value == NULL);
+    ct_test(pTest, test_value == NULL);
+    ct_test(pTest, count == BACNET_MAX_PRIORITY);
+    decode_arena_release(&arena);
+    value = rp_data.listOfProperties->value;
+    while (value) {
+        test_value = value;
+        value = value->next;
+        free(test_value);
+    }
+    free(rp_data.listOfProperties);
+
+    /* a value that does not decode: nothing is kept, from the heap or
+       from the arena */
+    apdu_len = testRPAckEncode(&apdu[0], malformed, sizeof(malformed));
+    memset(&rp_data, 0, sizeof(rp_data));
+    len = rp_ack_fully_decode_service_request(&apdu[3], apdu_len, &rp_data);
+    ct_test(pTest, len < 0);
+    ct_test(pTest, rp_data.listOfProperties == NULL);
+    memset(&test_data, 0, sizeof(test_data));
+    test_len =
+        rp_ack_fully_decode_service_request_arena(&apdu[3], apdu_len,
+        &arena, &test_data);
+    ct_test(pTest, test_len < 0);
+    ct_test(pTest, test_data.listOfProperties == NULL);
+    decode_arena_release(&arena);
+}
+#endif /* TEST */
@@ -44,7 +44,6 @@
 //#include <string.h>
 //#include <errno.h>
 //#include "config.h"
-#include "memcopy.h"
 //#include "bacdef.h"
 //#include "bacdcode.h"
 #include "apdu.h"
@@ -53,99 +52,39 @@
 #include "reject.h"
 #include "bacerror.h"
 #include "rpm.h"
+#include "encode_cursor.h"
 #include "handlers.h"
 /* device object has custom handler for all objects */
 #include "device.h"
 // #include "proplist.h"
 #include "datalink.h"
 #include "txbuf.h"
+#include "tsm.h"
 #include "bitsDebug.h"
 
 /** @file h_rpm.c  Handles Read Property Multiple requests. */
 
-static uint8_t Temp_Buf[MAX_APDU] = { 0 };
-
-static BACNET_PROPERTY_ID RPM_Object_Property(
-    struct special_property_list_t *pPropertyList,
-    BACNET_PROPERTY_ID special_property,
-    unsigned index)
-{
-    int property = -1;  /* return value */
-    unsigned required, optional, proprietary;
-
-    required = pPropertyList->Required.count;
-    optional = pPropertyList->Optional.count;
-    proprietary = pPropertyList->Proprietary.count;
-    if (special_property == PROP_ALL) {
-        if (index < required) {
-            property = pPropertyList->Required.pList[index];
-        }
-        else if (index < (required + optional)) {
-            index -= required;
-            property = pPropertyList->Optional.pList[index];
-        }
-        else if (index < (required + optional + proprietary)) {
-            index -= (required + optional);
-            property = pPropertyList->Proprietary.pList[index];
-        }
-    }
-    else if (special_property == PROP_REQUIRED) {
-        if (index < required) {
-            property = pPropertyList->Required.pList[index];
-        }
-    }
-    else if (special_property == PROP_OPTIONAL) {
-        if (index < optional) {
-            property = pPropertyList->Optional.pList[index];
-        }
-    }
-
-    return (BACNET_PROPERTY_ID) property;
-}
-
-static unsigned RPM_Object_Property_Count(
-    struct special_property_list_t *pPropertyList,
-    BACNET_PROPERTY_ID special_property)
-{
-    unsigned count = 0; /* return value */
-
-    if (special_property == PROP_ALL) {
-        count =
-            pPropertyList->Required.count + pPropertyList->Optional.count +
-            pPropertyList->Proprietary.count;
-    }
-    else if (special_property == PROP_REQUIRED) {
-        count = pPropertyList->Required.count;
-    }
-    else if (special_property == PROP_OPTIONAL) {
-        count = pPropertyList->Optional.count;
-    }
-
-    return count;
-}
-
-/** Encode the RPM property returning the length of the encoding,
-   or 0 if there is no room to fit the encoding.  */
+/** Encode the RPM property at the cursor, returning the length of the
+   encoding, or BACNET_STATUS_ABORT/REJECT with the cursor unchanged.
+   The value is read straight into the reply when there is room past the
+   cursor for any value, and through temp_buf when there is not. */
 static int RPM_Encode_Property(
-    uint8_t * apdu,
-    uint16_t offset,
-    uint16_t max_apdu,
-    BACNET_RPM_DATA * rpmdata)
+    BACNET_ENCODE_CURSOR * cursor,
+    BACNET_RPM_DATA * rpmdata,
+    uint8_t * temp_buf)
 {
     int len;
-    size_t copy_len ;
-    int apdu_len ;
+    unsigned mark;
+    unsigned value_mark;
     BACNET_READ_PROPERTY_DATA rpdata;
 
-    len =
-        rpm_ack_encode_apdu_object_property(&Temp_Buf[0],
-            rpmdata->object_property, rpmdata->array_index);
-    copy_len = memcopy(&apdu[0], &Temp_Buf[0], offset, len, max_apdu);
-    if (copy_len == 0) {
+    mark = encode_cursor_mark(cursor);
+    if (!rpm_ack_cursor_object_property(cursor, rpmdata->object_property,
+            rpmdata->array_index)) {
         rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
         return BACNET_STATUS_ABORT;
     }
-    apdu_len = len;
+    value_mark = encode_cursor_mark(cursor);
 
     rpdata.error_class = ERROR_CLASS_OBJECT;
     rpdata.error_code = ERROR_CODE_UNKNOWN_OBJECT;
@@ -153,107 +92,64 @@ static int RPM_Encode_Property(
     rpdata.object_instance = rpmdata->object_instance;
     rpdata.object_property = rpmdata->object_property;
     rpdata.array_index = rpmdata->array_index;
-    rpdata.application_data = &Temp_Buf[0];
-    rpdata.application_data_len = sizeof(Temp_Buf);
+    rpdata.application_data = rpm_ack_cursor_value_begin(cursor, temp_buf);
+    rpdata.application_data_len = MAX_APDU;
+    if (rpdata.application_data == NULL) {
+        encode_cursor_rollback(cursor, mark);
+        rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+        return BACNET_STATUS_ABORT;
+    }
 
     len = Device_Read_Property(&rpdata);
     if (len < 0) {
+        encode_cursor_rollback(cursor, value_mark);
         if ((len == BACNET_STATUS_ABORT) || (len == BACNET_STATUS_REJECT)) {
+            encode_cursor_rollback(cursor, mark);
             rpmdata->error_code = rpdata.error_code;
             /* pass along aborts and rejects for now */
             return len; /* Ie, Abort */
         }
         /* error was returned - encode that for the response */
-        len =
-            rpm_ack_encode_apdu_object_property_error(&Temp_Buf[0],
-                rpdata.error_class, rpdata.error_code);
-        copy_len =
-            memcopy(&apdu[0], &Temp_Buf[0], offset + apdu_len, len, max_apdu);
-
-        if (copy_len == 0) {
+        if (!rpm_ack_cursor_object_property_error(cursor, rpdata.error_class,
+                rpdata.error_code)) {
+            encode_cursor_rollback(cursor, mark);
             rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
             return BACNET_STATUS_ABORT;
         }
     }
-    else if ((offset + apdu_len + 1 + len + 1) < max_apdu) {
-        /* enough room to fit the property value and tags */
-        len =
-            rpm_ack_encode_apdu_object_property_value(&apdu[offset + apdu_len],
-                &Temp_Buf[0], len);
-    }
-    else {
+    else if (!rpm_ack_cursor_value_end(cursor, rpdata.application_data, len)) {
         /* not enough room - abort! */
+        encode_cursor_rollback(cursor, mark);
         rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
         return BACNET_STATUS_ABORT;
     }
-    apdu_len += len;
 
-    return apdu_len;
+    return (int) (encode_cursor_mark(cursor) - mark);
 }
 
-/** Handler for a ReadPropertyMultiple Service request.
- * @ingroup DSRPM
- * This handler will be invoked by apdu_handler() if it has been enabled
- * by a call to apdu_set_confirmed_handler().
- * This handler builds a response packet, which is
- * - an Abort if
- *   - the message is segmented
- *   - if decoding fails
- *   - if the response would be too large
- * - the result from each included read request, if it succeeds
- * - an Error if processing fails for all, or individual errors if only some fail,
- *   or there isn't enough room in the APDU to fit the data.
- *
- * @param service_request [in] The contents of the service request.
- * @param service_len [in] The length of the service_request.
- * @param src [in] BACNET_ADDRESS of the source of the message
- * @param service_data [in] The BACNET_CONFIRMED_SERVICE_DATA information
- *                          decoded from the APDU header of this message.
- */
-void handler_read_property_multiple(
+/** Encode the RPM reply to the request at the cursor, returning 0, or
+   BACNET_STATUS_ABORT/REJECT/ERROR with rpmdata holding the error.
+   An abort with ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED means the
+   reply did not fit the cursor. */
+static int RPM_Encode_Reply(
+    BACNET_ENCODE_CURSOR * cursor,
     uint8_t * service_request,
     uint16_t service_len,
-    BACNET_ADDRESS * src,
-    BACNET_CONFIRMED_SERVICE_DATA * service_data)
+    uint8_t invoke_id,
+    BACNET_RPM_DATA * rpmdata,
+    uint8_t * temp_buf)
 {
     int len = 0;
-    uint16_t copy_len = 0;
     uint16_t decode_len = 0;
-    int pdu_len = 0;
-    BACNET_NPCI_DATA npci_data;
-//    int bytes_sent;
-    BACNET_ADDRESS my_address;
-    BACNET_RPM_DATA rpmdata;
-    int apdu_len = 0;
-    int npdu_len = 0;
-    int error = 0;
 
-    /* jps_debug - see if we are utilizing all the buffer */
-    /* memset(&Handler_Transmit_Buffer[0], 0xff, sizeof(Handler_Transmit_Buffer)); */
-    /* encode the NPDU portion of the packet */
-    datalink_get_my_address(&my_address);
-    npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
-    npdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
-        &npci_data);
-    if (service_data->segmented_message) {
-        rpmdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-        error = BACNET_STATUS_ABORT;
-#if PRINT_ENABLED
-        fprintf(stderr, "RPM: Segmented message. Sending Abort!\r\n");
-#endif
-        goto RPM_FAILURE;
-    }
-    /* decode apdu request & encode apdu reply
-       encode complex ack, invoke id, service choice */
-    apdu_len =
-        rpm_ack_encode_apdu_init(&Handler_Transmit_Buffer[npdu_len],
-        service_data->invoke_id);
+    encode_cursor_commit(cursor, encode_cursor_tail(cursor),
+        rpm_ack_encode_apdu_init(encode_cursor_tail(cursor),
+            invoke_id));
     for (;;) {
         /* Start by looking for an object ID */
         len =
             rpm_decode_object_id(&service_request[decode_len],
-                service_len - decode_len, &rpmdata);
+                service_len - decode_len, rpmdata);
         // ekh 2015.03.13 I am sure the next line should be >, not >= !!  // todo2 (BTC), karg?
         if (len >= 0) {
             /* Got one so skip to next stage */
@@ -262,92 +158,76 @@ void handler_read_property_multiple(
         else {
             /* bad encoding - skip to error/reject/abort handling */
             dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "RPM: Bad Encoding.\n");
-            error = len;
-            goto RPM_FAILURE;
+            return len;
         }
 
         /* Test for case of indefinite Device object instance */
-        if ((rpmdata.object_type == OBJECT_DEVICE) &&
-            (rpmdata.object_instance == BACNET_MAX_INSTANCE)) {
-            rpmdata.object_instance = Device_Object_Instance_Number();
+        if ((rpmdata->object_type == OBJECT_DEVICE) &&
+            (rpmdata->object_instance == BACNET_MAX_INSTANCE)) {
+            rpmdata->object_instance = Device_Object_Instance_Number();
         }
 
         /* Stick this object id into the reply - if it will fit */
-        len = rpm_ack_encode_apdu_object_begin(&Temp_Buf[0], &rpmdata);
-        copy_len =
-            memcopy(&Handler_Transmit_Buffer[npdu_len], &Temp_Buf[0], apdu_len,
-            len, MAX_APDU);
-        if (copy_len == 0) {
+        if (!rpm_ack_cursor_object_begin(cursor, rpmdata)) {
             dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "RPM: Response too big!\r\n");
-            rpmdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-            error = BACNET_STATUS_ABORT;
-            goto RPM_FAILURE;
+            rpmdata->error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+            return BACNET_STATUS_ABORT;
         }
 
-        apdu_len += copy_len;
         /* do each property of this object of the RPM request */
         for (;;) {
             /* Fetch a property */
             len =
                 rpm_decode_object_property(&service_request[decode_len],
-                    service_len - decode_len, &rpmdata);
+                    service_len - decode_len, rpmdata);
             if (len < 0) {
                 /* bad encoding - skip to error/reject/abort handling */
                 dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "RPM: Bad Encoding.\n");
-                error = len;
-                goto RPM_FAILURE;
+                return len;
             }
             decode_len += len;
             /* handle the special properties */
-            if ((rpmdata.object_property == PROP_ALL) ||
-                (rpmdata.object_property == PROP_REQUIRED) ||
-                (rpmdata.object_property == PROP_OPTIONAL)) {
-                struct special_property_list_t property_list;
+            if ((rpmdata->object_property == PROP_ALL) ||
+                (rpmdata->object_property == PROP_REQUIRED) ||
+                (rpmdata->object_property == PROP_OPTIONAL)) {
+                const BACNET_PROPERTY_SET *pSet;
+                BACNET_PROPERTY_SET property_lists;
                 unsigned property_count = 0;
                 unsigned index = 0;
                 BACNET_PROPERTY_ID special_object_property;
 
-                if (rpmdata.array_index != BACNET_ARRAY_ALL) {
+                if (rpmdata->array_index != BACNET_ARRAY_ALL) {
                     /*  No array index options for this special property.
                        Encode error for this object property response */
-                    len =
-                        rpm_ack_encode_apdu_object_property(&Temp_Buf[0],
-                            rpmdata.object_property, rpmdata.array_index);
-                    copy_len =
-                        memcopy(&Handler_Transmit_Buffer[npdu_len],
-                        &Temp_Buf[0], apdu_len, len, MAX_APDU);
-                    if (copy_len == 0) {
+                    if (!rpm_ack_cursor_object_property(cursor,
+                            rpmdata->object_property, rpmdata->array_index)) {
                         dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR,
                             "RPM: Too full to encode property!\r\n");
-                        rpmdata.error_code =
+                        rpmdata->error_code =
                             ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                        error = BACNET_STATUS_ABORT;
-                        goto RPM_FAILURE;
+                        return BACNET_STATUS_ABORT;
                     }
-                    apdu_len += len;
-                    len =
-                        rpm_ack_encode_apdu_object_property_error(&Temp_Buf[0],
+                    if (!rpm_ack_cursor_object_property_error(cursor,
                             ERROR_CLASS_PROPERTY,
-                            ERROR_CODE_PROPERTY_IS_NOT_AN_ARRAY);
-                    copy_len =
-                        memcopy(&Handler_Transmit_Buffer[npdu_len],
-                        &Temp_Buf[0], apdu_len, len, MAX_APDU);
-                    if (copy_len == 0) {
+                            ERROR_CODE_PROPERTY_IS_NOT_AN_ARRAY)) {
                         dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "RPM: Too full to encode error!\r\n");
-                        rpmdata.error_code =
+                        rpmdata->error_code =
                             ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                        error = BACNET_STATUS_ABORT;
-                        goto RPM_FAILURE;
+                        return BACNET_STATUS_ABORT;
                     }
-                    apdu_len += len;
                 }
                 else {
-                    special_object_property = rpmdata.object_property;
-                    Device_Objects_Property_List(rpmdata.object_type,
-                        rpmdata.object_instance, &property_list);
+                    special_object_property = rpmdata->object_property;
+                    pSet = Device_Objects_Property_Set(rpmdata->object_type);
+                    if (pSet == NULL) {
+                        /* not counted at startup: only the lists are
+                           filled in, which is all the expansion uses */
+                        Device_Objects_Property_List(rpmdata->object_type,
+                            rpmdata->object_instance, &property_lists.Lists);
+                        pSet = &property_lists;
+                    }
                     property_count =
-                        RPM_Object_Property_Count(&property_list,
-                            special_object_property);
+                        property_set_count(pSet, special_object_property);
                     if (property_count == 0) {
                         /* this only happens with the OPTIONAL property */
                         /* 135-2016bl-2. Clarify ReadPropertyMultiple
@@ -358,21 +238,16 @@ void handler_read_property_multiple(
                     } 
                     else {
                         for (index = 0; index < property_count; index++) {
-                            rpmdata.object_property =
-                                RPM_Object_Property(&property_list,
+                            rpmdata->object_property =
+                                property_set_property(pSet,
                                     special_object_property, index);
                             len =
-                                RPM_Encode_Property(&Handler_Transmit_Buffer
-                                [npdu_len], (uint16_t) apdu_len, MAX_APDU,
-                                &rpmdata);
-                            if (len > 0) {
-                                apdu_len += len;
-                            }
-                            else {
+                                RPM_Encode_Property(cursor, rpmdata,
+                                temp_buf);
+                            if (len <= 0) {
                                 dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR,
                                     "RPM: Too full for property!\r\n");
-                                error = len;
-                                goto RPM_FAILURE;
+                                return len;
                             }
                         }
                     }
@@ -380,35 +255,21 @@ void handler_read_property_multiple(
             }
             else {
                 /* handle an individual property */
-                len =
-                    RPM_Encode_Property(&Handler_Transmit_Buffer[npdu_len],
-                    (uint16_t) apdu_len, MAX_APDU, &rpmdata);
-                if (len > 0) {
-                    apdu_len += len;
-                }
-                else {
+                len = RPM_Encode_Property(cursor, rpmdata, temp_buf);
+                if (len <= 0) {
                     dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR,
                         "RPM: Too full for individual property!\r\n");
-                    error = len;
-                    goto RPM_FAILURE;
+                    return len;
                 }
             }
             if (decode_is_closing_tag_number(&service_request[decode_len], 1)) {
                 /* Reached end of property list so cap the result list */
                 decode_len++;
-                len = rpm_ack_encode_apdu_object_end(&Temp_Buf[0]);
-                copy_len =
-                    memcopy(&Handler_Transmit_Buffer[npdu_len], &Temp_Buf[0],
-                    apdu_len, len, MAX_APDU);
-                if (copy_len == 0) {
+                if (!rpm_ack_cursor_object_end(cursor)) {
                     dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "RPM: Too full to encode object end!\r\n");
-                    rpmdata.error_code =
+                    rpmdata->error_code =
                         ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
-                    error = BACNET_STATUS_ABORT;
-                    goto RPM_FAILURE;
-                }
-                else {
-                    apdu_len += copy_len;
+                    return BACNET_STATUS_ABORT;
                 }
                 break;  /* finished with this property list */
             }
@@ -419,7 +280,133 @@ void handler_read_property_multiple(
         }
     }
 
-    if (apdu_len > service_data->max_resp) {
+
+    return 0;
+}
+
+/** Handler for a ReadPropertyMultiple Service request.
+ * @ingroup DSRPM
+ * This handler will be invoked by apdu_handler() if it has been enabled
+ * by a call to apdu_set_confirmed_handler().
+ * This handler builds a response packet, which is
+ * - an Abort if
+ *   - the message is segmented
+ *   - if decoding fails
+ *   - if the response would be too large, and the client does not take
+ *     segmented replies or has too few segments for it
+ * - a segmented ComplexACK, sent by the TSM, if it is too large for one APDU
+ * - the result from each included read request, if it succeeds
+ * - an Error if processing fails for all, or individual errors if only some fail,
+ *   or there isn't enough room in the APDU to fit the data.
+ *
+ * @param service_request [in] The contents of the service request.
+ * @param service_len [in] The length of the service_request.
+ * @param src [in] BACNET_ADDRESS of the source of the message
+ * @param service_data [in] The BACNET_CONFIRMED_SERVICE_DATA information
+ *                          decoded from the APDU header of this message.
+ */
+void handler_read_property_multiple(
+    uint8_t * service_request,
+    uint16_t service_len,
+    BACNET_ADDRESS * src,
+    BACNET_CONFIRMED_SERVICE_DATA * service_data)
+{
+    int pdu_len = 0;
+    BACNET_NPCI_DATA npci_data;
+//    int bytes_sent;
+    BACNET_ADDRESS my_address;
+    BACNET_RPM_DATA rpmdata;
+    int apdu_len = 0;
+    int npdu_len = 0;
+    int error = 0;
+    uint8_t *pdu = NULL;
+    uint8_t *temp_buf = NULL;
+    BACNET_ENCODE_CURSOR cursor;
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    BACNET_ABORT_REASON abort_reason;
+#endif
+
+    /* values near the end of the reply go through temp_buf; a segment
+       buffer is only taken if the reply turns out not to fit */
+    pdu = txbuf_acquire();
+    temp_buf = txbuf_acquire();
+    if ((pdu == NULL) || (temp_buf == NULL)) {
+        txbuf_release(pdu);
+        txbuf_release(temp_buf);
+        handler_out_of_resources(src, service_data);
+        return;
+    }
+
+    /* encode the NPDU portion of the packet */
+    datalink_get_my_address(&my_address);
+    npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    npdu_len =
+        npdu_encode_pdu(&pdu[0], src, &my_address,
+        &npci_data);
+    if (service_data->segmented_message) {
+        rpmdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+        error = BACNET_STATUS_ABORT;
+#if PRINT_ENABLED
+        fprintf(stderr, "RPM: Segmented message. Sending Abort!\r\n");
+#endif
+        goto RPM_FAILURE;
+    }
+    /* decode apdu request & encode apdu reply
+       encode complex ack, invoke id, service choice */
+    encode_cursor_init(&cursor, &pdu[npdu_len], MAX_APDU,
+        MAX_PDU - npdu_len);
+    error =
+        RPM_Encode_Reply(&cursor, service_request, service_len,
+        service_data->invoke_id, &rpmdata, temp_buf);
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    if ((error == BACNET_STATUS_ABORT) &&
+        (rpmdata.error_code == ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED)
+        && service_data->segmented_response_accepted) {
+        /* too big for one APDU: encode it again where the whole reply
+           fits, the TSM segments it */
+        uint8_t *segment_pdu = txbuf_acquire_segmented();
+
+        if (segment_pdu == NULL) {
+            rpmdata.error_code = ERROR_CODE_ABORT_OUT_OF_RESOURCES;
+        }
+        else {
+            txbuf_release(pdu);
+            pdu = segment_pdu;
+            npdu_len =
+                npdu_encode_pdu(&pdu[0], src, &my_address, &npci_data);
+            encode_cursor_init(&cursor, &pdu[npdu_len],
+                tsm_segmented_complex_ack_max(service_data->max_segs,
+                    service_data->max_resp),
+                TXBUF_SEGMENTED_SIZE - npdu_len);
+            error =
+                RPM_Encode_Reply(&cursor, service_request, service_len,
+                service_data->invoke_id, &rpmdata, temp_buf);
+        }
+    }
+#endif
+    if (error) {
+        goto RPM_FAILURE;
+    }
+
+    apdu_len = (int) encode_cursor_mark(&cursor);
+    if ((apdu_len > service_data->max_resp) || (apdu_len > MAX_APDU)) {
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+        if (service_data->segmented_response_accepted) {
+            if (tsm_set_segmented_complex_ack(src, &npci_data,
+                    service_data->max_segs, service_data->max_resp,
+                    &pdu[npdu_len], apdu_len, &abort_reason)) {
+                /* the TSM sends it from here */
+                txbuf_release(pdu);
+                txbuf_release(temp_buf);
+                return;
+            }
+            apdu_len =
+                abort_encode_apdu(&pdu[npdu_len], service_data->invoke_id,
+                abort_reason, true);
+            dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "RPM: Cannot segment.  Sending Abort!\n");
+            goto RPM_FAILURE;
+        }
+#endif
         /* too big for the sender - send an abort */
         rpmdata.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
         error = BACNET_STATUS_ABORT;
@@ -429,23 +416,31 @@ void handler_read_property_multiple(
 
 RPM_FAILURE:
     if (error) {
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+        if ((error == BACNET_STATUS_ABORT) &&
+            (rpmdata.error_code == ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED)
+            && service_data->segmented_response_accepted) {
+            /* it is segmented, but even that is too small */
+            rpmdata.error_code = ERROR_CODE_ABORT_BUFFER_OVERFLOW;
+        }
+#endif
         if (error == BACNET_STATUS_ABORT) {
             apdu_len =
-                abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                abort_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 abort_convert_error_code(rpmdata.error_code), true);
             dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "RPM: Sending Abort!\n");
         }
         else if (error == BACNET_STATUS_ERROR) {
             apdu_len =
-                bacerror_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                bacerror_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id, SERVICE_CONFIRMED_READ_PROP_MULTIPLE,
                 rpmdata.error_class, rpmdata.error_code);
             dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "RPM: Sending Error!\n");
         }
         else if (error == BACNET_STATUS_REJECT) {
             apdu_len =
-                reject_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                reject_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 reject_convert_error_code(rpmdata.error_code));
             dbTraffic(DBD_ALL, DB_UNEXPECTED_ERROR, "RPM: Sending Reject!\n");
@@ -453,6 +448,8 @@ RPM_FAILURE:
     }
 
     pdu_len = apdu_len + npdu_len;
-    datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+    datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
+    txbuf_release(pdu);
+    txbuf_release(temp_buf);
 }
@@ -39,6 +39,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <assert.h>
 #include "config.h"
@@ -53,24 +54,19 @@
 #include "datalink.h"
 #include "bactext.h"
 #include "rpm.h"
+#include "decode_arena.h"
 /* some demo stuff needed */
 #include "handlers.h"
 #include "txbuf.h"
 
 /** @file h_rpm_a.c  Handles Read Property Multiple Acknowledgments. */
 
-/** Decode the received RPM data and make a linked list of the results.
- * @ingroup DSRPM
- *
- * @param apdu [in] The received apdu data.
- * @param apdu_len [in] Total length of the apdu.
- * @param read_access_data [out] Pointer to the head of the linked list
- * 			where the RPM data is to be stored.
- * @return The number of bytes decoded, or -1 on error
- */
-int rpm_ack_decode_service_request(
+/* Decodes the RPM data into a linked list, allocating its parts from
+   the arena, or from the heap if it is NULL. */
+static int rpm_ack_decode_service_request_alloc(
     uint8_t * apdu,
     int apdu_len,
+    DECODE_ARENA * arena,
     BACNET_READ_ACCESS_DATA * read_access_data)
 {
     int decoded_len = 0;        /* return value */
@@ -94,13 +90,15 @@ int rpm_ack_decode_service_request(
             &rpm_object->object_instance);
         if (len <= 0) {
             old_rpm_object->next = NULL;
-            free(rpm_object);
+            decode_arena_free(arena, rpm_object);
             break;
         }
         decoded_len += len;
         apdu_len -= len;
         apdu += len;
-        rpm_property = (BACNET_PROPERTY_REFERENCE *) calloc(1, sizeof(BACNET_PROPERTY_REFERENCE));
+        rpm_property =
+            (BACNET_PROPERTY_REFERENCE *) decode_arena_calloc(arena,
+            sizeof(BACNET_PROPERTY_REFERENCE));
         rpm_object->listOfProperties = rpm_property;
         old_rpm_property = rpm_property;
         while (rpm_property && apdu_len) {
@@ -114,7 +112,7 @@ int rpm_ack_decode_service_request(
                     /* was this the only property in the list? */
                     rpm_object->listOfProperties = NULL;
                 }
-                free(rpm_property);
+                decode_arena_free(arena, rpm_property);
                 break;
             }
             decoded_len += len;
@@ -127,7 +125,10 @@ int rpm_ack_decode_service_request(
                 apdu++;
                 /* note: if this is an array, there will be
                    more than one element to decode */
-                value = (BACNET_APPLICATION_DATA_VALUE*) calloc(1, sizeof(BACNET_APPLICATION_DATA_VALUE));
+                value =
+                    (BACNET_APPLICATION_DATA_VALUE *)
+                    decode_arena_calloc(arena,
+                    sizeof(BACNET_APPLICATION_DATA_VALUE));
                 rpm_property->value = value;
                 old_value = value;
                 while (value && (apdu_len > 0)) {
@@ -157,7 +158,9 @@ int rpm_ack_decode_service_request(
                     } else {
                         old_value = value;
                         value =
-                            (BACNET_APPLICATION_DATA_VALUE*) calloc(1, sizeof(BACNET_APPLICATION_DATA_VALUE));
+                            (BACNET_APPLICATION_DATA_VALUE *)
+                            decode_arena_calloc(arena,
+                            sizeof(BACNET_APPLICATION_DATA_VALUE));
                         old_value->next = value;
                     }
                 }
@@ -196,7 +199,9 @@ int rpm_ack_decode_service_request(
                 }
             }
             old_rpm_property = rpm_property;
-            rpm_property = (BACNET_PROPERTY_REFERENCE *) calloc(1, sizeof(BACNET_PROPERTY_REFERENCE));
+            rpm_property =
+                (BACNET_PROPERTY_REFERENCE *) decode_arena_calloc(arena,
+                sizeof(BACNET_PROPERTY_REFERENCE));
             old_rpm_property->next = rpm_property;
         }
         len = rpm_decode_object_end(apdu, apdu_len);
@@ -207,7 +212,9 @@ int rpm_ack_decode_service_request(
         }
         if (apdu_len) {
             old_rpm_object = rpm_object;
-            rpm_object = (BACNET_READ_ACCESS_DATA *) calloc(1, sizeof(BACNET_READ_ACCESS_DATA));
+            rpm_object =
+                (BACNET_READ_ACCESS_DATA *) decode_arena_calloc(arena,
+                sizeof(BACNET_READ_ACCESS_DATA));
             old_rpm_object->next = rpm_object;
         }
     }
@@ -215,6 +222,49 @@ int rpm_ack_decode_service_request(
     return decoded_len;
 }
 
+/** Decode the received RPM data and make a linked list of the results.
+ * @ingroup DSRPM
+ * Each part of the list is calloc'd, and has to be freed by the caller.
+ * @see rpm_ack_decode_service_request_arena()
+ *
+ * @param apdu [in] The received apdu data.
+ * @param apdu_len [in] Total length of the apdu.
+ * @param read_access_data [out] Pointer to the head of the linked list
+ * 			where the RPM data is to be stored.
+ * @return The number of bytes decoded, or -1 on error
+ */
+int rpm_ack_decode_service_request(
+    uint8_t * apdu,
+    int apdu_len,
+    BACNET_READ_ACCESS_DATA * read_access_data)
+{
+    return rpm_ack_decode_service_request_alloc(apdu, apdu_len, NULL,
+        read_access_data);
+}
+
+/** Decode the received RPM data and make a linked list of the results,
+ * with every part of the list after the head allocated from the arena.
+ * @ingroup DSRPM
+ * The whole list, decoded or not, is given back with one
+ * decode_arena_release(); the head can come from the arena as well.
+ *
+ * @param apdu [in] The received apdu data.
+ * @param apdu_len [in] Total length of the apdu.
+ * @param arena [in] The arena for this ACK.
+ * @param read_access_data [out] Pointer to the head of the linked list
+ * 			where the RPM data is to be stored.
+ * @return The number of bytes decoded, or -1 on error
+ */
+int rpm_ack_decode_service_request_arena(
+    uint8_t * apdu,
+    int apdu_len,
+    DECODE_ARENA * arena,
+    BACNET_READ_ACCESS_DATA * read_access_data)
+{
+    return rpm_ack_decode_service_request_alloc(apdu, apdu_len, arena,
+        read_access_data);
+}
+
 /* for debugging... */
 void rpm_ack_print_data(
     BACNET_READ_ACCESS_DATA * rpm_data)
@@ -303,7 +353,7 @@ void rpm_ack_print_data(
 /** Handler for a ReadPropertyMultiple ACK.
  * @ingroup DSRPM
  * For each read property, print out the ACK'd data for debugging,
- * and free the request data items from linked property list.
+ * then give back the arena the ACK was decoded into.
  *
  * @param service_request [in] The contents of the service request.
  * @param service_len [in] The length of the service_request.
@@ -318,21 +368,20 @@ void handler_read_property_multiple_ack(
     BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data)
 {
     int len = 0;
+    DECODE_ARENA arena;
     BACNET_READ_ACCESS_DATA *rpm_data;
-    BACNET_READ_ACCESS_DATA *old_rpm_data;
-    BACNET_PROPERTY_REFERENCE *rpm_property;
-    BACNET_PROPERTY_REFERENCE *old_rpm_property;
-    BACNET_APPLICATION_DATA_VALUE *value;
-    BACNET_APPLICATION_DATA_VALUE *old_value;
 
     (void) src;
     (void) service_data;        /* we could use these... */
 
-    rpm_data = (BACNET_READ_ACCESS_DATA *) calloc(1, sizeof(BACNET_READ_ACCESS_DATA));
+    decode_arena_init(&arena, DECODE_ARENA_BLOCK_SIZE);
+    rpm_data =
+        (BACNET_READ_ACCESS_DATA *) decode_arena_calloc(&arena,
+        sizeof(BACNET_READ_ACCESS_DATA));
     if (rpm_data) {
         len =
-            rpm_ack_decode_service_request(service_request, service_len,
-            rpm_data);
+            rpm_ack_decode_service_request_arena(service_request,
+            service_len, &arena, rpm_data);
     }
 #if 1
     fprintf(stderr, "Received Read-Property-Multiple Ack!\n");
@@ -340,42 +389,360 @@ void handler_read_property_multiple_ack(
     if (len > 0) {
         while (rpm_data) {
             rpm_ack_print_data(rpm_data);
-            rpm_property = rpm_data->listOfProperties;
-            while (rpm_property) {
-                value = rpm_property->value;
-                while (value) {
-                    old_value = value;
-                    value = value->next;
-                    free(old_value);
-                }
-                old_rpm_property = rpm_property;
-                rpm_property = rpm_property->next;
-                free(old_rpm_property);
-            }
-            old_rpm_data = rpm_data;
             rpm_data = rpm_data->next;
-            free(old_rpm_data);
         }
     } else {
 #if 1
         fprintf(stderr, "RPM Ack Malformed! Freeing memory...\n");
 #endif
-        while (rpm_data) {
-            rpm_property = rpm_data->listOfProperties;
-            while (rpm_property) {
-                value = rpm_property->value;
-                while (value) {
-                    old_value = value;
-                    value = value->next;
-                    free(old_value);
+    }
+    decode_arena_release(&arena);
+}
+
+#ifdef TEST
+#include <string.h>
+#include <time.h>
+#include "ctest.h"
+
+/* heap allocations made by the decoders, counted by linking with
+   -Wl,--wrap=calloc (test/rpm_ack.mak) */
+static unsigned long Test_Heap_Allocations;
+
+void *__real_calloc(
+    size_t nmemb,
+    size_t size);
+
+void *__wrap_calloc(
+    size_t nmemb,
+    size_t size)
+{
+    Test_Heap_Allocations++;
+    return __real_calloc(nmemb, size);
+}
+
+/* frees a list from rpm_ack_decode_service_request(), head and all */
+static void testRPMAckFree(
+    BACNET_READ_ACCESS_DATA * rpm_data)
+{
+    BACNET_READ_ACCESS_DATA *old_rpm_data;
+    BACNET_PROPERTY_REFERENCE *rpm_property;
+    BACNET_PROPERTY_REFERENCE *old_rpm_property;
+    BACNET_APPLICATION_DATA_VALUE *value;
+    BACNET_APPLICATION_DATA_VALUE *old_value;
+
+    while (rpm_data) {
+        rpm_property = rpm_data->listOfProperties;
+        while (rpm_property) {
+            value = rpm_property->value;
+            while (value) {
+                old_value = value;
+                value = value->next;
+                free(old_value);
+            }
+            old_rpm_property = rpm_property;
+            rpm_property = rpm_property->next;
+            free(old_rpm_property);
+        }
+        old_rpm_data = rpm_data;
+        rpm_data = rpm_data->next;
+        free(old_rpm_data);
+    }
+}
+
+/* the two lists hold the same objects, properties, values and errors */
+static bool testRPMAckSame(
+    BACNET_READ_ACCESS_DATA * rpm_data,
+    BACNET_READ_ACCESS_DATA * test_data)
+{
+    BACNET_PROPERTY_REFERENCE *rpm_property, *test_property;
+    BACNET_APPLICATION_DATA_VALUE *value, *test_value;
+
+    while (rpm_data && test_data) {
+        if ((rpm_data->object_type != test_data->object_type) ||
+            (rpm_data->object_instance != test_data->object_instance)) {
+            return false;
+        }
+        rpm_property = rpm_data->listOfProperties;
+        test_property = test_data->listOfProperties;
+        while (rpm_property && test_property) {
+            if ((rpm_property->propertyIdentifier !=
+                    test_property->propertyIdentifier) ||
+                (rpm_property->propertyArrayIndex !=
+                    test_property->propertyArrayIndex) ||
+                (rpm_property->error.error_class !=
+                    test_property->error.error_class) ||
+                (rpm_property->error.error_code !=
+                    test_property->error.error_code)) {
+                return false;
+            }
+            value = rpm_property->value;
+            test_value = test_property->value;
+            while (value && test_value) {
+                if (!bacapp_same_value(value, test_value)) {
+                    return false;
                 }
-                old_rpm_property = rpm_property;
-                rpm_property = rpm_property->next;
-                free(old_rpm_property);
+                value = value->next;
+                test_value = test_value->next;
             }
-            old_rpm_data = rpm_data;
-            rpm_data = rpm_data->next;
-            free(old_rpm_data);
+            if (value || test_value) {
+                return false;
+            }
+            rpm_property = rpm_property->next;
+            test_property = test_property->next;
+        }
+        if (rpm_property || test_property) {
+            return false;
         }
+        rpm_data = rpm_data->next;
+        test_data = test_data->next;
+    }
+
+    return (rpm_data == NULL) && (test_data == NULL);
+}
+
+/* a mix of what objects return: a REAL, a Description sized
+   CharacterString, and a Priority_Array sized list of REALs */
+static int testRPMAckEncodeValue(
+    uint8_t * apdu,
+    unsigned i)
+{
+    BACNET_CHARACTER_STRING char_string;
+    int len = 0;
+    unsigned j;
+
+    switch (i % 3) {
+        case 0:
+            len = encode_application_real(&apdu[0], (float) i);
+            break;
+        case 1:
+            characterstring_init_ansi(&char_string,
+                "Supply air temperature, air handler 4, level 2");
+            len = encode_application_character_string(&apdu[0],
+                &char_string);
+            break;
+        default:
+            for (j = 0; j < BACNET_MAX_PRIORITY; j++) {
+                len += encode_application_real(&apdu[len], (float) j);
+            }
+            break;
     }
+
+    return len;
 }
+
+/* the results for one object with this many properties, every seventh
+   of them an error, in a ReadPropertyMultiple-ACK */
+static int testRPMAckEncodeObject(
+    uint8_t * apdu,
+    uint32_t object_instance,
+    unsigned properties)
+{
+    BACNET_RPM_DATA rpmdata;
+    uint8_t value[MAX_APDU];
+    int apdu_len;
+    int len;
+    unsigned i;
+
+    rpmdata.object_type = OBJECT_ANALOG_VALUE;
+    rpmdata.object_instance = object_instance;
+    apdu_len = rpm_ack_encode_apdu_object_begin(&apdu[0], &rpmdata);
+    for (i = 0; i < properties; i++) {
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+            (BACNET_PROPERTY_ID) (512 + i), BACNET_ARRAY_ALL);
+        if ((i % 7) == 6) {
+            apdu_len +=
+                rpm_ack_encode_apdu_object_property_error(&apdu[apdu_len],
+                ERROR_CLASS_PROPERTY, ERROR_CODE_UNKNOWN_PROPERTY);
+        } else {
+            len = testRPMAckEncodeValue(&value[0], i);
+            apdu_len +=
+                rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+                &value[0], len);
+        }
+    }
+    apdu_len += rpm_ack_encode_apdu_object_end(&apdu[apdu_len]);
+
+    return apdu_len;
+}
+
+void testReadPropertyMultipleAckArena(
+    Test * pTest)
+{
+    uint8_t apdu[4096];
+    /* a context opening tag where a value should be */
+    uint8_t malformed[] = { 0x0E };
+    BACNET_RPM_DATA rpmdata;
+    DECODE_ARENA arena;
+    BACNET_READ_ACCESS_DATA *rpm_data;
+    BACNET_READ_ACCESS_DATA *test_data;
+    BACNET_PROPERTY_REFERENCE *rpm_property;
+    unsigned long heap_allocations;
+    int apdu_len, len, test_len;
+
+    /* two objects in one ACK */
+    apdu_len = testRPMAckEncodeObject(&apdu[0], 1, 8);
+    apdu_len += testRPMAckEncodeObject(&apdu[apdu_len], 2, 3);
+    rpm_data =
+        (BACNET_READ_ACCESS_DATA *) calloc(1,
+        sizeof(BACNET_READ_ACCESS_DATA));
+    ct_test(pTest, rpm_data != NULL);
+    len = rpm_ack_decode_service_request(&apdu[0], apdu_len, rpm_data);
+    ct_test(pTest, len == apdu_len);
+
+    decode_arena_init(&arena, DECODE_ARENA_BLOCK_SIZE);
+    heap_allocations = Test_Heap_Allocations;
+    test_data =
+        (BACNET_READ_ACCESS_DATA *) decode_arena_calloc(&arena,
+        sizeof(BACNET_READ_ACCESS_DATA));
+    ct_test(pTest, test_data != NULL);
+    test_len =
+        rpm_ack_decode_service_request_arena(&apdu[0], apdu_len, &arena,
+        test_data);
+    ct_test(pTest, test_len == len);
+    ct_test(pTest, (Test_Heap_Allocations - heap_allocations) ==
+        arena.block_count);
+    ct_test(pTest, testRPMAckSame(rpm_data, test_data));
+    ct_test(pTest, test_data->object_instance == 1);
+    ct_test(pTest, test_data->next != NULL);
+    ct_test(pTest, test_data->next->object_instance == 2);
+    ct_test(pTest, test_data->next->next == NULL);
+    /* the seventh property is an error, the third a list of values */
+    rpm_property = test_data->listOfProperties;
+    ct_test(pTest, rpm_property->value->next == NULL);
+    ct_test(pTest, rpm_property->next->next->value->next != NULL);
+    while (rpm_property->propertyIdentifier != 518) {
+        rpm_property = rpm_property->next;
+    }
+    ct_test(pTest, rpm_property->value == NULL);
+    ct_test(pTest, rpm_property->error.error_class == ERROR_CLASS_PROPERTY);
+    ct_test(pTest,
+        rpm_property->error.error_code == ERROR_CODE_UNKNOWN_PROPERTY);
+    decode_arena_release(&arena);
+    ct_test(pTest, arena.block_count == 0);
+    testRPMAckFree(rpm_data);
+
+    /* a value that does not decode, after good ones: an error, and all
+       of it is given back just the same */
+    apdu_len = testRPMAckEncodeObject(&apdu[0], 1, 8);
+    rpmdata.object_type = OBJECT_ANALOG_VALUE;
+    rpmdata.object_instance = 2;
+    apdu_len +=
+        rpm_ack_encode_apdu_object_begin(&apdu[apdu_len], &rpmdata);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+        PROP_PRESENT_VALUE, BACNET_ARRAY_ALL);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+        &malformed[0], sizeof(malformed));
+    apdu_len += rpm_ack_encode_apdu_object_end(&apdu[apdu_len]);
+    test_data =
+        (BACNET_READ_ACCESS_DATA *) decode_arena_calloc(&arena,
+        sizeof(BACNET_READ_ACCESS_DATA));
+    test_len =
+        rpm_ack_decode_service_request_arena(&apdu[0], apdu_len, &arena,
+        test_data);
+    ct_test(pTest, test_len < 0);
+    ct_test(pTest, arena.block_count == 1);
+    decode_arena_release(&arena);
+}
+
+#define RPM_ACK_BENCH_PROPERTIES 200
+#define RPM_ACK_BENCH_DECODES 2000
+
+static double testRPMAckDecodeNs(
+    uint8_t * apdu,
+    int apdu_len,
+    bool use_arena,
+    unsigned long *allocations)
+{
+    DECODE_ARENA arena;
+    BACNET_READ_ACCESS_DATA *rpm_data;
+    struct timespec start, end;
+    unsigned long heap_allocations;
+    unsigned i;
+
+    decode_arena_init(&arena, DECODE_ARENA_BLOCK_SIZE);
+    heap_allocations = Test_Heap_Allocations;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < RPM_ACK_BENCH_DECODES; i++) {
+        if (use_arena) {
+            rpm_data =
+                (BACNET_READ_ACCESS_DATA *) decode_arena_calloc(&arena,
+                sizeof(BACNET_READ_ACCESS_DATA));
+            rpm_ack_decode_service_request_arena(apdu, apdu_len, &arena,
+                rpm_data);
+            decode_arena_release(&arena);
+        } else {
+            rpm_data =
+                (BACNET_READ_ACCESS_DATA *) calloc(1,
+                sizeof(BACNET_READ_ACCESS_DATA));
+            rpm_ack_decode_service_request(apdu, apdu_len, rpm_data);
+            testRPMAckFree(rpm_data);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *allocations =
+        (Test_Heap_Allocations - heap_allocations) / RPM_ACK_BENCH_DECODES;
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec -
+            start.tv_nsec)) / RPM_ACK_BENCH_DECODES;
+}
+
+/* Decoding a 200 property ReadPropertyMultiple-ACK, each part calloc'd
+   and freed against all of it from one arena */
+void testReadPropertyMultipleAckArenaBenchmark(
+    Test * pTest)
+{
+    static uint8_t apdu[16384];
+    FILE *stream = ct_getStream(pTest);
+    unsigned long heap_allocations = 0, arena_allocations = 0;
+    double heap_ns, arena_ns;
+    int apdu_len;
+
+    apdu_len =
+        testRPMAckEncodeObject(&apdu[0], 1, RPM_ACK_BENCH_PROPERTIES);
+    ct_test(pTest, apdu_len > 0);
+    ct_test(pTest, apdu_len < (int) sizeof(apdu));
+    heap_ns =
+        testRPMAckDecodeNs(&apdu[0], apdu_len, false, &heap_allocations);
+    arena_ns =
+        testRPMAckDecodeNs(&apdu[0], apdu_len, true, &arena_allocations);
+    ct_test(pTest, arena_allocations > 0);
+    ct_test(pTest, arena_allocations < heap_allocations);
+    fprintf(stream, "\n  %u properties, %d bytes per ACK\n",
+        RPM_ACK_BENCH_PROPERTIES, apdu_len);
+    fprintf(stream, "  %-8s %12s %12s %12s\n", "", "allocs/ACK", "ns/ACK",
+        "MB/s");
+    fprintf(stream, "  %-8s %12lu %12.0f %12.1f\n", "heap",
+        heap_allocations, heap_ns, apdu_len * 1e3 / heap_ns);
+    fprintf(stream, "  %-8s %12lu %12.0f %12.1f\n", "arena",
+        arena_allocations, arena_ns, apdu_len * 1e3 / arena_ns);
+}
+
+#ifdef TEST_RPM_ACK
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet ReadPropertyMultiple-ACK Decoding", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testReadPropertyMultipleAckArena);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testReadPropertyAckArena);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testReadPropertyMultipleAckArenaBenchmark);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_RPM_ACK */
+
+#endif /* TEST */
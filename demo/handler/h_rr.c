@@ -53,11 +53,10 @@
 #include "readrange.h"
 #include "device.h"
 #include "handlers.h"
+#include "tsm.h"
 
 /** @file h_rr.c  Handles Read Range requests. */
 
-static uint8_t Temp_Buf[MAX_APDU] = { 0 };
-
 /* Encodes the property APDU and returns the length,
    or sets the error, and returns -1 */
 static int Encode_RR_payload(
@@ -115,19 +114,54 @@ void handler_read_range(
     bool error = false;
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
+    uint8_t *temp_buf = NULL;
+    int max_apdu = MAX_APDU;
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    BACNET_ABORT_REASON abort_reason;
+#endif
 
+    if (service_data->max_resp < max_apdu) {
+        max_apdu = service_data->max_resp;
+    }
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    if (service_data->segmented_response_accepted) {
+        /* encode the whole reply, the TSM segments it if it has to */
+        pdu = txbuf_acquire_segmented();
+        temp_buf = txbuf_acquire_segmented();
+        if ((pdu != NULL) && (temp_buf != NULL)) {
+            max_apdu =
+                tsm_segmented_complex_ack_max(service_data->max_segs,
+                service_data->max_resp);
+        } else {
+            txbuf_release(pdu);
+            txbuf_release(temp_buf);
+            pdu = temp_buf = NULL;
+        }
+    }
+#endif
+    if (pdu == NULL) {
+        pdu = txbuf_acquire();
+        temp_buf = txbuf_acquire();
+    }
+    if ((pdu == NULL) || (temp_buf == NULL)) {
+        txbuf_release(pdu);
+        txbuf_release(temp_buf);
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     data.error_class = ERROR_CLASS_OBJECT;
     data.error_code = ERROR_CODE_UNKNOWN_OBJECT;
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     if (service_data->segmented_message) {
         /* we don't support segmentation - send an abort */
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
 #if PRINT_ENABLED
@@ -144,7 +178,7 @@ void handler_read_range(
     if (len < 0) {
         /* bad decoding - send an abort */
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
 #if PRINT_ENABLED
         fprintf(stderr, "RR: Bad Encoding.  Sending Abort!\n");
@@ -154,25 +188,42 @@ void handler_read_range(
 
     /* assume that there is an error */
     error = true;
-    len = Encode_RR_payload(&Temp_Buf[0], &data);
+    /* the object handlers fill the response up to this */
+    data.MaxApdu = max_apdu;
+    len = Encode_RR_payload(&temp_buf[0], &data);
     if (len >= 0) {
         /* encode the APDU portion of the packet */
-        data.application_data = &Temp_Buf[0];
+        data.application_data = &temp_buf[0];
         data.application_data_len = len;
         /* FIXME: probably need a length limitation sent with encode */
         len =
-            rr_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            rr_ack_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, &data);
 #if PRINT_ENABLED
         fprintf(stderr, "RR: Sending Ack!\n");
 #endif
         error = false;
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+        if ((len > service_data->max_resp) || (len > MAX_APDU)) {
+            if (tsm_set_segmented_complex_ack(src, &npci_data,
+                    service_data->max_segs, service_data->max_resp,
+                    &pdu[pdu_len], len, &abort_reason)) {
+                /* the TSM sends it from here */
+                txbuf_release(pdu);
+                txbuf_release(temp_buf);
+                return;
+            }
+            len =
+                abort_encode_apdu(&pdu[pdu_len], service_data->invoke_id,
+                abort_reason, true);
+        }
+#endif
     }
     if (error) {
         if (len == -2) {
             /* BACnet APDU too small to fit data, so proper response is Abort */
             len =
-                abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                abort_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id,
                 ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
 #if PRINT_ENABLED
@@ -180,7 +231,7 @@ void handler_read_range(
 #endif
         } else {
             len =
-                bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+                bacerror_encode_apdu(&pdu[pdu_len],
                 service_data->invoke_id, SERVICE_CONFIRMED_READ_RANGE,
                 data.error_class, data.error_code);
 #if PRINT_ENABLED
@@ -191,11 +242,12 @@ void handler_read_range(
   RR_ABORT:
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr, "Failed to send PDU (%s)!\n", strerror(errno));
 #endif
-
+    txbuf_release(pdu);
+    txbuf_release(temp_buf);
 }
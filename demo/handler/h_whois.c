@@ -99,6 +99,7 @@ void handler_who_is_unicast(
     uint16_t service_len,
     BACNET_ADDRESS * src)
 {
+    uint8_t *pdu = NULL;
     int len ;
     int32_t low_limit ;
     int32_t high_limit ;
@@ -107,17 +108,22 @@ void handler_who_is_unicast(
         whois_decode_service_request(service_request, service_len, &low_limit,
             &high_limit);
 
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     /* If no limits, then always respond */
     if (len == 0) {
-        Send_I_Am_Unicast(&Handler_Transmit_Buffer[0], src);
+        Send_I_Am_Unicast(&pdu[0], src);
     }
     else if (len != BACNET_STATUS_ERROR) {
         /* is my device id within the limits? */
         if ((Device_Object_Instance_Number() >= (uint32_t)low_limit) &&
             (Device_Object_Instance_Number() <= (uint32_t)high_limit)) {
-            Send_I_Am_Unicast(&Handler_Transmit_Buffer[0], src);
+            Send_I_Am_Unicast(&pdu[0], src);
         }
     }
+    txbuf_release(pdu);
 }
 
 
@@ -150,6 +156,7 @@ static void check_who_is_for_routing(
     int cursor = 0;     /* Starting hint */
     int my_list[2] = { 0, -1 }; /* Not really used, so dummy values */
     BACNET_ADDRESS bcast_net;
+    uint8_t *pdu = NULL;
 
     len =
         whois_decode_service_request(service_request, service_len, &low_limit,
@@ -163,17 +170,22 @@ static void check_who_is_for_routing(
     memset(&bcast_net, 0, sizeof(BACNET_ADDRESS));
     bcast_net.net = BACNET_BROADCAST_NETWORK;   /* That's all we have to set */
 
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     while (Routed_Device_GetNext(&bcast_net, my_list, &cursor)) {
         dev_instance = Device_Object_Instance_Number();
         /* If len == 0, no limits and always respond */
         if ((len == 0) || ((dev_instance >= low_limit) &&
             (dev_instance <= high_limit))) {
             if (is_unicast)
-                Send_I_Am_Unicast(&Handler_Transmit_Buffer[0], src);
+                Send_I_Am_Unicast(&pdu[0], src);
             else
-                Send_I_Am(&Handler_Transmit_Buffer[0]);
+                Send_I_Am(&pdu[0]);
         }
     }
+    txbuf_release(pdu);
 
 }
 
@@ -88,17 +88,23 @@ void handler_write_property(
     BACNET_NPCI_DATA npci_data;
     int bytes_sent = 0;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     dbTraffic(DBD_ALL, DB_UNUSUAL_TRAFFIC, "WP: Received Request!");
     if (service_data->segmented_message) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED,
             true);
         dbTraffic(DBD_ALL, DB_ERROR, "WP: Segmented message.  Sending Abort!");
@@ -119,19 +125,19 @@ void handler_write_property(
     /* bad decoding or something we didn't understand - send an abort */
     if (len <= 0) {
         len =
-            abort_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            abort_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, ABORT_REASON_OTHER, true);
         dbTraffic(DBD_ALL, DB_ERROR, "WP: Bad Encoding. Sending Abort!");
         goto WP_ABORT;
     }
     if (Device_Write_Property(&wp_data)) {
         len =
-            encode_simple_ack(&Handler_Transmit_Buffer[pdu_len],
+            encode_simple_ack(&pdu[pdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_WRITE_PROPERTY);
         dbTraffic(DBD_ALL, DB_UNUSUAL_TRAFFIC, "WP: Sending Simple Ack!");
     } else {
         len =
-            bacerror_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            bacerror_encode_apdu(&pdu[pdu_len],
             service_data->invoke_id, SERVICE_CONFIRMED_WRITE_PROPERTY,
             wp_data.error_class, wp_data.error_code);
         // dbTraffic(DBD_ALL, DB_UNUSUAL_TRAFFIC, "WP: Sending Error Class:%s Code:%s!", bactext_error_class_name( wp_data.error_class), bactext_error_code_name(wp_data.error_code)  );
@@ -139,13 +145,14 @@ void handler_write_property(
   WP_ABORT:
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
         fprintf(stderr, "WP: Failed to send PDU (%s)!\n", strerror(errno));
 #endif
     }
+    txbuf_release(pdu);
 
 }
 
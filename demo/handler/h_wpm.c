@@ -93,6 +93,7 @@ void handler_write_property_multiple(
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
     int bytes_sent = 0;
+    uint8_t *pdu = NULL;
 
     if (service_data->segmented_message) {
         wp_data.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
@@ -175,15 +176,20 @@ void handler_write_property_multiple(
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        handler_out_of_resources(src, service_data);
+        return;
+    }
     npdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     apdu_len = 0;
     /* handle any errors */
     if (error) {
         if (len == BACNET_STATUS_ABORT) {
             apdu_len =
-                abort_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                abort_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 abort_convert_error_code(wp_data.error_code), true);
 #if PRINT_ENABLED
@@ -191,14 +197,14 @@ void handler_write_property_multiple(
 #endif
         } else if (len == BACNET_STATUS_ERROR) {
             apdu_len =
-                wpm_error_ack_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                wpm_error_ack_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id, &wp_data);
 #if PRINT_ENABLED
             fprintf(stderr, "WPM: Sending Error!\n");
 #endif
         } else if (len == BACNET_STATUS_REJECT) {
             apdu_len =
-                reject_encode_apdu(&Handler_Transmit_Buffer[npdu_len],
+                reject_encode_apdu(&pdu[npdu_len],
                 service_data->invoke_id,
                 reject_convert_error_code(wp_data.error_code));
 #if PRINT_ENABLED
@@ -207,7 +213,7 @@ void handler_write_property_multiple(
         }
     } else {
         apdu_len =
-            wpm_ack_encode_apdu_init(&Handler_Transmit_Buffer[npdu_len],
+            wpm_ack_encode_apdu_init(&pdu[npdu_len],
             service_data->invoke_id);
 #if PRINT_ENABLED
         fprintf(stderr, "WPM: Sending Ack!\n");
@@ -216,7 +222,7 @@ void handler_write_property_multiple(
 
     pdu_len = npdu_len + apdu_len;
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0) {
@@ -225,4 +231,5 @@ void handler_write_property_multiple(
 #else
     bytes_sent = bytes_sent;
 #endif
+    txbuf_release(pdu);
 }
@@ -48,6 +48,7 @@
 #include "apdu.h"
 #include "npdu.h"
 #include "reject.h"
+#include "abort.h"
 #include "handlers.h"
 #include "device.h"
 
@@ -75,6 +76,7 @@ void handler_unrecognized_service(
     int bytes_sent = 0;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     (void) service_request;
     (void) service_len;
@@ -82,17 +84,21 @@ void handler_unrecognized_service(
     /* encode the NPDU portion of the packet */
     datalink_get_my_address(&my_address);
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], src, &my_address,
+        npdu_encode_pdu(&pdu[0], src, &my_address,
         &npci_data);
     /* encode the APDU portion of the packet */
     len =
-        reject_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        reject_encode_apdu(&pdu[pdu_len],
         service_data->invoke_id, REJECT_REASON_UNRECOGNIZED_SERVICE);
     pdu_len += len;
     /* send the data */
     bytes_sent =
-        datalink_send_pdu(src, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(src, &npci_data, &pdu[0],
         pdu_len);
     if (bytes_sent > 0) {
 #if PRINT_ENABLED
@@ -103,4 +109,32 @@ void handler_unrecognized_service(
         fprintf(stderr, "Failed to Send Reject (%s)!\n", strerror(errno));
 #endif
     }
+    txbuf_release(pdu);
+}
+
+/** Answers a confirmed request with Abort(out-of-resources) when there is
+ *  no transmit buffer free to handle it, so the client is told instead of
+ *  waiting out its timeout. The Abort is built on the stack.
+ * @ingroup MISCHNDLR
+ *
+ * @param src [in] BACNET_ADDRESS of the source of the message
+ * @param service_data [in] The BACNET_CONFIRMED_SERVICE_DATA information
+ *                          decoded from the APDU header of this message.
+ */
+void handler_out_of_resources(
+    BACNET_ADDRESS * src,
+    BACNET_CONFIRMED_SERVICE_DATA * service_data)
+{
+    uint8_t pdu[MAX_NPDU + 3];
+    int pdu_len = 0;
+    BACNET_NPCI_DATA npci_data;
+    BACNET_ADDRESS my_address;
+
+    datalink_get_my_address(&my_address);
+    npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(&pdu[0], src, &my_address, &npci_data);
+    pdu_len +=
+        abort_encode_apdu(&pdu[pdu_len], service_data->invoke_id,
+        ABORT_REASON_OUT_OF_RESOURCES, true);
+    (void) datalink_send_pdu(src, &npci_data, &pdu[0], pdu_len);
 }
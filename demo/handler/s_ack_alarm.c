@@ -77,12 +77,17 @@ uint8_t Send_Alarm_Acknowledgement(
     int pdu_len = 0;
     int bytes_sent = 0;
     BACNET_NPCI_DATA npci_data;
+    uint8_t *pdu = NULL;
 
     if (!dcc_communication_enabled())
         return 0;
 
     /* is the device bound? */
     status = address_get_by_device(device_id, &max_apdu, &dest);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     /* is there a tsm available? */
     if (status)
         invoke_id = tsm_next_free_invokeID();
@@ -91,10 +96,10 @@ uint8_t Send_Alarm_Acknowledgement(
         datalink_get_my_address(&my_address);
         npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
         pdu_len =
-            npdu_encode_pdu(&Handler_Transmit_Buffer[0], &dest, &my_address,
+            npdu_encode_pdu(&pdu[0], &dest, &my_address,
             &npci_data);
         len =
-            alarm_ack_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id,
+            alarm_ack_encode_apdu(&pdu[pdu_len], invoke_id,
             data);
         pdu_len += len;
         /* will it fit in the sender?
@@ -104,10 +109,10 @@ uint8_t Send_Alarm_Acknowledgement(
            max_apdu in the address binding table. */
         if ((unsigned) pdu_len < max_apdu) {
             tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest,
-                &npci_data, &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
+                &npci_data, &pdu[0], (uint16_t) pdu_len);
             bytes_sent =
                 datalink_send_pdu(&dest, &npci_data,
-                &Handler_Transmit_Buffer[0], pdu_len);
+                &pdu[0], pdu_len);
 #if PRINT_ENABLED
             if (bytes_sent <= 0)
                 fprintf(stderr, "Failed to Send Alarm Ack Request (%s)!\n",
@@ -124,5 +129,6 @@ uint8_t Send_Alarm_Acknowledgement(
         }
     }
 
+    txbuf_release(pdu);
     return invoke_id;
 }
@@ -76,6 +76,7 @@ uint8_t Send_Atomic_Read_File_Stream(
     int pdu_len = 0;
     int bytes_sent = 0;
     BACNET_ATOMIC_READ_FILE_DATA data;
+    uint8_t *pdu = NULL;
 
     /* if we are forbidden to send, don't send! */
     if (!dcc_communication_enabled())
@@ -83,6 +84,10 @@ uint8_t Send_Atomic_Read_File_Stream(
 
     /* is the device bound? */
     status = address_get_by_device(device_id, &max_apdu, &dest);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     /* is there a tsm available? */
     if (status)
         invoke_id = tsm_next_free_invokeID();
@@ -97,10 +102,10 @@ uint8_t Send_Atomic_Read_File_Stream(
         datalink_get_my_address(&my_address);
         npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
         pdu_len =
-            npdu_encode_pdu(&Handler_Transmit_Buffer[0], &dest, &my_address,
+            npdu_encode_pdu(&pdu[0], &dest, &my_address,
             &npci_data);
         len =
-            arf_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id,
+            arf_encode_apdu(&pdu[pdu_len], invoke_id,
             &data);
         pdu_len += len;
         /* will the APDU fit the target device?
@@ -110,10 +115,10 @@ uint8_t Send_Atomic_Read_File_Stream(
            max_apdu in the address binding table. */
         if ((unsigned) pdu_len < max_apdu) {
             tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest,
-                &npci_data, &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
+                &npci_data, &pdu[0], (uint16_t) pdu_len);
             bytes_sent =
                 datalink_send_pdu(&dest, &npci_data,
-                &Handler_Transmit_Buffer[0], pdu_len);
+                &pdu[0], pdu_len);
 #if PRINT_ENABLED
             if (bytes_sent <= 0)
                 fprintf(stderr,
@@ -131,5 +136,6 @@ uint8_t Send_Atomic_Read_File_Stream(
         }
     }
 
+    txbuf_release(pdu);
     return invoke_id;
 }
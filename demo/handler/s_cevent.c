@@ -75,12 +75,17 @@ uint8_t Send_CEvent_Notify(
     unsigned max_apdu = 0;
     bool status = false;
     uint8_t invoke_id = 0;
+    uint8_t *pdu = NULL;
 
     if (!dcc_communication_enabled())
         return 0;
 
     /* is the device bound? */
     status = address_get_by_device(device_id, &max_apdu, &dest);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     /* is there a tsm available? */
     if (status)
         invoke_id = tsm_next_free_invokeID();
@@ -89,11 +94,11 @@ uint8_t Send_CEvent_Notify(
         datalink_get_my_address(&my_address);
         npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
         pdu_len =
-            npdu_encode_pdu(&Handler_Transmit_Buffer[0], &dest, &my_address,
+            npdu_encode_pdu(&pdu[0], &dest, &my_address,
             &npci_data);
         /* encode the APDU portion of the packet */
         len =
-            cevent_notify_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+            cevent_notify_encode_apdu(&pdu[pdu_len],
             invoke_id, data);
         pdu_len += len;
         /* will it fit in the sender?
@@ -103,10 +108,10 @@ uint8_t Send_CEvent_Notify(
            max_apdu in the address binding table. */
         if ((unsigned) pdu_len < max_apdu) {
             tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest,
-                &npci_data, &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
+                &npci_data, &pdu[0], (uint16_t) pdu_len);
             bytes_sent =
                 datalink_send_pdu(&dest, &npci_data,
-                &Handler_Transmit_Buffer[0], pdu_len);
+                &pdu[0], pdu_len);
 #if PRINT_ENABLED
             if (bytes_sent <= 0) {
                 fprintf(stderr,
@@ -125,5 +130,6 @@ uint8_t Send_CEvent_Notify(
         }
     }
 
+    txbuf_release(pdu);
     return invoke_id;
 }
@@ -145,11 +145,16 @@ uint8_t Send_COV_Subscribe(
     int pdu_len = 0;
     int bytes_sent = 0;
     BACNET_NPCI_DATA npci_data;
+    uint8_t *pdu = NULL;
 
     if (!dcc_communication_enabled())
         return 0;
     /* is the device bound? */
     status = address_get_by_device(device_id, &max_apdu, &dest);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     /* is there a tsm available? */
     if (status) {
         invoke_id = tsm_next_free_invokeID();
@@ -159,12 +164,12 @@ uint8_t Send_COV_Subscribe(
         datalink_get_my_address(&my_address);
         npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
         pdu_len =
-            npdu_encode_pdu(&Handler_Transmit_Buffer[0], &dest, &my_address,
+            npdu_encode_pdu(&pdu[0], &dest, &my_address,
             &npci_data);
         /* encode the APDU portion of the packet */
         len =
-            cov_subscribe_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
-            sizeof(Handler_Transmit_Buffer)-pdu_len, invoke_id, cov_data);
+            cov_subscribe_encode_apdu(&pdu[pdu_len],
+            MAX_PDU-pdu_len, invoke_id, cov_data);
         pdu_len += len;
         /* will it fit in the sender?
            note: if there is a bottleneck router in between
@@ -173,10 +178,10 @@ uint8_t Send_COV_Subscribe(
            max_apdu in the address binding table. */
         if ((unsigned) pdu_len < max_apdu) {
             tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest,
-                &npci_data, &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
+                &npci_data, &pdu[0], (uint16_t) pdu_len);
             bytes_sent =
                 datalink_send_pdu(&dest, &npci_data,
-                &Handler_Transmit_Buffer[0], pdu_len);
+                &pdu[0], pdu_len);
             if (bytes_sent <= 0) {
 #if PRINT_ENABLED
                 fprintf(stderr, "Failed to Send SubscribeCOV Request (%s)!\n",
@@ -194,5 +199,6 @@ uint8_t Send_COV_Subscribe(
         }
     }
 
+    txbuf_release(pdu);
     return invoke_id;
 }
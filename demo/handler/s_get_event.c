@@ -80,10 +80,15 @@ uint8_t Send_Get_Event_Information_Address(
     uint8_t invoke_id = 0;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 #if PRINT_ENABLED
     int bytes_sent = 0;
 #endif
 
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     /* is there a tsm available? */
     invoke_id = tsm_next_free_invokeID();
     if (invoke_id) {
@@ -91,21 +96,21 @@ uint8_t Send_Get_Event_Information_Address(
         /* encode the NPDU portion of the packet */
         npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
         pdu_len =
-            npdu_encode_pdu(&Handler_Transmit_Buffer[0], dest,
+            npdu_encode_pdu(&pdu[0], dest,
             &my_address, &npci_data);
         /* encode the APDU portion of the packet */
-        len = getevent_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        len = getevent_encode_apdu(&pdu[pdu_len],
             invoke_id, lastReceivedObjectIdentifier);
 
         pdu_len += len;
         if ((uint16_t) pdu_len < max_apdu) {
             tsm_set_confirmed_unsegmented_transaction(invoke_id, dest,
-                &npci_data, &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
+                &npci_data, &pdu[0], (uint16_t) pdu_len);
 #if PRINT_ENABLED
             bytes_sent =
 #endif
                 datalink_send_pdu(dest, &npci_data,
-                &Handler_Transmit_Buffer[0], pdu_len);
+                &pdu[0], pdu_len);
 #if PRINT_ENABLED
             if (bytes_sent <= 0)
                 fprintf(stderr, "Failed to Send Get Event Information Request (%s)!\n",
@@ -122,6 +127,7 @@ uint8_t Send_Get_Event_Information_Address(
         }
     }
 
+    txbuf_release(pdu);
     return invoke_id;
 }
 
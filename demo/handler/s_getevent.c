@@ -75,24 +75,29 @@ uint8_t Send_GetEvent(
     uint8_t invoke_id = 0;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
 
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], target_address,
+        npdu_encode_pdu(&pdu[0], target_address,
         &my_address, &npci_data);
 
     invoke_id = tsm_next_free_invokeID();
     if (invoke_id) {
         /* encode the APDU portion of the packet */
         len =
-            getevent_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id, lastReceivedObjectIdentifier);
+            getevent_encode_apdu(&pdu[pdu_len], invoke_id, lastReceivedObjectIdentifier);
         pdu_len += len;
         bytes_sent =
             datalink_send_pdu(target_address, &npci_data,
-            &Handler_Transmit_Buffer[0], pdu_len);
+            &pdu[0], pdu_len);
 #if PRINT_ENABLED
         if (bytes_sent <= 0)
             fprintf(stderr, "Failed to Send GetEventInformation Request (%s)!\n",
@@ -107,6 +112,7 @@ uint8_t Send_GetEvent(
                 "(exceeds destination maximum APDU)!\n");
 #endif
     }
+    txbuf_release(pdu);
     return invoke_id;
 }
 
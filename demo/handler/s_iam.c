@@ -81,29 +81,35 @@ void Send_I_Am_To_Network(
     int bytes_sent = 0;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
 
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], target_address,
+        npdu_encode_pdu(&pdu[0], target_address,
         &my_address, &npci_data);
     /* encode the APDU portion of the packet */
     /* encode the APDU portion of the packet */
     len =
-        iam_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        iam_encode_apdu(&pdu[pdu_len],
         device_id, max_apdu, segmentation, vendor_id);
     pdu_len += len;
     bytes_sent =
         datalink_send_pdu(target_address, &npci_data,
-        &Handler_Transmit_Buffer[0], pdu_len);
+        &pdu[0], pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
         fprintf(stderr, "Failed to Send I-Am Request (%s)!\n",
             strerror(errno));
 #endif
     }
+    txbuf_release(pdu);
 
 }
 
@@ -82,6 +82,7 @@ void Send_I_Have(
     BACNET_I_HAVE_DATA data;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     datalink_get_my_address(&my_address);
     /* if we are forbidden to send, don't send! */
@@ -91,8 +92,12 @@ void Send_I_Have(
     datalink_get_broadcast_address(&dest);
     /* encode the NPDU portion of the packet */
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], &dest, &my_address,
+        npdu_encode_pdu(&pdu[0], &dest, &my_address,
         &npci_data);
 
     /* encode the APDU portion of the packet */
@@ -101,11 +106,11 @@ void Send_I_Have(
     data.object_id.type = object_type;
     data.object_id.instance = object_instance;
     characterstring_copy(&data.object_name, object_name);
-    len = ihave_encode_apdu(&Handler_Transmit_Buffer[pdu_len], &data);
+    len = ihave_encode_apdu(&pdu[pdu_len], &data);
     pdu_len += len;
     /* send the data */
     bytes_sent =
-        datalink_send_pdu(&dest, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(&dest, &npci_data, &pdu[0],
         pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
@@ -113,4 +118,5 @@ void Send_I_Have(
             strerror(errno));
 #endif
     }
+    txbuf_release(pdu);
 }
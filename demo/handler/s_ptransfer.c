@@ -89,6 +89,7 @@ uint8_t Send_Private_Transfer_Request(
     static uint8_t pt_req_buffer[300];  /* Somewhere to build the request packet */
     BACNET_PRIVATE_TRANSFER_DATA pt_block;
     BACNET_CHARACTER_STRING bsTemp;
+    uint8_t *pdu = NULL;
 
     /* if we are forbidden to send, don't send! */
     if (!dcc_communication_enabled())
@@ -96,6 +97,10 @@ uint8_t Send_Private_Transfer_Request(
 
     /* is the device bound? */
     status = address_get_by_device(device_id, &max_apdu, &dest);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     /* is there a tsm available? */
     if (status)
         invoke_id = tsm_next_free_invokeID();
@@ -104,7 +109,7 @@ uint8_t Send_Private_Transfer_Request(
         datalink_get_my_address(&my_address);
         npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
         pdu_len =
-            npdu_encode_pdu(&Handler_Transmit_Buffer[0], &dest, &my_address,
+            npdu_encode_pdu(&pdu[0], &dest, &my_address,
             &npci_data);
         /* encode the APDU portion of the packet */
 
@@ -129,7 +134,7 @@ uint8_t Send_Private_Transfer_Request(
         pt_block.serviceParameters = &pt_req_buffer[0];
         pt_block.serviceParametersLen = len;
         len =
-            ptransfer_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id,
+            ptransfer_encode_apdu(&pdu[pdu_len], invoke_id,
             &pt_block);
         pdu_len += len;
 
@@ -141,10 +146,10 @@ uint8_t Send_Private_Transfer_Request(
 
         if ((unsigned) pdu_len < max_apdu) {
             tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest,
-                &npci_data, &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
+                &npci_data, &pdu[0], (uint16_t) pdu_len);
             bytes_sent =
                 datalink_send_pdu(&dest, &npci_data,
-                &Handler_Transmit_Buffer[0], pdu_len);
+                &pdu[0], pdu_len);
 #if PRINT_ENABLED
             if (bytes_sent <= 0)
                 fprintf(stderr,
@@ -162,5 +167,6 @@ uint8_t Send_Private_Transfer_Request(
         }
     }
 
+    txbuf_release(pdu);
     return invoke_id;
 }
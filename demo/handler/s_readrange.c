@@ -75,12 +75,17 @@ uint8_t Send_ReadRange_Request(
     int pdu_len = 0;
     int bytes_sent = 0;
     BACNET_NPCI_DATA npci_data;
+    uint8_t *pdu = NULL;
 
     if (!dcc_communication_enabled())
         return 0;
 
     /* is the device bound? */
     status = address_get_by_device(device_id, &max_apdu, &dest);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     /* is there a tsm available? */
     if (status)
         invoke_id = tsm_next_free_invokeID();
@@ -90,14 +95,15 @@ uint8_t Send_ReadRange_Request(
         datalink_get_my_address(&my_address);
         npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
         pdu_len =
-            npdu_encode_pdu(&Handler_Transmit_Buffer[0], &dest, &my_address,
+            npdu_encode_pdu(&pdu[0], &dest, &my_address,
             &npci_data);
 
         /* encode the APDU portion of the packet */
         len =
-            rr_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id,
+            rr_encode_apdu(&pdu[pdu_len], invoke_id,
             read_access_data);
         if (len <= 0) {
+            txbuf_release(pdu);
             return 0;
         }
 
@@ -109,10 +115,10 @@ uint8_t Send_ReadRange_Request(
            max_apdu in the address binding table. */
         if ((unsigned) pdu_len < max_apdu) {
             tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest,
-                &npci_data, &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
+                &npci_data, &pdu[0], (uint16_t) pdu_len);
             bytes_sent =
                 datalink_send_pdu(&dest, &npci_data,
-                &Handler_Transmit_Buffer[0], pdu_len);
+                &pdu[0], pdu_len);
 #if PRINT_ENABLED
             if (bytes_sent <= 0)
                 fprintf(stderr, "Failed to Send ReadRange Request (%s)!\n",
@@ -128,5 +134,6 @@ uint8_t Send_ReadRange_Request(
         }
     }
 
+    txbuf_release(pdu);
     return invoke_id;
 }
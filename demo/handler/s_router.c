@@ -124,6 +124,7 @@ int Send_Network_Layer_Message(
     bool data_expecting_reply = false;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS bcastDest;
+    uint8_t *pdu = NULL;
 
     if (iArgs == NULL)
         return 0;       /* Can't do anything here */
@@ -142,15 +143,19 @@ int Send_Network_Layer_Message(
     /* We don't need src information, since a message can't originate from
      * our downstream BACnet network.
      */
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], dst, NULL, &npci_data);
+        npdu_encode_pdu(&pdu[0], dst, NULL, &npci_data);
 
     /* Now encode the optional payload bytes, per message type */
     switch (network_message_type) {
         case NETWORK_MESSAGE_WHO_IS_ROUTER_TO_NETWORK:
             if (*pVal >= 0) {
                 len =
-                    encode_unsigned16(&Handler_Transmit_Buffer[pdu_len],
+                    encode_unsigned16(&pdu[pdu_len],
                     (uint16_t) * pVal);
                 pdu_len += len;
             }
@@ -162,7 +167,7 @@ int Send_Network_Layer_Message(
         case NETWORK_MESSAGE_ROUTER_AVAILABLE_TO_NETWORK:
             while (*pVal >= 0) {
                 len =
-                    encode_unsigned16(&Handler_Transmit_Buffer[pdu_len],
+                    encode_unsigned16(&pdu[pdu_len],
                     (uint16_t) * pVal);
                 pdu_len += len;
                 pVal++;
@@ -171,10 +176,10 @@ int Send_Network_Layer_Message(
 
         case NETWORK_MESSAGE_REJECT_MESSAGE_TO_NETWORK:
             /* Encode the Reason byte, then the DNET */
-            Handler_Transmit_Buffer[pdu_len++] = (uint8_t) * pVal;
+            pdu[pdu_len++] = (uint8_t) * pVal;
             pVal++;
             len =
-                encode_unsigned16(&Handler_Transmit_Buffer[pdu_len],
+                encode_unsigned16(&pdu[pdu_len],
                 (uint16_t) * pVal);
             pdu_len += len;
             break;
@@ -187,7 +192,7 @@ int Send_Network_Layer_Message(
                 len++;
                 pVal++;
             }
-            Handler_Transmit_Buffer[pdu_len++] = (uint8_t) len;
+            pdu[pdu_len++] = (uint8_t) len;
 
             if (len > 0) {
                 uint8_t portID = 1;
@@ -198,11 +203,11 @@ int Send_Network_Layer_Message(
                  */
                 while (*pVal >= 0) {
                     len =
-                        encode_unsigned16(&Handler_Transmit_Buffer[pdu_len],
+                        encode_unsigned16(&pdu[pdu_len],
                         (uint16_t) * pVal);
                     pdu_len += len;
-                    Handler_Transmit_Buffer[pdu_len++] = portID++;
-                    Handler_Transmit_Buffer[pdu_len++] = 0;
+                    pdu[pdu_len++] = portID++;
+                    pdu[pdu_len++] = 0;
                     debug_printf("  Sending Routing Table entry for %u \n",
                         *pVal);
                     pVal++;
@@ -213,6 +218,7 @@ int Send_Network_Layer_Message(
         default:
             debug_printf("Not sent: %s message unsupported \n",
                 bactext_network_layer_msg_name(network_message_type));
+            txbuf_release(pdu);
             return 0;
             break;      /* Will never reach this line */
     }
@@ -226,7 +232,7 @@ int Send_Network_Layer_Message(
 
     /* Now send the message */
     bytes_sent =
-        datalink_send_pdu(dst, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(dst, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0) {
@@ -236,6 +242,7 @@ int Send_Network_Layer_Message(
             strerror(wasErrno));
     }
 #endif
+    txbuf_release(pdu);
     return bytes_sent;
 }
 
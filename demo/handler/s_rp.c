@@ -46,30 +46,20 @@
 #include "txbuf.h"
 #include "client.h"
 #include "tsm.h"
+#include "client_async.h"
 
 /** @file s_rp.c  Send Read Property request. */
 
-/** Sends a Read Property request
- * @ingroup DSRP
- *
- * @param dest [in] BACNET_ADDRESS of the destination device
- * @param max_apdu [in]
- * @param object_type [in]  Type of the object whose property is to be read.
- * @param object_instance [in] Instance # of the object to be read.
- * @param object_property [in] Property to be read, but not ALL, REQUIRED, or OPTIONAL.
- * @param array_index [in] Optional: if the Property is an array,
- *   - 0 for the array size
- *   - 1 to n for individual array members
- *   - BACNET_ARRAY_ALL (~0) for the full array to be read.
- * @return invoke id of outgoing message, or 0 if device is not bound or no tsm available
- */
-uint8_t Send_Read_Property_Request_Address(
+/* both of the requests to dest, callback NULL for the one without */
+static uint8_t rp_send_request(
     BACNET_ADDRESS * dest,
     uint16_t max_apdu,
     BACNET_OBJECT_TYPE object_type,
     uint32_t object_instance,
     BACNET_PROPERTY_ID object_property,
-    uint32_t array_index)
+    uint32_t array_index,
+    client_async_callback callback,
+    void *context)
 {
     BACNET_ADDRESS my_address;
     uint8_t invoke_id = 0;
@@ -78,6 +68,7 @@ uint8_t Send_Read_Property_Request_Address(
     int bytes_sent = 0;
     BACNET_READ_PROPERTY_DATA data;
     BACNET_NPCI_DATA npci_data;
+    uint8_t *pdu = NULL;
 
     if (!dcc_communication_enabled()) {
         return 0;
@@ -85,14 +76,20 @@ uint8_t Send_Read_Property_Request_Address(
     if (!dest) {
         return 0;
     }
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     /* is there a tsm available? */
-    invoke_id = tsm_next_free_invokeID();
+    invoke_id =
+        client_async_invoke_id(dest, SERVICE_CONFIRMED_READ_PROPERTY,
+        callback, context);
     if (invoke_id) {
         /* encode the NPDU portion of the packet */
         datalink_get_my_address(&my_address);
         npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
         pdu_len =
-            npdu_encode_pdu(&Handler_Transmit_Buffer[0], dest, &my_address,
+            npdu_encode_pdu(&pdu[0], dest, &my_address,
             &npci_data);
         /* encode the APDU portion of the packet */
         data.object_type = object_type;
@@ -100,7 +97,7 @@ uint8_t Send_Read_Property_Request_Address(
         data.object_property = object_property;
         data.array_index = array_index;
         len =
-            rp_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id,
+            rp_encode_apdu(&pdu[pdu_len], invoke_id,
             &data);
         pdu_len += len;
         /* will it fit in the sender?
@@ -109,11 +106,10 @@ uint8_t Send_Read_Property_Request_Address(
            we have a way to check for that and update the
            max_apdu in the address binding table. */
         if ((uint16_t) pdu_len < max_apdu) {
-            tsm_set_confirmed_unsegmented_transaction(invoke_id, dest,
-                &npci_data, &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
+            /* sent now, or once the device has room for it */
             bytes_sent =
-                datalink_send_pdu(dest, &npci_data,
-                &Handler_Transmit_Buffer[0], pdu_len);
+                tsm_send_confirmed_unsegmented_transaction(invoke_id, dest,
+                &npci_data, &pdu[0], (uint16_t) pdu_len);
             if (bytes_sent <= 0) {
 #if PRINT_ENABLED
                 fprintf(stderr, "Failed to Send ReadProperty Request (%s)!\n",
@@ -121,7 +117,7 @@ uint8_t Send_Read_Property_Request_Address(
 #endif
             }
         } else {
-            tsm_free_invoke_id(invoke_id);
+            client_async_free_invoke_id(dest, invoke_id);
             invoke_id = 0;
 #if PRINT_ENABLED
             fprintf(stderr,
@@ -131,9 +127,36 @@ uint8_t Send_Read_Property_Request_Address(
         }
     }
 
+    txbuf_release(pdu);
     return invoke_id;
 }
 
+/** Sends a Read Property request
+ * @ingroup DSRP
+ *
+ * @param dest [in] BACNET_ADDRESS of the destination device
+ * @param max_apdu [in]
+ * @param object_type [in]  Type of the object whose property is to be read.
+ * @param object_instance [in] Instance # of the object to be read.
+ * @param object_property [in] Property to be read, but not ALL, REQUIRED, or OPTIONAL.
+ * @param array_index [in] Optional: if the Property is an array,
+ *   - 0 for the array size
+ *   - 1 to n for individual array members
+ *   - BACNET_ARRAY_ALL (~0) for the full array to be read.
+ * @return invoke id of outgoing message, or 0 if device is not bound or no tsm available
+ */
+uint8_t Send_Read_Property_Request_Address(
+    BACNET_ADDRESS * dest,
+    uint16_t max_apdu,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index)
+{
+    return rp_send_request(dest, max_apdu, object_type, object_instance,
+        object_property, array_index, NULL, NULL);
+}
+
 /** Sends a Read Property request.
  * @ingroup DSRP
  *
@@ -169,3 +192,60 @@ uint8_t Send_Read_Property_Request(
 
     return invoke_id;
 }
+
+#if ( BACNET_CLIENT == 1 )
+/** Sends a Read Property request, calling back when it is done.
+ * @ingroup DSRP
+ *
+ * @param callback [in] Made once, for the ACK, an Error, Abort or Reject,
+ *   or the timeout. See client_async.h
+ * @param context [in] Handed to the callback.
+ * @return invoke id of outgoing message, or 0 if nothing was sent, and
+ *   there will be no callback
+ */
+uint8_t Send_Read_Property_Request_Address_Async(
+    BACNET_ADDRESS * dest,
+    uint16_t max_apdu,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index,
+    client_async_callback callback,
+    void *context)
+{
+    if (callback == NULL) {
+        return 0;
+    }
+
+    return rp_send_request(dest, max_apdu, object_type, object_instance,
+        object_property, array_index, callback, context);
+}
+
+/** Sends a Read Property request to a bound device, calling back when it
+ * is done.
+ * @ingroup DSRP
+ *
+ * @return invoke id of outgoing message, or 0 if the device is not bound
+ *   or nothing was sent, and there will be no callback
+ */
+uint8_t Send_Read_Property_Request_Async(
+    uint32_t device_id,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index,
+    client_async_callback callback,
+    void *context)
+{
+    BACNET_ADDRESS dest = { 0 };
+    unsigned max_apdu = 0;
+
+    if (!address_get_by_device(device_id, &max_apdu, &dest)) {
+        return 0;
+    }
+
+    return Send_Read_Property_Request_Address_Async(&dest, max_apdu,
+        object_type, object_instance, object_property, array_index,
+        callback, context);
+}
+#endif
@@ -57,24 +57,18 @@
 #include "handlers.h"
 #include "sbuf.h"
 #include "client.h"
+#include "client_async.h"
 
 /** @file s_rpm.c  Send Read Property Multiple request. */
 
-/** Sends a Read Property Multiple request.
- * @ingroup DSRPM
- *
- * @param pdu [out] Buffer to build the outgoing message into
- * @param max_pdu [in] Length of the pdu buffer.
- * @param device_id [in] ID of the destination device
- * @param read_access_data [in] Ptr to structure with the linked list of
- *        properties to be read.
- * @return invoke id of outgoing message, or 0 if device is not bound or no tsm available
- */
-uint8_t Send_Read_Property_Multiple_Request(
+/* both of the requests, callback NULL for the one without */
+static uint8_t rpm_send_request(
     uint8_t * pdu,
     size_t max_pdu,
-    uint32_t device_id, /* destination device */
-    BACNET_READ_ACCESS_DATA * read_access_data)
+    uint32_t device_id,
+    BACNET_READ_ACCESS_DATA * read_access_data,
+    client_async_callback callback,
+    void *context)
 {
     BACNET_ADDRESS dest;
     BACNET_ADDRESS my_address;
@@ -93,7 +87,9 @@ uint8_t Send_Read_Property_Multiple_Request(
     status = address_get_by_device(device_id, &max_apdu, &dest);
     /* is there a tsm available? */
     if (status)
-        invoke_id = tsm_next_free_invokeID();
+        invoke_id =
+            client_async_invoke_id(&dest,
+            SERVICE_CONFIRMED_READ_PROP_MULTIPLE, callback, context);
     if (invoke_id) {
         /* encode the NPDU portion of the packet */
         datalink_get_my_address(&my_address);
@@ -104,6 +100,7 @@ uint8_t Send_Read_Property_Multiple_Request(
             rpm_encode_apdu(&pdu[pdu_len], max_pdu - pdu_len, invoke_id,
             read_access_data);
         if (len <= 0) {
+            client_async_free_invoke_id(&dest, invoke_id);
             return 0;
         }
         pdu_len += len;
@@ -113,10 +110,10 @@ uint8_t Send_Read_Property_Multiple_Request(
            we have a way to check for that and update the
            max_apdu in the address binding table. */
         if ((unsigned) pdu_len < max_apdu) {
-            tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest,
-                &npci_data, &pdu[0], (uint16_t) pdu_len);
+            /* sent now, or once the device has room for it */
             bytes_sent =
-                datalink_send_pdu(&dest, &npci_data, &pdu[0], pdu_len);
+                tsm_send_confirmed_unsegmented_transaction(invoke_id, &dest,
+                &npci_data, &pdu[0], (uint16_t) pdu_len);
 #if PRINT_ENABLED
             if (bytes_sent <= 0)
                 fprintf(stderr,
@@ -124,7 +121,7 @@ uint8_t Send_Read_Property_Multiple_Request(
                     strerror(errno));
 #endif
         } else {
-            tsm_free_invoke_id(invoke_id);
+            client_async_free_invoke_id(&dest, invoke_id);
             invoke_id = 0;
 #if PRINT_ENABLED
             fprintf(stderr,
@@ -136,3 +133,50 @@ uint8_t Send_Read_Property_Multiple_Request(
 
     return invoke_id;
 }
+
+/** Sends a Read Property Multiple request.
+ * @ingroup DSRPM
+ *
+ * @param pdu [out] Buffer to build the outgoing message into
+ * @param max_pdu [in] Length of the pdu buffer.
+ * @param device_id [in] ID of the destination device
+ * @param read_access_data [in] Ptr to structure with the linked list of
+ *        properties to be read.
+ * @return invoke id of outgoing message, or 0 if device is not bound or no tsm available
+ */
+uint8_t Send_Read_Property_Multiple_Request(
+    uint8_t * pdu,
+    size_t max_pdu,
+    uint32_t device_id, /* destination device */
+    BACNET_READ_ACCESS_DATA * read_access_data)
+{
+    return rpm_send_request(pdu, max_pdu, device_id, read_access_data, NULL,
+        NULL);
+}
+
+#if ( BACNET_CLIENT == 1 )
+/** Sends a Read Property Multiple request, calling back when it is done.
+ * @ingroup DSRPM
+ *
+ * @param callback [in] Made once, for the ACK, an Error, Abort or Reject,
+ *   or the timeout. See client_async.h
+ * @param context [in] Handed to the callback.
+ * @return invoke id of outgoing message, or 0 if nothing was sent, and
+ *   there will be no callback
+ */
+uint8_t Send_Read_Property_Multiple_Request_Async(
+    uint8_t * pdu,
+    size_t max_pdu,
+    uint32_t device_id,
+    BACNET_READ_ACCESS_DATA * read_access_data,
+    client_async_callback callback,
+    void *context)
+{
+    if (callback == NULL) {
+        return 0;
+    }
+
+    return rpm_send_request(pdu, max_pdu, device_id, read_access_data,
+        callback, context);
+}
+#endif
@@ -79,6 +79,7 @@ void Send_TimeSync_Remote(
     int bytes_sent = 0;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     if (!dcc_communication_enabled())
         return;
@@ -86,22 +87,27 @@ void Send_TimeSync_Remote(
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], dest, &my_address,
+        npdu_encode_pdu(&pdu[0], dest, &my_address,
         &npci_data);
     /* encode the APDU portion of the packet */
     len =
-        timesync_encode_apdu(&Handler_Transmit_Buffer[pdu_len], bdate, btime);
+        timesync_encode_apdu(&pdu[pdu_len], bdate, btime);
     pdu_len += len;
     /* send it out the datalink */
     bytes_sent =
-        datalink_send_pdu(dest, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(dest, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr, "Failed to Send Time-Synchronization Request (%s)!\n",
             strerror(errno));
 #endif
+    txbuf_release(pdu);
 }
 
 /**
@@ -137,6 +143,7 @@ void Send_TimeSyncUTC_Remote(
     int bytes_sent = 0;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     if (!dcc_communication_enabled())
         return;
@@ -144,16 +151,20 @@ void Send_TimeSyncUTC_Remote(
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], dest, &my_address,
+        npdu_encode_pdu(&pdu[0], dest, &my_address,
         &npci_data);
     /* encode the APDU portion of the packet */
     len =
-        timesync_utc_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        timesync_utc_encode_apdu(&pdu[pdu_len],
         bdate, btime);
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(dest, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(dest, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
@@ -161,6 +172,7 @@ void Send_TimeSyncUTC_Remote(
             "Failed to Send UTC-Time-Synchronization Request (%s)!\n",
             strerror(errno));
 #endif
+    txbuf_release(pdu);
 }
 
 /**
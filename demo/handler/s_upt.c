@@ -68,6 +68,7 @@ int Send_UnconfirmedPrivateTransfer(
     int bytes_sent = 0;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     if (!dcc_communication_enabled())
         return bytes_sent;
@@ -75,17 +76,21 @@ int Send_UnconfirmedPrivateTransfer(
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], dest, &my_address,
+        npdu_encode_pdu(&pdu[0], dest, &my_address,
         &npci_data);
 
     /* encode the APDU portion of the packet */
     len =
-        uptransfer_encode_apdu(&Handler_Transmit_Buffer[pdu_len],
+        uptransfer_encode_apdu(&pdu[pdu_len],
         private_data);
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(dest, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(dest, &npci_data, &pdu[0],
         pdu_len);
     if (bytes_sent <= 0) {
 #if PRINT_ENABLED
@@ -95,5 +100,6 @@ int Send_UnconfirmedPrivateTransfer(
 #endif
     }
 
+    txbuf_release(pdu);
     return bytes_sent;
 }
@@ -82,6 +82,7 @@ void Send_WhoHas_Name(
     BACNET_WHO_HAS_DATA data;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     /* if we are forbidden to send, don't send! */
     if (!dcc_communication_enabled())
@@ -91,8 +92,12 @@ void Send_WhoHas_Name(
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], &dest, &my_address,
+        npdu_encode_pdu(&pdu[0], &dest, &my_address,
         &npci_data);
 
     /* encode the APDU portion of the packet */
@@ -100,12 +105,13 @@ void Send_WhoHas_Name(
     data.high_limit = high_limit;
     data.is_object_name = true;
     characterstring_init_ansi(&data.object.name, object_name);
-    len = whohas_encode_apdu(&Handler_Transmit_Buffer[pdu_len], &data);
+    len = whohas_encode_apdu(&pdu[pdu_len], &data);
     pdu_len += len;
     /* send the data */
     bytes_sent =
-        datalink_send_pdu(&dest, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(&dest, &npci_data, &pdu[0],
         pdu_len);
+    txbuf_release(pdu);
 }
 
 /** Send a Who-Has request for a device which has a specific Object type and ID.
@@ -132,6 +138,7 @@ void Send_WhoHas_Object(
     BACNET_WHO_HAS_DATA data;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     /* if we are forbidden to send, don't send! */
     if (!dcc_communication_enabled())
@@ -141,8 +148,12 @@ void Send_WhoHas_Object(
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], &dest, &my_address,
+        npdu_encode_pdu(&pdu[0], &dest, &my_address,
         &npci_data);
 
     /* encode the APDU portion of the packet */
@@ -151,14 +162,15 @@ void Send_WhoHas_Object(
     data.is_object_name = false;
     data.object.identifier.type = object_type;
     data.object.identifier.instance = object_instance;
-    len = whohas_encode_apdu(&Handler_Transmit_Buffer[pdu_len], &data);
+    len = whohas_encode_apdu(&pdu[pdu_len], &data);
     pdu_len += len;
     bytes_sent =
-        datalink_send_pdu(&dest, &npci_data, &Handler_Transmit_Buffer[0],
+        datalink_send_pdu(&dest, &npci_data, &pdu[0],
         pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr, "Failed to Send Who-Has Request (%s)!\n",
             strerror(errno));
 #endif
+    txbuf_release(pdu);
 }
@@ -81,27 +81,33 @@ void Send_WhoIs_To_Network(
     int bytes_sent = 0;
     BACNET_NPCI_DATA npci_data;
     BACNET_ADDRESS my_address;
+    uint8_t *pdu = NULL;
 
     datalink_get_my_address(&my_address);
     /* encode the NPDU portion of the packet */
     npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
 
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return;
+    }
     pdu_len =
-        npdu_encode_pdu(&Handler_Transmit_Buffer[0], target_address,
+        npdu_encode_pdu(&pdu[0], target_address,
         &my_address, &npci_data);
     /* encode the APDU portion of the packet */
     len =
-        whois_encode_apdu(&Handler_Transmit_Buffer[pdu_len], low_limit,
+        whois_encode_apdu(&pdu[pdu_len], low_limit,
         high_limit);
     pdu_len += len;
     bytes_sent =
         datalink_send_pdu(target_address, &npci_data,
-        &Handler_Transmit_Buffer[0], pdu_len);
+        &pdu[0], pdu_len);
 #if PRINT_ENABLED
     if (bytes_sent <= 0)
         fprintf(stderr, "Failed to Send Who-Is Request (%s)!\n",
             strerror(errno));
 #endif
+    txbuf_release(pdu);
 }
 
 /** Send a global Who-Is request for a specific device, a range, or any device.
@@ -47,11 +47,12 @@
 #include "handlers.h"
 #include "txbuf.h"
 #include "client.h"
+#include "client_async.h"
 
 /** @file s_wp.c  Send a Write Property request. */
 
-/** returns the invoke ID for confirmed request, or zero on failure */
-uint8_t Send_Write_Property_Request_Data(
+/* both of the requests, callback NULL for the one without */
+static uint8_t wp_send_request(
     uint32_t device_id,
     BACNET_OBJECT_TYPE object_type,
     uint32_t object_instance,
@@ -59,7 +60,9 @@ uint8_t Send_Write_Property_Request_Data(
     uint8_t * application_data,
     int application_data_len,
     uint8_t priority,
-    uint32_t array_index)
+    uint32_t array_index,
+    client_async_callback callback,
+    void *context)
 {
     BACNET_ADDRESS dest;
     BACNET_ADDRESS my_address;
@@ -71,21 +74,28 @@ uint8_t Send_Write_Property_Request_Data(
     int bytes_sent = 0;
     BACNET_WRITE_PROPERTY_DATA data;
     BACNET_NPCI_DATA npci_data;
+    uint8_t *pdu = NULL;
 
     if (!dcc_communication_enabled())
         return 0;
 
     /* is the device bound? */
     status = address_get_by_device(device_id, &max_apdu, &dest);
+    pdu = txbuf_acquire();
+    if (pdu == NULL) {
+        return 0;
+    }
     /* is there a tsm available? */
     if (status)
-        invoke_id = tsm_next_free_invokeID();
+        invoke_id =
+            client_async_invoke_id(&dest, SERVICE_CONFIRMED_WRITE_PROPERTY,
+            callback, context);
     if (invoke_id) {
         /* encode the NPDU portion of the packet */
         datalink_get_my_address(&my_address);
         npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
         pdu_len =
-            npdu_encode_pdu(&Handler_Transmit_Buffer[0], &dest, &my_address,
+            npdu_encode_pdu(&pdu[0], &dest, &my_address,
             &npci_data);
         /* encode the APDU portion of the packet */
         data.object_type = object_type;
@@ -97,7 +107,7 @@ uint8_t Send_Write_Property_Request_Data(
             application_data_len);
         data.priority = priority;
         len =
-            wp_encode_apdu(&Handler_Transmit_Buffer[pdu_len], invoke_id,
+            wp_encode_apdu(&pdu[pdu_len], invoke_id,
             &data);
         pdu_len += len;
         /* will it fit in the sender?
@@ -106,18 +116,17 @@ uint8_t Send_Write_Property_Request_Data(
            we have a way to check for that and update the
            max_apdu in the address binding table. */
         if ((unsigned) pdu_len < max_apdu) {
-            tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest,
-                &npci_data, &Handler_Transmit_Buffer[0], (uint16_t) pdu_len);
+            /* sent now, or once the device has room for it */
             bytes_sent =
-                datalink_send_pdu(&dest, &npci_data,
-                &Handler_Transmit_Buffer[0], pdu_len);
+                tsm_send_confirmed_unsegmented_transaction(invoke_id, &dest,
+                &npci_data, &pdu[0], (uint16_t) pdu_len);
 #if PRINT_ENABLED
             if (bytes_sent <= 0)
                 fprintf(stderr, "Failed to Send WriteProperty Request (%s)!\n",
                     strerror(errno));
 #endif
         } else {
-            tsm_free_invoke_id(invoke_id);
+            client_async_free_invoke_id(&dest, invoke_id);
             invoke_id = 0;
 #if PRINT_ENABLED
             fprintf(stderr,
@@ -127,9 +136,26 @@ uint8_t Send_Write_Property_Request_Data(
         }
     }
 
+    txbuf_release(pdu);
     return invoke_id;
 }
 
+/** returns the invoke ID for confirmed request, or zero on failure */
+uint8_t Send_Write_Property_Request_Data(
+    uint32_t device_id,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint8_t * application_data,
+    int application_data_len,
+    uint8_t priority,
+    uint32_t array_index)
+{
+    return wp_send_request(device_id, object_type, object_instance,
+        object_property, application_data, application_data_len, priority,
+        array_index, NULL, NULL);
+}
+
 
 /** Sends a Write Property request.
  * @ingroup DSWP
@@ -179,3 +205,67 @@ uint8_t Send_Write_Property_Request(
         object_instance, object_property, &application_data[0], apdu_len,
         priority, array_index);
 }
+
+#if ( BACNET_CLIENT == 1 )
+/** As Send_Write_Property_Request_Data(), calling back when it is done.
+ * @ingroup DSWP
+ *
+ * @param callback [in] Made once, for the SimpleACK, an Error, Abort or
+ *   Reject, or the timeout. See client_async.h
+ * @param context [in] Handed to the callback.
+ * @return invoke id of outgoing message, or 0 if nothing was sent, and
+ *   there will be no callback
+ */
+uint8_t Send_Write_Property_Request_Data_Async(
+    uint32_t device_id,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    uint8_t * application_data,
+    int application_data_len,
+    uint8_t priority,
+    uint32_t array_index,
+    client_async_callback callback,
+    void *context)
+{
+    if (callback == NULL) {
+        return 0;
+    }
+
+    return wp_send_request(device_id, object_type, object_instance,
+        object_property, application_data, application_data_len, priority,
+        array_index, callback, context);
+}
+
+/** As Send_Write_Property_Request(), calling back when it is done.
+ * @ingroup DSWP
+ */
+uint8_t Send_Write_Property_Request_Async(
+    uint32_t device_id,
+    BACNET_OBJECT_TYPE object_type,
+    uint32_t object_instance,
+    BACNET_PROPERTY_ID object_property,
+    BACNET_APPLICATION_DATA_VALUE * object_value,
+    uint8_t priority,
+    uint32_t array_index,
+    client_async_callback callback,
+    void *context)
+{
+    uint8_t application_data[MAX_APDU] = { 0 };
+    int apdu_len = 0, len = 0;
+
+    while (object_value) {
+        len = bacapp_encode_data(&application_data[apdu_len], object_value);
+        if ((len + apdu_len) < MAX_APDU) {
+            apdu_len += len;
+        } else {
+            return 0;
+        }
+        object_value = object_value->next;
+    }
+
+    return Send_Write_Property_Request_Data_Async(device_id, object_type,
+        object_instance, object_property, &application_data[0], apdu_len,
+        priority, array_index, callback, context);
+}
+#endif
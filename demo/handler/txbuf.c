@@ -39,9 +39,249 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include "config.h"
 #include "datalink.h"
+#include "txbuf.h"
+#include "osLayer.h"
 
-/** @file txbuf.c  Declare the global Transmit Buffer for handler functions. */
+/** @file txbuf.c  Transmit buffers for the handler functions.
+ *
+ * Each handler takes a buffer from the pool for the request it is working
+ * on and gives it back when the reply has been sent, so two threads can
+ * build replies at the same time. The TSM keeps its own copy of anything it
+ * may have to resend, so a buffer is never needed after the handler returns.
+ */
 
+#if (BACNET_GLOBAL_TX_BUFFER == 1)
 uint8_t Handler_Transmit_Buffer[MAX_PDU] = { 0 };
+#endif
+
+static uint8_t Tx_Buffers[MAX_TX_BUFFERS][MAX_PDU];
+static bool Tx_Buffer_In_Use[MAX_TX_BUFFERS];
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+/* for replies that the TSM may have to segment: room for the whole reply */
+static uint8_t Tx_Segmented_Buffers[MAX_TX_SEGMENTED_BUFFERS]
+    [TXBUF_SEGMENTED_SIZE];
+static bool Tx_Segmented_Buffer_In_Use[MAX_TX_SEGMENTED_BUFFERS];
+#endif
+
+static RwLockDefine(Tx_Lock);
+
+
+void txbuf_init(
+    void)
+{
+    RwLockInit(Tx_Lock);
+}
+
+
+static uint8_t *txbuf_take(
+    uint8_t * buffers,
+    bool * in_use,
+    unsigned count,
+    size_t size)
+{
+    uint8_t *pdu = NULL;
+    unsigned i;
+
+    RwLockWrite(Tx_Lock);
+    for (i = 0; i < count; i++) {
+        if (!in_use[i]) {
+            in_use[i] = true;
+            pdu = &buffers[i * size];
+            break;
+        }
+    }
+    RwUnlockWrite(Tx_Lock);
+
+    return pdu;
+}
+
+
+static bool txbuf_give(
+    uint8_t * pdu,
+    uint8_t * buffers,
+    bool * in_use,
+    unsigned count,
+    size_t size)
+{
+    size_t offset;
+
+    if ((pdu < buffers) || (pdu >= &buffers[count * size])) {
+        return false;
+    }
+    offset = (size_t) (pdu - buffers);
+    if ((offset % size) == 0) {
+        RwLockWrite(Tx_Lock);
+        in_use[offset / size] = false;
+        RwUnlockWrite(Tx_Lock);
+    }
+
+    return true;
+}
+
+
+uint8_t *txbuf_acquire(
+    void)
+{
+    return txbuf_take(&Tx_Buffers[0][0], &Tx_Buffer_In_Use[0],
+        MAX_TX_BUFFERS, MAX_PDU);
+}
+
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+uint8_t *txbuf_acquire_segmented(
+    void)
+{
+    return txbuf_take(&Tx_Segmented_Buffers[0][0],
+        &Tx_Segmented_Buffer_In_Use[0], MAX_TX_SEGMENTED_BUFFERS,
+        TXBUF_SEGMENTED_SIZE);
+}
+#endif
+
+
+void txbuf_release(
+    uint8_t * pdu)
+{
+    if (pdu == NULL) {
+        return;
+    }
+    if (txbuf_give(pdu, &Tx_Buffers[0][0], &Tx_Buffer_In_Use[0],
+            MAX_TX_BUFFERS, MAX_PDU)) {
+        return;
+    }
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    (void) txbuf_give(pdu, &Tx_Segmented_Buffers[0][0],
+        &Tx_Segmented_Buffer_In_Use[0], MAX_TX_SEGMENTED_BUFFERS,
+        TXBUF_SEGMENTED_SIZE);
+#endif
+}
+
+
+unsigned txbuf_in_use(
+    void)
+{
+    unsigned count = 0;
+    unsigned i;
+
+    RwLockRead(Tx_Lock);
+    for (i = 0; i < MAX_TX_BUFFERS; i++) {
+        if (Tx_Buffer_In_Use[i]) {
+            count++;
+        }
+    }
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    for (i = 0; i < MAX_TX_SEGMENTED_BUFFERS; i++) {
+        if (Tx_Segmented_Buffer_In_Use[i]) {
+            count++;
+        }
+    }
+#endif
+    RwUnlockRead(Tx_Lock);
+
+    return count;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <string.h>
+
+#include "ctest.h"
+
+void testTxBufPool(
+    Test * pTest)
+{
+    uint8_t *pdu[MAX_TX_BUFFERS];
+    unsigned i, j;
+
+    txbuf_init();
+    ct_test(pTest, txbuf_in_use() == 0);
+    for (i = 0; i < MAX_TX_BUFFERS; i++) {
+        pdu[i] = txbuf_acquire();
+        ct_test(pTest, pdu[i] != NULL);
+        for (j = 0; j < i; j++) {
+            ct_test(pTest, pdu[i] != pdu[j]);
+        }
+        /* the whole buffer is ours */
+        memset(pdu[i], (int) i, MAX_PDU);
+    }
+    ct_test(pTest, txbuf_in_use() == MAX_TX_BUFFERS);
+    /* exhausted */
+    ct_test(pTest, txbuf_acquire() == NULL);
+    for (i = 0; i < MAX_TX_BUFFERS; i++) {
+        ct_test(pTest, pdu[i][0] == (uint8_t) i);
+        ct_test(pTest, pdu[i][MAX_PDU - 1] == (uint8_t) i);
+    }
+    /* the one given back is the one handed out next */
+    txbuf_release(pdu[1]);
+    ct_test(pTest, txbuf_in_use() == (MAX_TX_BUFFERS - 1));
+    ct_test(pTest, txbuf_acquire() == pdu[1]);
+    /* NULL and foreign pointers are ignored */
+    txbuf_release(NULL);
+    txbuf_release((uint8_t *) & i);
+    txbuf_release(&pdu[0][1]);
+    ct_test(pTest, txbuf_in_use() == MAX_TX_BUFFERS);
+    for (i = 0; i < MAX_TX_BUFFERS; i++) {
+        txbuf_release(pdu[i]);
+    }
+    ct_test(pTest, txbuf_in_use() == 0);
+}
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+void testTxBufSegmented(
+    Test * pTest)
+{
+    uint8_t *pdu[MAX_TX_SEGMENTED_BUFFERS];
+    uint8_t *small;
+    unsigned i;
+
+    txbuf_init();
+    small = txbuf_acquire();
+    ct_test(pTest, small != NULL);
+    for (i = 0; i < MAX_TX_SEGMENTED_BUFFERS; i++) {
+        pdu[i] = txbuf_acquire_segmented();
+        ct_test(pTest, pdu[i] != NULL);
+        ct_test(pTest, pdu[i] != small);
+        memset(pdu[i], 0x55, TXBUF_SEGMENTED_SIZE);
+    }
+    ct_test(pTest, txbuf_acquire_segmented() == NULL);
+    ct_test(pTest, txbuf_in_use() == (MAX_TX_SEGMENTED_BUFFERS + 1));
+    /* the small pool is separate */
+    ct_test(pTest, small[0] != 0x55);
+    txbuf_release(small);
+    for (i = 0; i < MAX_TX_SEGMENTED_BUFFERS; i++) {
+        txbuf_release(pdu[i]);
+    }
+    ct_test(pTest, txbuf_in_use() == 0);
+}
+#endif
+
+#ifdef TEST_TXBUF
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Transmit Buffers", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testTxBufPool);
+    assert(rc);
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    rc = ct_addTestFunction(pTest, testTxBufSegmented);
+    assert(rc);
+#endif
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_TXBUF */
+#endif /* TEST */
@@ -59,9 +59,11 @@
 #include "bitsDebug.h"
 #include "llist.h"
 #include "emm.h"
+#include "BACnetSnapshot.h"
 
 // ANALOG_INPUT_DESCR AI_Descr[MAX_ANALOG_INPUTS];
 LLIST_HDR AI_Descriptor_List;
+static EMM_SLAB AI_Slab;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 
@@ -133,7 +135,9 @@ void Analog_Input_Property_Lists(
 void Analog_Input_Init(
     void)
 {
-    ll_Init(&AI_Descriptor_List, 100);
+    Generic_Object_List_Init(&AI_Descriptor_List, 100);
+    emm_slab_init(&AI_Slab, sizeof(ANALOG_INPUT_DESCR), 32);
+    Snapshot_Register_Type(OBJECT_ANALOG_INPUT, &AI_Descriptor_List, &AI_Slab, sizeof(ANALOG_INPUT_DESCR), NULL);
 
 #if (INTRINSIC_REPORTING_B == 1)
 
@@ -161,18 +165,22 @@ bool Analog_Input_Create(
     const uint32_t instance,
     const char *name)
 {
-    ANALOG_INPUT_DESCR *currentObject = (ANALOG_INPUT_DESCR *)emm_scalloc('a', sizeof(ANALOG_INPUT_DESCR));
+    ANALOG_INPUT_DESCR *currentObject = (ANALOG_INPUT_DESCR *)emm_slab_calloc(&AI_Slab);
     if (currentObject == NULL) {
         panic();
         return false;
     }
+    // the instance index is keyed on objectInstance, so this has to precede ll_Enqueue()
+    Generic_Object_Init(&currentObject->common, OBJECT_ANALOG_INPUT, instance, name);
+
     if (!ll_Enqueue(&AI_Descriptor_List, currentObject)) {
+        // list full, or the instance already exists
+        Generic_Object_Name_Remove(&currentObject->common);
+        emm_slab_free(&AI_Slab, currentObject);
         panic();
         return false;
     }
 
-    Generic_Object_Init(&currentObject->common, instance, name);
-
     currentObject->Present_Value = 0.0f;
     currentObject->Out_Of_Service = false;
     currentObject->Units = UNITS_PERCENT;
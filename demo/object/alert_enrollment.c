@@ -39,7 +39,7 @@
 #include "device.h"
 #include "event.h"
 #include "handlers.h"
-// #include "txbuf.h"
+#include "txbuf.h"
 #include "wp.h"
 #include "alert_enrollment.h"
 
@@ -893,6 +893,7 @@ void Alert_Enrollment_Class_common_reporting_function(
             BACNET_ADDRESS dest;
             uint32_t device_id;
             unsigned max_apdu;
+            uint8_t *pdu = NULL;
 
             /* Process Identifier */
             event_data->processIdentifier = pBacDest->ProcessIdentifier;
@@ -904,9 +905,13 @@ void Alert_Enrollment_Class_common_reporting_function(
 
                 if (pBacDest->ConfirmedNotify == true)
                     Send_CEvent_Notify(device_id, event_data);
-                else if (address_get_by_device(device_id, &max_apdu, &dest))
-                    Send_UEvent_Notify(Handler_Transmit_Buffer, event_data,
-                        &dest);
+                else if (address_get_by_device(device_id, &max_apdu, &dest)) {
+                    pdu = txbuf_acquire();
+                    if (pdu != NULL) {
+                        Send_UEvent_Notify(pdu, event_data, &dest);
+                        txbuf_release(pdu);
+                    }
+                }
             } else if (pBacDest->Recipient.RecipientType ==
                 RECIPIENT_TYPE_ADDRESS) {
                 /* send alert_enrollment to the address indicated */
@@ -915,8 +920,11 @@ void Alert_Enrollment_Class_common_reporting_function(
                         Send_CEvent_Notify(device_id, event_data);
                 } else {
                     dest = pBacDest->Recipient._.Address;
-                    Send_UEvent_Notify(Handler_Transmit_Buffer, event_data,
-                                       &dest);
+                    pdu = txbuf_acquire();
+                    if (pdu != NULL) {
+                        Send_UEvent_Notify(pdu, event_data, &dest);
+                        txbuf_release(pdu);
+                    }
                 }
             }
         }
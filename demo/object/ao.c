@@ -56,6 +56,7 @@
 #include "bitsDebug.h"
 #include "llist.h"
 #include "emm.h"
+#include "BACnetSnapshot.h"
 #include "device.h"
 
 #if 0
@@ -85,6 +86,7 @@ static bool Analog_Output_Initialized = false;
 
 
 LLIST_HDR AO_Descriptor_List;
+static EMM_SLAB AO_Slab;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 
@@ -138,18 +140,22 @@ bool Analog_Output_Create(
     const uint32_t instance,
     const char *name)
 {
-    ANALOG_OUTPUT_DESCR *currentObject = (ANALOG_OUTPUT_DESCR *)emm_smalloc('a', sizeof(ANALOG_OUTPUT_DESCR));
+    ANALOG_OUTPUT_DESCR *currentObject = (ANALOG_OUTPUT_DESCR *)emm_slab_calloc(&AO_Slab);
     if (currentObject == NULL) {
         panic();
         return false;
     }
+    // the instance index is keyed on objectInstance, so this has to precede ll_Enqueue()
+    Generic_Object_Init(&currentObject->common, OBJECT_ANALOG_OUTPUT, instance, name);
+
     if (!ll_Enqueue(&AO_Descriptor_List, currentObject)) {
+        // list full, or the instance already exists
+        Generic_Object_Name_Remove(&currentObject->common);
+        emm_slab_free(&AO_Slab, currentObject);
         panic();
         return false;
     }
 
-    Generic_Object_Init(&currentObject->common, instance, name);
-
     currentObject->Present_Value = 0.0f;
     currentObject->Out_Of_Service = false;
     currentObject->Units = UNITS_PERCENT;
@@ -201,7 +207,9 @@ void Analog_Output_Init(
     unsigned j;
 #endif
 
-    ll_Init(&AO_Descriptor_List, 100);
+    Generic_Object_List_Init(&AO_Descriptor_List, 100);
+    emm_slab_init(&AO_Slab, sizeof(ANALOG_OUTPUT_DESCR), 32);
+    Snapshot_Register_Type(OBJECT_ANALOG_OUTPUT, &AO_Descriptor_List, &AO_Slab, sizeof(ANALOG_OUTPUT_DESCR), NULL);
 
 #if (INTRINSIC_REPORTING_B2 == 1)
 
@@ -58,6 +58,7 @@
 #include "bitsDebug.h"
 #include "llist.h"
 #include "emm.h"
+#include "BACnetSnapshot.h"
 #include "BACnetObject.h"
 
 #if (INTRINSIC_REPORTING_B == 1)
@@ -66,6 +67,7 @@
 #endif
 
 LLIST_HDR AV_Descriptor_List;
+static EMM_SLAB AV_Slab;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 
@@ -100,6 +102,9 @@ static const BACNET_PROPERTY_ID Properties_Optional[] = {
     PROP_ACKED_TRANSITIONS,
     PROP_NOTIFY_TYPE,
     PROP_EVENT_TIME_STAMPS,
+#endif
+#if ( BACNET_PROTOCOL_REVISION >= 14 )
+    PROP_EVENT_DETECTION_ENABLE,
 #endif
     MAX_BACNET_PROPERTY_ID
 };
@@ -115,18 +120,22 @@ bool Analog_Value_Create(
     const char *name,
     const BACNET_ENGINEERING_UNITS units)
 {
-    ANALOG_VALUE_DESCR *currentObject = (ANALOG_VALUE_DESCR *)emm_smalloc('a', sizeof(ANALOG_VALUE_DESCR));
+    ANALOG_VALUE_DESCR *currentObject = (ANALOG_VALUE_DESCR *)emm_slab_calloc(&AV_Slab);
     if (currentObject == NULL) {
         panic();
         return false;
     }
+    // the instance index is keyed on objectInstance, so this has to precede ll_Enqueue()
+    Generic_Object_Init(&currentObject->common, OBJECT_ANALOG_VALUE, instance, name);
+
     if (!ll_Enqueue(&AV_Descriptor_List, currentObject)) {
+        // list full, or the instance already exists
+        Generic_Object_Name_Remove(&currentObject->common);
+        emm_slab_free(&AV_Slab, currentObject);
         panic();
         return false;
     }
 
-    Generic_Object_Init(&currentObject->common, instance, name);
-
     currentObject->Present_Value = BINARY_ACTIVE ;
     currentObject->Out_Of_Service = false;
     currentObject->Reliability = RELIABILITY_NO_FAULT_DETECTED;
@@ -184,7 +193,9 @@ void Analog_Value_Init(
         Analog_Value_Alarm_Summary);
 #endif
 
-    ll_Init(&AV_Descriptor_List, 100);
+    Generic_Object_List_Init(&AV_Descriptor_List, 100);
+    emm_slab_init(&AV_Slab, sizeof(ANALOG_VALUE_DESCR), 32);
+    Snapshot_Register_Type(OBJECT_ANALOG_VALUE, &AV_Descriptor_List, &AV_Slab, sizeof(ANALOG_VALUE_DESCR), NULL);
 }
 
 
@@ -523,12 +534,11 @@ int Analog_Value_Read_Property(
 #if ( BACNET_PROTOCOL_REVISION >= 14 )
     case PROP_EVENT_DETECTION_ENABLE:
 #if ( INTRINSIC_REPORTING_B == 1 )
-        apdu_len =
-            encode_application_enumerated(&apdu[0], true);
+        apdu_len = encode_application_boolean(&apdu[0], true);
 #else
-        apdu_len =
-            encode_application_enumerated(&apdu[0], false);
+        apdu_len = encode_application_boolean(&apdu[0], false);
 #endif
+        break;
 #endif
 
     case PROP_RELIABILITY:
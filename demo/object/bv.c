@@ -58,9 +58,11 @@
 #include "bitsDebug.h"
 #include "llist.h"
 #include "emm.h"
+#include "BACnetSnapshot.h"
 #include "BACnetObject.h"
 
 LLIST_HDR BV_Descriptor_List;
+static EMM_SLAB BV_Slab;
 
 /* These three arrays are used by the ReadPropertyMultiple handler */
 
@@ -113,18 +115,22 @@ bool Binary_Value_Create(
     const uint32_t instance,
     const char *name)
 {
-    BINARY_VALUE_DESCR *currentObject = (BINARY_VALUE_DESCR *)emm_scalloc('a', sizeof(BINARY_VALUE_DESCR));
+    BINARY_VALUE_DESCR *currentObject = (BINARY_VALUE_DESCR *)emm_slab_calloc(&BV_Slab);
     if (currentObject == NULL) {
         panic();
         return false;
     }
+    // the instance index is keyed on objectInstance, so this has to precede ll_Enqueue()
+    Generic_Object_Init(&currentObject->common, OBJECT_BINARY_VALUE, instance, name);
+
     if (!ll_Enqueue(&BV_Descriptor_List, currentObject)) {
+        // list full, or the instance already exists
+        Generic_Object_Name_Remove(&currentObject->common);
+        emm_slab_free(&BV_Slab, currentObject);
         panic();
         return false;
     }
 
-    Generic_Object_Init(&currentObject->common, instance, name);
-
     currentObject->Present_Value = BINARY_ACTIVE;
     currentObject->Out_Of_Service = false;
     currentObject->Reliability = RELIABILITY_NO_FAULT_DETECTED;
@@ -176,7 +182,9 @@ void Binary_Value_Init(
     unsigned j;
 #endif
 
-    ll_Init(&BV_Descriptor_List, 100);
+    Generic_Object_List_Init(&BV_Descriptor_List, 100);
+    emm_slab_init(&BV_Slab, sizeof(BINARY_VALUE_DESCR), 32);
+    Snapshot_Register_Type(OBJECT_BINARY_VALUE, &BV_Descriptor_List, &BV_Slab, sizeof(BINARY_VALUE_DESCR), NULL);
 
 #if (INTRINSIC_REPORTING_B2 == 1)
 
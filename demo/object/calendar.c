@@ -27,10 +27,12 @@
 #include "bitsDebug.h"
 #include "llist.h"
 #include "emm.h"
+#include "BACnetSnapshot.h"
 #include "bacdcode.h"
 #include "proplist.h"
 
 LLIST_HDR Calendar_Descriptor_List;
+static EMM_SLAB Calendar_Slab;
 
 int encode_calendar_entry(uint8_t *apdu, BACNET_CALENDAR_ENTRY *ev)
 {
@@ -110,18 +112,22 @@ bool Calendar_Create(
     const uint32_t instance,
     const char *name)
 {
-    CALENDAR_DESCR *currentObject = (CALENDAR_DESCR *)emm_scalloc('a', sizeof(CALENDAR_DESCR));
+    CALENDAR_DESCR *currentObject = (CALENDAR_DESCR *)emm_slab_calloc(&Calendar_Slab);
     if (currentObject == NULL) {
         panic();
         return false;
     }
+    // the instance index is keyed on objectInstance, so this has to precede ll_Enqueue()
+    Generic_Object_Init(&currentObject->common, OBJECT_CALENDAR, instance, name);
+
     if (!ll_Enqueue(&Calendar_Descriptor_List, currentObject)) {
+        // list full, or the instance already exists
+        Generic_Object_Name_Remove(&currentObject->common);
+        emm_slab_free(&Calendar_Slab, currentObject);
         panic();
         return false;
     }
 
-    Generic_Object_Init(&currentObject->common, instance, name);
-
     for (int i = 0; i < MAX_CALENDAR_EVENTS; i++) {
         currentObject->calendar[i].tag = CALENDAR_ENTRY_NONE;
     }
@@ -149,7 +155,9 @@ void Calendar_Property_Lists(
 void Calendar_Init(
     void)
 {
-    ll_Init(&Calendar_Descriptor_List, 100);
+    Generic_Object_List_Init(&Calendar_Descriptor_List, 100);
+    emm_slab_init(&Calendar_Slab, sizeof(CALENDAR_DESCR), 32);
+    Snapshot_Register_Type(OBJECT_CALENDAR, &Calendar_Descriptor_List, &Calendar_Slab, sizeof(CALENDAR_DESCR), NULL);
 }
 
 
@@ -428,7 +436,7 @@ static int rr_date_list(
     bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_MORE_ITEMS, false);
     /* See how much space we have */
 
-    uiRemaining = (uint32_t)(MAX_APDU - pRequest->Overhead);
+    uiRemaining = (uint32_t)(pRequest->MaxApdu - pRequest->Overhead);
 
     pRequest->ItemCount = 0;              /* Start out with nothing */
 
@@ -1255,7 +1255,7 @@ static bool Channel_Write_Members(
                     sizeof(wp_data.application_data);
                 status = Channel_Write_Member_Value(&wp_data, value);
                 if (status) {
-                    status = Device_Write_Property(&wp_data);
+                    status = Device_Write_Property_Locked(&wp_data);
                 } else {
                     pChannel->Write_Status = BACNET_WRITE_STATUS_FAILED;
                 }
@@ -36,6 +36,7 @@
 #include "rp.h"
 #include "wp.h"
 #include "csv.h"
+#include "propertyCache.h"
 #include "handlers.h"
 
 /* number of demo objects */
@@ -238,6 +239,12 @@ bool CharacterString_Value_Description_Set(
         }
     }
 
+#if (BACNET_PROPERTY_CACHE == 1)
+    if (status) {
+        pc_InvalidateObject(OBJECT_CHARACTERSTRING_VALUE, object_instance);
+    }
+#endif
+
     return status;
 }
 
@@ -301,6 +308,12 @@ bool CharacterString_Value_Name_Set(
         }
     }
 
+#if (BACNET_PROPERTY_CACHE == 1)
+    if (status) {
+        pc_InvalidateObject(OBJECT_CHARACTERSTRING_VALUE, object_instance);
+    }
+#endif
+
     return status;
 }
 
@@ -51,6 +51,7 @@ Questions regarding this can be directed to: info@connect-ex.com
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>     /* for malloc */
 #include <string.h>     /* for memmove */
 #include <time.h>       /* for timezone, localtime */
 #include "bacdef.h"
@@ -119,6 +120,10 @@ Questions regarding this can be directed to: info@connect-ex.com
 #if (BACFILE == 1)
 #include "bacfile.h"
 #endif /* defined(BACFILE) */
+#include "BACnetObject.h"
+#include "propertyCache.h"
+#include "txbuf.h"
+#include "bacnet_lock.h"
 #include "bitsDebug.h"
 #include "bactext.h"
 
@@ -146,6 +151,18 @@ extern const char *BACnet_Version;
 /* may be overridden by outside table */
 static object_functions_t *Object_Table;
 
+/* Object_Table entries indexed by object type, built by Device_Init() so that
+   Device_Objects_Find_Functions() is a single array access */
+static object_functions_t *Object_Type_Table[MAX_BACNET_OBJECT_TYPE];
+
+/* The counted property lists and membership bitmap of each type in
+   Object_Type_Table that has an Object_RPM_List, also built by Device_Init() */
+static BACNET_PROPERTY_SET *Object_Property_Sets[MAX_BACNET_OBJECT_TYPE];
+
+/* the objects, read locked by the Device_ functions that look at them and
+   write locked by those that change them */
+BACNET_RWLOCK_DEFINE(Object_Store_Lock);
+
 static object_functions_t My_Object_Table[] =
 {
     {
@@ -973,18 +990,27 @@ static object_functions_t My_Object_Table[] =
 static struct object_functions *Device_Objects_Find_Functions(
     BACNET_OBJECT_TYPE Object_Type)
 {
-    struct object_functions *pObject;
+    if ((unsigned)Object_Type >= MAX_BACNET_OBJECT_TYPE) {
+        return (NULL);
+    }
 
-    pObject = Object_Table;
-    while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
-        /* handle each object type */
-        if (pObject->Object_Type == Object_Type) {
-            return (pObject);
-        }
-        pObject++;
+    return (Object_Type_Table[Object_Type]);
+}
+
+/** The precomputed property lists and membership of an object type.
+ * @ingroup ObjIntf
+ * @param Object_Type [in] The type of BACnet Object.
+ * @return The object type's property set, or NULL if the type is unknown or
+ *         does not list its properties (then any property may be tried).
+ */
+const BACNET_PROPERTY_SET *Device_Objects_Property_Set(
+    BACNET_OBJECT_TYPE Object_Type)
+{
+    if ((unsigned)Object_Type >= MAX_BACNET_OBJECT_TYPE) {
+        return (NULL);
     }
 
-    return (NULL);
+    return (Object_Property_Sets[Object_Type]);
 }
 
 /** Try to find a rr_info_function helper function for the requested object type.
@@ -1024,8 +1050,15 @@ void Device_Objects_Property_List(
     struct special_property_list_t *pPropertyList)
 {
     struct object_functions *pObject = NULL;
+    const BACNET_PROPERTY_SET *pSet = NULL;
 
     (void)object_instance;
+    pSet = Device_Objects_Property_Set(object_type);
+    if (pSet != NULL) {
+        /* counted once at startup */
+        *pPropertyList = pSet->Lists;
+        return;
+    }
     pPropertyList->Required.pList = NULL;
     pPropertyList->Optional.pList = NULL;
     pPropertyList->Proprietary.pList = NULL;
@@ -1130,6 +1163,10 @@ static const BACNET_PROPERTY_ID Device_Properties_Required[] = {
     PROP_NUMBER_OF_APDU_RETRIES,
     PROP_DEVICE_ADDRESS_BINDING,
     PROP_DATABASE_REVISION,
+#if (BACNET_SEGMENTATION_TRANSMIT == 1) || (BACNET_SEGMENTATION_RECEIVE == 1)
+    PROP_MAX_SEGMENTS_ACCEPTED,
+    PROP_APDU_SEGMENT_TIMEOUT,
+#endif
     MAX_BACNET_PROPERTY_ID
 };
 
@@ -1523,7 +1560,13 @@ uint8_t Device_Protocol_Revision(
 BACNET_SEGMENTATION Device_Segmentation_Supported(
     void)
 {
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    /* not BOTH, even with BACNET_SEGMENTATION_RECEIVE: that only covers
+       the ACKs to our own requests */
+    return SEGMENTATION_TRANSMIT;
+#else
     return SEGMENTATION_NONE;
+#endif
 }
 
 
@@ -1579,6 +1622,9 @@ unsigned Device_Object_List_Count(
  * Even though we don't keep a single linear array of objects in the Device,
  * this method acts as though we do and works through a virtual, concatenated
  * array of all of our object type arrays.
+ * The list based object types keep their descriptors in a dense array (see
+ * Generic_Object_List_Init()), so Object_Index_To_Instance is O(1) and walking
+ * the whole Object_List is linear in the number of objects.
  *
  * @param array_index [in] The desired array index (1 to N)
  * @param object_type [out] The object's type, if found.
@@ -1640,7 +1686,8 @@ bool Device_Object_List_Identifier(
     return status;
 }
 
-/** Determine if we have an object with the given object_name.
+/** Determine if we have an object with the given object_name, for a caller
+ * that holds the object store lock (an Object_Name write).
  * If the object_type and object_instance pointers are not null,
  * and the lookup succeeds, they will be given the resulting values.
  * @param object_name [in] The desired Object Name to look for.
@@ -1648,40 +1695,77 @@ bool Device_Object_List_Identifier(
  * @param object_instance [out] The object instance number of the matching Object.
  * @return True on success or else False if not found.
  */
-bool Device_Valid_Object_Name(
+bool Device_Valid_Object_Name_Locked(
     BACNET_CHARACTER_STRING *object_name1,
     BACNET_OBJECT_TYPE *object_type,
     uint32_t *object_instance)
 {
-    bool found = false;
-    BACNET_OBJECT_TYPE type;
     uint32_t instance;
-    uint32_t max_objects = 0, i = 0;
-    bool check_id = false;
+    unsigned count = 0, index = 0, i = 0;
     BACNET_CHARACTER_STRING object_name2;
     struct object_functions *pObject = NULL;
 
-    max_objects = Device_Object_List_Count();
-    for (i = 1; i <= max_objects; i++) {
-        // todo - push back to Karg, the last object was not being found, the virtual object list is 1 based !
-        check_id = Device_Object_List_Identifier(i, &type, &instance);
-        if (check_id) {
-            pObject = Device_Objects_Find_Functions(type);
-            if ((pObject != NULL) && (pObject->Object_Name != NULL) &&
-                (pObject->Object_Name(instance, &object_name2) &&
-                    characterstring_same(object_name1, &object_name2))) {
-                found = true;
-                if (object_type) {
-                    *object_type = type;
+    /* objects built on Generic_Object_Init() are in the name index */
+    if (Generic_Object_Name_Find(object_name1, object_type, object_instance)) {
+        return true;
+    }
+
+    /* the rest (e.g. the Device object itself) still have to be compared one by one */
+    pObject = Object_Table;
+    while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
+        if ((pObject->Object_Count != NULL) &&
+            (pObject->Object_Index_To_Instance != NULL) &&
+            (pObject->Object_Name != NULL) &&
+            !Generic_Object_Name_Type_Indexed(pObject->Object_Type)) {
+            count = pObject->Object_Count();
+            if (pObject->Object_Iterator) {
+                index = pObject->Object_Iterator(~(unsigned)0);
+            }
+            else {
+                index = 0;
+            }
+            for (i = 0; i < count; i++) {
+                instance = pObject->Object_Index_To_Instance(index);
+                if (pObject->Object_Name(instance, &object_name2) &&
+                    characterstring_same(object_name1, &object_name2)) {
+                    if (object_type) {
+                        *object_type = pObject->Object_Type;
+                    }
+                    if (object_instance) {
+                        *object_instance = instance;
+                    }
+                    return true;
                 }
-                if (object_instance) {
-                    *object_instance = instance;
+                if (pObject->Object_Iterator) {
+                    index = pObject->Object_Iterator(index);
+                }
+                else {
+                    index++;
                 }
-                break;
             }
         }
+        pObject++;
     }
 
+    return false;
+}
+
+/** Device_Valid_Object_Name_Locked(), for a caller that does not hold the
+ *  object store lock (Who-Has).
+ * @ingroup ObjHelpers
+ */
+bool Device_Valid_Object_Name(
+    BACNET_CHARACTER_STRING *object_name1,
+    BACNET_OBJECT_TYPE *object_type,
+    uint32_t *object_instance)
+{
+    bool found;
+
+    BACNET_READ_LOCK(Object_Store_Lock);
+    found = Device_Valid_Object_Name_Locked(object_name1, object_type,
+        object_instance);
+    BACNET_READ_UNLOCK(Object_Store_Lock);
+
     return found;
 }
 
@@ -1719,10 +1803,12 @@ bool Device_Object_Name_Copy(
     struct object_functions *pObject = NULL;
     bool found = false;
 
+    BACNET_READ_LOCK(Object_Store_Lock);
     pObject = Device_Objects_Find_Functions(object_type);
     if ((pObject != NULL) && (pObject->Object_Name != NULL)) {
         found = pObject->Object_Name(object_instance, object_name);
     }
+    BACNET_READ_UNLOCK(Object_Store_Lock);
 
     return found;
 }
@@ -2168,6 +2254,25 @@ int Device_Read_Property_Local(
         apdu_len = encode_application_unsigned(&apdu[0], apdu_retries());
         break;
 
+#if (BACNET_SEGMENTATION_TRANSMIT == 1) || (BACNET_SEGMENTATION_RECEIVE == 1)
+    case PROP_MAX_SEGMENTS_ACCEPTED:
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+        /* per ComplexACK to our requests, segmented requests are
+           still refused */
+        apdu_len =
+            encode_application_unsigned(&apdu[0], MAX_SEGMENTS_ACCEPTED);
+#else
+        /* we send segmented replies, but do not take segmented requests */
+        apdu_len = encode_application_unsigned(&apdu[0], 1);
+#endif
+        break;
+
+    case PROP_APDU_SEGMENT_TIMEOUT:
+        apdu_len =
+            encode_application_unsigned(&apdu[0], apdu_segment_timeout());
+        break;
+#endif
+
     case PROP_DEVICE_ADDRESS_BINDING:
         apdu_len = address_list_encode(&apdu[0], apdu_max);
         break;
@@ -2254,6 +2359,7 @@ bool Device_Add_List_Element(
     /* initialize the default return values */
     lmdata->error_class = ERROR_CLASS_PROPERTY;
     lmdata->error_code = ERROR_CODE_WRITE_ACCESS_DENIED;
+    BACNET_WRITE_LOCK(Object_Store_Lock);
     pObject = Device_Objects_Find_Functions(lmdata->object_type);
     if (pObject != NULL) {
         if (pObject->Object_Valid_Instance &&
@@ -2263,6 +2369,7 @@ bool Device_Add_List_Element(
             }
         }
     }
+    BACNET_WRITE_UNLOCK(Object_Store_Lock);
 
     return status;
 }
@@ -2276,6 +2383,7 @@ bool Device_Remove_List_Element(
     /* initialize the default return values */
     lmdata->error_class = ERROR_CLASS_PROPERTY;
     lmdata->error_code = ERROR_CODE_WRITE_ACCESS_DENIED;
+    BACNET_WRITE_LOCK(Object_Store_Lock);
     pObject = Device_Objects_Find_Functions(lmdata->object_type);
     if (pObject != NULL) {
         if (pObject->Object_Valid_Instance &&
@@ -2285,25 +2393,24 @@ bool Device_Remove_List_Element(
             }
         }
     }
+    BACNET_WRITE_UNLOCK(Object_Store_Lock);
 
     return status;
 }
 #endif // #if ( BACNET_SVC_LIST_MANIPULATION_B == 1)
 
 
-/** Looks up the requested Object and Property, and encodes its Value in an APDU.
+/** Device_Read_Property() for a caller that already holds the object store
+ *  lock, for reading or writing, such as work the tick does under
+ *  Device_Objects_Lock() (Trend Log).
  * @ingroup ObjIntf
- * If the Object or Property can't be found, sets the error class and code.
- *
- * @param rpdata [in,out] Structure with the desired Object and Property info
- *                 on entry, and APDU message on return.
- * @return The length of the APDU on success, else BACNET_STATUS_ERROR
  */
-int Device_Read_Property(
+int Device_Read_Property_Locked(
     BACNET_READ_PROPERTY_DATA * rpdata)
 {
     int apdu_len = BACNET_STATUS_ERROR;
     struct object_functions *pObject = NULL;
+    const BACNET_PROPERTY_SET *pSet = NULL;
 #if (BACNET_PROTOCOL_REVISION >= 14)
     struct special_property_list_t property_list;
 #endif
@@ -2316,10 +2423,30 @@ int Device_Read_Property(
         if (pObject->Object_Valid_Instance &&
             pObject->Object_Valid_Instance(rpdata->object_instance)) {
             if (pObject->Object_Read_Property) {
+                pSet = Device_Objects_Property_Set(rpdata->object_type);
+                if ((pSet != NULL) &&
+#if (BACNET_PROTOCOL_REVISION >= 14)
+                    ((int)rpdata->object_property != PROP_PROPERTY_LIST) &&
+#endif
+                    !property_set_member(pSet, rpdata->object_property)) {
+                    /* not in the object's Property_List, don't ask the object */
+                    rpdata->error_class = ERROR_CLASS_PROPERTY;
+                    rpdata->error_code = ERROR_CODE_UNKNOWN_PROPERTY;
+                    return BACNET_STATUS_ERROR;
+                }
+#if (BACNET_PROPERTY_CACHE == 1)
+                if (pc_Read(rpdata, &apdu_len)) {
+                    return apdu_len;
+                }
+#endif
                 /// BTC todo - enable 14, disable property list and 1) make sure missing prop list detected
                 // 2) user notified before running tests that depend on property list
 #if (BACNET_PROTOCOL_REVISION >= 14)
-                if ((int)rpdata->object_property == PROP_PROPERTY_LIST) {
+                if (((int)rpdata->object_property == PROP_PROPERTY_LIST) &&
+                    (pSet != NULL)) {
+                    apdu_len = property_set_encode(rpdata, pSet);
+                }
+                else if ((int)rpdata->object_property == PROP_PROPERTY_LIST) {
                     Device_Objects_Property_List(
                         rpdata->object_type,
                         rpdata->object_instance,
@@ -2335,6 +2462,9 @@ int Device_Read_Property(
                 {
                     apdu_len = pObject->Object_Read_Property(rpdata);
                 }
+#if (BACNET_PROPERTY_CACHE == 1)
+                pc_Store(rpdata, apdu_len);
+#endif
             }
         }
     }
@@ -2342,6 +2472,26 @@ int Device_Read_Property(
     return apdu_len;
 }
 
+/** Looks up the requested Object and Property, and encodes its Value in an APDU.
+ * @ingroup ObjIntf
+ * If the Object or Property can't be found, sets the error class and code.
+ *
+ * @param rpdata [in,out] Structure with the desired Object and Property info
+ *                 on entry, and APDU message on return.
+ * @return The length of the APDU on success, else BACNET_STATUS_ERROR
+ */
+int Device_Read_Property(
+    BACNET_READ_PROPERTY_DATA * rpdata)
+{
+    int apdu_len;
+
+    BACNET_READ_LOCK(Object_Store_Lock);
+    apdu_len = Device_Read_Property_Locked(rpdata);
+    BACNET_READ_UNLOCK(Object_Store_Lock);
+
+    return apdu_len;
+}
+
 /* returns true if successful */
 bool Device_Write_Property_Local(
     BACNET_WRITE_PROPERTY_DATA *wp_data)
@@ -2413,6 +2563,18 @@ bool Device_Write_Property_Local(
             apdu_timeout_set((uint16_t)value.type.Unsigned_Int);
         }
         break;
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1) || (BACNET_SEGMENTATION_RECEIVE == 1)
+    case PROP_APDU_SEGMENT_TIMEOUT:
+        status =
+            WPValidateArgType(&value, BACNET_APPLICATION_TAG_UNSIGNED_INT,
+                &wp_data->error_class, &wp_data->error_code);
+        if (status) {
+            /* FIXME: bounds check? */
+            apdu_segment_timeout_set((uint16_t)value.type.Unsigned_Int);
+        }
+        break;
+#endif
         // EKH: Makes no sense that system status is writable
         //case PROP_SYSTEM_STATUS:
         //    status =
@@ -2441,7 +2603,7 @@ bool Device_Write_Property_Local(
                 &wp_data->error_class, &wp_data->error_code);
         if (status) {
             /* All the object names in a device must be unique */
-            if (Device_Valid_Object_Name(&value.type.Character_String,
+            if (Device_Valid_Object_Name_Locked(&value.type.Character_String,
                 &object_type, &object_instance)) {
                 if ((object_type == wp_data->object_type) &&
                     (object_instance == wp_data->object_instance)) {
@@ -2639,20 +2801,17 @@ bool Device_Write_Property_Local(
     return status;
 }
 
-/** Looks up the requested Object and Property, and set the new Value in it,
- *  if allowed.
- * If the Object or Property can't be found, sets the error class and code.
+/** Device_Write_Property() for a caller that already holds the object store
+ *  write lock, such as an object that writes to others from its own
+ *  Object_Write_Property (Channel).
  * @ingroup ObjIntf
- *
- * @param wp_data [in,out] Structure with the desired Object and Property info
- *              and new Value on entry, and APDU message on return.
- * @return True on success, else False if there is an error.
  */
-bool Device_Write_Property(
+bool Device_Write_Property_Locked(
     BACNET_WRITE_PROPERTY_DATA *wp_data)
 {
     bool status = false;        /* Ever the pessamist! */
     struct object_functions *pObject = NULL;
+    const BACNET_PROPERTY_SET *pSet = NULL;
 
     /* initialize the default return values */
     wp_data->error_class = ERROR_CLASS_OBJECT;
@@ -2662,6 +2821,7 @@ bool Device_Write_Property(
         if (pObject->Object_Valid_Instance &&
             pObject->Object_Valid_Instance(wp_data->object_instance)) {
             if (pObject->Object_Write_Property) {
+                pSet = Device_Objects_Property_Set(wp_data->object_type);
                 // BTC todo is property list write protected??
 #if (BACNET_PROTOCOL_REVISION >= 14)
                 if (wp_data->object_property == PROP_PROPERTY_LIST) {
@@ -2670,9 +2830,20 @@ bool Device_Write_Property(
                 }
                 else
 #endif
-                {
+                if ((pSet != NULL) &&
+                    !property_set_member(pSet, wp_data->object_property)) {
+                    wp_data->error_class = ERROR_CLASS_PROPERTY;
+                    wp_data->error_code = ERROR_CODE_UNKNOWN_PROPERTY;
+                }
+                else {
                     status = pObject->Object_Write_Property(wp_data);
                 }
+#if (BACNET_PROPERTY_CACHE == 1)
+                if (status) {
+                    // the whole object, one property may be encoded from another
+                    pc_InvalidateObject(wp_data->object_type, wp_data->object_instance);
+                }
+#endif
             }
             else {
                 wp_data->error_class = ERROR_CLASS_PROPERTY;
@@ -2692,6 +2863,53 @@ bool Device_Write_Property(
     return (status);
 }
 
+/** Looks up the requested Object and Property, and set the new Value in it,
+ *  if allowed.
+ * If the Object or Property can't be found, sets the error class and code.
+ * @ingroup ObjIntf
+ *
+ * @param wp_data [in,out] Structure with the desired Object and Property info
+ *              and new Value on entry, and APDU message on return.
+ * @return True on success, else False if there is an error.
+ */
+bool Device_Write_Property(
+    BACNET_WRITE_PROPERTY_DATA *wp_data)
+{
+    bool status;
+
+    BACNET_WRITE_LOCK(Object_Store_Lock);
+    status = Device_Write_Property_Locked(wp_data);
+    BACNET_WRITE_UNLOCK(Object_Store_Lock);
+
+    return (status);
+}
+
+/** Holds the objects still for work that goes to them directly rather than
+ *  through the Device_ functions, such as the periodic tick's state machines.
+ * @ingroup ObjIntf
+ *
+ * @param exclusive [in] True if the objects are to be changed.
+ */
+void Device_Objects_Lock(
+    bool exclusive)
+{
+    if (exclusive) {
+        BACNET_WRITE_LOCK(Object_Store_Lock);
+    } else {
+        BACNET_READ_LOCK(Object_Store_Lock);
+    }
+}
+
+void Device_Objects_Unlock(
+    bool exclusive)
+{
+    if (exclusive) {
+        BACNET_WRITE_UNLOCK(Object_Store_Lock);
+    } else {
+        BACNET_READ_UNLOCK(Object_Store_Lock);
+    }
+}
+
 #if ( BACNET_SVC_COV_B == 1 )
 /** Looks up the requested Object, and fills the Property Value list.
  * If the Object or Property can't be found, returns false.
@@ -2709,6 +2927,7 @@ bool Device_Encode_Value_List(
     bool status = false;        /* Ever the pessamist! */
     struct object_functions *pObject = NULL;
 
+    BACNET_READ_LOCK(Object_Store_Lock);
     pObject = Device_Objects_Find_Functions(object_type);
     if (pObject != NULL) {
         if (pObject->Object_Valid_Instance &&
@@ -2719,6 +2938,7 @@ bool Device_Encode_Value_List(
             }
         }
     }
+    BACNET_READ_UNLOCK(Object_Store_Lock);
 
     return (status);
 }
@@ -2737,6 +2957,7 @@ bool Device_COV(
     bool status = false;        /* Ever the pessamist! */
     struct object_functions *pObject = NULL;
 
+    BACNET_READ_LOCK(Object_Store_Lock);
     pObject = Device_Objects_Find_Functions(object_type);
     if (pObject != NULL) {
         if (pObject->Object_Valid_Instance &&
@@ -2746,6 +2967,7 @@ bool Device_COV(
             }
         }
     }
+    BACNET_READ_UNLOCK(Object_Store_Lock);
 
     return (status);
 }
@@ -2761,6 +2983,7 @@ void Device_COV_Clear(
 {
     struct object_functions *pObject = NULL;
 
+    BACNET_WRITE_LOCK(Object_Store_Lock);
     pObject = Device_Objects_Find_Functions(object_type);
     if (pObject != NULL) {
         if (pObject->Object_Valid_Instance &&
@@ -2770,6 +2993,7 @@ void Device_COV_Clear(
             }
         }
     }
+    BACNET_WRITE_UNLOCK(Object_Store_Lock);
 }
 #endif // BACNET_SVC_COV_B
 
@@ -2990,6 +3214,12 @@ void Device_Init(
     object_functions_t * object_table)
 {
     struct object_functions *pObject = NULL;
+    const BACNET_PROPERTY_ID *pRequired = NULL;
+    const BACNET_PROPERTY_ID *pOptional = NULL;
+    const BACNET_PROPERTY_ID *pProprietary = NULL;
+    unsigned i;
+
+    BACNET_RWLOCK_INIT(Object_Store_Lock);
 
     // Set default Device Name if not already preset by e.g. command line
     if (My_Object_Name.length == 0) {
@@ -3002,13 +3232,45 @@ void Device_Init(
     else {
         Object_Table = &My_Object_Table[0];
     }
+    memset(Object_Type_Table, 0, sizeof(Object_Type_Table));
+#if (BACNET_PROPERTY_CACHE == 1)
+    pc_Init();
+#endif
+    txbuf_init();
     pObject = Object_Table;
     while (pObject->Object_Type < MAX_BACNET_OBJECT_TYPE) {
+        /* first entry for a type wins, as it did with the linear search */
+        if (Object_Type_Table[pObject->Object_Type] == NULL) {
+            Object_Type_Table[pObject->Object_Type] = pObject;
+        }
         if (pObject->Object_Init) {
             pObject->Object_Init();
         }
         pObject++;
     }
+    for (i = 0; i < MAX_BACNET_OBJECT_TYPE; i++) {
+        pObject = Object_Type_Table[i];
+        if ((pObject == NULL) || (pObject->Object_RPM_List == NULL)) {
+            /* a re-init with a different table may drop a type */
+            if (Object_Property_Sets[i] != NULL) {
+                free(Object_Property_Sets[i]);
+                Object_Property_Sets[i] = NULL;
+            }
+            continue;
+        }
+        if (Object_Property_Sets[i] == NULL) {
+            Object_Property_Sets[i] =
+                (BACNET_PROPERTY_SET *) malloc(sizeof(BACNET_PROPERTY_SET));
+            if (Object_Property_Sets[i] == NULL) {
+                panic();
+                continue;
+            }
+        }
+        pRequired = pOptional = pProprietary = NULL;
+        pObject->Object_RPM_List(&pRequired, &pOptional, &pProprietary);
+        property_set_init(Object_Property_Sets[i], pRequired, pOptional,
+            pProprietary);
+    }
 
     Device_Time_Init();
 }
@@ -339,6 +339,9 @@ void Device_Objects_Property_List(
     uint32_t object_instance,
     struct special_property_list_t *pPropertyList);
 
+const BACNET_PROPERTY_SET *Device_Objects_Property_Set(
+    BACNET_OBJECT_TYPE Object_Type);
+
 /* functions to support COV */
 bool Device_Encode_Value_List(
     BACNET_OBJECT_TYPE object_type,
@@ -460,6 +463,12 @@ bool Device_Valid_Object_Name(
     BACNET_OBJECT_TYPE *object_type,
     uint32_t * object_instance);
 
+/* for the name uniqueness check in an Object_Write_Property */
+bool Device_Valid_Object_Name_Locked(
+    BACNET_CHARACTER_STRING * object_name,
+    BACNET_OBJECT_TYPE *object_type,
+    uint32_t * object_instance);
+
 bool Device_Valid_Object_Id(
     BACNET_OBJECT_TYPE object_type,
     uint32_t object_instance);
@@ -475,9 +484,25 @@ bool Device_Valid_Object_Id(
 int Device_Read_Property(
     BACNET_READ_PROPERTY_DATA * rpdata);
 
+/* for reads made with the object store lock already held */
+int Device_Read_Property_Locked(
+    BACNET_READ_PROPERTY_DATA * rpdata);
+
 bool Device_Write_Property(
     BACNET_WRITE_PROPERTY_DATA * wp_data);
 
+/* for writes made from inside an object's own write */
+bool Device_Write_Property_Locked(
+    BACNET_WRITE_PROPERTY_DATA * wp_data);
+
+/* for work on the objects that does not go through the Device_ functions,
+   exclusive if it changes them. Under either, use the _Locked variants and
+   not the Device_ functions that lock. */
+void Device_Objects_Lock(
+    bool exclusive);
+void Device_Objects_Unlock(
+    bool exclusive);
+
 bool DeviceGetRRInfo(
     BACNET_READ_RANGE_DATA * pRequest,      /* Info on the request */
     RR_PROP_INFO * pInfo);  /* Where to put the information */
@@ -51,6 +51,7 @@
 #include "config.h"     /* the custom stuff */
 #include "device.h"
 #include "handlers.h"
+#include "propertyCache.h"
 /* me! */
 #include "iv.h"
 
@@ -299,6 +300,12 @@ bool Integer_Value_Units_Set(
         status = true;
     }
 
+#if (BACNET_PROPERTY_CACHE == 1)
+    if (status) {
+        pc_InvalidateObject(OBJECT_INTEGER_VALUE, instance);
+    }
+#endif
+
     return status;
 }
 
@@ -37,6 +37,7 @@
 #include "wp.h"
 #include "device.h"
 #include "ms-input.h"
+#include "propertyCache.h"
 #include "handlers.h"
 
 /* number of demo objects */
@@ -257,6 +258,12 @@ bool Multistate_Input_Description_Set(
         }
     }
 
+#if (BACNET_PROPERTY_CACHE == 1)
+    if (status) {
+        pc_InvalidateObject(OBJECT_MULTI_STATE_INPUT, object_instance);
+    }
+#endif
+
     return status;
 }
 
@@ -343,6 +350,12 @@ bool Multistate_Input_Name_Set(
         }
     }
 
+#if (BACNET_PROPERTY_CACHE == 1)
+    if (status) {
+        pc_InvalidateObject(OBJECT_MULTI_STATE_INPUT, object_instance);
+    }
+#endif
+
     return status;
 }
 
@@ -432,6 +445,12 @@ bool Multistate_Input_State_Text_Set(
         }
     }
 
+#if (BACNET_PROPERTY_CACHE == 1)
+    if (status) {
+        pc_InvalidateObject(OBJECT_MULTI_STATE_INPUT, object_instance);
+    }
+#endif
+
     return status;;
 }
 
@@ -662,7 +681,7 @@ bool Multistate_Input_Write_Property(
         case PROP_OBJECT_NAME:
             if (value.tag == BACNET_APPLICATION_TAG_CHARACTER_STRING) {
                 /* All the object names in a device must be unique */
-                if (Device_Valid_Object_Name(&value.type.Character_String,
+                if (Device_Valid_Object_Name_Locked(&value.type.Character_String,
                         &object_type, &object_instance)) {
                     if ((object_type == wp_data->object_type) &&
                         (object_instance == wp_data->object_instance)) {
@@ -798,7 +817,7 @@ bool Multistate_Input_Write_Property(
 #include "ctest.h"
 
 
-bool Device_Valid_Object_Name(
+bool Device_Valid_Object_Name_Locked(
     BACNET_CHARACTER_STRING * object_name,
     BACNET_OBJECT_TYPE *object_type,
     uint32_t * object_instance)
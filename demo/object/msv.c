@@ -36,6 +36,7 @@
 #include "rp.h"
 #include "wp.h"
 #include "msv.h"
+#include "propertyCache.h"
 #include "handlers.h"
 
 /* number of demo objects */
@@ -249,6 +250,12 @@ bool Multistate_Value_Description_Set(
         }
     }
 
+#if (BACNET_PROPERTY_CACHE == 1)
+    if (status) {
+        pc_InvalidateObject(OBJECT_MULTI_STATE_VALUE, object_instance);
+    }
+#endif
+
     return status;
 }
 
@@ -294,6 +301,12 @@ bool Multistate_Value_Name_Set(
         }
     }
 
+#if (BACNET_PROPERTY_CACHE == 1)
+    if (status) {
+        pc_InvalidateObject(OBJECT_MULTI_STATE_VALUE, object_instance);
+    }
+#endif
+
     return status;
 }
 
@@ -343,6 +356,12 @@ bool Multistate_Value_State_Text_Set(
         }
     }
 
+#if (BACNET_PROPERTY_CACHE == 1)
+    if (status) {
+        pc_InvalidateObject(OBJECT_MULTI_STATE_VALUE, object_instance);
+    }
+#endif
+
     return status;;
 }
 
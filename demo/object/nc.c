@@ -783,6 +783,7 @@ void Notification_Class_common_reporting_function(
             BACNET_ADDRESS dest;
             uint32_t device_id;
             unsigned max_apdu;
+            uint8_t *pdu = NULL;
 
             /* Process Identifier */
             event_data->processIdentifier = pBacDest->ProcessIdentifier;
@@ -801,9 +802,13 @@ void Notification_Class_common_reporting_function(
 
                 if (pBacDest->ConfirmedNotify == true)
                     Send_CEvent_Notify(device_id, event_data);
-                else if (address_get_by_device(device_id, &max_apdu, &dest))
-                    Send_UEvent_Notify(Handler_Transmit_Buffer, event_data,
-                        &dest);
+                else if (address_get_by_device(device_id, &max_apdu, &dest)) {
+                    pdu = txbuf_acquire();
+                    if (pdu != NULL) {
+                        Send_UEvent_Notify(pdu, event_data, &dest);
+                        txbuf_release(pdu);
+                    }
+                }
             }
             else if (pBacDest->Recipient.RecipientType ==
                 RECIPIENT_TYPE_ADDRESS) {
@@ -815,8 +820,11 @@ void Notification_Class_common_reporting_function(
                 else {
                     panic(); // i suspect that Steve is missing the local mac in address table for this operation.
                     dest = pBacDest->Recipient._.Address;
-                    Send_UEvent_Notify(Handler_Transmit_Buffer, event_data,
-                        &dest);
+                    pdu = txbuf_acquire();
+                    if (pdu != NULL) {
+                        Send_UEvent_Notify(pdu, event_data, &dest);
+                        txbuf_release(pdu);
+                    }
                 }
             }
         }
@@ -67,6 +67,7 @@
 //#include "bitsDebug.h"
 ///* me */
 #include "netport.h"
+#include "propertyCache.h"
 
 #define BIP_DNS_MAX 3
 struct bacnet_ipv4_port {
@@ -246,6 +247,9 @@ bool Network_Port_Name_Set(
     index = Network_Port_Instance_To_Index(object_instance);
     if (index < BACNET_NETWORK_PORTS_MAX) {
         Object_List[index].Object_Name = new_name;
+#if (BACNET_PROPERTY_CACHE == 1)
+        pc_InvalidateObject(OBJECT_NETWORK_PORT, object_instance);
+#endif
     }
 
     return status;
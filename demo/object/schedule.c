@@ -51,12 +51,14 @@
 //#include "timestamp.h"
 #include "schedule.h"
 #include "emm.h"
+#include "BACnetSnapshot.h"
 #include "bitsDebug.h"
 #include "calendar.h"
 #include "datetime.h"
 #include "llist.h"
 
 LLIST_HDR Schedule_Descriptor_List;
+static EMM_SLAB Schedule_Slab;
 
 static const BACNET_PROPERTY_ID Schedule_Properties_Required[] = {
     PROP_OBJECT_IDENTIFIER,
@@ -89,18 +91,22 @@ bool Schedule_Create(
     const uint32_t instance,
     const char *name)
 {
-    SCHEDULE_DESCR *currentObject = (SCHEDULE_DESCR *)emm_scalloc('a', sizeof(SCHEDULE_DESCR));
+    SCHEDULE_DESCR *currentObject = (SCHEDULE_DESCR *)emm_slab_calloc(&Schedule_Slab);
     if (currentObject == NULL) {
         panic();
         return false;
     }
+    // the instance index is keyed on objectInstance, so this has to precede ll_Enqueue()
+    Generic_Object_Init(&currentObject->common, OBJECT_SCHEDULE, instance, name);
+
     if (!ll_Enqueue(&Schedule_Descriptor_List, currentObject)) {
+        // list full, or the instance already exists
+        Generic_Object_Name_Remove(&currentObject->common);
+        emm_slab_free(&Schedule_Slab, currentObject);
         panic();
         return false;
     }
 
-    Generic_Object_Init(&currentObject->common, instance, name);
-
     currentObject->Present_Value.tag = BACNET_APPLICATION_TAG_NULL;
     currentObject->Out_Of_Service = false;
     currentObject->Reliability = RELIABILITY_NO_FAULT_DETECTED;
@@ -206,12 +212,37 @@ static int weekly_event_count(BACNET_DAILY_SCHEDULE *weeklySchedule)
 }
 
 
+// The application data values carry a 'next' pointer, left over from the list decoder.
+// Nothing here follows it, but a snapshot must not bring back a stale one.
+static void Schedule_Snapshot_Restore(
+    BACNET_OBJECT *bacnetObject)
+{
+    SCHEDULE_DESCR *desc = (SCHEDULE_DESCR *)bacnetObject;
+    int i, j;
+
+    desc->Present_Value.next = NULL;
+    desc->Schedule_Default.next = NULL;
+    for (i = 0; i < MAX_BACNET_DAYS_OF_WEEK; i++) {
+        for (j = 0; j < BACNET_WEEKLY_SCHEDULE_SIZE; j++) {
+            desc->Weekly_Schedule[i].Time_Values[j].Value.next = NULL;
+        }
+    }
+    for (i = 0; i < MX_EXCEPTION_SCHEDULE; i++) {
+        for (j = 0; j < MX_SPECIAL_EVENT_TIME_VALUES; j++) {
+            desc->Exception_Schedule[i].listOfTimeValues[j].Value.next = NULL;
+        }
+    }
+}
+
+
 // Gets called once for each device
 
 void Schedule_Init(
     void)
 {
-    ll_Init(&Schedule_Descriptor_List, 100);
+    Generic_Object_List_Init(&Schedule_Descriptor_List, 100);
+    emm_slab_init(&Schedule_Slab, sizeof(SCHEDULE_DESCR), 32);
+    Snapshot_Register_Type(OBJECT_SCHEDULE, &Schedule_Descriptor_List, &Schedule_Slab, sizeof(SCHEDULE_DESCR), Schedule_Snapshot_Restore);
 }
 
 
@@ -1298,7 +1329,7 @@ static int rr_schedule(
     if (uiTotal == 0) return 0;
     /* See how much space we have */
 
-    uiRemaining = (uint32_t)(MAX_APDU - pRequest->Overhead);
+    uiRemaining = (uint32_t)(pRequest->MaxApdu - pRequest->Overhead);
 
     pRequest->ItemCount = 0;              /* Start out with nothing */
 
@@ -1085,7 +1085,7 @@ int TL_encode_by_position(
     uint32_t uiRemaining = 0;   /* Amount of unused space in packet */
 
     /* See how much space we have */
-    uiRemaining = MAX_APDU - pRequest->Overhead;
+    uiRemaining = pRequest->MaxApdu - pRequest->Overhead;
     log_index = Trend_Log_Instance_To_Index(pRequest->object_instance);
     CurrentLog = &LogInfo[log_index];
     if (pRequest->RequestType == RR_READ_ALL) {
@@ -1195,7 +1195,7 @@ int TL_encode_by_sequence(
     bool bWrapLog = false;      /* Has log sequence range spanned the max for uint32_t? */
 
     /* See how much space we have */
-    uiRemaining = MAX_APDU - pRequest->Overhead;
+    uiRemaining = pRequest->MaxApdu - pRequest->Overhead;
     log_index = Trend_Log_Instance_To_Index(pRequest->object_instance);
     CurrentLog = &LogInfo[log_index];
     /* Figure out the sequence number for the first record, last is ulTotalRecordCount */
@@ -1327,7 +1327,7 @@ int TL_encode_by_time(
     time_t tRefTime = 0;        /* The time from the request in local format */
 
     /* See how much space we have */
-    uiRemaining = MAX_APDU - pRequest->Overhead;
+    uiRemaining = pRequest->MaxApdu - pRequest->Overhead;
     log_index = Trend_Log_Instance_To_Index(pRequest->object_instance);
     CurrentLog = &LogInfo[log_index];
 
@@ -1583,7 +1583,7 @@ static int local_read_property(
         rpdata.object_property = Source->propertyIdentifier;
         rpdata.array_index = Source->arrayIndex;
         /* Try to fetch the required property */
-        len = Device_Read_Property(&rpdata);
+        len = Device_Read_Property_Locked(&rpdata);
         if (len < 0) {
             *error_class = rpdata.error_class;
             *error_code = rpdata.error_code;
@@ -1596,7 +1596,7 @@ static int local_read_property(
         rpdata.application_data_len = MAX_APDU;
         rpdata.object_property = PROP_STATUS_FLAGS;
         rpdata.array_index = BACNET_ARRAY_ALL;
-        len = Device_Read_Property(&rpdata);
+        len = Device_Read_Property_Locked(&rpdata);
         if (len < 0) {
             *error_class = rpdata.error_class;
             *error_code = rpdata.error_code;
@@ -129,7 +129,7 @@ void MyRejectHandler(
 /** Handler for a ReadPropertyMultiple ACK.
  * @ingroup DSRPM
  * For each read property, print out the ACK'd data,
- * and free the request data items from linked property list.
+ * then give back the arena the ACK was decoded into.
  *
  * @param service_request [in] The contents of the service request.
  * @param service_len [in] The length of the service_request.
@@ -144,61 +144,30 @@ void My_Read_Property_Multiple_Ack_Handler(
     BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data)
 {
     int len = 0;
+    DECODE_ARENA arena;
     BACNET_READ_ACCESS_DATA *rpm_data;
-    BACNET_READ_ACCESS_DATA *old_rpm_data;
-    BACNET_PROPERTY_REFERENCE *rpm_property;
-    BACNET_PROPERTY_REFERENCE *old_rpm_property;
-    BACNET_APPLICATION_DATA_VALUE *value;
-    BACNET_APPLICATION_DATA_VALUE *old_value;
 
     if (address_match(&Target_Address, src) &&
         (service_data->invoke_id == Request_Invoke_ID)) {
-        rpm_data = (BACNET_READ_ACCESS_DATA *) calloc(1, sizeof(BACNET_READ_ACCESS_DATA));
+        decode_arena_init(&arena, DECODE_ARENA_BLOCK_SIZE);
+        rpm_data =
+            (BACNET_READ_ACCESS_DATA *) decode_arena_calloc(&arena,
+            sizeof(BACNET_READ_ACCESS_DATA));
         if (rpm_data) {
             len =
-                rpm_ack_decode_service_request(service_request, service_len,
-                    rpm_data);
+                rpm_ack_decode_service_request_arena(service_request,
+                service_len, &arena, rpm_data);
         }
         if (len > 0) {
             while (rpm_data) {
                 rpm_ack_print_data(rpm_data);
-                rpm_property = rpm_data->listOfProperties;
-                while (rpm_property) {
-                    value = rpm_property->value;
-                    while (value) {
-                        old_value = value;
-                        value = value->next;
-                        free(old_value);
-                    }
-                    old_rpm_property = rpm_property;
-                    rpm_property = rpm_property->next;
-                    free(old_rpm_property);
-                }
-                old_rpm_data = rpm_data;
                 rpm_data = rpm_data->next;
-                free(old_rpm_data);
             }
         }
         else {
             fprintf(stderr, "RPM Ack Malformed! Freeing memory...\n");
-            while (rpm_data) {
-                rpm_property = rpm_data->listOfProperties;
-                while (rpm_property) {
-                    value = rpm_property->value;
-                    while (value) {
-                        old_value = value;
-                        value = value->next;
-                        free(old_value);
-                    }
-                    old_rpm_property = rpm_property;
-                    rpm_property = rpm_property->next;
-                    free(old_rpm_property);
-                }
-                old_rpm_data = rpm_data;
-                rpm_data = rpm_data->next;
-                free(old_rpm_data);
-            }
         }
+        decode_arena_release(&arena);
     }
 }
 
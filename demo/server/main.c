@@ -87,6 +87,7 @@
 #include "bv.h"
 #include "calendar.h"
 #include "schedule.h"
+#include "BACnetSnapshot.h"
 
 #include "dcc.h"
 #include "btaDebug.h"
@@ -316,26 +317,32 @@ int main(
 
     InitBACnet();
 
+    // The objects as they were when last saved, if there is a usable snapshot. The
+    // workers are already running, so the objects are created under the write lock.
+    Device_Objects_Lock(true);
+    if (!Snapshot_Load(SNAPSHOT_FILENAME)) {
 #if ( BACNET_USE_OBJECT_ANALOG_INPUT == 1)
-    // Create some Objects, dynamically
-    Analog_Input_Create(1, "Ana Input 1"); // , UNITS_DEGREES_CELSIUS, 0.0 );
-    Analog_Input_Create(2, "Ana Input 2"); // , UNITS_DEGREES_CELSIUS, 0.0 );
+        // Create some Objects, dynamically
+        Analog_Input_Create(1, "Ana Input 1"); // , UNITS_DEGREES_CELSIUS, 0.0 );
+        Analog_Input_Create(2, "Ana Input 2"); // , UNITS_DEGREES_CELSIUS, 0.0 );
 #endif
 
-    // todo1 etc
-    Analog_Output_Create(1, "Ana Output 1"); // , UNITS_DEGREES_CELSIUS, 0.0 );
+        // todo1 etc
+        Analog_Output_Create(1, "Ana Output 1"); // , UNITS_DEGREES_CELSIUS, 0.0 );
 
-    Analog_Value_Create(1, "Ana Value 1", UNITS_PERCENT_RELATIVE_HUMIDITY );
+        Analog_Value_Create(1, "Ana Value 1", UNITS_PERCENT_RELATIVE_HUMIDITY );
 
-    Binary_Value_Create(1, "Bin Value 1");
+        Binary_Value_Create(1, "Bin Value 1");
 
-    Calendar_Create(1, "Calendar 1");
-    Calendar_Create(2, "Calendar 2");
-    Calendar_Create(3, "Calendar 3");
+        Calendar_Create(1, "Calendar 1");
+        Calendar_Create(2, "Calendar 2");
+        Calendar_Create(3, "Calendar 3");
 
-    Schedule_Create(1, "Schedule 1");
-    Schedule_Create(2, "Schedule 2");
-    Schedule_Create(3, "Schedule 3");
+        Schedule_Create(1, "Schedule 1");
+        Schedule_Create(2, "Schedule 2");
+        Schedule_Create(3, "Schedule 3");
+    }
+    Device_Objects_Unlock(true);
 
     /* broadcast an I-Am on startup */
     Send_I_Am(&Handler_Transmit_Buffer[0]);
@@ -421,6 +428,9 @@ int main(
         msSleep(10);
     }
 
+    // so the next start is a bulk load, not a rebuild
+    SaveBACnetSnapshot();
+
 #if defined ( _MSC_VER  )
 #pragma warning( disable : 4702)    // unreachable code
 #endif
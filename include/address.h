@@ -83,6 +83,28 @@ bool address_get_device_id(
 	BACNET_ADDRESS * src,
     uint32_t * device_id);
 
+/* What the TSM has learned of the device at an address: how many requests
+   it takes at once, and how long it takes to answer them. It is kept with
+   the binding while the TSM has nothing in flight to the device, and is
+   forgotten if the address of the device changes. All 0 is nothing
+   learned yet. */
+typedef struct BACnet_Address_Learned {
+    unsigned window;
+    uint32_t srtt;
+    uint32_t rttvar;
+    unsigned backoff;
+} BACNET_ADDRESS_LEARNED;
+
+/* false if the address is not bound */
+bool address_learned_get(
+    BACNET_ADDRESS * src,
+    unsigned *max_apdu,
+    BACNET_ADDRESS_LEARNED * learned);
+
+void address_learned_set(
+    BACNET_ADDRESS * src,
+    BACNET_ADDRESS_LEARNED * learned);
+
 unsigned address_count(
     void);
 
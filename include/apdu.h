@@ -144,6 +144,14 @@ void apdu_set_confirmed_ack_handler(
 void apdu_set_confirmed_simple_ack_handler(
     BACNET_CONFIRMED_SERVICE service_choice,
     confirmed_simple_ack_function pFunction);
+
+/* the handlers set above, NULL if there are none, so that whoever sets
+   their own can pass on what is not theirs */
+confirmed_ack_function apdu_confirmed_ack_handler(
+    BACNET_CONFIRMED_SERVICE service_choice);
+
+confirmed_simple_ack_function apdu_confirmed_simple_ack_handler(
+    BACNET_CONFIRMED_SERVICE service_choice);
 #endif
 
 /* configure reject for confirmed services that are not supported */
@@ -181,6 +189,16 @@ void apdu_set_abort_handler(
 
 void apdu_set_reject_handler(
     reject_function pFunction);
+
+/* as apdu_confirmed_ack_handler() */
+error_function apdu_error_handler(
+    BACNET_CONFIRMED_SERVICE service_choice);
+
+abort_function apdu_abort_handler(
+    void);
+
+reject_function apdu_reject_handler(
+    void);
 #endif
 
 uint16_t apdu_decode_confirmed_service_request(
@@ -199,6 +217,10 @@ uint8_t apdu_retries(
     void);
 void apdu_retries_set(
     uint8_t value);
+uint16_t apdu_segment_timeout(
+    void);
+void apdu_segment_timeout_set(
+    uint16_t value);
 
 void apdu_handler(
     BACNET_ADDRESS * src,   /* source address */
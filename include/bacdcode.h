@@ -460,6 +460,16 @@ int decode_max_segs(
 int decode_max_apdu(
     uint8_t octet);
 
+/* PDU type flag (clause 20.1.2.3) and max-segments-accepted of the confirmed
+   requests we send whose ComplexACK may come back segmented */
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+#define PDU_SEGMENTED_RESPONSE_ACCEPTED 0x02
+#define PDU_MAX_SEGS_ACCEPTED MAX_SEGMENTS_ACCEPTED
+#else
+#define PDU_SEGMENTED_RESPONSE_ACCEPTED 0
+#define PDU_MAX_SEGS_ACCEPTED 0
+#endif
+
 /* returns the number of apdu bytes consumed */
 int encode_simple_ack(
     uint8_t * apdu,
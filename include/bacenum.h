@@ -1647,10 +1647,15 @@ typedef enum {
     ABORT_REASON_SEGMENTATION_NOT_SUPPORTED = 4,
     ABORT_REASON_SECURITY_ERROR = 5,
     ABORT_REASON_INSUFFICIENT_SECURITY = 6,
+    ABORT_REASON_WINDOW_SIZE_OUT_OF_RANGE = 7,
+    ABORT_REASON_APPLICATION_EXCEEDED_REPLY_TIME = 8,
+    ABORT_REASON_OUT_OF_RESOURCES = 9,
+    ABORT_REASON_TSM_TIMEOUT = 10,
+    ABORT_REASON_APDU_TOO_LONG = 11,
     /* Enumerated values 0-63 are reserved for definition by ASHRAE. */
     /* Enumerated values 64-65535 may be used by others subject to */
     /* the procedures and constraints described in Clause 23. */
-    MAX_BACNET_ABORT_REASON = 7,
+    MAX_BACNET_ABORT_REASON = 12,
     /* do the MAX here instead of outside of enum so that
        compilers will allocate adequate sized datatype for enum */
     ABORT_REASON_PROPRIETARY_FIRST = 64,
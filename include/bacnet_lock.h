@@ -0,0 +1,85 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#ifndef BACNET_LOCK_H
+#define BACNET_LOCK_H
+
+#include "config.h"
+
+/* Locks for the state the stack shares between threads, one per subsystem,
+   compiled away unless BACNET_STACK_LOCKS is set.
+
+   A subsystem lock may be taken again by the thread that holds it, so
+   that its functions can call each other. When more than one is needed
+   they are taken in this order, and released in reverse:
+
+       object store -> COV subscriptions -> TSM -> address cache -> DCC
+
+   all of them under stackLock when it is held, see the concurrency model in
+   bacnetProc.c.
+
+   The object store lock is a reader/writer lock, so that ReadProperty and
+   friends run side by side. Unlike the others it must never be taken again
+   by a thread that holds it, for reading or writing: SRW locks and writer
+   preferring rwlocks deadlock on a nested read once a writer is waiting.
+   Code that already holds it calls the _Locked variants, see
+   Device_Read_Property_Locked() and Device_Write_Property_Locked(). */
+
+#if (BACNET_STACK_LOCKS == 1)
+
+#include "osLayer.h"
+
+#define BACNET_LOCK_DEFINE(a)           static RecursiveLockDefine(a)
+#define BACNET_LOCK_INIT(a)             RecursiveLockInit(a)
+#define BACNET_LOCK(a)                  RecursiveLock(a)
+#define BACNET_UNLOCK(a)                RecursiveUnlock(a)
+
+#define BACNET_RWLOCK_DEFINE(a)         static RwLockDefine(a)
+#define BACNET_RWLOCK_INIT(a)           RwLockInit(a)
+#define BACNET_READ_LOCK(a)             RwLockRead(a)
+#define BACNET_READ_UNLOCK(a)           RwUnlockRead(a)
+#define BACNET_WRITE_LOCK(a)            RwLockWrite(a)
+#define BACNET_WRITE_UNLOCK(a)          RwUnlockWrite(a)
+
+#else
+
+/* a declaration, so that the ; after it is still legal at file scope */
+#define BACNET_LOCK_DEFINE(a)           struct bacnet_lock_unused_##a
+#define BACNET_LOCK_INIT(a)
+#define BACNET_LOCK(a)
+#define BACNET_UNLOCK(a)
+
+#define BACNET_RWLOCK_DEFINE(a)         struct bacnet_lock_unused_##a
+#define BACNET_RWLOCK_INIT(a)
+#define BACNET_READ_LOCK(a)
+#define BACNET_READ_UNLOCK(a)
+#define BACNET_WRITE_LOCK(a)
+#define BACNET_WRITE_UNLOCK(a)
+
+#endif
+
+#endif
@@ -45,6 +45,7 @@
 
 #include "net.h"
 #include <stdint.h>
+#include "timer_wheel.h"
 //#include <stdlib.h>
 //#include <time.h>
 //#define WIN32_LEAN_AND_MEAN
@@ -87,8 +88,8 @@ typedef struct {
     uint16_t dest_port;
     /* seconds for valid entry lifetime */
     uint16_t time_to_live;
-    /* our counter */
-    time_t seconds_remaining;   /* includes 30 second grace period */
+    /* our timer, in seconds */
+    BACNET_TIMER timer;     /* includes 30 second grace period */
 } FD_TABLE_ENTRY;
 
 typedef struct {
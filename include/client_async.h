@@ -0,0 +1,175 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#ifndef CLIENT_ASYNC_H
+#define CLIENT_ASYNC_H
+
+/* Functional Description: confirmed requests that call back when they are
+   done, so that one thread can have thousands of them in flight instead
+   of waiting on each in turn.
+
+   Each request takes one of the peer's own invoke IDs (see
+   tsm_next_free_invokeID_peer()) and the TSM keeps its completion with
+   the transaction. The callback is made exactly once, for the ACK, an
+   Error, an Abort, a Reject or the final timeout, and the invoke ID is
+   free again by the time it returns. It is made from whichever thread
+   hands the reply to apdu_handler(), or for a timeout from
+   tsm_timer_milliseconds(), and may send more requests from there.
+
+   Client_Async_Init() takes over the ACK and Error handlers of the
+   services below, and the Abort and Reject handlers, from apdu.c, and
+   the TSM's peer timeout handler. Replies and timeouts of requests that
+   are not its own go on to the handlers that were set before. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacenum.h"
+#include "rpm.h"
+
+typedef enum {
+    CLIENT_ASYNC_ACK,
+    CLIENT_ASYNC_ERROR,
+    CLIENT_ASYNC_ABORT,
+    CLIENT_ASYNC_REJECT,
+    CLIENT_ASYNC_TIMEOUT
+} CLIENT_ASYNC_RESULT;
+
+typedef struct Client_Async_Completion {
+    CLIENT_ASYNC_RESULT result;
+    /* the device that answered, or for a timeout, did not */
+    BACNET_ADDRESS *src;
+    uint8_t invoke_id;
+    /* the service that was asked for */
+    BACNET_CONFIRMED_SERVICE service;
+    /* ACK: the service ACK data of a ComplexACK, for
+       rp_ack_decode_service_request() or rpm_ack_decode_service_request(),
+       valid until the callback returns. NULL for a SimpleACK. */
+    uint8_t *service_request;
+    uint16_t service_len;
+    /* ERROR */
+    BACNET_ERROR_CLASS error_class;
+    BACNET_ERROR_CODE error_code;
+    /* ABORT and REJECT: the reason */
+    uint8_t reason;
+} CLIENT_ASYNC_COMPLETION;
+
+typedef void (
+    *client_async_callback) (
+    CLIENT_ASYNC_COMPLETION * completion,
+    void *context);
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    /* for the senders: an invoke ID for a request to dest, one of the
+       peer's own that carries the completion, or a stack wide one if
+       callback is NULL. 0 if there is none. */
+    uint8_t client_async_invoke_id(
+        BACNET_ADDRESS * dest,
+        BACNET_CONFIRMED_SERVICE service,
+        client_async_callback callback,
+        void *context);
+
+    /* the request was not sent after all: frees the invoke ID from
+       client_async_invoke_id(), without calling back */
+    void client_async_free_invoke_id(
+        BACNET_ADDRESS * dest,
+        uint8_t invoke_id);
+
+#if ( BACNET_CLIENT == 1 )
+    void Client_Async_Init(
+        void);
+
+    /* requests waiting for their completion */
+    unsigned Client_Async_Pending(
+        void);
+
+    /* As the requests without _Async, returning the invoke ID, or 0 if
+       nothing was sent and there will be no callback */
+    uint8_t Send_Read_Property_Request_Address_Async(
+        BACNET_ADDRESS * dest,
+        uint16_t max_apdu,
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance,
+        BACNET_PROPERTY_ID object_property,
+        uint32_t array_index,
+        client_async_callback callback,
+        void *context);
+    uint8_t Send_Read_Property_Request_Async(
+        uint32_t device_id,
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance,
+        BACNET_PROPERTY_ID object_property,
+        uint32_t array_index,
+        client_async_callback callback,
+        void *context);
+
+    uint8_t Send_Read_Property_Multiple_Request_Async(
+        uint8_t * pdu,
+        size_t max_pdu,
+        uint32_t device_id,
+        BACNET_READ_ACCESS_DATA * read_access_data,
+        client_async_callback callback,
+        void *context);
+
+    uint8_t Send_Write_Property_Request_Data_Async(
+        uint32_t device_id,
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance,
+        BACNET_PROPERTY_ID object_property,
+        uint8_t * application_data,
+        int application_data_len,
+        uint8_t priority,
+        uint32_t array_index,
+        client_async_callback callback,
+        void *context);
+    uint8_t Send_Write_Property_Request_Async(
+        uint32_t device_id,
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance,
+        BACNET_PROPERTY_ID object_property,
+        BACNET_APPLICATION_DATA_VALUE * object_value,
+        uint8_t priority,
+        uint32_t array_index,
+        client_async_callback callback,
+        void *context);
+#endif
+
+#ifdef TEST
+#include "ctest.h"
+    void testClientAsync(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,134 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#ifndef CLIENT_POLL_H
+#define CLIENT_POLL_H
+
+/* Functional Description: polls points, each an object property of a
+   device read every period, packing the reads that are due to the same
+   device into ReadPropertyMultiple requests, as many as the device's
+   max_apdu from the address cache takes, instead of one ReadProperty each.
+
+   The requests are asynchronous (client_async.h). The value of each point,
+   or the reason there is none, is handed to its own callback as the reply
+   is taken apart, without anything being allocated. A device that rejects
+   ReadPropertyMultiple is read with ReadProperty from then on, and one
+   that aborts a reply as too long is sent fewer reads at a time.
+
+   The application calls Client_Poll_Timer() as it calls
+   tsm_timer_milliseconds(), and sends the Who-Is for devices that are not
+   yet bound (address_bind_request()). Their points are reported as
+   timed out until they are. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "bacdef.h"
+#include "bacenum.h"
+#include "client_async.h"
+
+typedef struct Client_Poll_Value {
+    /* ACK, or the Error, Abort, Reject or timeout of the request, or for
+       ERROR, the property access error of this one read */
+    CLIENT_ASYNC_RESULT result;
+    uint32_t device_id;
+    BACNET_OBJECT_TYPE object_type;
+    uint32_t object_instance;
+    BACNET_PROPERTY_ID object_property;
+    uint32_t array_index;
+    /* ACK: the application tagged value as it came, for
+       bacapp_decode_application_data(), valid until the callback returns */
+    uint8_t *application_data;
+    int application_data_len;
+    /* ERROR */
+    BACNET_ERROR_CLASS error_class;
+    BACNET_ERROR_CODE error_code;
+    /* ABORT and REJECT */
+    uint8_t reason;
+} CLIENT_POLL_VALUE;
+
+typedef void (
+    *client_poll_callback) (
+    CLIENT_POLL_VALUE * value,
+    void *context);
+
+typedef struct Client_Poll_Point CLIENT_POLL_POINT;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#if ( BACNET_CLIENT == 1 )
+    /* also sets up client_async.h, Client_Async_Init() */
+    void Client_Poll_Init(
+        void);
+
+    /* reads the property of the device every period_ms, the first time
+       on the next Client_Poll_Timer(). NULL if out of memory. */
+    CLIENT_POLL_POINT *Client_Poll_Add(
+        uint32_t device_id,
+        BACNET_OBJECT_TYPE object_type,
+        uint32_t object_instance,
+        BACNET_PROPERTY_ID object_property,
+        uint32_t array_index,
+        uint32_t period_ms,
+        client_poll_callback callback,
+        void *context);
+
+    /* the point is not read again, and its memory goes when its last read
+       is done. Once it returns the callback is not called for the point,
+       and is not running on another thread: it waits for that call to
+       return, so it is not to be called holding anything the callbacks
+       take. From a callback it may remove any point. */
+    void Client_Poll_Remove(
+        CLIENT_POLL_POINT * point);
+
+    /* moves time on, and sends the reads that are due */
+    void Client_Poll_Timer(
+        uint16_t milliseconds);
+
+    /* milliseconds until the next read is due, UINT32_MAX if none */
+    uint32_t Client_Poll_Next_Milliseconds(
+        void);
+
+    /* the requests sent since Client_Poll_Init() */
+    unsigned Client_Poll_Requests(
+        void);
+#endif
+
+#ifdef TEST
+#include "ctest.h"
+    void testClientPoll(
+        Test * pTest);
+    void testClientPollBenchmark(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
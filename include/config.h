@@ -152,6 +152,201 @@
 #define MAX_TSM_TRANSACTIONS 255
 #endif
 
+#if (MAX_TSM_TRANSACTIONS)
+/* requests sent with invoke IDs of their own for each peer device
+   (tsm_next_free_invokeID_peer), in all, on top of the ones above.
+   They are allocated as they are needed, up to this many. */
+#if !defined(MAX_TSM_PEER_TRANSACTIONS)
+#define MAX_TSM_PEER_TRANSACTIONS 4096
+#endif
+
+/* how many of those may be in flight to one peer at once, when they are
+   sent with tsm_send_confirmed_unsegmented_transaction(); the rest wait
+   in the peer's queue. A peer starts at TSM_WINDOW_INITIAL, or at 1 if it
+   is behind a router or takes small APDUs (MS/TP). The window grows by
+   about one for each window of requests answered without a retry, and
+   halves on each timeout and Abort, between 1 and TSM_WINDOW_MAX. */
+#if !defined(TSM_WINDOW_INITIAL)
+#define TSM_WINDOW_INITIAL 2
+#endif
+#if !defined(TSM_WINDOW_MAX)
+#define TSM_WINDOW_MAX 16
+#endif
+
+/* how long a request to a peer waits for the reply before it is sent
+   again follows the round trip times measured to the peer, as TCP's
+   retransmission timer does (RFC 6298): the smoothed time plus four
+   deviations, or a quarter of it if that is more, in milliseconds
+   between these. It is apdu_timeout() until
+   a reply has been timed, and is as fine as tsm_timer_milliseconds() is
+   called. Only replies to requests that were sent once are timed, and
+   each timeout doubles the time, up to TSM_BACKOFF_MAX times, until one
+   is (Karn's algorithm). */
+#if !defined(TSM_TIMEOUT_MIN)
+#define TSM_TIMEOUT_MIN 500
+#endif
+#if !defined(TSM_TIMEOUT_MAX)
+#define TSM_TIMEOUT_MAX 10000
+#endif
+#if !defined(TSM_BACKOFF_MAX)
+#define TSM_BACKOFF_MAX 4
+#endif
+#endif
+
+/* the client poll scheduler (client_poll.h): the most reads it packs into
+   one ReadPropertyMultiple, the requests it has in flight to a device at
+   once, and how long it takes a value to be until it has read it */
+#if !defined(CLIENT_POLL_MAX_READS)
+#define CLIENT_POLL_MAX_READS 128
+#endif
+#if !defined(CLIENT_POLL_DEVICE_REQUESTS)
+#define CLIENT_POLL_DEVICE_REQUESTS 1
+#endif
+#if !defined(CLIENT_POLL_VALUE_SIZE)
+#define CLIENT_POLL_VALUE_SIZE 8
+#endif
+
+/* the first block of the arena that a ReadProperty or
+   ReadPropertyMultiple ACK is decoded into (decode_arena.h). Each block
+   after it is twice the size of the one before. */
+#if !defined(DECODE_ARENA_BLOCK_SIZE)
+#define DECODE_ARENA_BLOCK_SIZE 4096
+#endif
+
+/* Segmented ComplexACKs (RPM, ReadRange, GetEventInformation replies that do
+   not fit in one APDU) are sent by the TSM, which needs transactions. */
+#if !defined(BACNET_SEGMENTATION_TRANSMIT)
+#if (MAX_TSM_TRANSACTIONS)
+#define BACNET_SEGMENTATION_TRANSMIT 1
+#else
+#define BACNET_SEGMENTATION_TRANSMIT 0
+#endif
+#endif
+
+/* Segmented ComplexACKs to our own confirmed requests are put back together
+   by the TSM. Segmented requests are still refused. */
+#if !defined(BACNET_SEGMENTATION_RECEIVE)
+#if (MAX_TSM_TRANSACTIONS)
+#define BACNET_SEGMENTATION_RECEIVE 1
+#else
+#define BACNET_SEGMENTATION_RECEIVE 0
+#endif
+#endif
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+/* number of segmented replies that can be in progress at once, each
+   keeps a copy of the reply in a MAX_SEGMENTED_APDU buffer */
+#if !defined(MAX_SEGMENTED_RESPONSES)
+#define MAX_SEGMENTED_RESPONSES 2
+#endif
+#endif
+
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+/* number of segmented ACKs that can be put back together at once, each
+   takes a MAX_SEGMENTED_APDU buffer */
+#if !defined(MAX_SEGMENTED_REASSEMBLY)
+#define MAX_SEGMENTED_REASSEMBLY 1
+#endif
+/* the max-segments-accepted we ask for: 2, 4, 8, 16, 32 or 64. Keep
+   MAX_SEGMENTED_APDU at least this many APDUs. */
+#if !defined(MAX_SEGMENTS_ACCEPTED)
+#define MAX_SEGMENTS_ACCEPTED 4
+#endif
+#endif
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1) || (BACNET_SEGMENTATION_RECEIVE == 1)
+/* the largest ComplexACK, before segmentation. Must stay below 64K.
+   Every segmented response, reassembly and transmit buffer is this big, so
+   the default is small; raise it (and the segment counts) for devices that
+   serve or read large lists. */
+#if !defined(MAX_SEGMENTED_APDU)
+#define MAX_SEGMENTED_APDU (MAX_APDU * 4)
+#endif
+#if (MAX_SEGMENTED_APDU > 65535)
+#error "MAX_SEGMENTED_APDU must be less than 64K"
+#endif
+/* the window size we propose with the first segment of a reply, and the
+   largest we accept when receiving one */
+#if !defined(TSM_PROPOSED_WINDOW_SIZE)
+#define TSM_PROPOSED_WINDOW_SIZE 16
+#endif
+#endif
+
+/* keep the old global Handler_Transmit_Buffer for the demo applications and
+   ports that still build their own packets in it */
+#if !defined(BACNET_GLOBAL_TX_BUFFER)
+#define BACNET_GLOBAL_TX_BUFFER 1
+#endif
+
+/* Received NPDUs are handled on the datalink thread by default. With worker
+   threads they are copied to a queue of MAX_WORKER_QUEUE entries and handled
+   by a pool of threads instead, each source always by the same one; a PDU that arrives to a full queue is
+   dropped, and the client retries. The TSM, COV subscriptions, address cache
+   and object store each have a lock of their own (BACNET_STACK_LOCKS) so that
+   the workers only wait for each other where they share state. */
+#if !defined(BACNET_WORKER_THREADS)
+#define BACNET_WORKER_THREADS 0
+#endif
+#if !defined(MAX_WORKER_QUEUE)
+#define MAX_WORKER_QUEUE 32
+#endif
+#if !defined(MAX_WORKER_THREADS)
+#define MAX_WORKER_THREADS 8
+#endif
+#if (BACNET_WORKER_THREADS > MAX_WORKER_THREADS)
+#error "BACNET_WORKER_THREADS is more than MAX_WORKER_THREADS"
+#endif
+#if !defined(BACNET_STACK_LOCKS)
+#if (BACNET_WORKER_THREADS > 0)
+#define BACNET_STACK_LOCKS 1
+#else
+#define BACNET_STACK_LOCKS 0
+#endif
+#endif
+
+/* The handlers build each reply or request in a transmit buffer of their
+   own, taken from a small pool, so that requests can be handled by more than
+   one thread. A handler holds two at the most, so there are two for each
+   worker thread and two for the datalink thread. Should the pool be empty
+   all the same, the request is answered with Abort(out-of-resources). */
+#if !defined(MAX_TX_BUFFERS)
+#if (BACNET_WORKER_THREADS > 1)
+#define MAX_TX_BUFFERS (2 * (BACNET_WORKER_THREADS + 1))
+#else
+#define MAX_TX_BUFFERS 4
+#endif
+#endif
+#if (MAX_TX_BUFFERS < (2 * (BACNET_WORKER_THREADS + 1)))
+#error "MAX_TX_BUFFERS is fewer than two for each worker thread"
+#endif
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+/* buffers big enough for a whole reply before segmentation, each takes
+   MAX_NPDU + MAX_SEGMENTED_APDU + MAX_APDU. RPM takes one only when its
+   reply does not fit the ones above. ReadRange and GetEventInformation take
+   them whenever the client accepts segments, and make do with the ones
+   above, unsegmented, when none is free. */
+#if !defined(MAX_TX_SEGMENTED_BUFFERS)
+#define MAX_TX_SEGMENTED_BUFFERS 2
+#endif
+#endif
+
+/* Linux only, BACnet/IP only. Instead of a datalink thread polling the socket
+   every 100 ms and an idle thread ticking every 10 ms, one epoll loop waits
+   on the datalink socket, a timerfd that fires every BACNET_EVENT_LOOP_TIMER_MS
+   for the stack timers, and an eventfd for wakeups, so that nothing runs
+   while there is nothing to do and what a message changes (COV) goes out
+   straight away. The loop has MAX_EVENT_LOOP_FDS slots for sockets, the
+   datalink's and the application's. See eventLoop.h. */
+#if !defined(BACNET_EVENT_LOOP)
+#define BACNET_EVENT_LOOP 0
+#endif
+#if !defined(BACNET_EVENT_LOOP_TIMER_MS)
+#define BACNET_EVENT_LOOP_TIMER_MS 1000
+#endif
+#if !defined(MAX_EVENT_LOOP_FDS)
+#define MAX_EVENT_LOOP_FDS 8
+#endif
+
 /* The address cache is used for binding to BACnet devices */
 /* The number of entries corresponds to the number of */
 /* devices that might respond to an I-Am on the network. */
@@ -370,6 +565,10 @@
 #define BACNET_USE_SIGNED           1
 #endif
 
+#ifndef BACNET_PROPERTY_CACHE       /* Keep pre-encoded static properties for RP/RPM? */
+#define BACNET_PROPERTY_CACHE       1
+#endif
+
 
 /* And a similar method for optional BACnet Objects */
 
@@ -43,6 +43,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "bacapp.h"
+#include "timer_wheel.h"
 
 typedef struct BACnet_COV_Address {
     bool valid : 1;
@@ -62,7 +63,8 @@ typedef struct {
     int8_t dest_index;      // Has to be signed, tested for < 0 in places
     uint8_t invokeID;   /* for confirmed COV */
     uint32_t subscriberProcessIdentifier;
-    uint32_t lifetime;  /* optional */
+    uint32_t lifetime;  /* optional, as subscribed, 0 is indefinite */
+    BACNET_TIMER timer; /* what is left of it, in seconds */
     BACNET_OBJECT_ID monitoredObjectIdentifier;
 } BACNET_COV_SUBSCRIPTION ;
 
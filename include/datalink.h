@@ -52,6 +52,10 @@
 
 void Init_Datalink_Thread( void )  ;
 
+/* the pieces of the datalink thread, for an event loop that does its work instead */
+bool DatalinkReceive(unsigned timeout);
+void DatalinkMaintenance(void);
+
 #if defined(BACDL_ETHERNET)
 #include "ethernet.h"
 
@@ -45,6 +45,10 @@
 #include "bacenum.h"
 #include "bacstr.h"
 
+/* sets up the lock, before any other thread uses DCC */
+void dcc_init(
+    void);
+
 /* return the status */
 BACNET_COMMUNICATION_ENABLE_DISABLE dcc_enable_status(
     void);
@@ -0,0 +1,84 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#ifndef DECODE_ARENA_H
+#define DECODE_ARENA_H
+
+/* Functional Description: an arena that everything decoded from one
+   received APDU is allocated from, so that the result, however many
+   pieces it has, goes back to the heap in one call. */
+
+#include <stddef.h>
+
+typedef struct BACnet_Decode_Arena_Block DECODE_ARENA_BLOCK;
+
+typedef struct BACnet_Decode_Arena {
+    DECODE_ARENA_BLOCK *blocks; /* newest first */
+    size_t first_block_size;
+    size_t block_size;  /* size of the next block; each is twice the last */
+    size_t used;        /* bytes handed out from the newest block */
+    size_t remaining;   /* bytes left in the newest block */
+    unsigned block_count;       /* blocks taken from the heap */
+} DECODE_ARENA;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    /* first_block_size is the size of the first block, which is only
+       taken from the heap when something is allocated */
+    void decode_arena_init(
+        DECODE_ARENA * arena,
+        size_t first_block_size);
+
+    /* size bytes, zeroed and aligned for any type, or NULL if the heap
+       is out of memory. With a NULL arena this is calloc(). */
+    void *decode_arena_calloc(
+        DECODE_ARENA * arena,
+        size_t size);
+
+    /* gives back something from decode_arena_calloc(). With an arena this
+       does nothing, the memory is given back by decode_arena_release(). */
+    void decode_arena_free(
+        DECODE_ARENA * arena,
+        void *data);
+
+    /* gives back everything allocated from the arena. It can be used
+       again afterwards. */
+    void decode_arena_release(
+        DECODE_ARENA * arena);
+
+#ifdef TEST
+#include "ctest.h"
+    void testDecodeArena(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
@@ -0,0 +1,95 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#ifndef ENCODE_CURSOR_H
+#define ENCODE_CURSOR_H
+
+/* Functional Description: a bounded cursor into an APDU being encoded, so
+   that encoders can write straight into the transmit buffer instead of
+   into a temporary buffer that is then copied. */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct BACnet_Encode_Cursor {
+    uint8_t *buffer;    /* start of the encoding */
+    unsigned offset;    /* number of bytes encoded so far */
+    unsigned capacity;  /* number of bytes that may be kept */
+    unsigned size;      /* number of bytes that may be written, the size
+                           of the buffer. capacity is never more than this.
+                           Writing past capacity is harmless, but
+                           it is never kept. */
+} BACNET_ENCODE_CURSOR;
+
+/* where the next byte goes */
+#define encode_cursor_tail(c) (&(c)->buffer[(c)->offset])
+/* the number of bytes that can still be kept */
+#define encode_cursor_room(c) ((c)->capacity - (c)->offset)
+/* the encoded length, which is also a mark to roll back to */
+#define encode_cursor_mark(c) ((c)->offset)
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void encode_cursor_init(
+        BACNET_ENCODE_CURSOR * cursor,
+        uint8_t * buffer,
+        unsigned capacity,
+        unsigned size);
+
+    /* drops everything encoded after the mark */
+    void encode_cursor_rollback(
+        BACNET_ENCODE_CURSOR * cursor,
+        unsigned mark);
+
+    /* where to encode something of at most max_len bytes: at the tail
+       when the buffer has max_len bytes left there, otherwise the scratch
+       buffer, which may be NULL if there is none */
+    uint8_t *encode_cursor_reserve(
+        BACNET_ENCODE_CURSOR * cursor,
+        uint8_t * scratch,
+        unsigned max_len);
+
+    /* keeps len bytes encoded at the pointer from encode_cursor_reserve(),
+       copying them if it was the scratch buffer. Returns false, and keeps
+       nothing, if they do not fit or len is negative. */
+    bool encode_cursor_commit(
+        BACNET_ENCODE_CURSOR * cursor,
+        uint8_t * data,
+        int len);
+
+#ifdef TEST
+#include "ctest.h"
+    void testEncodeCursor(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
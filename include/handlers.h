@@ -49,6 +49,7 @@
 //#include "rd.h"
 //#include "rp.h"
 #include "rpm.h"
+#include "decode_arena.h"
 #include "wp.h"
 //#include "readrange.h"
 #include "getevent.h"
@@ -62,6 +63,12 @@ void handler_unrecognized_service(
 	BACNET_ADDRESS * dest,
 	BACNET_CONFIRMED_SERVICE_DATA * service_data);
 
+/* answers a confirmed request that could not be handled for want of a
+   transmit buffer with Abort(out-of-resources), without one */
+void handler_out_of_resources(
+	BACNET_ADDRESS * src,
+	BACNET_CONFIRMED_SERVICE_DATA * service_data);
+
 void npdu_handler(
 	BACNET_ADDRESS * src,   /* source address */
 	uint8_t * pdu,  /* PDU data */
@@ -272,6 +279,13 @@ int rpm_ack_decode_service_request(
     int apdu_len,
     BACNET_READ_ACCESS_DATA * read_access_data);
 
+/* The same, allocating the list from an arena for the ACK. */
+int rpm_ack_decode_service_request_arena(
+    uint8_t * apdu,
+    int apdu_len,
+    DECODE_ARENA * arena,
+    BACNET_READ_ACCESS_DATA * read_access_data);
+
 /* print the RP Ack data to stdout */
 
 void rp_ack_print_data(
@@ -404,6 +418,16 @@ void get_event_ack_handler(
 	BACNET_ADDRESS *src,
 	BACNET_CONFIRMED_SERVICE_ACK_DATA *service_data);
 
+#ifdef TEST
+#include "ctest.h"
+void testReadPropertyAckArena(
+    Test * pTest);
+void testReadPropertyMultipleAckArena(
+    Test * pTest);
+void testReadPropertyMultipleAckArenaBenchmark(
+    Test * pTest);
+#endif
+
 
 /** @defgroup MISCHNDLR Miscellaneous Handler Utilities
  * Various utilities and functions to support the Handlers.
@@ -63,6 +63,17 @@ struct special_property_list_t {
     struct property_list_t Proprietary;
 };
 
+/* Standard properties (0-511) as one bit each */
+#define PROPERTY_SET_STANDARD_MAX   512
+
+/* The property lists of one object type, counted once at startup, plus a
+   membership bitmap, so RPM ALL/REQUIRED/OPTIONAL expansion and the
+   unknown property checks do not walk the lists on every request. */
+typedef struct property_set_t {
+    struct special_property_list_t Lists;
+    uint32_t Members[PROPERTY_SET_STANDARD_MAX / 32];
+} BACNET_PROPERTY_SET;
+
 unsigned property_list_count(
     const BACNET_PROPERTY_ID *pList);
 
@@ -91,4 +102,27 @@ int property_list_encode(
     const BACNET_PROPERTY_ID *pListOptional,
     const BACNET_PROPERTY_ID *pListProprietary);
 
+void property_set_init(
+    BACNET_PROPERTY_SET * pSet,
+    const BACNET_PROPERTY_ID *pListRequired,
+    const BACNET_PROPERTY_ID *pListOptional,
+    const BACNET_PROPERTY_ID *pListProprietary);
+
+bool property_set_member(
+    const BACNET_PROPERTY_SET * pSet,
+    BACNET_PROPERTY_ID property);
+
+unsigned property_set_count(
+    const BACNET_PROPERTY_SET * pSet,
+    BACNET_PROPERTY_ID special_property);
+
+BACNET_PROPERTY_ID property_set_property(
+    const BACNET_PROPERTY_SET * pSet,
+    BACNET_PROPERTY_ID special_property,
+    unsigned index);
+
+int property_set_encode(
+    BACNET_READ_PROPERTY_DATA * rpdata,
+    const BACNET_PROPERTY_SET * pSet);
+
 #endif
@@ -54,6 +54,7 @@ typedef struct BACnet_Read_Range_Data {
     BACNET_BIT_STRING ResultFlags;  /**<  FIRST_ITEM, LAST_ITEM, MORE_ITEMS. */
     int RequestType;/**< Index, sequence or time based request. */
     int Overhead;    /**< How much space the baggage takes in the response. */
+    int MaxApdu;     /**< How much space the response has, more if it may be segmented. */
     uint32_t ItemCount;
     uint32_t FirstSequence;
     union { /**< Pick the appropriate data type. */
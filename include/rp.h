@@ -58,6 +58,8 @@ typedef struct BACnet_Read_Property_Data {
 
 /* Forward declaration of RPM-style data structure */
 struct BACnet_Read_Access_Data;
+/* and of the arena it can be decoded into (decode_arena.h) */
+struct BACnet_Decode_Arena;
 
 /** Reads one property for this object type of a given instance.
  * A function template; @see device.c for assignment to object types.
@@ -111,6 +113,13 @@ int rp_ack_fully_decode_service_request(
     int apdu_len,
     struct BACnet_Read_Access_Data *read_access_data);
 
+/* The same, allocating the result from an arena. */
+int rp_ack_fully_decode_service_request_arena(
+    uint8_t * apdu,
+    int apdu_len,
+    struct BACnet_Decode_Arena *arena,
+    struct BACnet_Read_Access_Data *read_access_data);
+
 #ifdef TEST
 #include "ctest.h"
 int rp_decode_apdu(
@@ -46,6 +46,7 @@
 #include "bacdef.h"
 #include "bacapp.h"
 #include "proplist.h"
+#include "encode_cursor.h"
 
 /*
  * Bundle together commonly used data items for convenience when calling
@@ -165,6 +166,38 @@ int rpm_ack_encode_apdu_object_property_error(
     int rpm_ack_encode_apdu_object_end(
         uint8_t * apdu);
 
+/* RPM Ack encoded in place through a cursor. Each returns false, and
+   leaves the cursor where it was, if its part does not fit. */
+bool rpm_ack_cursor_object_begin(
+    BACNET_ENCODE_CURSOR * cursor,
+    BACNET_RPM_DATA * rpmdata);
+
+bool rpm_ack_cursor_object_property(
+    BACNET_ENCODE_CURSOR * cursor,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index);
+
+/* opens the property value, and returns where the value itself is to be
+   encoded (MAX_APDU bytes): in place if there is room, otherwise scratch */
+uint8_t *rpm_ack_cursor_value_begin(
+    BACNET_ENCODE_CURSOR * cursor,
+    uint8_t * scratch);
+
+/* keeps the value encoded where rpm_ack_cursor_value_begin() said and
+   closes it. On false, roll back to before the value was begun. */
+bool rpm_ack_cursor_value_end(
+    BACNET_ENCODE_CURSOR * cursor,
+    uint8_t * application_data,
+    int application_data_len);
+
+bool rpm_ack_cursor_object_property_error(
+    BACNET_ENCODE_CURSOR * cursor,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code);
+
+bool rpm_ack_cursor_object_end(
+    BACNET_ENCODE_CURSOR * cursor);
+
 int rpm_ack_decode_object_id(
     uint8_t * apdu,
     unsigned apdu_len,
@@ -0,0 +1,58 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#ifndef SEGMENTACK_H
+#define SEGMENTACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* BACnet-SegmentACK-PDU, 20.1.6 */
+typedef struct BACnet_Segment_Ack_Data {
+    bool negative_ack;          /* segment received out of order */
+    bool server;                /* sent by the server of the transaction */
+    uint8_t invoke_id;
+    uint8_t sequence_number;    /* last segment received in order */
+    uint8_t actual_window_size;
+} BACNET_SEGMENT_ACK_DATA;
+
+int segmentack_encode_apdu(
+    uint8_t * apdu,
+    BACNET_SEGMENT_ACK_DATA * data);
+
+int segmentack_decode_apdu(
+    uint8_t * apdu,
+    unsigned apdu_len,
+    BACNET_SEGMENT_ACK_DATA * data);
+
+#ifdef TEST
+#include "ctest.h"
+void testSegmentAck(
+    Test * pTest);
+#endif
+
+#endif
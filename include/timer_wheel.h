@@ -0,0 +1,126 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+/* Functional Description: a hierarchical timer wheel, for subsystems that
+   keep a deadline per table entry (transactions, subscriptions, bindings).
+   Only the live deadlines are on the wheel, so advancing it costs the
+   number of timers that expire and not the size of the tables.
+
+   The wheel does not know what a tick is, each owner advances its own
+   wheel in its own unit: the TSM in milliseconds, the caches in seconds.
+   It has no lock, it is guarded by whatever guards its owner, and the
+   callbacks run from timer_wheel_advance() under that too. An all zero
+   wheel or timer is a valid empty one. */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* 5 levels of 64 slots, 64^5 ticks (12 days in milliseconds) ahead.
+   Later deadlines wait at the far end and are put back as they come
+   round. */
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1U << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS  5
+
+struct BACnet_Timer;
+typedef void (
+    *timer_wheel_callback) (
+    struct BACnet_Timer * timer);
+
+typedef struct BACnet_Timer {
+    struct BACnet_Timer *next;
+    struct BACnet_Timer **pprev;    /* NULL when not on a wheel */
+    uint32_t expires;               /* wheel time it is due */
+    uint16_t slot;                  /* level * TIMER_WHEEL_SLOTS + slot */
+    timer_wheel_callback callback;
+    void *context;
+} BACNET_TIMER;
+
+typedef struct BACnet_Timer_Wheel {
+    uint32_t now;
+    unsigned count;
+    uint64_t occupied[TIMER_WHEEL_LEVELS];  /* a bit per non-empty slot */
+    BACNET_TIMER *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} BACNET_TIMER_WHEEL;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void timer_wheel_init(
+        BACNET_TIMER_WHEEL * wheel);
+
+    /* (re)starts the timer, due in ticks (at least 1) from now */
+    void timer_wheel_start(
+        BACNET_TIMER_WHEEL * wheel,
+        BACNET_TIMER * timer,
+        uint32_t ticks,
+        timer_wheel_callback callback,
+        void *context);
+
+    void timer_wheel_stop(
+        BACNET_TIMER_WHEEL * wheel,
+        BACNET_TIMER * timer);
+
+    bool timer_wheel_pending(
+        const BACNET_TIMER * timer);
+
+    /* ticks until it is due, 0 if it is not pending */
+    uint32_t timer_wheel_remaining(
+        const BACNET_TIMER_WHEEL * wheel,
+        const BACNET_TIMER * timer);
+
+    /* moves time on, calling back each timer as it comes due. A callback
+       may start and stop timers, its own included. */
+    void timer_wheel_advance(
+        BACNET_TIMER_WHEEL * wheel,
+        uint32_t ticks);
+
+    /* ticks that can pass before anything is due, perhaps fewer (a far
+       deadline counts from when it is next moved along), UINT32_MAX if
+       the wheel is empty */
+    uint32_t timer_wheel_next(
+        const BACNET_TIMER_WHEEL * wheel);
+
+    unsigned timer_wheel_count(
+        const BACNET_TIMER_WHEEL * wheel);
+
+#ifdef TEST
+#include "ctest.h"
+    void testTimerWheel(
+        Test * pTest);
+    void testTimerWheelBenchmark(
+        Test * pTest);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif
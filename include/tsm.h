@@ -45,18 +45,29 @@
 #include <stddef.h>
 #include "bacdef.h"
 #include "npdu.h"
+#include "apdu.h"
+#include "timer_wheel.h"
 
 /* note: TSM functionality is optional - only needed if we are
    doing client requests */
 #if (!MAX_TSM_TRANSACTIONS)
 #define tsm_free_invoke_id(x) (void)x;
+#define tsm_free_invoke_id_peer(s, x) (void)s; (void)x;
+#define tsm_reply_invoke_id_peer(s, x) (void)s; (void)x;
+#define tsm_abort_invoke_id_peer(s, x) (void)s; (void)x;
 #else
 typedef enum {
     TSM_STATE_IDLE,
     TSM_STATE_AWAIT_CONFIRMATION,
     TSM_STATE_AWAIT_RESPONSE,
     TSM_STATE_SEGMENTED_REQUEST,
-    TSM_STATE_SEGMENTED_CONFIRMATION
+    TSM_STATE_SEGMENTED_CONFIRMATION,
+    /* a segmented ComplexACK reassembled, until its invoke ID is freed */
+    TSM_STATE_SEGMENTED_COMPLETE,
+    /* server side, sending a segmented ComplexACK */
+    TSM_STATE_SEGMENTED_RESPONSE,
+    /* a request waiting for the peer's window to have room */
+    TSM_STATE_QUEUED
 } BACNET_TSM_STATE;
 
 /* 5.4.1 Variables And Parameters */
@@ -66,25 +77,25 @@ typedef struct BACnet_TSM_Data {
     /* used to count APDU retries */
     uint8_t RetryCount;
     /* used to count segment retries */
-    /*uint8_t SegmentRetryCount;  */
+    uint8_t SegmentRetryCount;
     /* used to control APDU retries and the acceptance of server replies */
-    /*bool SentAllSegments;  */
+    bool SentAllSegments;
     /* stores the sequence number of the last segment received in order */
-    /*uint8_t LastSequenceNumber; */
+    uint8_t LastSequenceNumber;
     /* stores the sequence number of the first segment of */
     /* a sequence of segments that fill a window */
-    /*uint8_t InitialSequenceNumber; */
+    uint8_t InitialSequenceNumber;
     /* stores the current window size */
-    /*uint8_t ActualWindowSize; */
+    uint8_t ActualWindowSize;
     /* stores the window size proposed by the segment sender */
-    /*uint8_t ProposedWindowSize;  */
-    /*  used to perform timeout on PDU segments */
-    /*uint8_t SegmentTimer; */
-    /* used to perform timeout on Confirmed Requests */
-    /* in milliseconds */
-    uint16_t RequestTimer;
+    uint8_t ProposedWindowSize;
+    /* used to perform timeout on Confirmed Requests, and on PDU */
+    /* segments, in milliseconds on the TSM timer wheel */
+    BACNET_TIMER Timer;
     /* unique id */
     uint8_t InvokeID;
+    /* whoever sent the request keeps what it needs here */
+    void *context;
     /* state that the TSM is in */
     BACNET_TSM_STATE state;
 
@@ -95,6 +106,17 @@ typedef struct BACnet_TSM_Data {
     /* copy of the APDU, should we need to send it again */
     uint8_t apdu[MAX_PDU];
     unsigned apdu_len;
+
+    /* segmented ComplexACK: the service ACK data that follows the
+       ComplexACK header, cut into segment_size pieces when we send it,
+       and put back together (segment_data_len so far) when we receive it */
+    uint8_t service_choice;
+    uint8_t *segment_data;
+    unsigned segment_data_len;
+    uint16_t segment_size;
+    unsigned segment_count;
+    /* segment number of InitialSequenceNumber, which wraps at 256 */
+    unsigned segment_base;
 } BACNET_TSM_DATA;
 
 typedef void(
@@ -104,6 +126,10 @@ typedef void(
 void tsm_set_timeout_handler(
     tsm_timeout_function pFunction);
 
+/* sets up the TSM lock, before any other thread uses the TSM */
+void tsm_init(
+    void);
+
 bool tsm_transaction_available(
     void);
         
@@ -113,6 +139,11 @@ uint8_t tsm_transaction_idle_count(
 void tsm_timer_milliseconds(
     uint16_t milliseconds);
 
+/* milliseconds until the next TSM timeout could be due,
+   UINT32_MAX if nothing is waiting */
+uint32_t tsm_timer_next_milliseconds(
+    void);
+
 /* free the invoke ID when the reply comes back */
 void tsm_free_invoke_id(
     uint8_t invokeID);
@@ -146,6 +177,160 @@ uint8_t tsm_next_free_invokeID(
     bool tsm_invoke_id_failed(
         uint8_t invokeID);
 
+/* Invoke IDs are only unique between two devices, so each peer has 255
+   of its own, and a client polling many devices is not limited to 255
+   requests in flight in all. These transactions are keyed by the peer's
+   address and the invoke ID, and a reply only matches one of the invoke
+   IDs above if it comes from where that request went. They keep clear of
+   the peers' while there are others, and the peers' of them. */
+
+/* reserves the next invoke ID for requests to dest, 0 if there is none */
+    uint8_t tsm_next_free_invokeID_peer(
+        BACNET_ADDRESS * dest);
+
+/* frees the transaction, when the reply comes back from src. Falls back
+   to the invoke IDs above, if the request went to src */
+    void tsm_free_invoke_id_peer(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID);
+
+    bool tsm_invoke_id_free_peer(
+        BACNET_ADDRESS * dest,
+        uint8_t invokeID);
+
+    bool tsm_invoke_id_failed_peer(
+        BACNET_ADDRESS * dest,
+        uint8_t invokeID);
+
+/* A pointer kept with the transaction for whoever sent the request, such
+   as the completion of an asynchronous one. It is NULL until it is set,
+   and again once it is taken or the transaction is freed, so only one of
+   the replies, the timeout or the sender giving up gets it. */
+    bool tsm_set_transaction_context(
+        BACNET_ADDRESS * dest,
+        uint8_t invokeID,
+        void *context);
+
+    void *tsm_take_transaction_context(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID);
+
+/* Sends the request, as tsm_set_confirmed_unsegmented_transaction() and
+   datalink_send_pdu() would, if fewer than the peer's window are in
+   flight to it; otherwise it waits in the peer's queue, and is sent once
+   the replies to those before it make room (see TSM_WINDOW_INITIAL).
+   Requests with the invoke IDs of TSM_List are sent right away.
+   Returns the bytes sent, apdu_len if it was queued, or -1. */
+    int tsm_send_confirmed_unsegmented_transaction(
+        uint8_t invokeID,
+        BACNET_ADDRESS * dest,
+        BACNET_NPCI_DATA * ndpu_data,
+        uint8_t * apdu,
+        uint16_t apdu_len);
+
+/* frees the transaction as tsm_free_invoke_id_peer(), when src answered
+   it with an ACK, an Error or a Reject. The reply is timed, and the
+   peer's window grows, which giving up on a request does not do. */
+    void tsm_reply_invoke_id_peer(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID);
+
+/* frees the transaction as tsm_free_invoke_id_peer(), when src aborted
+   it, which halves the peer's window */
+    void tsm_abort_invoke_id_peer(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID);
+
+/* the window of the device, in requests, and how many requests are in
+   flight to it and waiting in its queue. False if it is not bound. */
+    bool tsm_device_window(
+        uint32_t device_id,
+        unsigned *window,
+        unsigned *in_flight,
+        unsigned *queued);
+
+/* the smoothed round trip time to the device and its mean deviation, 0
+   until a reply from it has been timed, and the time requests to it wait
+   for the reply before they are sent again, in milliseconds (see
+   TSM_TIMEOUT_MIN). False if it is not bound. */
+    bool tsm_device_timeout(
+        uint32_t device_id,
+        unsigned *srtt,
+        unsigned *rttvar,
+        unsigned *timeout);
+
+/* the number of transactions in the peers' invoke ID spaces */
+    unsigned tsm_peer_transaction_count(
+        void);
+
+typedef void(
+    *tsm_peer_timeout_function) (
+        BACNET_ADDRESS * dest,
+        uint8_t invoke_id);
+
+/* called for every request that was never answered, from either invoke
+   ID space, with the address it went to. Both handlers are called from
+   tsm_timer_milliseconds() after it has let go of the TSM, so they may
+   use it, or send, as they like. */
+void tsm_set_peer_timeout_handler(
+    tsm_peer_timeout_function pFunction);
+
+/* the handler set above, NULL if there is none */
+tsm_peer_timeout_function tsm_peer_timeout_handler(
+    void);
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+/* Sends a ComplexACK that is too big for one APDU as segments, and keeps
+   the transaction until the client has acknowledged the last one.
+   apdu is the unsegmented ComplexACK, as the handlers encode it.
+   Returns false, and the abort reason to send, if it cannot be done. */
+    bool tsm_set_segmented_complex_ack(
+        BACNET_ADDRESS * dest,
+        BACNET_NPCI_DATA * npci_data,
+        uint8_t max_segs,
+        uint16_t max_resp,
+        uint8_t * apdu,
+        unsigned apdu_len,
+        BACNET_ABORT_REASON * abort_reason);
+
+/* the largest ComplexACK (unsegmented header included) that we can send
+   to a client that takes max_segs segments of max_resp */
+    unsigned tsm_segmented_complex_ack_max(
+        uint8_t max_segs,
+        uint16_t max_resp);
+
+/* a Segment-ACK from the client of a segmented ComplexACK */
+    void tsm_segmentack_received(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID,
+        uint8_t sequence_number,
+        uint8_t actual_window_size);
+
+/* an Abort from the client of a segmented ComplexACK */
+    void tsm_segmented_response_abort(
+        BACNET_ADDRESS * src,
+        uint8_t invokeID);
+
+    unsigned tsm_segmented_response_count(
+        void);
+#endif
+
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+/* A segment of the ComplexACK to one of our requests, from src. The TSM
+   keeps and Segment-ACKs them until the last one is in, then points
+   service_request at the whole service ACK data and returns its length.
+   That stays valid until tsm_free_invoke_id(). Returns 0 while more is to
+   come, or if the segment was dropped or the transaction aborted. */
+    uint16_t tsm_segmented_complex_ack_received(
+        BACNET_ADDRESS * src,
+        BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data,
+        uint8_t ** service_request,
+        uint16_t service_request_len);
+
+    unsigned tsm_segmented_confirmation_count(
+        void);
+#endif
+
 /* define out any functions necessary for compile */
 #endif
 #endif
@@ -45,6 +45,42 @@
 #include "config.h"
 #include "datalink.h"
 
+#if (BACNET_GLOBAL_TX_BUFFER == 1)
 extern uint8_t Handler_Transmit_Buffer[MAX_PDU];
+#endif
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+/* a whole reply before segmentation, and MAX_APDU more so that a value can
+   be encoded in place however close to the end of the reply it starts */
+#define TXBUF_SEGMENTED_SIZE (MAX_NPDU + MAX_SEGMENTED_APDU + MAX_APDU)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+    void txbuf_init(
+        void);
+
+    /* a MAX_PDU buffer, or NULL if they are all in use */
+    uint8_t *txbuf_acquire(
+        void);
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    /* a TXBUF_SEGMENTED_SIZE buffer, or NULL if they are all in use */
+    uint8_t *txbuf_acquire_segmented(
+        void);
+#endif
+
+    /* gives back either kind of buffer, NULL is ignored */
+    void txbuf_release(
+        uint8_t * pdu);
+
+    unsigned txbuf_in_use(
+        void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
 
 #endif
@@ -42,6 +42,8 @@ SRCS = main.c \
        ..\..\demo\handler\h_wp.c  \
        ..\..\demo\handler\h_rp.c  \
        ..\..\demo\handler\noserv.c  \
+       ..\..\demo\handler\client_async.c  \
+       ..\..\demo\handler\client_poll.c  \
        ..\..\demo\handler\txbuf.c  \
        ..\..\demo\handler\s_iam.c  \
        ..\..\demo\handler\s_rp.c  \
@@ -70,10 +72,12 @@ SRCS = main.c \
        ..\..\demo\object\lsp.c \
        ..\..\demo\object\mso.c \
        ..\..\datalink.c \
+       ..\..\timer_wheel.c \
        ..\..\tsm.c \
        ..\..\address.c \
        ..\..\abort.c \
        ..\..\reject.c \
+       ..\..\segmentack.c \
        ..\..\bacerror.c \
        ..\..\apdu.c \
        ..\..\npdu.c
@@ -77,6 +77,9 @@ BACNET_ABORT_REASON abort_convert_error_code(
         case ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED:
             abort_code = ABORT_REASON_SEGMENTATION_NOT_SUPPORTED;
             break;
+        case ERROR_CODE_ABORT_OUT_OF_RESOURCES:
+            abort_code = ABORT_REASON_OUT_OF_RESOURCES;
+            break;
         case ERROR_CODE_ABORT_PROPRIETARY:
             abort_code = ABORT_REASON_PROPRIETARY_FIRST;
             break;
@@ -52,6 +52,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "config.h"
 #include "bacaddr.h"
 #include "address.h"
@@ -60,6 +61,8 @@
 #include "readrange.h"
 #include "debug.h"
 #include "bactext.h"
+#include "bacnet_lock.h"
+#include "timer_wheel.h"
 
 /** @file address.c  Handle address binding */
 
@@ -85,9 +88,16 @@ static struct Address_Cache_Entry {
     uint32_t        device_id;
     unsigned max_apdu;
     BACNET_ADDRESS address;
-    uint32_t        TimeToLive;
+    BACNET_TIMER    TimeToLive;     /* not running for static entries */
+    BACNET_ADDRESS_LEARNED learned; /* see address_learned_get() */
 } Address_Cache[MAX_ADDRESS_CACHE];
 
+/* the TTLs of the entries that expire, in seconds */
+static BACNET_TIMER_WHEEL Address_Wheel;
+
+/* the cache and the two above, taken by each of the public functions */
+BACNET_LOCK_DEFINE(Address_Lock);
+
 /* State flags for cache entries */
 
 #define BAC_ADDR_IN_USE    1    /* Address cache entry in use */
@@ -103,6 +113,46 @@ static struct Address_Cache_Entry {
 #define BAC_ADDR_SHORT_TIME BAC_ADDR_SECS_1HOUR
 #define BAC_ADDR_FOREVER    0xFFFFFFFF  /* Permanent entry */
 
+/* Address_Lock is held, from address_cache_timer() */
+static void address_ttl_expired(
+    BACNET_TIMER * timer)
+{
+    struct Address_Cache_Entry *pMatch =
+        (struct Address_Cache_Entry *) timer->context;
+
+    pMatch->Flags = 0;
+}
+
+/* BAC_ADDR_FOREVER never expires */
+static void address_ttl_set(
+    struct Address_Cache_Entry *pMatch,
+    uint32_t seconds)
+{
+    if (seconds == BAC_ADDR_FOREVER) {
+        timer_wheel_stop(&Address_Wheel, &pMatch->TimeToLive);
+    } else {
+        timer_wheel_start(&Address_Wheel, &pMatch->TimeToLive, seconds,
+            address_ttl_expired, pMatch);
+    }
+}
+
+static uint32_t address_ttl_get(
+    const struct Address_Cache_Entry *pMatch)
+{
+    if (!timer_wheel_pending(&pMatch->TimeToLive)) {
+        return BAC_ADDR_FOREVER;
+    }
+    return timer_wheel_remaining(&Address_Wheel, &pMatch->TimeToLive);
+}
+
+/* an entry is free */
+static void address_entry_clear(
+    struct Address_Cache_Entry *pMatch)
+{
+    timer_wheel_stop(&Address_Wheel, &pMatch->TimeToLive);
+    pMatch->Flags = 0;
+}
+
 #if defined ( _MSC_VER  )
 void print_address_cache(void)
 {
@@ -115,7 +165,7 @@ void print_address_cache(void)
             Address_Cache[i].device_id,
             Address_Cache[i].max_apdu,
             "mxxxx", // bactext_bacnet_path ( tbuf, &Address_Cache[i].address.bacnetPath ), 
-            Address_Cache[i].TimeToLive,
+            address_ttl_get(&Address_Cache[i]),
             Address_Cache[i].Flags
             );
     }
@@ -124,12 +174,16 @@ void print_address_cache(void)
 
 void address_protected_entry_index_set(uint32_t top_protected_entry_index)
 {
+    BACNET_LOCK(Address_Lock);
     Top_Protected_Entry = top_protected_entry_index;
+    BACNET_UNLOCK(Address_Lock);
 }
 
 void address_own_device_id_set(uint32_t own_id)
 {
+    BACNET_LOCK(Address_Lock);
     Own_Device_ID = own_id;
+    BACNET_UNLOCK(Address_Lock);
 }
 
 bool address_match(
@@ -174,11 +228,12 @@ void address_remove_device(
     struct Address_Cache_Entry *pMatch;
     uint32_t index = 0;
 
+    BACNET_LOCK(Address_Lock);
     pMatch = Address_Cache;
     while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
         if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
             (pMatch->device_id == device_id)) {
-            pMatch->Flags = 0;
+            address_entry_clear(pMatch);
             if (index < Top_Protected_Entry) {
                 Top_Protected_Entry--;
             }
@@ -187,6 +242,7 @@ void address_remove_device(
         pMatch++;
         index++;
     }
+    BACNET_UNLOCK(Address_Lock);
 
 }
 
@@ -219,8 +275,8 @@ static struct Address_Cache_Entry *address_remove_oldest(
         if ((pMatch->
                 Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ |
                     BAC_ADDR_STATIC)) == BAC_ADDR_IN_USE) {
-            if (pMatch->TimeToLive <= ulTime) { /* Shorter lived entry found */
-                ulTime = pMatch->TimeToLive;
+            if (address_ttl_get(pMatch) <= ulTime) {    /* Shorter lived entry found */
+                ulTime = address_ttl_get(pMatch);
                 pCandidate = pMatch;
             }
         }
@@ -229,7 +285,7 @@ static struct Address_Cache_Entry *address_remove_oldest(
 
     if (pCandidate != NULL) {   /* Found something to free up */
         pCandidate->Flags = BAC_ADDR_RESERVED;
-        pCandidate->TimeToLive = BAC_ADDR_SHORT_TIME;   /* only reserve it for a short while */
+        address_ttl_set(pCandidate, BAC_ADDR_SHORT_TIME);       /* only reserve it for a short while */
         return (pCandidate);
     }
 
@@ -240,8 +296,8 @@ static struct Address_Cache_Entry *address_remove_oldest(
                 Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ |
                     BAC_ADDR_STATIC)) ==
             ((uint8_t) (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ))) {
-            if (pMatch->TimeToLive <= ulTime) { /* Shorter lived entry found */
-                ulTime = pMatch->TimeToLive;
+            if (address_ttl_get(pMatch) <= ulTime) {    /* Shorter lived entry found */
+                ulTime = address_ttl_get(pMatch);
                 pCandidate = pMatch;
             }
         }
@@ -250,7 +306,7 @@ static struct Address_Cache_Entry *address_remove_oldest(
 
     if (pCandidate != NULL) {   /* Found something to free up */
         pCandidate->Flags = BAC_ADDR_RESERVED;
-        pCandidate->TimeToLive = BAC_ADDR_SHORT_TIME;   /* only reserve it for a short while */
+        address_ttl_set(pCandidate, BAC_ADDR_SHORT_TIME);       /* only reserve it for a short while */
     }
 
     return (pCandidate);
@@ -406,13 +462,16 @@ void address_init(
 {
     struct Address_Cache_Entry *pMatch;
 
+    BACNET_LOCK_INIT(Address_Lock);
+    BACNET_LOCK(Address_Lock);
    Top_Protected_Entry = 0;
 
     pMatch = Address_Cache;
     while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        pMatch->Flags = 0;
+        address_entry_clear(pMatch);
         pMatch++;
     }
+    BACNET_UNLOCK(Address_Lock);
 #ifdef BACNET_ADDRESS_CACHE_FILE
     address_file_init(Address_Cache_Filename);
 #endif
@@ -432,12 +491,18 @@ void address_init_partial(
 {
     struct Address_Cache_Entry *pMatch;
 
+    BACNET_LOCK(Address_Lock);
+    /* the wheel does not survive a reset, so the bound entries that do
+       start a fresh time to live */
+    timer_wheel_init(&Address_Wheel);
     pMatch = Address_Cache;
     while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
+        memset(&pMatch->TimeToLive, 0, sizeof(pMatch->TimeToLive));
         if ((pMatch->Flags & BAC_ADDR_IN_USE) != 0) {   /* It's in use so let's check further */
-            if (((pMatch->Flags & BAC_ADDR_BIND_REQ) != 0) ||
-                (pMatch->TimeToLive == 0))
+            if ((pMatch->Flags & BAC_ADDR_BIND_REQ) != 0)
                 pMatch->Flags = 0;
+            else if ((pMatch->Flags & BAC_ADDR_STATIC) == 0)
+                address_ttl_set(pMatch, BAC_ADDR_LONG_TIME);
         }
 
         if ((pMatch->Flags & BAC_ADDR_RESERVED) != 0) { /* Reserved entries should be cleared */
@@ -446,6 +511,7 @@ void address_init_partial(
 
         pMatch++;
     }
+    BACNET_UNLOCK(Address_Lock);
 #if ( USE_FILE_CACHE == 1 )
     address_file_init(Address_Cache_Filename);
 #endif
@@ -467,6 +533,7 @@ void address_set_device_TTL(
 {
     struct Address_Cache_Entry *pMatch;
 
+    BACNET_LOCK(Address_Lock);
     pMatch = Address_Cache;
     while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
         if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
@@ -474,18 +541,19 @@ void address_set_device_TTL(
             if ((pMatch->Flags & BAC_ADDR_BIND_REQ) == 0) {     /* If bound then we have either static or normaal */
                 if (StaticFlag) {
                     pMatch->Flags |= BAC_ADDR_STATIC;
-                    pMatch->TimeToLive = BAC_ADDR_FOREVER;
+                    address_ttl_set(pMatch, BAC_ADDR_FOREVER);
                 } else {
                     pMatch->Flags &= ~BAC_ADDR_STATIC;
-                    pMatch->TimeToLive = TimeOut;
+                    address_ttl_set(pMatch, TimeOut);
                 }
             } else {
-                pMatch->TimeToLive = TimeOut;   /* For unbound we can only set the time to live */
+                address_ttl_set(pMatch, TimeOut);   /* For unbound we can only set the time to live */
             }
             break;      /* Exit now if found at all - bound or unbound */
         }
         pMatch++;
     }
+    BACNET_UNLOCK(Address_Lock);
 }
 
 
@@ -497,6 +565,7 @@ bool address_get_by_device(
     struct Address_Cache_Entry *pMatch;
     bool found = false; /* return value */
 
+    BACNET_LOCK(Address_Lock);
     pMatch = Address_Cache;
     while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
         if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
@@ -510,6 +579,7 @@ bool address_get_by_device(
         }
         pMatch++;
     }
+    BACNET_UNLOCK(Address_Lock);
 
     return found;
 }
@@ -523,6 +593,7 @@ bool address_get_device_id(
     struct Address_Cache_Entry *pMatch;
     bool found = false; /* return value */
 
+    BACNET_LOCK(Address_Lock);
     pMatch = Address_Cache;
     while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
         if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) == BAC_ADDR_IN_USE) {       /* If bound */
@@ -536,10 +607,67 @@ bool address_get_device_id(
         }
         pMatch++;
     }
+    BACNET_UNLOCK(Address_Lock);
 
     return found;
 }
 
+/* the bound entry of the device at src, NULL if none.
+   Address_Lock is held */
+static struct Address_Cache_Entry *address_find_bound(
+    BACNET_ADDRESS * src)
+{
+    struct Address_Cache_Entry *pMatch;
+
+    pMatch = Address_Cache;
+    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
+        if (((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
+                BAC_ADDR_IN_USE) &&
+            bacnet_address_same(&pMatch->address, src)) {
+            return pMatch;
+        }
+        pMatch++;
+    }
+
+    return NULL;
+}
+
+bool address_learned_get(
+    BACNET_ADDRESS * src,
+    unsigned *max_apdu,
+    BACNET_ADDRESS_LEARNED * learned)
+{
+    struct Address_Cache_Entry *pMatch;
+
+    BACNET_LOCK(Address_Lock);
+    pMatch = address_find_bound(src);
+    if (pMatch != NULL) {
+        if (max_apdu) {
+            *max_apdu = pMatch->max_apdu;
+        }
+        if (learned) {
+            *learned = pMatch->learned;
+        }
+    }
+    BACNET_UNLOCK(Address_Lock);
+
+    return (pMatch != NULL);
+}
+
+void address_learned_set(
+    BACNET_ADDRESS * src,
+    BACNET_ADDRESS_LEARNED * learned)
+{
+    struct Address_Cache_Entry *pMatch;
+
+    BACNET_LOCK(Address_Lock);
+    pMatch = address_find_bound(src);
+    if (pMatch != NULL) {
+        pMatch->learned = *learned;
+    }
+    BACNET_UNLOCK(Address_Lock);
+}
+
 void address_add(
     uint32_t device_id,
     unsigned max_apdu,
@@ -548,7 +676,9 @@ void address_add(
     bool found = false; /* return value */
     struct Address_Cache_Entry *pMatch;
 
+    BACNET_LOCK(Address_Lock);
     if (Own_Device_ID == device_id) {
+        BACNET_UNLOCK(Address_Lock);
         return;
     }
 
@@ -563,19 +693,22 @@ void address_add(
     while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
         if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
             (pMatch->device_id == device_id)) {
+            if (!bacnet_address_same(&pMatch->address, src)) {
+                memset(&pMatch->learned, 0, sizeof(pMatch->learned));
+            }
             bacnet_address_copy(&pMatch->address, src);
             pMatch->max_apdu = max_apdu;
 
             /* Pick the right time to live */
 
             if ((pMatch->Flags & BAC_ADDR_BIND_REQ) != 0)       /* Bind requested so long time */
-                pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
+                address_ttl_set(pMatch, BAC_ADDR_LONG_TIME);
             else if ((pMatch->Flags & BAC_ADDR_STATIC) != 0)    /* Static already so make sure it never expires */
-                pMatch->TimeToLive = BAC_ADDR_FOREVER;
+                address_ttl_set(pMatch, BAC_ADDR_FOREVER);
             else if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) != 0) /* Opportunistic entry so leave on short fuse */
-                pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
+                address_ttl_set(pMatch, BAC_ADDR_SHORT_TIME);
             else
-                pMatch->TimeToLive = BAC_ADDR_LONG_TIME;        /* Renewing existing entry */
+                address_ttl_set(pMatch, BAC_ADDR_LONG_TIME);        /* Renewing existing entry */
 
             pMatch->Flags &= ~BAC_ADDR_BIND_REQ;        /* Clear bind request flag just in case */
             found = true;
@@ -592,8 +725,9 @@ void address_add(
                 pMatch->Flags = BAC_ADDR_IN_USE;
                 pMatch->device_id = device_id;
                 pMatch->max_apdu = max_apdu;
+                memset(&pMatch->learned, 0, sizeof(pMatch->learned));
                 bacnet_address_copy(&pMatch->address, src);
-                pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;       /* Opportunistic entry so leave on short fuse */
+                address_ttl_set(pMatch, BAC_ADDR_SHORT_TIME);       /* Opportunistic entry so leave on short fuse */
                 found = true;
                 break;
             }
@@ -608,15 +742,16 @@ void address_add(
             pMatch->Flags = BAC_ADDR_IN_USE;
             pMatch->device_id = device_id;
             pMatch->max_apdu = max_apdu;
+            memset(&pMatch->learned, 0, sizeof(pMatch->learned));
             bacnet_address_copy(&pMatch->address, src);
-            pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;   /* Opportunistic entry so leave on short fuse */
+            address_ttl_set(pMatch, BAC_ADDR_SHORT_TIME);   /* Opportunistic entry so leave on short fuse */
         }
     }
+    BACNET_UNLOCK(Address_Lock);
 }
 
-/* returns true if device is already bound */
-/* also returns the address and max apdu if already bound */
-bool address_device_bind_request(
+/* Address_Lock is held */
+static bool address_device_bind_request_locked(
     uint32_t device_id,
     uint32_t * device_ttl,
     unsigned *max_apdu,
@@ -639,11 +774,11 @@ bool address_device_bind_request(
                     *max_apdu = pMatch->max_apdu;
                 }
                 if (device_ttl) {
-                    *device_ttl = pMatch->TimeToLive;
+                    *device_ttl = address_ttl_get(pMatch);
                 }
                 if ((pMatch->Flags & BAC_ADDR_SHORT_TTL) != 0) {        /* Was picked up opportunistacilly */
                     pMatch->Flags &= ~BAC_ADDR_SHORT_TTL;       /* Convert to normal entry  */
-                    pMatch->TimeToLive = BAC_ADDR_LONG_TIME;    /* And give it a decent time to live */
+                    address_ttl_set(pMatch, BAC_ADDR_LONG_TIME);    /* And give it a decent time to live */
                 }
             }
             return (found);     /* True if bound, false if bind request outstanding */
@@ -658,8 +793,9 @@ bool address_device_bind_request(
             /* In use and awaiting binding */
             pMatch->Flags = (uint8_t) (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ);
             pMatch->device_id = device_id;
+            memset(&pMatch->learned, 0, sizeof(pMatch->learned));
             /* No point in leaving bind requests in for long haul */
-            pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
+            address_ttl_set(pMatch, BAC_ADDR_SHORT_TIME);
             /* now would be a good time to do a Who-Is request */
             return (false);
         }
@@ -671,12 +807,32 @@ bool address_device_bind_request(
     if (pMatch != NULL) {
         pMatch->Flags = (uint8_t) (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ);
         pMatch->device_id = device_id;
+        memset(&pMatch->learned, 0, sizeof(pMatch->learned));
         /* No point in leaving bind requests in for long haul */
-        pMatch->TimeToLive = BAC_ADDR_SHORT_TIME;
+        address_ttl_set(pMatch, BAC_ADDR_SHORT_TIME);
     }
     return (false);
 }
 
+/* returns true if device is already bound */
+/* also returns the address and max apdu if already bound */
+bool address_device_bind_request(
+    uint32_t device_id,
+    uint32_t * device_ttl,
+    unsigned *max_apdu,
+    BACNET_ADDRESS * src)
+{
+    bool found;
+
+    BACNET_LOCK(Address_Lock);
+    found =
+        address_device_bind_request_locked(device_id, device_ttl, max_apdu,
+        src);
+    BACNET_UNLOCK(Address_Lock);
+
+    return found;
+}
+
 /* returns true if device is already bound */
 /* also returns the address and max apdu if already bound */
 bool address_bind_request(
@@ -695,10 +851,14 @@ void address_add_binding(
     struct Address_Cache_Entry *pMatch;
 
     /* existing device or bind request - update address */
+    BACNET_LOCK(Address_Lock);
     pMatch = Address_Cache;
     while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
         if (((pMatch->Flags & BAC_ADDR_IN_USE) != 0) &&
             (pMatch->device_id == device_id)) {
+            if (!bacnet_address_same(&pMatch->address, src)) {
+                memset(&pMatch->learned, 0, sizeof(pMatch->learned));
+            }
             bacnet_address_copy(&pMatch->address, src);
             pMatch->max_apdu = max_apdu;
             /* Clear bind request flag in case it was set */
@@ -706,12 +866,13 @@ void address_add_binding(
             /* Only update TTL if not static */
             if ((pMatch->Flags & BAC_ADDR_STATIC) == 0) {
                 /* and set it on a long fuse */
-                pMatch->TimeToLive = BAC_ADDR_LONG_TIME;
+                address_ttl_set(pMatch, BAC_ADDR_LONG_TIME);
             }
             break;
         }
         pMatch++;
     }
+    BACNET_UNLOCK(Address_Lock);
 }
 
 bool address_device_get_by_index(
@@ -725,6 +886,7 @@ bool address_device_get_by_index(
     bool found = false; /* return value */
 
     if (index < MAX_ADDRESS_CACHE) {
+        BACNET_LOCK(Address_Lock);
         pMatch = &Address_Cache[index];
         if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
             BAC_ADDR_IN_USE) {
@@ -738,10 +900,11 @@ bool address_device_get_by_index(
                 *max_apdu = pMatch->max_apdu;
             }
             if (device_ttl) {
-                *device_ttl = pMatch->TimeToLive;
+                *device_ttl = address_ttl_get(pMatch);
             }
             found = true;
         }
+        BACNET_UNLOCK(Address_Lock);
     }
 
     return found;
@@ -762,6 +925,7 @@ unsigned address_count(
     struct Address_Cache_Entry *pMatch;
     unsigned count = 0; /* return value */
 
+    BACNET_LOCK(Address_Lock);
     pMatch = Address_Cache;
     while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
         /* Only count bound entries */
@@ -771,6 +935,7 @@ unsigned address_count(
 
         pMatch++;
     }
+    BACNET_UNLOCK(Address_Lock);
 
     return count;
 }
@@ -793,6 +958,7 @@ int address_list_encode(
        the packet to work with as at the moment it is just MAX_APDU */
     apdu_len = apdu_len;
     /* look for matching address */
+    BACNET_LOCK(Address_Lock);
     pMatch = Address_Cache;
     while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
         if ((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_BIND_REQ)) ==
@@ -819,6 +985,7 @@ int address_list_encode(
         }
         pMatch++;
     }
+    BACNET_UNLOCK(Address_Lock);
 
     return (iLen);
 }
@@ -833,8 +1000,8 @@ int address_list_encode(
  * extract entries by doing a linear scan starting from the first entry in  *
  * the cache and picking them off one by one.                               *
  *                                                                          *
- * We do assume the list cannot change whilst we are accessing it so would  *
- * not be multithread safe if there are other tasks that change the cache.  *
+ * The list must not change whilst we are accessing it, so the wrapper     *
+ * holds Address_Lock for the whole of it when BACNET_STACK_LOCKS is set.   *
  *                                                                          *
  * We take the simple approach here to filling the buffer by taking a max   *
  * size for a single entry and then stopping if there is less than that     *
@@ -848,7 +1015,8 @@ int address_list_encode(
 
 #define ACACHE_MAX_ENC 17       /* Maximum size of encoded cache entry, see above */
 
-int rr_address_list_encode(
+/* Address_Lock is held */
+static int rr_address_list_encode_locked(
     uint8_t * apdu,
     BACNET_READ_RANGE_DATA * pRequest)
 {
@@ -869,7 +1037,7 @@ int rr_address_list_encode(
     bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_LAST_ITEM, false);
     bitstring_set_bit(&pRequest->ResultFlags, RESULT_FLAG_MORE_ITEMS, false);
     /* See how much space we have */
-    uiRemaining = (uint32_t) (MAX_APDU - pRequest->Overhead);
+    uiRemaining = (uint32_t) (pRequest->MaxApdu - pRequest->Overhead);
 
     pRequest->ItemCount = 0;    /* Start out with nothing */
     uiTotal = address_count();  /* What do we have to work with here ? */
@@ -992,8 +1160,22 @@ int rr_address_list_encode(
     return (iLen);
 }
 
+int rr_address_list_encode(
+    uint8_t * apdu,
+    BACNET_READ_RANGE_DATA * pRequest)
+{
+    int iLen;
+
+    /* the count and the entries must not change between them */
+    BACNET_LOCK(Address_Lock);
+    iLen = rr_address_list_encode_locked(apdu, pRequest);
+    BACNET_UNLOCK(Address_Lock);
+
+    return (iLen);
+}
+
 /****************************************************************************
- * Scan the cache and eliminate any expired entries. Should be called       *
+ * Eliminate any expired entries, as they fall due. Should be called       *
  * periodically to ensure the cache is managed correctly. If this function  *
  * is never called at all the whole cache is effectivly rendered static and *
  * entries never expire unless explictely deleted.                          *
@@ -1004,20 +1186,10 @@ int rr_address_list_encode(
 void address_cache_timer(
     uint16_t uSeconds)
 {       /* Approximate number of seconds since last call to this function */
-    struct Address_Cache_Entry *pMatch;
-
-    pMatch = Address_Cache;
-    while (pMatch <= &Address_Cache[MAX_ADDRESS_CACHE - 1]) {
-        if (((pMatch->Flags & (BAC_ADDR_IN_USE | BAC_ADDR_RESERVED)) != 0)
-            && ((pMatch->Flags & BAC_ADDR_STATIC) == 0)) {      /* Check all entries holding a slot except statics */
-            if (pMatch->TimeToLive >= uSeconds)
-                pMatch->TimeToLive -= uSeconds;
-            else
-                pMatch->Flags = 0;
-        }
-
-        pMatch++;
-    }
+    /* only the entries that can expire are on the wheel, statics are not */
+    BACNET_LOCK(Address_Lock);
+    timer_wheel_advance(&Address_Wheel, uSeconds);
+    BACNET_UNLOCK(Address_Lock);
 }
 
 
@@ -1177,6 +1349,49 @@ void testAddress(
     }
 }
 
+void testAddressTimeToLive(
+    Test * pTest)
+{
+    BACNET_ADDRESS src;
+    BACNET_ADDRESS test_address;
+    unsigned test_max_apdu = 0;
+    uint32_t device_ttl = 0;
+
+    address_init();
+    /* seen, not asked for: an hour */
+    set_address(1, &src);
+    address_add(1001, 480, &src);
+    set_address(2, &src);
+    address_add(1002, 480, &src);
+    address_set_device_TTL(1002, 0, true);
+    ct_test(pTest, address_count() == 2);
+    ct_test(pTest, address_device_bind_request(1001, &device_ttl,
+            &test_max_apdu, &test_address));
+    ct_test(pTest, device_ttl == BAC_ADDR_SHORT_TIME);
+    address_cache_timer(60);
+    ct_test(pTest, address_device_bind_request(1001, &device_ttl,
+            &test_max_apdu, &test_address));
+    ct_test(pTest, device_ttl == (BAC_ADDR_SHORT_TIME - 60));
+    /* gone on the second, only the static one is left */
+    address_cache_timer(BAC_ADDR_SHORT_TIME - 61);
+    ct_test(pTest, address_get_by_device(1001, &test_max_apdu,
+            &test_address));
+    address_cache_timer(1);
+    ct_test(pTest, !address_get_by_device(1001, &test_max_apdu,
+            &test_address));
+    ct_test(pTest, address_count() == 1);
+    ct_test(pTest, address_get_by_device(1002, &test_max_apdu,
+            &test_address));
+    address_cache_timer(60000);
+    ct_test(pTest, address_get_by_device(1002, &test_max_apdu,
+            &test_address));
+    ct_test(pTest, address_device_bind_request(1002, &device_ttl,
+            &test_max_apdu, &test_address));
+    ct_test(pTest, device_ttl == BAC_ADDR_FOREVER);
+    address_remove_device(1002);
+    ct_test(pTest, address_count() == 0);
+}
+
 #ifdef TEST_ADDRESS
 int main(
     void)
@@ -1188,6 +1403,8 @@ int main(
     /* individual tests */
     rc = ct_addTestFunction(pTest, testAddress);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testAddressTimeToLive);
+    assert(rc);
 #ifdef BACNET_ADDRESS_CACHE_FILE
     rc = ct_addTestFunction(pTest, testAddressFile);
     assert(rc);
@@ -58,6 +58,7 @@
 #include "dcc.h"
 #include "iam.h"
 #include "device.h"
+#include "segmentack.h"
 
 /* Punchlist for EKH */
 /*
@@ -108,6 +109,8 @@
 static uint16_t Timeout_Milliseconds = 10000;
 /* Number of APDU Retries */
 static uint8_t Number_Of_Retries = 3;
+/* APDU Segment Timeout in Milliseconds */
+static uint16_t Segment_Timeout_Milliseconds = 2000;
 
 /* a simple table for crossing the services supported */
 static BACNET_SERVICES_SUPPORTED
@@ -347,6 +350,23 @@ void apdu_set_confirmed_ack_handler(
     }
 }
 
+confirmed_simple_ack_function apdu_confirmed_simple_ack_handler(
+    BACNET_CONFIRMED_SERVICE service_choice)
+{
+    if (service_choice >= MAX_BACNET_CONFIRMED_SERVICE)
+        return NULL;
+    return (confirmed_simple_ack_function)
+        Confirmed_ACK_Function[service_choice];
+}
+
+confirmed_ack_function apdu_confirmed_ack_handler(
+    BACNET_CONFIRMED_SERVICE service_choice)
+{
+    if (service_choice >= MAX_BACNET_CONFIRMED_SERVICE)
+        return NULL;
+    return Confirmed_ACK_Function[service_choice];
+}
+
 #if ( BACNET_CLIENT == 1 )
 static error_function Error_Function[MAX_BACNET_CONFIRMED_SERVICE];
 
@@ -358,6 +378,14 @@ void apdu_set_error_handler(
         Error_Function[service_choice] = pFunction;
 }
 
+error_function apdu_error_handler(
+    BACNET_CONFIRMED_SERVICE service_choice)
+{
+    if (service_choice >= MAX_BACNET_CONFIRMED_SERVICE)
+        return NULL;
+    return Error_Function[service_choice];
+}
+
 static abort_function Abort_Function;
 
 void apdu_set_abort_handler(
@@ -366,6 +394,12 @@ void apdu_set_abort_handler(
     Abort_Function = pFunction;
 }
 
+abort_function apdu_abort_handler(
+    void)
+{
+    return Abort_Function;
+}
+
 static reject_function Reject_Function;
 
 void apdu_set_reject_handler(
@@ -373,6 +407,12 @@ void apdu_set_reject_handler(
 {
     Reject_Function = pFunction;
 }
+
+reject_function apdu_reject_handler(
+    void)
+{
+    return Reject_Function;
+}
 #endif // ( BACNET_CLIENT == 1 )
 
 
@@ -429,6 +469,18 @@ void apdu_retries_set(
     Number_Of_Retries = value;
 }
 
+uint16_t apdu_segment_timeout(
+    void)
+{
+    return Segment_Timeout_Milliseconds;
+}
+
+void apdu_segment_timeout_set(
+    uint16_t milliseconds)
+{
+    Segment_Timeout_Milliseconds = milliseconds;
+}
+
 
 /* When network communications are completely disabled,
    only DeviceCommunicationControl and ReinitializeDevice APDUs
@@ -502,6 +554,9 @@ void apdu_handler(
 {
     BACNET_CONFIRMED_SERVICE_DATA service_data = { 0 };
     BACNET_CONFIRMED_SERVICE_ACK_DATA service_ack_data = { 0 };
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    BACNET_SEGMENT_ACK_DATA segment_ack_data;
+#endif
     uint8_t invoke_id = 0;
     BACNET_CONFIRMED_SERVICE service_choice ;
     uint8_t *service_request = NULL;
@@ -511,7 +566,9 @@ void apdu_handler(
     uint32_t len_value = 0;
     uint32_t error_code = 0;
     uint32_t error_class = 0;
-    // BACNET_ABORT_REASON reason ;
+#if ( BACNET_CLIENT == 1 )
+    BACNET_ABORT_REASON reason;
+#endif
     bool server = false;
 
     if (apdu) {
@@ -582,7 +639,7 @@ void apdu_handler(
                                 Confirmed_ACK_Function[service_choice]) (src,
                                 invoke_id);
                         }
-                        tsm_free_invoke_id(invoke_id);
+                        tsm_reply_invoke_id_peer(src, invoke_id);
                         break;
                     default:
                         break;
@@ -602,6 +659,20 @@ void apdu_handler(
                 service_choice = (BACNET_CONFIRMED_SERVICE)apdu[len++];
                 service_request = &apdu[len];
                 service_request_len = apdu_len - (uint16_t) len;
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+                if (service_ack_data.segmented_message) {
+                    /* the TSM keeps the segments, and hands us the whole
+                       ACK with the last one */
+                    service_request_len =
+                        tsm_segmented_complex_ack_received(src,
+                        &service_ack_data, &service_request,
+                        service_request_len);
+                    if (service_request_len == 0) {
+                        break;
+                    }
+                    service_ack_data.segmented_message = false;
+                }
+#endif
                 switch (service_choice) {
                     case SERVICE_CONFIRMED_GET_ALARM_SUMMARY:
                     case SERVICE_CONFIRMED_GET_ENROLLMENT_SUMMARY:
@@ -626,16 +697,24 @@ void apdu_handler(
                                 (service_request, service_request_len, src,
                                 &service_ack_data);
                         }
-                        tsm_free_invoke_id(invoke_id);
+                        tsm_reply_invoke_id_peer(src, invoke_id);
                         break;
                     default:
                         break;
                 }
                 break;
             case PDU_TYPE_SEGMENT_ACK:
-                /* FIXME: what about a denial of service attack here?
-                   we could check src to see if that matched the tsm */
-                tsm_free_invoke_id(invoke_id);
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+                /* from the client of a segmented reply of ours; the TSM
+                   matches src as well as the invoke ID */
+                if ((segmentack_decode_apdu(apdu, apdu_len,
+                            &segment_ack_data) > 0) &&
+                    !segment_ack_data.server) {
+                    tsm_segmentack_received(src, segment_ack_data.invoke_id,
+                        segment_ack_data.sequence_number,
+                        segment_ack_data.actual_window_size);
+                }
+#endif
                 break;
 
 #if ( BACNET_CLIENT == 1 )
@@ -677,25 +756,34 @@ void apdu_handler(
                             (BACNET_ERROR_CLASS) error_class,
                             (BACNET_ERROR_CODE) error_code);
                 }
-                tsm_free_invoke_id(invoke_id);
+                tsm_reply_invoke_id_peer(src, invoke_id);
                 break;
 
             case PDU_TYPE_REJECT:
                 invoke_id = apdu[1];
                 if (Reject_Function)
                     Reject_Function(src, invoke_id, (BACNET_REJECT_REASON) apdu[2] );
-                tsm_free_invoke_id(invoke_id);
+                tsm_reply_invoke_id_peer(src, invoke_id);
                 break;
+#endif
 
             case PDU_TYPE_ABORT:
                 server = apdu[0] & 0x01;
                 invoke_id = apdu[1];
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+                if (!server) {
+                    /* the client gave up on a segmented reply of ours */
+                    tsm_segmented_response_abort(src, invoke_id);
+                    break;
+                }
+#endif
+#if ( BACNET_CLIENT == 1 )
                 reason = (BACNET_ABORT_REASON) apdu[2];
                 if (Abort_Function)
                     Abort_Function(src, invoke_id, reason, server);
-                tsm_free_invoke_id(invoke_id);
-                break;
+                tsm_abort_invoke_id_peer(src, invoke_id);
 #endif
+                break;
 
             default:
                 break;
@@ -1784,6 +1784,8 @@ static INDTEXT_DATA bacnet_abort_reason_names[] = {
     ,
     {ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, "Segmentation Not Supported"}
     ,
+    {ABORT_REASON_OUT_OF_RESOURCES, "Out of Resources"}
+    ,
     {ABORT_REASON_PROPRIETARY_FIRST, "Proprietary"}
     ,
     {0, NULL}
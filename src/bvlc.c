@@ -131,6 +131,8 @@ registration.*/
 #define MAX_FD_ENTRIES 128
 #endif
 static FD_TABLE_ENTRY FD_Table[MAX_FD_ENTRIES];
+/* the registrations, counting down in seconds */
+static BACNET_TIMER_WHEEL FD_Wheel;
 
 
 /* Define BBMD_BACKUP_FILE if the contents of the BDT
@@ -195,6 +197,15 @@ void bvlc_bdt_backup_local (void) {}
 void bvlc_bdt_restore_local(void) {}
 #endif
 
+/* a registration was not renewed in time */
+static void bvlc_fd_expired(
+    BACNET_TIMER * timer)
+{
+    FD_TABLE_ENTRY *fd_entry = (FD_TABLE_ENTRY *) timer->context;
+
+    fd_entry->valid = false;
+}
+
 /** A timer function that is called about once a second.
  *
  * @param seconds - number of elapsed seconds since the last call
@@ -202,21 +213,8 @@ void bvlc_bdt_restore_local(void) {}
 void bvlc_maintenance_timer(
     time_t seconds)
 {
-    unsigned i = 0;
-
-    for (i = 0; i < MAX_FD_ENTRIES; i++) {
-        if (FD_Table[i].valid) {
-            if (FD_Table[i].seconds_remaining) {
-                if (FD_Table[i].seconds_remaining < seconds) {
-                    FD_Table[i].seconds_remaining = 0;
-                } else {
-                    FD_Table[i].seconds_remaining -= seconds;
-                }
-                if (FD_Table[i].seconds_remaining == 0) {
-                    FD_Table[i].valid = false;
-                }
-            }
-        }
+    if (seconds > 0) {
+        timer_wheel_advance(&FD_Wheel, (uint32_t) seconds);
     }
 }
 
@@ -619,6 +617,7 @@ static int bvlc_encode_read_fdt_ack(
     unsigned count = 0;
     unsigned i;
     uint16_t seconds_remaining = 0;
+    uint32_t remaining = 0;
 
     for (i = 0; i < MAX_FD_ENTRIES; i++) {
         if (FD_Table[i].valid) {
@@ -640,7 +639,9 @@ static int bvlc_encode_read_fdt_ack(
             pdu_len += len;
             len = encode_unsigned16(&pdu[pdu_len], FD_Table[i].time_to_live);
             pdu_len += len;
-            seconds_remaining = (uint16_t) FD_Table[i].seconds_remaining;
+            remaining = timer_wheel_remaining(&FD_Wheel, &FD_Table[i].timer);
+            seconds_remaining =
+                (uint16_t) ((remaining > 65535UL) ? 65535UL : remaining);
             len = encode_unsigned16(&pdu[pdu_len], seconds_remaining);
             pdu_len += len;
         }
@@ -826,7 +827,9 @@ static bool bvlc_register_foreign_device(
                    a BBMD shall start a timer with a value equal to the
                    Time-to-Live parameter supplied plus a fixed grace
                    period of 30 seconds. */
-                FD_Table[i].seconds_remaining = time_to_live_seconds + 30;
+                timer_wheel_start(&FD_Wheel, &FD_Table[i].timer,
+                    time_to_live_seconds + 30UL, bvlc_fd_expired,
+                    &FD_Table[i]);
                 break;
             }
         }
@@ -837,7 +840,9 @@ static bool bvlc_register_foreign_device(
                 FD_Table[i].dest_address.s_addr = sin->sin_addr.s_addr;
                 FD_Table[i].dest_port = sin->sin_port;
                 FD_Table[i].time_to_live = time_to_live_seconds;
-                FD_Table[i].seconds_remaining = time_to_live_seconds + 30;
+                timer_wheel_start(&FD_Wheel, &FD_Table[i].timer,
+                    time_to_live_seconds + 30UL, bvlc_fd_expired,
+                    &FD_Table[i]);
                 FD_Table[i].valid = true;
                 status = true;
                 break;
@@ -872,7 +877,7 @@ static bool bvlc_delete_foreign_device(
             if ((FD_Table[i].dest_address.s_addr == sin.sin_addr.s_addr) &&
                 (FD_Table[i].dest_port == sin.sin_port)) {
                 FD_Table[i].valid = false;
-                FD_Table[i].seconds_remaining = 0;
+                timer_wheel_stop(&FD_Wheel, &FD_Table[i].timer);
                 status = true;
                 break;
             }
@@ -1079,7 +1084,7 @@ static void bvlc_fdt_forward_npdu(
 
     /* loop through the FDT and send one to each entry */
     for (i = 0; i < MAX_FD_ENTRIES; i++) {
-        if (FD_Table[i].valid && FD_Table[i].seconds_remaining) {
+        if (FD_Table[i].valid) {
             bip_dest.sin_addr.s_addr = FD_Table[i].dest_address.s_addr;
             bip_dest.sin_port = FD_Table[i].dest_port;
             /* don't send to my ip address and same port */
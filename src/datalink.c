@@ -46,6 +46,8 @@
 *
 ****************************************************************************************/
 
+#include <time.h>
+
 #ifdef _MSC_VER
 #include <process.h>
 #endif
@@ -56,6 +58,12 @@
 #include "handlers.h"
 #include "dlenv.h"
 #include "bitsDebug.h"
+#if (BACNET_WORKER_THREADS > 0)
+#include "npduWorkers.h"
+#else
+/* bacnetProc.c, held by TickBACnetDevice() */
+LockExtern(stackLock);
+#endif
 
 /** @file datalink.c  Optional run-time assignment of datalink transport */
 
@@ -152,25 +160,66 @@ void datalink_set(
 
 // Note: This will be removed for the router project, and becomes Init_Router_Thread(), one for each port
 
+/* Receives one NPDU, waiting up to timeout milliseconds, and passes it on.
+   Returns true if there was one. */
+bool DatalinkReceive(unsigned timeout)
+{
+	BACNET_ADDRESS src;         /* address where message came from */
+	static uint8_t Rx_Buf[MAX_MPDU] ;
+
+	/* returns 0 bytes on timeout */
+	int pdu_len = datalink_receive(&src, &Rx_Buf[0], MAX_MPDU, timeout);
+
+	/* process */
+	if (pdu_len) {
+#if (BACNET_WORKER_THREADS > 0)
+		/* copied, Rx_Buf is ours again straight away */
+		npduWorkers_Dispatch(&src, &Rx_Buf[0], (uint16_t) pdu_len);
+#else
+		/* the rest of the stack is only ever entered with stackLock held */
+		LockTransaction(stackLock);
+		npdu_handler(&src, &Rx_Buf[0], pdu_len);
+		UnlockTransaction(stackLock);
+#endif
+		return true;
+	}
+	return false;
+}
+
+/* The BBMD tables and foreign device registration belong to the thread that receives, they
+   are changed by the BVLC messages datalink_receive() handles, so they are timed there too,
+   and need no lock. Called every second or so. */
+void DatalinkMaintenance(void)
+{
+	static time_t last_seconds;
+	time_t current_seconds = time(NULL);
+	uint32_t elapsed_seconds;
+
+	if (last_seconds == 0) {
+		last_seconds = current_seconds;
+	}
+	elapsed_seconds = (uint32_t) (current_seconds - last_seconds);
+	if (elapsed_seconds) {
+		last_seconds = current_seconds;
+#if defined(BACDL_BIP) && BBMD_ENABLED
+		bvlc_maintenance_timer(elapsed_seconds);
+#endif
+		dlenv_maintenance_timer((uint16_t) elapsed_seconds);
+	}
+}
+
 #ifdef _MSC_VER
 void DatalinkListen(void *pArgs)
 #else
 void* DatalinkListen(void *pArgs)
 #endif
 {
-	BACNET_ADDRESS src;         /* address where message came from */
 	unsigned timeout = 100;		/* milliseconds */
-	static uint8_t Rx_Buf[MAX_MPDU] ;
 
 	while ( true )
 	{
-		/* returns 0 bytes on timeout */
-		int pdu_len = datalink_receive(&src, &Rx_Buf[0], MAX_MPDU, timeout);
-
-		/* process */
-		if (pdu_len) {
-			npdu_handler(&src, &Rx_Buf[0], pdu_len);
-		}
+		DatalinkReceive(timeout);
+		DatalinkMaintenance();
 	}
 }
 
@@ -51,6 +51,7 @@
 #include "bacdcode.h"
 //#include "bacdef.h"
 #include "dcc.h"
+#include "bacnet_lock.h"
 
 /** @file dcc.c  Enable/Disable Device Communication Control (DCC) */
 
@@ -64,16 +65,32 @@ static BACNET_COMMUNICATION_ENABLE_DISABLE DCC_Enable_Disable =
     COMMUNICATION_ENABLE;
 /* password is optionally supported */
 
+/* the status is checked from every thread that sends, and changed by the
+   DCC service and the timer. A leaf lock, nothing else is taken under it. */
+BACNET_LOCK_DEFINE(DCC_Lock);
+
+void dcc_init(
+    void)
+{
+    BACNET_LOCK_INIT(DCC_Lock);
+}
+
 BACNET_COMMUNICATION_ENABLE_DISABLE dcc_enable_status(
     void)
 {
-    return DCC_Enable_Disable;
+    BACNET_COMMUNICATION_ENABLE_DISABLE status;
+
+    BACNET_LOCK(DCC_Lock);
+    status = DCC_Enable_Disable;
+    BACNET_UNLOCK(DCC_Lock);
+
+    return status;
 }
 
 bool dcc_communication_enabled(
     void)
 {
-    return (DCC_Enable_Disable == COMMUNICATION_ENABLE);
+    return (dcc_enable_status() == COMMUNICATION_ENABLE);
 }
 
 /* When network communications are completely disabled,
@@ -82,7 +99,7 @@ bool dcc_communication_enabled(
 bool dcc_communication_disabled(
     void)
 {
-    return (DCC_Enable_Disable == COMMUNICATION_DISABLE);
+    return (dcc_enable_status() == COMMUNICATION_DISABLE);
 }
 
 /* When the initiation of communications is disabled,
@@ -97,14 +114,20 @@ bool dcc_communication_disabled(
 bool dcc_communication_initiation_disabled(
     void)
 {
-    return (DCC_Enable_Disable == COMMUNICATION_DISABLE_INITIATION);
+    return (dcc_enable_status() == COMMUNICATION_DISABLE_INITIATION);
 }
 
 /* note: 0 indicates either expired, or infinite duration */
 uint32_t dcc_duration_seconds(
     void)
 {
-    return DCC_Time_Duration_Seconds;
+    uint32_t seconds;
+
+    BACNET_LOCK(DCC_Lock);
+    seconds = DCC_Time_Duration_Seconds;
+    BACNET_UNLOCK(DCC_Lock);
+
+    return seconds;
 }
 
 /* called every second or so.  If more than one second,
@@ -112,6 +135,7 @@ uint32_t dcc_duration_seconds(
 void dcc_timer_seconds(
     uint32_t seconds)
 {
+    BACNET_LOCK(DCC_Lock);
     if (DCC_Time_Duration_Seconds) {
         if (DCC_Time_Duration_Seconds > seconds)
             DCC_Time_Duration_Seconds -= seconds;
@@ -121,6 +145,7 @@ void dcc_timer_seconds(
         if (DCC_Time_Duration_Seconds == 0)
             DCC_Enable_Disable = COMMUNICATION_ENABLE;
     }
+    BACNET_UNLOCK(DCC_Lock);
 }
 
 bool dcc_set_status_duration(
@@ -131,12 +156,14 @@ bool dcc_set_status_duration(
 
     /* valid? */
     if (status < MAX_BACNET_COMMUNICATION_ENABLE_DISABLE) {
+        BACNET_LOCK(DCC_Lock);
         DCC_Enable_Disable = status;
         if (status == COMMUNICATION_ENABLE) {
             DCC_Time_Duration_Seconds = 0;
         } else {
             DCC_Time_Duration_Seconds = minutes * 60;
         }
+        BACNET_UNLOCK(DCC_Lock);
         valid = true;
     }
 
@@ -337,6 +364,7 @@ int main(
     Test *pTest;
     bool rc;
 
+    dcc_init();
     pTest = ct_create("BACnet DeviceCommunicationControl", NULL);
     /* individual tests */
     rc = ct_addTestFunction(pTest, test_DeviceCommunicationControl);
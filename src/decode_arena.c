@@ -0,0 +1,219 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "decode_arena.h"
+
+/** @file decode_arena.c  Arena for the results of decoding one APDU */
+
+/* everything handed out is aligned, and rounded up, to this */
+typedef union Decode_Arena_Align {
+    long double ld;
+    double d;
+    long long ll;
+    void *p;
+} DECODE_ARENA_ALIGN;
+
+struct BACnet_Decode_Arena_Block {
+    DECODE_ARENA_BLOCK *next;
+    DECODE_ARENA_ALIGN data[1];
+};
+
+#define DECODE_ARENA_UNIT sizeof(DECODE_ARENA_ALIGN)
+#define DECODE_ARENA_BLOCK_MIN (16 * DECODE_ARENA_UNIT)
+
+void decode_arena_init(
+    DECODE_ARENA * arena,
+    size_t first_block_size)
+{
+    if (first_block_size < DECODE_ARENA_BLOCK_MIN) {
+        first_block_size = DECODE_ARENA_BLOCK_MIN;
+    }
+    arena->blocks = NULL;
+    arena->first_block_size = first_block_size;
+    arena->block_size = first_block_size;
+    arena->used = 0;
+    arena->remaining = 0;
+    arena->block_count = 0;
+}
+
+void *decode_arena_calloc(
+    DECODE_ARENA * arena,
+    size_t size)
+{
+    DECODE_ARENA_BLOCK *block;
+    size_t block_size;
+    void *data;
+
+    if (arena == NULL) {
+        return calloc(1, size);
+    }
+    if (size == 0) {
+        size = 1;
+    }
+    if (size > ((size_t) -1 - DECODE_ARENA_UNIT)) {
+        return NULL;
+    }
+    size = (size + DECODE_ARENA_UNIT - 1) & ~(DECODE_ARENA_UNIT - 1);
+    if (size > arena->remaining) {
+        block_size = arena->block_size;
+        while (block_size < size) {
+            block_size *= 2;
+        }
+        /* calloc, so nothing handed out needs zeroing again */
+        block =
+            (DECODE_ARENA_BLOCK *) calloc(1,
+            offsetof(DECODE_ARENA_BLOCK, data) + block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = arena->blocks;
+        arena->blocks = block;
+        arena->used = 0;
+        arena->remaining = block_size;
+        arena->block_size = block_size * 2;
+        arena->block_count++;
+    }
+    data = (uint8_t *) arena->blocks->data + arena->used;
+    arena->used += size;
+    arena->remaining -= size;
+
+    return data;
+}
+
+void decode_arena_free(
+    DECODE_ARENA * arena,
+    void *data)
+{
+    if (arena == NULL) {
+        free(data);
+    }
+}
+
+void decode_arena_release(
+    DECODE_ARENA * arena)
+{
+    DECODE_ARENA_BLOCK *block;
+
+    while (arena->blocks) {
+        block = arena->blocks;
+        arena->blocks = block->next;
+        free(block);
+    }
+    decode_arena_init(arena, arena->first_block_size);
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <string.h>
+
+void testDecodeArena(
+    Test * pTest)
+{
+    DECODE_ARENA arena;
+    uint8_t *data[64];
+    uint8_t *big;
+    unsigned i, j;
+
+    decode_arena_init(&arena, 0);
+    ct_test(pTest, arena.block_count == 0);
+    ct_test(pTest, arena.blocks == NULL);
+
+    /* small pieces share a block, aligned, zeroed and apart */
+    for (i = 0; i < 8; i++) {
+        data[i] = decode_arena_calloc(&arena, 3 + i);
+        ct_test(pTest, data[i] != NULL);
+        ct_test(pTest, ((uintptr_t) data[i] % DECODE_ARENA_UNIT) == 0);
+        for (j = 0; j < (3 + i); j++) {
+            ct_test(pTest, data[i][j] == 0);
+        }
+        memset(data[i], 0xA5, 3 + i);
+    }
+    ct_test(pTest, arena.block_count == 1);
+    for (i = 1; i < 8; i++) {
+        ct_test(pTest, data[i] >= (data[i - 1] + 3 + i - 1));
+    }
+    /* freeing one piece keeps it until the release */
+    decode_arena_free(&arena, data[0]);
+    ct_test(pTest, data[0][0] == 0xA5);
+
+    /* more blocks, each twice the one before */
+    for (i = 8; i < 64; i++) {
+        data[i] = decode_arena_calloc(&arena, 96);
+        ct_test(pTest, data[i] != NULL);
+    }
+    ct_test(pTest, arena.block_count > 1);
+    ct_test(pTest, arena.block_count < 8);
+    /* a piece bigger than the next block gets a block of its own size */
+    j = arena.block_count;
+    big = decode_arena_calloc(&arena, 64 * arena.block_size);
+    ct_test(pTest, big != NULL);
+    ct_test(pTest, arena.block_count == (j + 1));
+    ct_test(pTest, big[0] == 0);
+
+    /* one call gives it all back, and it can be used again */
+    decode_arena_release(&arena);
+    ct_test(pTest, arena.block_count == 0);
+    ct_test(pTest, arena.blocks == NULL);
+    ct_test(pTest, arena.block_size == arena.first_block_size);
+    data[0] = decode_arena_calloc(&arena, 0);
+    ct_test(pTest, data[0] != NULL);
+    ct_test(pTest, arena.block_count == 1);
+    decode_arena_release(&arena);
+
+    /* without an arena it is the heap */
+    data[0] = decode_arena_calloc(NULL, 16);
+    ct_test(pTest, data[0] != NULL);
+    ct_test(pTest, data[0][15] == 0);
+    decode_arena_free(NULL, data[0]);
+}
+
+#ifdef TEST_DECODE_ARENA
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Decode Arena", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testDecodeArena);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_DECODE_ARENA */
+#endif /* TEST */
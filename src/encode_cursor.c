@@ -0,0 +1,183 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "encode_cursor.h"
+
+/** @file encode_cursor.c  Bounded cursor for encoding in place */
+
+void encode_cursor_init(
+    BACNET_ENCODE_CURSOR * cursor,
+    uint8_t * buffer,
+    unsigned capacity,
+    unsigned size)
+{
+    cursor->buffer = buffer;
+    cursor->offset = 0;
+    cursor->capacity = (capacity < size) ? capacity : size;
+    cursor->size = size;
+}
+
+void encode_cursor_rollback(
+    BACNET_ENCODE_CURSOR * cursor,
+    unsigned mark)
+{
+    if (mark < cursor->offset) {
+        cursor->offset = mark;
+    }
+}
+
+uint8_t *encode_cursor_reserve(
+    BACNET_ENCODE_CURSOR * cursor,
+    uint8_t * scratch,
+    unsigned max_len)
+{
+    if ((cursor->size - cursor->offset) >= max_len) {
+        return &cursor->buffer[cursor->offset];
+    }
+
+    return scratch;
+}
+
+bool encode_cursor_commit(
+    BACNET_ENCODE_CURSOR * cursor,
+    uint8_t * data,
+    int len)
+{
+    uint8_t *tail = &cursor->buffer[cursor->offset];
+
+    if ((data == NULL) || (len < 0) ||
+        ((unsigned) len > (cursor->capacity - cursor->offset))) {
+        return false;
+    }
+    if (data != tail) {
+        memmove(tail, data, (size_t) len);
+    }
+    cursor->offset += (unsigned) len;
+
+    return true;
+}
+
+#ifdef TEST
+#include <assert.h>
+
+void testEncodeCursor(
+    Test * pTest)
+{
+    BACNET_ENCODE_CURSOR cursor;
+    uint8_t buffer[16] = { 0 };
+    uint8_t scratch[8] = { 0 };
+    uint8_t *apdu;
+    unsigned mark;
+
+    /* 8 bytes may be kept, 12 written */
+    encode_cursor_init(&cursor, buffer, 8, 12);
+    ct_test(pTest, encode_cursor_room(&cursor) == 8);
+    ct_test(pTest, encode_cursor_tail(&cursor) == &buffer[0]);
+
+    /* in place */
+    apdu = encode_cursor_reserve(&cursor, scratch, 4);
+    ct_test(pTest, apdu == &buffer[0]);
+    memset(apdu, 0x11, 3);
+    ct_test(pTest, encode_cursor_commit(&cursor, apdu, 3));
+    ct_test(pTest, encode_cursor_mark(&cursor) == 3);
+    ct_test(pTest, encode_cursor_room(&cursor) == 5);
+
+    /* too big to keep: nothing changes */
+    mark = encode_cursor_mark(&cursor);
+    apdu = encode_cursor_reserve(&cursor, scratch, 8);
+    ct_test(pTest, apdu == &buffer[3]);
+    memset(apdu, 0x22, 6);
+    ct_test(pTest, !encode_cursor_commit(&cursor, apdu, 6));
+    ct_test(pTest, encode_cursor_mark(&cursor) == mark);
+    ct_test(pTest, !encode_cursor_commit(&cursor, apdu, -1));
+    ct_test(pTest, !encode_cursor_commit(&cursor, NULL, 1));
+
+    /* not enough left to write in place: the scratch is used and copied */
+    apdu = encode_cursor_reserve(&cursor, scratch, 10);
+    ct_test(pTest, apdu == &scratch[0]);
+    memset(apdu, 0x33, 2);
+    ct_test(pTest, encode_cursor_commit(&cursor, apdu, 2));
+    ct_test(pTest, buffer[3] == 0x33);
+    ct_test(pTest, buffer[4] == 0x33);
+    ct_test(pTest, encode_cursor_mark(&cursor) == 5);
+    apdu = encode_cursor_reserve(&cursor, NULL, 10);
+    ct_test(pTest, apdu == NULL);
+
+    /* roll back to a mark, never forward */
+    encode_cursor_rollback(&cursor, mark);
+    ct_test(pTest, encode_cursor_mark(&cursor) == 3);
+    encode_cursor_rollback(&cursor, 7);
+    ct_test(pTest, encode_cursor_mark(&cursor) == 3);
+    ct_test(pTest, buffer[0] == 0x11);
+    ct_test(pTest, buffer[2] == 0x11);
+
+    /* fill it exactly */
+    apdu = encode_cursor_reserve(&cursor, scratch, 5);
+    memset(apdu, 0x44, 5);
+    ct_test(pTest, encode_cursor_commit(&cursor, apdu, 5));
+    ct_test(pTest, encode_cursor_room(&cursor) == 0);
+    ct_test(pTest, encode_cursor_commit(&cursor,
+            encode_cursor_tail(&cursor), 0));
+    ct_test(pTest, !encode_cursor_commit(&cursor,
+            encode_cursor_tail(&cursor), 1));
+
+    /* capacity is never more than the buffer */
+    encode_cursor_init(&cursor, buffer, 12, 8);
+    ct_test(pTest, encode_cursor_room(&cursor) == 8);
+    ct_test(pTest, encode_cursor_reserve(&cursor, NULL, 8) == &buffer[0]);
+    ct_test(pTest, encode_cursor_reserve(&cursor, NULL, 9) == NULL);
+    ct_test(pTest, !encode_cursor_commit(&cursor,
+            encode_cursor_tail(&cursor), 9));
+}
+
+#ifdef TEST_ENCODE_CURSOR
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Encode Cursor", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testEncodeCursor);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_ENCODE_CURSOR */
+#endif /* TEST */
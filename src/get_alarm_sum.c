@@ -66,8 +66,9 @@ int get_alarm_summary_encode_apdu(
     int apdu_len = 0; /* total length of the apdu, return value */
 
     if (apdu) {
-        apdu[0] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
-        apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU);
+        apdu[0] =
+            PDU_TYPE_CONFIRMED_SERVICE_REQUEST | PDU_SEGMENTED_RESPONSE_ACCEPTED;
+        apdu[1] = encode_max_segs_max_apdu(PDU_MAX_SEGS_ACCEPTED, MAX_APDU);
         apdu[2] = invoke_id;
         apdu[3] = SERVICE_CONFIRMED_GET_ALARM_SUMMARY;
         apdu_len = 4;
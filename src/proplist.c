@@ -47,6 +47,7 @@
 ****************************************************************************************/
 
 #include <stdint.h>
+#include <string.h>
 #include "bacenum.h"
 #include "bacdef.h"
 #include "bacdcode.h"
@@ -1617,35 +1618,24 @@ unsigned property_list_special_count(
 //    return property_count;
 //}
 
-/**
- * ReadProperty handler for this property.  For the given ReadProperty
- * data, the application_data is loaded or the error flags are set.
- *
- * @param  rpdata - ReadProperty data, including requested data and
- * data for the reply, or error response.
- *
- * @return number of APDU bytes in the response, or
- * BACNET_STATUS_ERROR on error.
- */
-int property_list_encode(
+/* Encodes the Property_List from counted lists */
+static int property_list_encode_counted(
     BACNET_READ_PROPERTY_DATA * rpdata,
-    const BACNET_PROPERTY_ID *pListRequired,
-    const BACNET_PROPERTY_ID *pListOptional,
-    const BACNET_PROPERTY_ID *pListProprietary)
+    const struct special_property_list_t *pLists)
 {
     int apdu_len = 0;   /* return value */
     uint8_t *apdu ;
     int max_apdu_len ;
     uint32_t count = 0;
-    unsigned required_count = 0;
-    unsigned optional_count = 0;
-    unsigned proprietary_count = 0;
+    const BACNET_PROPERTY_ID *pListRequired = pLists->Required.pList;
+    const BACNET_PROPERTY_ID *pListOptional = pLists->Optional.pList;
+    const BACNET_PROPERTY_ID *pListProprietary = pLists->Proprietary.pList;
+    unsigned required_count = pLists->Required.count;
+    unsigned optional_count = pLists->Optional.count;
+    unsigned proprietary_count = pLists->Proprietary.count;
     int len = 0;
     unsigned i = 0; /* loop index */
 
-    required_count = property_list_count(pListRequired);
-    optional_count = property_list_count(pListOptional);
-    proprietary_count = property_list_count(pListProprietary);
     /* total of all counts */
     count = required_count + optional_count + proprietary_count;
     if (required_count >= 3) {
@@ -1782,11 +1772,165 @@ int property_list_encode(
     return apdu_len;
 }
 
+
+/**
+ * ReadProperty handler for this property.  For the given ReadProperty
+ * data, the application_data is loaded or the error flags are set.
+ *
+ * @param  rpdata - ReadProperty data, including requested data and
+ * data for the reply, or error response.
+ *
+ * @return number of APDU bytes in the response, or
+ * BACNET_STATUS_ERROR on error.
+ */
+int property_list_encode(
+    BACNET_READ_PROPERTY_DATA * rpdata,
+    const BACNET_PROPERTY_ID *pListRequired,
+    const BACNET_PROPERTY_ID *pListOptional,
+    const BACNET_PROPERTY_ID *pListProprietary)
+{
+    struct special_property_list_t lists;
+
+    lists.Required.pList = pListRequired;
+    lists.Optional.pList = pListOptional;
+    lists.Proprietary.pList = pListProprietary;
+    lists.Required.count = property_list_count(pListRequired);
+    lists.Optional.count = property_list_count(pListOptional);
+    lists.Proprietary.count = property_list_count(pListProprietary);
+
+    return property_list_encode_counted(rpdata, &lists);
+}
+
+/**
+ * Counts the lists of an object type and sets up its membership bitmap.
+ * The lists are referenced, not copied, and must stay put.
+ *
+ * @param pSet - the set to fill in
+ * @param pListRequired, pListOptional, pListProprietary - MAX_BACNET_PROPERTY_ID
+ * terminated lists, any of which may be NULL.
+ */
+void property_set_init(
+    BACNET_PROPERTY_SET * pSet,
+    const BACNET_PROPERTY_ID *pListRequired,
+    const BACNET_PROPERTY_ID *pListOptional,
+    const BACNET_PROPERTY_ID *pListProprietary)
+{
+    struct property_list_t *lists[3];
+    unsigned l, i;
+
+    memset(pSet, 0, sizeof(*pSet));
+    pSet->Lists.Required.pList = pListRequired;
+    pSet->Lists.Optional.pList = pListOptional;
+    pSet->Lists.Proprietary.pList = pListProprietary;
+    lists[0] = &pSet->Lists.Required;
+    lists[1] = &pSet->Lists.Optional;
+    lists[2] = &pSet->Lists.Proprietary;
+    for (l = 0; l < 3; l++) {
+        lists[l]->count = property_list_count(lists[l]->pList);
+        for (i = 0; i < lists[l]->count; i++) {
+            unsigned property = (unsigned)lists[l]->pList[i];
+            if (property < PROPERTY_SET_STANDARD_MAX) {
+                pSet->Members[property / 32] |= (uint32_t)1 << (property % 32);
+            }
+        }
+    }
+}
+
+/**
+ * Is the property one of the object type's? Standard properties are a bit
+ * test, proprietary ones are looked up in the (short) proprietary list.
+ */
+bool property_set_member(
+    const BACNET_PROPERTY_SET * pSet,
+    BACNET_PROPERTY_ID property)
+{
+    unsigned i;
+
+    if ((unsigned)property < PROPERTY_SET_STANDARD_MAX) {
+        return (pSet->Members[property / 32] &
+            ((uint32_t)1 << (property % 32))) != 0;
+    }
+    for (i = 0; i < pSet->Lists.Proprietary.count; i++) {
+        if (pSet->Lists.Proprietary.pList[i] == property) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Number of properties RPM expands PROP_ALL, PROP_REQUIRED or PROP_OPTIONAL to.
+ */
+unsigned property_set_count(
+    const BACNET_PROPERTY_SET * pSet,
+    BACNET_PROPERTY_ID special_property)
+{
+    unsigned count = 0; /* return value */
+
+    if (special_property == PROP_ALL) {
+        count =
+            pSet->Lists.Required.count + pSet->Lists.Optional.count +
+            pSet->Lists.Proprietary.count;
+    } else if (special_property == PROP_REQUIRED) {
+        count = pSet->Lists.Required.count;
+    } else if (special_property == PROP_OPTIONAL) {
+        count = pSet->Lists.Optional.count;
+    }
+
+    return count;
+}
+
+/**
+ * The index'th property of the RPM expansion of PROP_ALL, PROP_REQUIRED or
+ * PROP_OPTIONAL, in list order. MAX_BACNET_PROPERTY_ID past the end.
+ */
+BACNET_PROPERTY_ID property_set_property(
+    const BACNET_PROPERTY_SET * pSet,
+    BACNET_PROPERTY_ID special_property,
+    unsigned index)
+{
+    unsigned required = pSet->Lists.Required.count;
+    unsigned optional = pSet->Lists.Optional.count;
+    unsigned proprietary = pSet->Lists.Proprietary.count;
+
+    if (special_property == PROP_ALL) {
+        if (index < required) {
+            return pSet->Lists.Required.pList[index];
+        } else if (index < (required + optional)) {
+            return pSet->Lists.Optional.pList[index - required];
+        } else if (index < (required + optional + proprietary)) {
+            return pSet->Lists.Proprietary.pList[index - required - optional];
+        }
+    } else if (special_property == PROP_REQUIRED) {
+        if (index < required) {
+            return pSet->Lists.Required.pList[index];
+        }
+    } else if (special_property == PROP_OPTIONAL) {
+        if (index < optional) {
+            return pSet->Lists.Optional.pList[index];
+        }
+    }
+
+    return MAX_BACNET_PROPERTY_ID;
+}
+
+/**
+ * property_list_encode() for a precomputed set.
+ */
+int property_set_encode(
+    BACNET_READ_PROPERTY_DATA * rpdata,
+    const BACNET_PROPERTY_SET * pSet)
+{
+    return property_list_encode_counted(rpdata, &pSet->Lists);
+}
+
 #ifdef TEST
 #include <assert.h>
 #include <string.h>
+#include <time.h>
 #include "ctest.h"
 
+#if ( BACNET_PROPERTY_LISTS == 1 )
 void testPropList(
     Test * pTest)
 {
@@ -1821,6 +1965,139 @@ void testPropList(
     }
 }
 
+/* the old way, walk the lists */
+static bool testListMember(
+    const struct special_property_list_t *pLists,
+    BACNET_PROPERTY_ID property)
+{
+    const BACNET_PROPERTY_ID *lists[3];
+    unsigned l, i;
+
+    lists[0] = pLists->Required.pList;
+    lists[1] = pLists->Optional.pList;
+    lists[2] = pLists->Proprietary.pList;
+    for (l = 0; l < 3; l++) {
+        for (i = 0; lists[l] && (lists[l][i] != MAX_BACNET_PROPERTY_ID); i++) {
+            if (lists[l][i] == property) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void testPropSet(
+    Test * pTest)
+{
+    static const BACNET_PROPERTY_ID proprietary[] = {
+        (BACNET_PROPERTY_ID) 512, (BACNET_PROPERTY_ID) 9999, MAX_BACNET_PROPERTY_ID
+    };
+    static const BACNET_PROPERTY_ID specials[] = {
+        PROP_ALL, PROP_REQUIRED, PROP_OPTIONAL
+    };
+    struct special_property_list_t lists = { {0} };
+    BACNET_PROPERTY_SET set;
+    unsigned i, j, s, count;
+    unsigned property;
+
+    for (i = 0; i < OBJECT_PROPRIETARY_MIN; i++) {
+        property_list_special((BACNET_OBJECT_TYPE) i, &lists);
+        property_set_init(&set, lists.Required.pList, lists.Optional.pList,
+            lists.Proprietary.pList);
+        for (s = 0; s < 3; s++) {
+            count = property_list_special_count((BACNET_OBJECT_TYPE) i, specials[s]);
+            ct_test(pTest, property_set_count(&set, specials[s]) == count);
+            for (j = 0; j <= count; j++) {
+                ct_test(pTest, property_set_property(&set, specials[s], j) ==
+                    property_list_special_property((BACNET_OBJECT_TYPE) i,
+                        specials[s], j));
+            }
+        }
+        for (property = 0; property < PROPERTY_SET_STANDARD_MAX; property++) {
+            if (property_set_member(&set, (BACNET_PROPERTY_ID) property) !=
+                testListMember(&lists, (BACNET_PROPERTY_ID) property)) {
+                ct_fail(pTest, "membership differs from the property lists");
+                break;
+            }
+        }
+    }
+
+    /* proprietary properties are beyond the bitmap */
+    property_set_init(&set, NULL, NULL, proprietary);
+    ct_test(pTest, property_set_count(&set, PROP_ALL) == 2);
+    ct_test(pTest, property_set_count(&set, PROP_REQUIRED) == 0);
+    ct_test(pTest, property_set_member(&set, (BACNET_PROPERTY_ID) 512));
+    ct_test(pTest, property_set_member(&set, (BACNET_PROPERTY_ID) 9999));
+    ct_test(pTest, !property_set_member(&set, (BACNET_PROPERTY_ID) 513));
+    ct_test(pTest, !property_set_member(&set, PROP_OBJECT_NAME));
+    ct_test(pTest, property_set_property(&set, PROP_ALL, 1) == 9999);
+    ct_test(pTest, property_set_property(&set, PROP_ALL, 2) ==
+        MAX_BACNET_PROPERTY_ID);
+}
+
+static double testElapsedMs(struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1e3 + (end.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+/* What an RPM of ALL plus an unknown property check per expanded property
+   costs, counting and walking the lists each time, or from the set */
+void testPropSetBenchmark(
+    Test * pTest)
+{
+    FILE *stream = ct_getStream(pTest);
+    static BACNET_PROPERTY_SET sets[OBJECT_PROPRIETARY_MIN];
+    struct special_property_list_t lists = { {0} };
+    struct timespec start;
+    double ms[2];
+    unsigned long found[2] = { 0, 0 };
+    unsigned round, i, j, count;
+    BACNET_PROPERTY_ID property;
+
+    for (i = 0; i < OBJECT_PROPRIETARY_MIN; i++) {
+        property_list_special((BACNET_OBJECT_TYPE) i, &lists);
+        property_set_init(&sets[i], lists.Required.pList,
+            lists.Optional.pList, lists.Proprietary.pList);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (round = 0; round < 200; round++) {
+        for (i = 0; i < OBJECT_PROPRIETARY_MIN; i++) {
+            property_list_special((BACNET_OBJECT_TYPE) i, &lists);
+            count = lists.Required.count + lists.Optional.count +
+                lists.Proprietary.count;
+            for (j = 0; j < count; j++) {
+                property = (j < lists.Required.count) ?
+                    lists.Required.pList[j] :
+                    lists.Optional.pList[j - lists.Required.count];
+                found[0] += testListMember(&lists, property);
+            }
+        }
+    }
+    ms[0] = testElapsedMs(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (round = 0; round < 200; round++) {
+        for (i = 0; i < OBJECT_PROPRIETARY_MIN; i++) {
+            count = property_set_count(&sets[i], PROP_ALL);
+            for (j = 0; j < count; j++) {
+                property = property_set_property(&sets[i], PROP_ALL, j);
+                found[1] += property_set_member(&sets[i], property);
+            }
+        }
+    }
+    ms[1] = testElapsedMs(&start);
+    ct_test(pTest, found[0] == found[1]);
+
+    fprintf(stream, "\n  %u object types x ALL x 200 requests\n", OBJECT_PROPRIETARY_MIN);
+    fprintf(stream, "  %-20s %10.2f ms\n", "walk lists", ms[0]);
+    fprintf(stream, "  %-20s %10.2f ms\n", "property set", ms[1]);
+}
+#endif
+
 #ifdef TEST_PROPLIST
 int main(
     void)
@@ -1830,8 +2107,14 @@ int main(
 
     pTest = ct_create("BACnet Property List", NULL);
     /* individual tests */
+#if ( BACNET_PROPERTY_LISTS == 1 )
     rc = ct_addTestFunction(pTest, testPropList);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testPropSet);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testPropSetBenchmark);
+    assert(rc);
+#endif
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
@@ -102,8 +102,9 @@ int ptransfer_encode_apdu(
     int len = 0;
 
     if (apdu) {
-        apdu[0] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
-        apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU);
+        apdu[0] =
+            PDU_TYPE_CONFIRMED_SERVICE_REQUEST | PDU_SEGMENTED_RESPONSE_ACCEPTED;
+        apdu[1] = encode_max_segs_max_apdu(PDU_MAX_SEGS_ACCEPTED, MAX_APDU);
         apdu[2] = invoke_id;
         apdu[3] = SERVICE_CONFIRMED_PRIVATE_TRANSFER;
         apdu_len = 4;
@@ -383,7 +384,7 @@ int ptransfer_decode_apdu(
     if (!apdu)
         return -1;
     /* optional checking - most likely was already done prior to this call */
-    if (apdu[0] != PDU_TYPE_CONFIRMED_SERVICE_REQUEST)
+    if ((apdu[0] & 0xF0) != PDU_TYPE_CONFIRMED_SERVICE_REQUEST)
         return -1;
     /*  apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU); */
     /* invoke id - filled in by net layer */
@@ -90,8 +90,9 @@ int rr_encode_apdu(
     int apdu_len = 0;   /* total length of the apdu, return value */
 
     if (apdu) {
-        apdu[0] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
-        apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU);
+        apdu[0] =
+            PDU_TYPE_CONFIRMED_SERVICE_REQUEST | PDU_SEGMENTED_RESPONSE_ACCEPTED;
+        apdu[1] = encode_max_segs_max_apdu(PDU_MAX_SEGS_ACCEPTED, MAX_APDU);
         apdu[2] = invoke_id;
         apdu[3] = SERVICE_CONFIRMED_READ_RANGE; /* service choice */
         apdu_len = 4;
@@ -190,6 +191,7 @@ int rr_decode_service_request(
         len += decode_enumerated(&apdu[len], len_value_type, &UnsignedTemp);
         rrdata->object_property = (BACNET_PROPERTY_ID) UnsignedTemp;
         rrdata->Overhead = RR_OVERHEAD; /* Start with the fixed overhead */
+        rrdata->MaxApdu = MAX_APDU;
 
         /* Tag 2: Optional Array Index - set to ALL if not present */
         rrdata->array_index = BACNET_ARRAY_ALL; /* Assuming this is the most common outcome... */
@@ -53,8 +53,12 @@
 #include "bacdef.h"
 #include "bacapp.h"
 #include "memcopy.h"
+#include "encode_cursor.h"
 #include "rpm.h"
 
+/* the most any of the fixed parts of an RPM Ack can take */
+#define RPM_ACK_PART_MAX 16
+
 /** @file rpm.c  Encode/Decode Read Property Multiple and RPM ACKs  */
 
 #if ( BACNET_SVC_RPM_A == 1 )
@@ -66,8 +70,9 @@ int rpm_encode_apdu_init(
     int apdu_len = 0;   /* total length of the apdu, return value */
 
     if (apdu) {
-        apdu[0] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
-        apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU);
+        apdu[0] =
+            PDU_TYPE_CONFIRMED_SERVICE_REQUEST | PDU_SEGMENTED_RESPONSE_ACCEPTED;
+        apdu[1] = encode_max_segs_max_apdu(PDU_MAX_SEGS_ACCEPTED, MAX_APDU);
         apdu[2] = invoke_id;
         apdu[3] = SERVICE_CONFIRMED_READ_PROP_MULTIPLE; /* service choice */
         apdu_len = 4;
@@ -441,6 +446,95 @@ int rpm_ack_encode_apdu_object_end(
     return apdu_len;
 }
 
+bool rpm_ack_cursor_object_begin(
+    BACNET_ENCODE_CURSOR * cursor,
+    BACNET_RPM_DATA * rpmdata)
+{
+    uint8_t scratch[RPM_ACK_PART_MAX];
+    uint8_t *apdu;
+
+    apdu = encode_cursor_reserve(cursor, scratch, sizeof(scratch));
+    return encode_cursor_commit(cursor, apdu,
+        rpm_ack_encode_apdu_object_begin(apdu, rpmdata));
+}
+
+bool rpm_ack_cursor_object_property(
+    BACNET_ENCODE_CURSOR * cursor,
+    BACNET_PROPERTY_ID object_property,
+    uint32_t array_index)
+{
+    uint8_t scratch[RPM_ACK_PART_MAX];
+    uint8_t *apdu;
+
+    apdu = encode_cursor_reserve(cursor, scratch, sizeof(scratch));
+    return encode_cursor_commit(cursor, apdu,
+        rpm_ack_encode_apdu_object_property(apdu, object_property,
+            array_index));
+}
+
+uint8_t *rpm_ack_cursor_value_begin(
+    BACNET_ENCODE_CURSOR * cursor,
+    uint8_t * scratch)
+{
+    uint8_t *apdu;
+
+    /* Tag 4: propertyValue, one octet, so it goes straight in */
+    if (encode_cursor_room(cursor) < 1) {
+        return NULL;
+    }
+    apdu = encode_cursor_tail(cursor);
+    cursor->offset += encode_opening_tag(apdu, 4);
+
+    return encode_cursor_reserve(cursor, scratch, MAX_APDU);
+}
+
+bool rpm_ack_cursor_value_end(
+    BACNET_ENCODE_CURSOR * cursor,
+    uint8_t * application_data,
+    int application_data_len)
+{
+    uint8_t *apdu;
+
+    /* the value and its closing tag */
+    if ((application_data_len < 0) ||
+        (encode_cursor_room(cursor) < ((unsigned) application_data_len + 1))) {
+        return false;
+    }
+    encode_cursor_commit(cursor, application_data, application_data_len);
+    apdu = encode_cursor_tail(cursor);
+    cursor->offset += encode_closing_tag(apdu, 4);
+
+    return true;
+}
+
+bool rpm_ack_cursor_object_property_error(
+    BACNET_ENCODE_CURSOR * cursor,
+    BACNET_ERROR_CLASS error_class,
+    BACNET_ERROR_CODE error_code)
+{
+    uint8_t scratch[RPM_ACK_PART_MAX];
+    uint8_t *apdu;
+
+    apdu = encode_cursor_reserve(cursor, scratch, sizeof(scratch));
+    return encode_cursor_commit(cursor, apdu,
+        rpm_ack_encode_apdu_object_property_error(apdu, error_class,
+            error_code));
+}
+
+bool rpm_ack_cursor_object_end(
+    BACNET_ENCODE_CURSOR * cursor)
+{
+    uint8_t *apdu;
+
+    if (encode_cursor_room(cursor) < 1) {
+        return false;
+    }
+    apdu = encode_cursor_tail(cursor);
+    cursor->offset += encode_closing_tag(apdu, 1);
+
+    return true;
+}
+
 #if BACNET_SVC_RPM_A
 
 /* decode the object portion of the service request only */
@@ -536,6 +630,7 @@ int rpm_ack_decode_object_property(
 #ifdef TEST
 #include <assert.h>
 #include <string.h>
+#include <time.h>
 #include "ctest.h"
 
 int rpm_ack_decode_apdu(
@@ -578,7 +673,7 @@ int rpm_decode_apdu(
     if (!apdu)
         return -1;
     /* optional checking - most likely was already done prior to this call */
-    if (apdu[0] != PDU_TYPE_CONFIRMED_SERVICE_REQUEST)
+    if ((apdu[0] & 0xF0) != PDU_TYPE_CONFIRMED_SERVICE_REQUEST)
         return -1;
     /*  apdu[1] = encode_max_segs_max_apdu(0, MAX_APDU); */
     *invoke_id = apdu[2];       /* invoke id - filled in by net layer */
@@ -955,6 +1050,236 @@ void testReadPropertyMultipleAck(
     ct_test(pTest, len == service_request_len);
 }
 
+/* the cursor must give exactly what the plain encoders give */
+void testReadPropertyMultipleAckCursor(
+    Test * pTest)
+{
+    uint8_t apdu[64] = { 0 };
+    uint8_t test_apdu[64] = { 0 };
+    uint8_t scratch[MAX_APDU] = { 0 };
+    uint8_t *value;
+    int apdu_len = 0;
+    int len;
+    unsigned mark;
+    BACNET_ENCODE_CURSOR cursor;
+    BACNET_RPM_DATA rpmdata;
+
+    rpmdata.object_type = OBJECT_ANALOG_INPUT;
+    rpmdata.object_instance = 33;
+    apdu_len = rpm_ack_encode_apdu_object_begin(&apdu[0], &rpmdata);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+        PROP_PRESENT_VALUE, BACNET_ARRAY_ALL);
+    len = encode_application_real(&scratch[0], 12.5f);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+        &scratch[0], len);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property(&apdu[apdu_len],
+        PROP_PRIORITY_ARRAY, 16);
+    apdu_len +=
+        rpm_ack_encode_apdu_object_property_error(&apdu[apdu_len],
+        ERROR_CLASS_PROPERTY, ERROR_CODE_UNKNOWN_PROPERTY);
+    apdu_len += rpm_ack_encode_apdu_object_end(&apdu[apdu_len]);
+
+    /* all in place, the value never reaches the scratch buffer */
+    memset(scratch, 0, sizeof(scratch));
+    encode_cursor_init(&cursor, test_apdu, sizeof(test_apdu),
+        sizeof(test_apdu) + MAX_APDU);
+    ct_test(pTest, rpm_ack_cursor_object_begin(&cursor, &rpmdata));
+    ct_test(pTest, rpm_ack_cursor_object_property(&cursor,
+            PROP_PRESENT_VALUE, BACNET_ARRAY_ALL));
+    value = rpm_ack_cursor_value_begin(&cursor, scratch);
+    ct_test(pTest, value == encode_cursor_tail(&cursor));
+    len = encode_application_real(value, 12.5f);
+    ct_test(pTest, rpm_ack_cursor_value_end(&cursor, value, len));
+    ct_test(pTest, rpm_ack_cursor_object_property(&cursor,
+            PROP_PRIORITY_ARRAY, 16));
+    ct_test(pTest, rpm_ack_cursor_object_property_error(&cursor,
+            ERROR_CLASS_PROPERTY, ERROR_CODE_UNKNOWN_PROPERTY));
+    ct_test(pTest, rpm_ack_cursor_object_end(&cursor));
+    ct_test(pTest, encode_cursor_mark(&cursor) == (unsigned) apdu_len);
+    ct_test(pTest, memcmp(apdu, test_apdu, apdu_len) == 0);
+
+    /* no room past the end: the value goes through the scratch buffer */
+    memset(test_apdu, 0, sizeof(test_apdu));
+    encode_cursor_init(&cursor, test_apdu, sizeof(test_apdu),
+        sizeof(test_apdu));
+    ct_test(pTest, rpm_ack_cursor_object_begin(&cursor, &rpmdata));
+    ct_test(pTest, rpm_ack_cursor_object_property(&cursor,
+            PROP_PRESENT_VALUE, BACNET_ARRAY_ALL));
+    value = rpm_ack_cursor_value_begin(&cursor, scratch);
+    ct_test(pTest, value == &scratch[0]);
+    len = encode_application_real(value, 12.5f);
+    ct_test(pTest, rpm_ack_cursor_value_end(&cursor, value, len));
+    ct_test(pTest, memcmp(apdu, test_apdu, encode_cursor_mark(&cursor)) == 0);
+
+    /* a value that does not fit leaves the cursor where it was */
+    encode_cursor_init(&cursor, test_apdu, 12, 12);
+    ct_test(pTest, rpm_ack_cursor_object_begin(&cursor, &rpmdata));
+    mark = encode_cursor_mark(&cursor);
+    ct_test(pTest, rpm_ack_cursor_object_property(&cursor,
+            PROP_PRESENT_VALUE, BACNET_ARRAY_ALL));
+    value = rpm_ack_cursor_value_begin(&cursor, scratch);
+    ct_test(pTest, value != NULL);
+    len = encode_application_real(value, 12.5f);
+    ct_test(pTest, !rpm_ack_cursor_value_end(&cursor, value, len));
+    encode_cursor_rollback(&cursor, mark);
+    ct_test(pTest, encode_cursor_mark(&cursor) == mark);
+    ct_test(pTest, rpm_ack_cursor_object_end(&cursor));
+    ct_test(pTest, !rpm_ack_cursor_object_property_error(&cursor,
+            ERROR_CLASS_PROPERTY, ERROR_CODE_UNKNOWN_PROPERTY));
+    ct_test(pTest, encode_cursor_mark(&cursor) == (mark + 1));
+}
+
+#define RPM_BENCH_PROPERTIES 200
+#define RPM_BENCH_REPLIES 20000
+
+/* a mix of what objects return: a REAL, a Description sized
+   CharacterString, and a Priority_Array sized list of REALs */
+static int testRPMEncodeValue(
+    uint8_t * apdu,
+    unsigned i)
+{
+    BACNET_CHARACTER_STRING char_string;
+    int len = 0;
+    unsigned j;
+
+    switch (i % 3) {
+        case 0:
+            len = encode_application_real(&apdu[0], (float) i);
+            break;
+        case 1:
+            characterstring_init_ansi(&char_string,
+                "Supply air temperature, air handler 4, level 2");
+            len = encode_application_character_string(&apdu[0],
+                &char_string);
+            break;
+        default:
+            for (j = 0; j < BACNET_MAX_PRIORITY; j++) {
+                len += encode_application_real(&apdu[len], (float) j);
+            }
+            break;
+    }
+
+    return len;
+}
+
+/* the way h_rpm.c used to do it: every part into a temporary buffer,
+   then copied into the reply */
+static int testRPMEncodeCopy(
+    uint8_t * apdu,
+    unsigned max_apdu,
+    uint8_t * temp_buf,
+    BACNET_RPM_DATA * rpmdata)
+{
+    unsigned i;
+    int apdu_len;
+    int len;
+
+    apdu_len = rpm_ack_encode_apdu_init(&apdu[0], 1);
+    len = rpm_ack_encode_apdu_object_begin(&temp_buf[0], rpmdata);
+    apdu_len += memcopy(&apdu[0], &temp_buf[0], apdu_len, len, max_apdu);
+    for (i = 0; i < RPM_BENCH_PROPERTIES; i++) {
+        len =
+            rpm_ack_encode_apdu_object_property(&temp_buf[0],
+            (BACNET_PROPERTY_ID) (512 + i), BACNET_ARRAY_ALL);
+        apdu_len += memcopy(&apdu[0], &temp_buf[0], apdu_len, len, max_apdu);
+        len = testRPMEncodeValue(&temp_buf[0], i);
+        if ((apdu_len + 1 + len + 1) >= (int) max_apdu) {
+            return -1;
+        }
+        apdu_len +=
+            rpm_ack_encode_apdu_object_property_value(&apdu[apdu_len],
+            &temp_buf[0], len);
+    }
+    len = rpm_ack_encode_apdu_object_end(&temp_buf[0]);
+    apdu_len += memcopy(&apdu[0], &temp_buf[0], apdu_len, len, max_apdu);
+
+    return apdu_len;
+}
+
+static int testRPMEncodeCursor(
+    uint8_t * apdu,
+    unsigned max_apdu,
+    uint8_t * temp_buf,
+    BACNET_RPM_DATA * rpmdata)
+{
+    BACNET_ENCODE_CURSOR cursor;
+    uint8_t *value;
+    unsigned i;
+
+    encode_cursor_init(&cursor, apdu, max_apdu, max_apdu + MAX_APDU);
+    encode_cursor_commit(&cursor, apdu, rpm_ack_encode_apdu_init(apdu, 1));
+    rpm_ack_cursor_object_begin(&cursor, rpmdata);
+    for (i = 0; i < RPM_BENCH_PROPERTIES; i++) {
+        rpm_ack_cursor_object_property(&cursor,
+            (BACNET_PROPERTY_ID) (512 + i), BACNET_ARRAY_ALL);
+        value = rpm_ack_cursor_value_begin(&cursor, temp_buf);
+        if (!rpm_ack_cursor_value_end(&cursor, value,
+                testRPMEncodeValue(value, i))) {
+            return -1;
+        }
+    }
+    rpm_ack_cursor_object_end(&cursor);
+
+    return (int) encode_cursor_mark(&cursor);
+}
+
+static double testRPMEncodeNs(
+    int (*encode) (uint8_t *, unsigned, uint8_t *, BACNET_RPM_DATA *),
+    uint8_t * apdu,
+    unsigned max_apdu,
+    uint8_t * temp_buf,
+    int *apdu_len)
+{
+    BACNET_RPM_DATA rpmdata;
+    struct timespec start, end;
+    unsigned i;
+
+    rpmdata.object_type = OBJECT_ANALOG_VALUE;
+    rpmdata.object_instance = 1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < RPM_BENCH_REPLIES; i++) {
+        rpmdata.object_instance = i;
+        *apdu_len = encode(apdu, max_apdu, temp_buf, &rpmdata);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec -
+            start.tv_nsec)) / RPM_BENCH_REPLIES;
+}
+
+/* Encoding a 200 property ComplexACK, through a temporary buffer
+   against in place through the cursor */
+void testReadPropertyMultipleAckBenchmark(
+    Test * pTest)
+{
+    static uint8_t apdu[16384 + MAX_APDU];
+    static uint8_t test_apdu[16384 + MAX_APDU];
+    static uint8_t temp_buf[MAX_APDU];
+    FILE *stream = ct_getStream(pTest);
+    int apdu_len = 0, test_apdu_len = 0;
+    double copy_ns, cursor_ns;
+
+    copy_ns =
+        testRPMEncodeNs(testRPMEncodeCopy, apdu, 16384, temp_buf,
+        &apdu_len);
+    cursor_ns =
+        testRPMEncodeNs(testRPMEncodeCursor, test_apdu, 16384, temp_buf,
+        &test_apdu_len);
+    ct_test(pTest, apdu_len > 0);
+    ct_test(pTest, apdu_len == test_apdu_len);
+    ct_test(pTest, memcmp(apdu, test_apdu, apdu_len) == 0);
+    fprintf(stream, "\n  %u properties, %d bytes per reply\n",
+        RPM_BENCH_PROPERTIES, apdu_len);
+    fprintf(stream, "  %-12s %12s %12s\n", "", "ns/reply", "MB/s");
+    fprintf(stream, "  %-12s %12.0f %12.1f\n", "temp + copy", copy_ns,
+        apdu_len * 1e3 / copy_ns);
+    fprintf(stream, "  %-12s %12.0f %12.1f\n", "cursor", cursor_ns,
+        apdu_len * 1e3 / cursor_ns);
+}
+
 #ifdef TEST_READ_PROPERTY_MULTIPLE
 int main(
     void)
@@ -968,6 +1293,10 @@ int main(
     assert(rc);
     rc = ct_addTestFunction(pTest, testReadPropertyMultipleAck);
     assert(rc);
+    rc = ct_addTestFunction(pTest, testReadPropertyMultipleAckCursor);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testReadPropertyMultipleAckBenchmark);
+    assert(rc);
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
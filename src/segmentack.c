@@ -0,0 +1,139 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#include <stdint.h>
+#include "bacenum.h"
+#include "bacdef.h"
+#include "segmentack.h"
+
+/** @file segmentack.c  Segment-ACK Encoding/Decoding */
+
+/* encode the whole APDU, returns 4 */
+int segmentack_encode_apdu(
+    uint8_t * apdu,
+    BACNET_SEGMENT_ACK_DATA * data)
+{
+    int apdu_len = 0;   /* total length of the apdu, return value */
+
+    if (apdu && data) {
+        apdu[0] = PDU_TYPE_SEGMENT_ACK;
+        if (data->negative_ack)
+            apdu[0] |= 0x02;
+        if (data->server)
+            apdu[0] |= 0x01;
+        apdu[1] = data->invoke_id;
+        apdu[2] = data->sequence_number;
+        apdu[3] = data->actual_window_size;
+        apdu_len = 4;
+    }
+
+    return apdu_len;
+}
+
+/* decode the whole APDU, returns the length decoded or -1 if it is not
+   a Segment-ACK */
+int segmentack_decode_apdu(
+    uint8_t * apdu,
+    unsigned apdu_len,
+    BACNET_SEGMENT_ACK_DATA * data)
+{
+    if (!apdu || !data || (apdu_len < 4))
+        return -1;
+    if ((apdu[0] & 0xF0) != PDU_TYPE_SEGMENT_ACK)
+        return -1;
+    data->negative_ack = (apdu[0] & 0x02) ? true : false;
+    data->server = (apdu[0] & 0x01) ? true : false;
+    data->invoke_id = apdu[1];
+    data->sequence_number = apdu[2];
+    data->actual_window_size = apdu[3];
+
+    return 4;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <string.h>
+#include "ctest.h"
+
+void testSegmentAck(
+    Test * pTest)
+{
+    uint8_t apdu[8] = { 0 };
+    BACNET_SEGMENT_ACK_DATA data, test_data;
+    unsigned flags, sequence;
+    int len;
+
+    for (flags = 0; flags < 4; flags++) {
+        for (sequence = 0; sequence < 256; sequence += 17) {
+            data.negative_ack = (flags & 2) ? true : false;
+            data.server = (flags & 1) ? true : false;
+            data.invoke_id = (uint8_t) (255 - sequence);
+            data.sequence_number = (uint8_t) sequence;
+            data.actual_window_size = (uint8_t) (1 + (sequence % 127));
+            len = segmentack_encode_apdu(&apdu[0], &data);
+            ct_test(pTest, len == 4);
+            ct_test(pTest, (apdu[0] & 0xF0) == PDU_TYPE_SEGMENT_ACK);
+            memset(&test_data, 0, sizeof(test_data));
+            len = segmentack_decode_apdu(&apdu[0], 4, &test_data);
+            ct_test(pTest, len == 4);
+            ct_test(pTest, test_data.negative_ack == data.negative_ack);
+            ct_test(pTest, test_data.server == data.server);
+            ct_test(pTest, test_data.invoke_id == data.invoke_id);
+            ct_test(pTest, test_data.sequence_number == data.sequence_number);
+            ct_test(pTest,
+                test_data.actual_window_size == data.actual_window_size);
+        }
+    }
+
+    /* short, or not a Segment-ACK */
+    ct_test(pTest, segmentack_decode_apdu(&apdu[0], 3, &test_data) == -1);
+    apdu[0] = PDU_TYPE_ABORT;
+    ct_test(pTest, segmentack_decode_apdu(&apdu[0], 4, &test_data) == -1);
+    ct_test(pTest, segmentack_decode_apdu(NULL, 4, &test_data) == -1);
+}
+
+#ifdef TEST_SEGMENT_ACK
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Segment-ACK", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testSegmentAck);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_SEGMENT_ACK */
+#endif /* TEST */
@@ -0,0 +1,511 @@
+/****************************************************************************************
+*
+*   Copyright (C) 2018 BACnet Interoperability Testing Services, Inc.
+*
+*   This program is free software : you can redistribute it and/or modify
+*   it under the terms of the GNU Lesser General Public License as published by
+*   the Free Software Foundation, either version 3 of the License, or
+*   (at your option) any later version.
+
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+*   GNU Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program.If not, see <http://www.gnu.org/licenses/>.
+*
+*   For more information : info@bac-test.com
+*
+*   For access to source code :
+*
+*       info@bac-test.com
+*           or
+*       www.github.com/bacnettesting/bacnet-stack
+*
+****************************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer_wheel.h"
+
+/** @file timer_wheel.c  Hierarchical timer wheel */
+
+#define TIMER_WHEEL_MASK    (TIMER_WHEEL_SLOTS - 1)
+/* how far ahead the wheel reaches */
+#define TIMER_WHEEL_SPAN    ((uint32_t) 1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+/* the lowest set bit, bits is not 0 */
+static unsigned timer_wheel_first(
+    uint64_t bits)
+{
+#if defined(__GNUC__)
+    return (unsigned) __builtin_ctzll(bits);
+#else
+    unsigned n = 0;
+
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* level 0 holds what is due in the next 64 ticks, level 1 the next 64 * 64,
+   and so on, each in the slot for its deadline at that level */
+static void timer_wheel_link(
+    BACNET_TIMER_WHEEL * wheel,
+    BACNET_TIMER * timer)
+{
+    uint32_t delta = timer->expires - wheel->now;
+    uint32_t when = timer->expires;
+    unsigned level = 0;
+    unsigned slot;
+    BACNET_TIMER **head;
+
+    if (delta >= TIMER_WHEEL_SPAN) {
+        delta = TIMER_WHEEL_SPAN - 1;
+        when = wheel->now + delta;
+    }
+    while ((level < (TIMER_WHEEL_LEVELS - 1)) &&
+        (delta >= ((uint32_t) 1 << (TIMER_WHEEL_BITS * (level + 1))))) {
+        level++;
+    }
+    slot = (when >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    head = &wheel->slots[level][slot];
+    timer->next = *head;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+    timer->slot = (uint16_t) (level * TIMER_WHEEL_SLOTS + slot);
+    wheel->occupied[level] |= (uint64_t) 1 << slot;
+}
+
+static void timer_wheel_unlink(
+    BACNET_TIMER_WHEEL * wheel,
+    BACNET_TIMER * timer)
+{
+    unsigned level = timer->slot / TIMER_WHEEL_SLOTS;
+    unsigned slot = timer->slot % TIMER_WHEEL_SLOTS;
+
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    if (wheel->slots[level][slot] == NULL) {
+        wheel->occupied[level] &= ~((uint64_t) 1 << slot);
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/* level 0 has come round, move the next slot of each level that has come
+   round with it down to where its timers now belong */
+static void timer_wheel_cascade(
+    BACNET_TIMER_WHEEL * wheel)
+{
+    unsigned level;
+    unsigned index;
+    BACNET_TIMER *list;
+    BACNET_TIMER *next;
+
+    for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        index = (wheel->now >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+        list = wheel->slots[level][index];
+        wheel->slots[level][index] = NULL;
+        wheel->occupied[level] &= ~((uint64_t) 1 << index);
+        while (list) {
+            next = list->next;
+            timer_wheel_link(wheel, list);
+            list = next;
+        }
+        if (index != 0) {
+            break;
+        }
+    }
+}
+
+void timer_wheel_init(
+    BACNET_TIMER_WHEEL * wheel)
+{
+    unsigned level;
+    unsigned slot;
+
+    wheel->now = 0;
+    wheel->count = 0;
+    for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        wheel->occupied[level] = 0;
+        for (slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            wheel->slots[level][slot] = NULL;
+        }
+    }
+}
+
+void timer_wheel_start(
+    BACNET_TIMER_WHEEL * wheel,
+    BACNET_TIMER * timer,
+    uint32_t ticks,
+    timer_wheel_callback callback,
+    void *context)
+{
+    timer_wheel_stop(wheel, timer);
+    if (ticks == 0) {
+        ticks = 1;
+    }
+    timer->expires = wheel->now + ticks;
+    timer->callback = callback;
+    timer->context = context;
+    timer_wheel_link(wheel, timer);
+    wheel->count++;
+}
+
+void timer_wheel_stop(
+    BACNET_TIMER_WHEEL * wheel,
+    BACNET_TIMER * timer)
+{
+    if (timer->pprev) {
+        timer_wheel_unlink(wheel, timer);
+        wheel->count--;
+    }
+}
+
+bool timer_wheel_pending(
+    const BACNET_TIMER * timer)
+{
+    return (timer->pprev != NULL);
+}
+
+uint32_t timer_wheel_remaining(
+    const BACNET_TIMER_WHEEL * wheel,
+    const BACNET_TIMER * timer)
+{
+    if (timer->pprev == NULL) {
+        return 0;
+    }
+    return timer->expires - wheel->now;
+}
+
+void timer_wheel_advance(
+    BACNET_TIMER_WHEEL * wheel,
+    uint32_t ticks)
+{
+    unsigned index;
+    uint32_t step;
+    uint64_t ahead;
+    BACNET_TIMER **head;
+    BACNET_TIMER *timer;
+
+    while (ticks) {
+        /* straight to the next slot with something in it, or to the end of
+           this turn of level 0, whichever is sooner */
+        index = wheel->now & TIMER_WHEEL_MASK;
+        step = TIMER_WHEEL_SLOTS - index;
+        if (index < TIMER_WHEEL_MASK) {
+            ahead = wheel->occupied[0] >> (index + 1);
+            if (ahead) {
+                step = timer_wheel_first(ahead) + 1;
+            }
+        }
+        if (step > ticks) {
+            step = ticks;
+        }
+        wheel->now += step;
+        ticks -= step;
+        if ((wheel->now & TIMER_WHEEL_MASK) == 0) {
+            timer_wheel_cascade(wheel);
+        }
+        /* one at a time, a callback may change the slot */
+        head = &wheel->slots[0][wheel->now & TIMER_WHEEL_MASK];
+        while ((timer = *head) != NULL) {
+            timer_wheel_unlink(wheel, timer);
+            wheel->count--;
+            timer->callback(timer);
+        }
+    }
+}
+
+uint32_t timer_wheel_next(
+    const BACNET_TIMER_WHEEL * wheel)
+{
+    uint32_t next = UINT32_MAX;
+    uint64_t due;
+    uint64_t bits;
+    unsigned level;
+    unsigned shift;
+    unsigned index;
+    unsigned slot;
+    unsigned turns;
+
+    if (wheel->count == 0) {
+        return next;
+    }
+    for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        shift = TIMER_WHEEL_BITS * level;
+        index = (wheel->now >> shift) & TIMER_WHEEL_MASK;
+        for (bits = wheel->occupied[level]; bits; bits &= bits - 1) {
+            slot = timer_wheel_first(bits);
+            /* the slot is next reached this many turns of its level on */
+            turns = ((slot - index - 1) & TIMER_WHEEL_MASK) + 1;
+            due = ((((uint64_t) wheel->now >> shift) + turns) << shift) -
+                wheel->now;
+            if (due < next) {
+                next = (uint32_t) due;
+            }
+        }
+    }
+
+    return next;
+}
+
+unsigned timer_wheel_count(
+    const BACNET_TIMER_WHEEL * wheel)
+{
+    return wheel->count;
+}
+
+#ifdef TEST
+#include <assert.h>
+#include <time.h>
+
+#define TEST_TIMERS 200
+
+static unsigned Test_Fired;
+static unsigned Test_Late;
+static BACNET_TIMER_WHEEL *Test_Wheel;
+
+static uint32_t testTimerWheelRandom(
+    void)
+{
+    static uint32_t seed = 12345;
+
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+/* context is the tick it should have fired on */
+static void testTimerWheelFired(
+    BACNET_TIMER * timer)
+{
+    if (Test_Wheel->now != (uint32_t) (uintptr_t) timer->context) {
+        Test_Late++;
+    }
+    Test_Fired++;
+}
+
+/* restarts itself, context counts the periods left */
+static void testTimerWheelPeriodic(
+    BACNET_TIMER * timer)
+{
+    uintptr_t left = (uintptr_t) timer->context;
+
+    Test_Fired++;
+    if (left > 1) {
+        timer_wheel_start(Test_Wheel, timer, 10, testTimerWheelPeriodic,
+            (void *) (left - 1));
+    }
+}
+
+static void testTimerWheelStartAt(
+    BACNET_TIMER_WHEEL * wheel,
+    BACNET_TIMER * timer,
+    uint32_t ticks)
+{
+    timer_wheel_start(wheel, timer, ticks, testTimerWheelFired,
+        (void *) (uintptr_t) (wheel->now + ticks));
+}
+
+void testTimerWheel(
+    Test * pTest)
+{
+    static BACNET_TIMER_WHEEL wheel;
+    static BACNET_TIMER timers[TEST_TIMERS];
+    static const uint32_t deadlines[] = {
+        1, 2, 63, 64, 65, 127, 4095, 4096, 4097, 100000, 262144,
+        16777215, 16777216, 16777300, 1073741823, 1073741824, 2000000000
+    };
+    const unsigned n = sizeof(deadlines) / sizeof(deadlines[0]);
+    uint32_t step;
+    unsigned i;
+
+    Test_Wheel = &wheel;
+    timer_wheel_init(&wheel);
+    ct_test(pTest, timer_wheel_count(&wheel) == 0);
+    ct_test(pTest, timer_wheel_next(&wheel) == UINT32_MAX);
+    ct_test(pTest, !timer_wheel_pending(&timers[0]));
+    ct_test(pTest, timer_wheel_remaining(&wheel, &timers[0]) == 0);
+
+    /* each level and the far end, hit exactly tick by tick */
+    for (i = 0; i < n; i++) {
+        testTimerWheelStartAt(&wheel, &timers[i], deadlines[i]);
+    }
+    ct_test(pTest, timer_wheel_count(&wheel) == n);
+    ct_test(pTest, timer_wheel_remaining(&wheel, &timers[9]) == 100000);
+    ct_test(pTest, timer_wheel_next(&wheel) == 1);
+    Test_Fired = Test_Late = 0;
+    timer_wheel_advance(&wheel, 1);
+    ct_test(pTest, Test_Fired == 1);
+    ct_test(pTest, timer_wheel_next(&wheel) == 1);
+    timer_wheel_advance(&wheel, 1);
+    ct_test(pTest, timer_wheel_next(&wheel) == 61);
+    ct_test(pTest, timer_wheel_remaining(&wheel, &timers[9]) == 99998);
+    /* a far deadline may be put back, never passed */
+    while (timer_wheel_count(&wheel)) {
+        step = timer_wheel_next(&wheel);
+        ct_test(pTest, step > 0);
+        timer_wheel_advance(&wheel, step);
+    }
+    ct_test(pTest, Test_Fired == n);
+    ct_test(pTest, Test_Late == 0);
+    ct_test(pTest, wheel.now == 2000000000);
+
+    /* stop and restart */
+    Test_Fired = Test_Late = 0;
+    testTimerWheelStartAt(&wheel, &timers[0], 100);
+    testTimerWheelStartAt(&wheel, &timers[1], 100);
+    timer_wheel_stop(&wheel, &timers[0]);
+    timer_wheel_stop(&wheel, &timers[0]);
+    ct_test(pTest, !timer_wheel_pending(&timers[0]));
+    ct_test(pTest, timer_wheel_count(&wheel) == 1);
+    testTimerWheelStartAt(&wheel, &timers[1], 5000);
+    ct_test(pTest, timer_wheel_count(&wheel) == 1);
+    timer_wheel_advance(&wheel, 4999);
+    ct_test(pTest, Test_Fired == 0);
+    timer_wheel_advance(&wheel, 1);
+    ct_test(pTest, Test_Fired == 1);
+    ct_test(pTest, Test_Late == 0);
+    ct_test(pTest, timer_wheel_count(&wheel) == 0);
+
+    /* 0 ticks is the next tick, and time can wrap */
+    wheel.now = UINT32_MAX - 2;
+    testTimerWheelStartAt(&wheel, &timers[0], 0);
+    timers[0].context = (void *) (uintptr_t) (wheel.now + 1);
+    testTimerWheelStartAt(&wheel, &timers[1], 10);
+    Test_Fired = Test_Late = 0;
+    timer_wheel_advance(&wheel, 20);
+    ct_test(pTest, Test_Fired == 2);
+    ct_test(pTest, Test_Late == 0);
+
+    /* a callback restarting itself, and a large step passing several */
+    Test_Fired = 0;
+    timer_wheel_start(&wheel, &timers[0], 10, testTimerWheelPeriodic,
+        (void *) 5);
+    timer_wheel_advance(&wheel, 1000);
+    ct_test(pTest, Test_Fired == 5);
+    ct_test(pTest, timer_wheel_count(&wheel) == 0);
+
+    /* random deadlines and steps against their exact ticks */
+    Test_Fired = Test_Late = 0;
+    for (i = 0; i < TEST_TIMERS; i++) {
+        testTimerWheelStartAt(&wheel, &timers[i],
+            testTimerWheelRandom() % 1000000);
+    }
+    for (i = 0; i < TEST_TIMERS; i += 3) {
+        timer_wheel_stop(&wheel, &timers[i]);
+    }
+    while (timer_wheel_count(&wheel)) {
+        step = timer_wheel_next(&wheel);
+        ct_test(pTest, step > 0);
+        /* sometimes exactly, sometimes short of it */
+        if (testTimerWheelRandom() & 1) {
+            step = 1 + testTimerWheelRandom() % step;
+        }
+        timer_wheel_advance(&wheel, step);
+    }
+    ct_test(pTest, Test_Fired == TEST_TIMERS - (TEST_TIMERS + 2) / 3);
+    ct_test(pTest, Test_Late == 0);
+}
+
+#define BENCH_TABLE     255
+#define BENCH_TICKS     100000
+
+static void testTimerWheelBenchFired(
+    BACNET_TIMER * timer)
+{
+    (void) timer;
+}
+
+/* The cost of letting a millisecond pass: a sweep of a table of
+   countdowns, as the TSM and the caches did, against the wheel, with
+   few and with all of the entries live */
+void testTimerWheelBenchmark(
+    Test * pTest)
+{
+    static BACNET_TIMER_WHEEL wheel;
+    static BACNET_TIMER timers[BENCH_TABLE];
+    static volatile uint32_t countdown[BENCH_TABLE];
+    static volatile uint8_t state[BENCH_TABLE];
+    FILE *stream = ct_getStream(pTest);
+    struct timespec start, end;
+    double sweep_ns, wheel_ns;
+    unsigned live[] = { 0, 8, BENCH_TABLE };
+    unsigned i, j, k;
+
+    fprintf(stream, "\n  %u entries, ns per 1 ms tick\n", BENCH_TABLE);
+    fprintf(stream, "  %-6s %12s %12s\n", "live", "sweep", "wheel");
+    for (k = 0; k < sizeof(live) / sizeof(live[0]); k++) {
+        for (i = 0; i < BENCH_TABLE; i++) {
+            state[i] = (i < live[k]);
+            countdown[i] = UINT32_MAX;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < BENCH_TICKS; j++) {
+            for (i = 0; i < BENCH_TABLE; i++) {
+                if (state[i] && countdown[i]) {
+                    countdown[i]--;
+                }
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        sweep_ns =
+            ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec -
+                start.tv_nsec)) / BENCH_TICKS;
+
+        timer_wheel_init(&wheel);
+        for (i = 0; i < live[k]; i++) {
+            /* APDU timeouts, a few seconds out, restarted as they go */
+            timer_wheel_start(&wheel, &timers[i], 3000 + i * 7,
+                testTimerWheelBenchFired, NULL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < BENCH_TICKS; j++) {
+            timer_wheel_advance(&wheel, 1);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        wheel_ns =
+            ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec -
+                start.tv_nsec)) / BENCH_TICKS;
+        ct_test(pTest, timer_wheel_count(&wheel) == 0);
+        fprintf(stream, "  %-6u %12.1f %12.1f\n", live[k], sweep_ns,
+            wheel_ns);
+    }
+}
+
+#ifdef TEST_TIMER_WHEEL
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    pTest = ct_create("BACnet Timer Wheel", NULL);
+
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testTimerWheel);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTimerWheelBenchmark);
+    assert(rc);
+
+    ct_setStream(pTest, stdout);
+    ct_run(pTest);
+    (void) ct_report(pTest);
+
+    ct_destroy(pTest);
+
+    return 0;
+}
+#endif /* TEST_TIMER_WHEEL */
+#endif /* TEST */
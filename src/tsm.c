@@ -50,6 +50,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include "bits.h"
 #include "apdu.h"
 #include "bacdef.h"
@@ -61,6 +63,9 @@
 #include "handlers.h"
 #include "address.h"
 #include "bacaddr.h"
+#include "abort.h"
+#include "segmentack.h"
+#include "bacnet_lock.h"
 
 /** @file tsm.c  BACnet Transaction State Machine operations  */
 
@@ -70,69 +75,373 @@
 /* If we are only a server and only initiate broadcasts, */
 /* then we don't need a TSM layer. */
 
-/* FIXME: not coded for segmentation */
+/* FIXME: segmented requests are neither sent nor received */
 
 /* declare space for the TSM transactions, and set it up in the init. */
 /* table rules: an Invoke ID = 0 is an unused spot in the table */
 static BACNET_TSM_DATA TSM_List[MAX_TSM_TRANSACTIONS];
 
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+/* Server side segmented ComplexACKs. The invoke IDs are the clients', so
+   these are kept apart from TSM_List and found by address and invoke ID.
+   table rules: state IDLE is an unused spot in the table */
+static BACNET_TSM_DATA TSM_Response_List[MAX_SEGMENTED_RESPONSES];
+static uint8_t TSM_Response_Data[MAX_SEGMENTED_RESPONSES][MAX_SEGMENTED_APDU];
+
+/* segmented ComplexACK header: PDU type, invoke ID, sequence number,
+   proposed window size, service choice */
+#define TSM_SEGMENT_HEADER_LEN  5
+/* and the unsegmented one: PDU type, invoke ID, service choice */
+#define TSM_COMPLEX_ACK_HEADER_LEN  3
+
+static void tsm_segmented_response_timeout(
+    BACNET_TSM_DATA * pTsm);
+#endif
+
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+/* Segmented ComplexACKs to our requests are put back together in these,
+   lent to the transaction from its first segment to tsm_free_invoke_id().
+   table rules: an Invoke ID = 0 is an unused buffer */
+static uint8_t TSM_Reassembly_Data[MAX_SEGMENTED_REASSEMBLY][MAX_SEGMENTED_APDU];
+static uint8_t TSM_Reassembly_Owner[MAX_SEGMENTED_REASSEMBLY];
+
+static void tsm_reassembly_free(
+    BACNET_TSM_DATA * pTsm);
+static void tsm_segmented_confirmation_timeout(
+    BACNET_TSM_DATA * pTsm);
+#endif
+
+/* the request and segment timers of all of the above, in milliseconds,
+   so only the transactions that are waiting cost anything */
+static BACNET_TIMER_WHEEL TSM_Wheel;
+
 /* invoke ID for incrementing between subsequent calls. */
 static uint8_t Current_Invoke_ID = 1;
 
+/* So that allocating, finding and freeing an invoke ID take the same time
+   however full TSM_List is: TSM_Index maps each invoke ID in use to its
+   spot + 1 (0 is not in use), and TSM_Used has a bit for each of them to
+   find the next free ID a word at a time. The spots that have never been
+   used start at TSM_Fresh, those given back are a list from TSM_Free_Head
+   through TSM_Next_Free, both spot + 1. All zero is an empty table. */
+static uint8_t TSM_Index[256];
+static uint64_t TSM_Used[4];
+static uint8_t TSM_Next_Free[MAX_TSM_TRANSACTIONS];
+static uint8_t TSM_Free_Head;
+static unsigned TSM_Fresh;
+static unsigned TSM_Count;
+
+/* Invoke IDs of each peer's own, see tsm_next_free_invokeID_peer(). The
+   peers and their transactions are allocated as they are needed, kept
+   for reuse when done, and found through hash tables that double as they
+   fill up: the peers by address, the transactions by peer and invoke ID.
+   A peer is let go when it has nothing in flight, and its window kept
+   with its address binding until it is back. */
+typedef struct TSM_Peer {
+    BACNET_ADDRESS address;
+    uint32_t hash;
+    /* the invoke IDs of this peer in use, and where to look next */
+    uint64_t Used[4];
+    uint8_t Current_Invoke_ID;
+    unsigned count;
+    /* how many requests may be in flight to the peer, in TSM_WINDOW_ONE
+       parts of one, how many are, and those waiting for room in order */
+    unsigned window;
+    unsigned in_flight;
+    unsigned queued;
+    struct TSM_Peer_Data *queue_head;
+    struct TSM_Peer_Data *queue_tail;
+    /* the smoothed round trip time to the peer, in eighths of a
+       millisecond, and its mean deviation, in quarters; 0 until the
+       first reply is timed */
+    uint32_t srtt;
+    uint32_t rttvar;
+    /* the most times a request has timed out since the last reply that
+       was timed, each doubling the timeout, up to TSM_BACKOFF_MAX */
+    unsigned backoff;
+    /* the requests sent so far, and while recovering, how many had been
+       when the window was last cut: until one sent after that is
+       answered, the losses of those before it are the same loss */
+    uint32_t sends;
+    uint32_t recover;
+    bool recovering;
+    /* hash chain, or the free list */
+    struct TSM_Peer *next;
+} TSM_PEER;
+
+typedef struct TSM_Peer_Data {
+    /* first, so that the timer context is the TSM_PEER_DATA too */
+    BACNET_TSM_DATA data;
+    TSM_PEER *peer;
+    /* hash chain, or the free list */
+    struct TSM_Peer_Data *next;
+    /* counted in the peer's in_flight */
+    bool in_flight;
+    /* the peer's queue, while TSM_STATE_QUEUED */
+    struct TSM_Peer_Data *queue_next;
+    /* TSM_Wheel time it was first sent, to time the reply, and which of
+       the peer's sends that was */
+    uint32_t sent;
+    uint32_t seq;
+} TSM_PEER_DATA;
+
+#define TSM_HASH_INITIAL 64
+
+/* so the window grows by 1/window for each request answered */
+#define TSM_WINDOW_ONE 256
+/* the largest APDU of MS/TP, and of devices that are likely slow */
+#define TSM_WINDOW_SMALL_APDU 480
+
+static TSM_PEER **TSM_Peer_Table;
+static unsigned TSM_Peer_Table_Size;
+static unsigned TSM_Peer_Count;
+static TSM_PEER *TSM_Peer_Free;
+
+static TSM_PEER_DATA **TSM_Data_Table;
+static unsigned TSM_Data_Table_Size;
+static unsigned TSM_Data_Count;
+static TSM_PEER_DATA *TSM_Data_Free;
+
+/* a new peer starts where the last one left off, so a device that is
+   polled one request at a time does not get the same invoke ID each time */
+static uint8_t TSM_Peer_Invoke_ID = 1;
+
+/* the number of peers using each invoke ID, and a bit for those any of
+   them uses. The invoke IDs in TSM_List keep clear of them while there
+   are others, and theirs keep clear of TSM_Used, but as the replies are
+   matched by where they come from as well, the two only get mixed up if
+   TSM_List has to share an invoke ID with a peer and sends it there */
+static uint16_t TSM_Peer_Users[256];
+static uint64_t TSM_Peer_Used[4];
+
 static tsm_timeout_function Timeout_Function;
+static tsm_peer_timeout_function Peer_Timeout_Function;
+
+/* What the timers send and the timeouts they report, which wait until
+   tsm_timer_milliseconds() has let go of TSM_Lock, so that neither the
+   datalink nor the handlers are called with it held. In the order they
+   were made; pdu_len is 0 for a timeout. */
+typedef struct TSM_Deferred {
+    struct TSM_Deferred *next;
+    BACNET_ADDRESS dest;
+    uint8_t invokeID;
+    /* a request of TSM_List, which Timeout_Function is told of too */
+    bool in_list;
+    BACNET_NPCI_DATA npci_data;
+    unsigned pdu_len;
+    uint8_t pdu[1];
+} TSM_DEFERRED;
+
+static TSM_DEFERRED *TSM_Deferred_Head;
+static TSM_DEFERRED *TSM_Deferred_Tail;
+/* while the timers run */
+static bool TSM_Deferring;
+
+/* everything above, taken by each of the public functions */
+BACNET_LOCK_DEFINE(TSM_Lock);
+
+static void tsm_timer_expired(
+    BACNET_TIMER * timer);
+
+/* (re)starts the one timer the transaction has, for its present state */
+static void tsm_timer_start(
+    BACNET_TSM_DATA * pTsm,
+    uint16_t milliseconds)
+{
+    timer_wheel_start(&TSM_Wheel, &pTsm->Timer, milliseconds,
+        tsm_timer_expired, pTsm);
+}
+
+static void tsm_timer_stop(
+    BACNET_TSM_DATA * pTsm)
+{
+    timer_wheel_stop(&TSM_Wheel, &pTsm->Timer);
+}
+
+/* adds to the end of TSM_Deferred_Head, NULL if there is no memory */
+static TSM_DEFERRED *tsm_defer(
+    BACNET_ADDRESS * dest,
+    unsigned pdu_len)
+{
+    TSM_DEFERRED *work;
+
+    work = (TSM_DEFERRED *) malloc(offsetof(TSM_DEFERRED, pdu) +
+        (pdu_len ? pdu_len : 1));
+    if (work == NULL) {
+        return NULL;
+    }
+    work->next = NULL;
+    bacnet_address_copy(&work->dest, dest);
+    work->invokeID = 0;
+    work->in_list = false;
+    work->pdu_len = pdu_len;
+    if (TSM_Deferred_Tail != NULL) {
+        TSM_Deferred_Tail->next = work;
+    } else {
+        TSM_Deferred_Head = work;
+    }
+    TSM_Deferred_Tail = work;
+
+    return work;
+}
+
+/* datalink_send_pdu(), or a copy of the PDU for tsm_timer_milliseconds()
+   to send if the timers are running */
+static int tsm_send_pdu(
+    BACNET_ADDRESS * dest,
+    BACNET_NPCI_DATA * npci_data,
+    uint8_t * pdu,
+    unsigned pdu_len)
+{
+    TSM_DEFERRED *work;
+
+    if (!TSM_Deferring) {
+        return datalink_send_pdu(dest, npci_data, pdu, pdu_len);
+    }
+    work = tsm_defer(dest, pdu_len);
+    if (work == NULL) {
+        /* as if it was lost on the way */
+        return -1;
+    }
+    npdu_copy_data(&work->npci_data, npci_data);
+    memcpy(&work->pdu[0], pdu, pdu_len);
+
+    return (int) pdu_len;
+}
+
+void tsm_init(
+    void)
+{
+    BACNET_LOCK_INIT(TSM_Lock);
+}
 
 void tsm_set_timeout_handler(
     tsm_timeout_function pFunction)
 {
+    BACNET_LOCK(TSM_Lock);
     Timeout_Function = pFunction;
+    BACNET_UNLOCK(TSM_Lock);
+}
+
+void tsm_set_peer_timeout_handler(
+    tsm_peer_timeout_function pFunction)
+{
+    BACNET_LOCK(TSM_Lock);
+    Peer_Timeout_Function = pFunction;
+    BACNET_UNLOCK(TSM_Lock);
+}
+
+tsm_peer_timeout_function tsm_peer_timeout_handler(
+    void)
+{
+    tsm_peer_timeout_function pFunction;
+
+    BACNET_LOCK(TSM_Lock);
+    pFunction = Peer_Timeout_Function;
+    BACNET_UNLOCK(TSM_Lock);
+
+    return pFunction;
 }
 
 /* returns MAX_TSM_TRANSACTIONS if not found */
 static uint8_t tsm_find_invokeID_index(
     uint8_t invokeID)
 {
-    unsigned i ;     /* counter */
-    uint8_t index = MAX_TSM_TRANSACTIONS;       /* return value */
+    if (TSM_Index[invokeID] == 0) {
+        return MAX_TSM_TRANSACTIONS;
+    }
+    return (uint8_t) (TSM_Index[invokeID] - 1);
+}
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
-        if (TSM_List[i].InvokeID == invokeID) {
-            index = (uint8_t) i;
-            break;
+/* the lowest set bit, bits is not 0 */
+static unsigned tsm_first_bit(
+    uint64_t bits)
+{
+#if defined(__GNUC__)
+    return (unsigned) __builtin_ctzll(bits);
+#else
+    unsigned n = 0;
+
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* the first invoke ID in neither used nor also from invokeID on, round
+   to 1, 0 if they all are */
+static uint8_t tsm_next_unused_invokeID(
+    const uint64_t * used,
+    const uint64_t * also,
+    uint8_t invokeID)
+{
+    unsigned n;
+    unsigned word;
+    uint64_t bits;
+
+    for (n = 0; n <= 4; n++) {
+        word = ((invokeID >> 6) + n) & 3;
+        bits = ~(used[word] | also[word]);
+        if (word == 0) {
+            /* we treat zero internally as invalid or no free */
+            bits &= ~(uint64_t) 1;
+        }
+        if (n == 0) {
+            bits &= ~(uint64_t) 0 << (invokeID & 63);
+        }
+        if (bits) {
+            return (uint8_t) (word * 64 + tsm_first_bit(bits));
         }
     }
 
-    return index;
+    return 0;
 }
 
-static uint8_t tsm_find_first_free_index(
-    void)
+/* takes a spot for invokeID, MAX_TSM_TRANSACTIONS if there are none */
+static uint8_t tsm_index_alloc(
+    uint8_t invokeID)
 {
-    unsigned i ;     /* counter */
-    uint8_t index = MAX_TSM_TRANSACTIONS;       /* return value */
+    uint8_t index;
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
-        if (TSM_List[i].InvokeID == 0) {
-            index = (uint8_t) i;
-            break;
-        }
+    if (TSM_Free_Head) {
+        index = (uint8_t) (TSM_Free_Head - 1);
+        TSM_Free_Head = TSM_Next_Free[index];
+    } else if (TSM_Fresh < MAX_TSM_TRANSACTIONS) {
+        index = (uint8_t) TSM_Fresh++;
+    } else {
+        return MAX_TSM_TRANSACTIONS;
     }
+    TSM_Index[invokeID] = (uint8_t) (index + 1);
+    TSM_Used[invokeID >> 6] |= (uint64_t) 1 << (invokeID & 63);
+    TSM_Count++;
 
     return index;
 }
 
+static void tsm_index_free(
+    uint8_t invokeID)
+{
+    uint8_t index = tsm_find_invokeID_index(invokeID);
+
+    if (index < MAX_TSM_TRANSACTIONS) {
+        TSM_Index[invokeID] = 0;
+        TSM_Used[invokeID >> 6] &= ~((uint64_t) 1 << (invokeID & 63));
+        TSM_Next_Free[index] = TSM_Free_Head;
+        TSM_Free_Head = (uint8_t) (index + 1);
+        TSM_Count--;
+    }
+}
+
 bool tsm_transaction_available(
     void)
 {
     bool status = false;        /* return value */
-    unsigned int i ;     /* counter */
 
-    for (i=0; i < MAX_TSM_TRANSACTIONS; i++) {
-        if (TSM_List[i].InvokeID == 0) {
-            /* one is available! */
-            status = true;
-            break;
-        }
-    }
+    BACNET_LOCK(TSM_Lock);
+    status = (TSM_Count < MAX_TSM_TRANSACTIONS);
+    BACNET_UNLOCK(TSM_Lock);
 
     return status;
 }
@@ -141,15 +450,11 @@ uint8_t tsm_transaction_idle_count(
     void)
 {
     uint8_t count = 0;  /* return value */
-    unsigned i ;     /* counter */
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
-        if ((TSM_List[i].InvokeID == 0) &&
-            (TSM_List[i].state == TSM_STATE_IDLE)) {
-            /* one is available! */
-            count++;
-        }
-    }
+    BACNET_LOCK(TSM_Lock);
+    /* the spots not in use are all IDLE */
+    count = (uint8_t) (MAX_TSM_TRANSACTIONS - TSM_Count);
+    BACNET_UNLOCK(TSM_Lock);
 
     return count;
 }
@@ -162,7 +467,9 @@ void tsm_invokeID_set(
     if (invokeID == 0) {
         invokeID = 1;
     }
+    BACNET_LOCK(TSM_Lock);
     Current_Invoke_ID = invokeID;
+    BACNET_UNLOCK(TSM_Lock);
 }
 
 /* gets the next free invokeID,
@@ -173,243 +480,3005 @@ uint8_t tsm_next_free_invokeID(
 {
     uint8_t index = 0;
     uint8_t invokeID = 0;
-    bool found = false;
 
+    BACNET_LOCK(TSM_Lock);
     /* is there even space available? */
-    if (tsm_transaction_available()) {
-        while (!found) {
-            index = tsm_find_invokeID_index(Current_Invoke_ID);
-            if (index == MAX_TSM_TRANSACTIONS) {
-                /* Not found, so this invokeID is not used */
-                found = true;
-                /* set this id into the table */
-                index = tsm_find_first_free_index();
-                if (index != MAX_TSM_TRANSACTIONS) {
-                    TSM_List[index].InvokeID = invokeID = Current_Invoke_ID;
-                    TSM_List[index].state = TSM_STATE_IDLE;
-                    TSM_List[index].RequestTimer = apdu_timeout();
-                    /* update for the next call or check */
-                    Current_Invoke_ID++;
-                    /* skip zero - we treat that internally as invalid or no free */
-                    if (Current_Invoke_ID == 0) {
-                        Current_Invoke_ID = 1;
-                    }
-                }
-            } else {
-                /* found! This invokeID is already used */
-                /* try next one */
-                Current_Invoke_ID++;
-                /* skip zero - we treat that internally as invalid or no free */
-                if (Current_Invoke_ID == 0) {
-                    Current_Invoke_ID = 1;
-                }
+    if (TSM_Count < MAX_TSM_TRANSACTIONS) {
+        invokeID =
+            tsm_next_unused_invokeID(TSM_Used, TSM_Peer_Used,
+            Current_Invoke_ID);
+        if (invokeID == 0) {
+            /* the peers have all the others, so share one with them */
+            invokeID =
+                tsm_next_unused_invokeID(TSM_Used, TSM_Used,
+                Current_Invoke_ID);
+        }
+        if (invokeID) {
+            /* set this id into the table */
+            index = tsm_index_alloc(invokeID);
+            TSM_List[index].InvokeID = invokeID;
+            TSM_List[index].state = TSM_STATE_IDLE;
+            TSM_List[index].context = NULL;
+            /* no reply matches it until it is sent */
+            memset(&TSM_List[index].dest, 0, sizeof(BACNET_ADDRESS));
+            /* update for the next call or check */
+            Current_Invoke_ID = (uint8_t) (invokeID + 1);
+            /* skip zero - we treat that internally as invalid or no free */
+            if (Current_Invoke_ID == 0) {
+                Current_Invoke_ID = 1;
             }
         }
     }
+    BACNET_UNLOCK(TSM_Lock);
 
     return invokeID;
 }
 
-void tsm_set_confirmed_unsegmented_transaction(
-    uint8_t invokeID,
-    BACNET_ADDRESS * dest,
-    BACNET_NPCI_DATA * ndpu_data,
-    uint8_t * apdu,
-    uint16_t apdu_len)
+#define TSM_FNV_PRIME 16777619UL
+#define TSM_FNV(hash, octet) (((hash) ^ (uint8_t) (octet)) * TSM_FNV_PRIME)
+
+/* over what bacnet_address_same() compares, and nothing else */
+static uint32_t tsm_address_hash(
+    BACNET_ADDRESS * address)
 {
-    uint16_t j = 0;
-    uint8_t index;
+    uint32_t hash = 2166136261UL;
+    unsigned len;
+    unsigned i;
 
-    if (invokeID) {
-        index = tsm_find_invokeID_index(invokeID);
-        if (index < MAX_TSM_TRANSACTIONS) {
-            /* SendConfirmedUnsegmented */
-            TSM_List[index].state = TSM_STATE_AWAIT_CONFIRMATION;
-            TSM_List[index].RetryCount = 0;
-            /* start the timer */
-            TSM_List[index].RequestTimer = apdu_timeout();
-            /* copy the data */
-            for (j = 0; j < apdu_len; j++) {
-                TSM_List[index].apdu[j] = apdu[j];
-            }
-            TSM_List[index].apdu_len = apdu_len;
-            npdu_copy_data(&TSM_List[index].npci_data, ndpu_data);
-            bacnet_address_copy(&TSM_List[index].dest, dest);
+    hash = TSM_FNV(hash, address->net);
+    hash = TSM_FNV(hash, address->net >> 8);
+    hash = TSM_FNV(hash, address->len);
+    len = (address->len > MAX_MAC_LEN) ? MAX_MAC_LEN : address->len;
+    for (i = 0; i < len; i++) {
+        hash = TSM_FNV(hash, address->adr[i]);
+    }
+    if (address->net == 0) {
+        hash = TSM_FNV(hash, address->mac_len);
+        len = (address->mac_len > MAX_MAC_LEN) ? MAX_MAC_LEN :
+            address->mac_len;
+        for (i = 0; i < len; i++) {
+            hash = TSM_FNV(hash, address->mac[i]);
         }
     }
 
+    return hash;
 }
 
-/* used to retrieve the transaction payload */
-/* if we wanted to find out what we sent (i.e. when we get an ack) */
-bool tsm_get_transaction_pdu(
-    uint8_t invokeID,
-    BACNET_ADDRESS * dest,
-    BACNET_NPCI_DATA * ndpu_data,
-    uint8_t * apdu,
-    uint16_t * apdu_len)
+static unsigned tsm_data_bucket(
+    TSM_PEER * peer,
+    uint8_t invokeID)
 {
-    uint16_t j = 0;
-    uint8_t index;
-    bool found = false;
+    return (peer->hash + invokeID * 2654435761UL) & (TSM_Data_Table_Size -
+        1);
+}
 
-    if (invokeID) {
-        index = tsm_find_invokeID_index(invokeID);
-        /* how much checking is needed?  state?  dest match? just invokeID? */
-        if (index < MAX_TSM_TRANSACTIONS) {
-            /* FIXME: we may want to free the transaction so it doesn't timeout */
-            /* retrieve the transaction */
-            /* FIXME: bounds check the pdu_len? */
-            *apdu_len = (uint16_t) TSM_List[index].apdu_len;
-            for (j = 0; j < *apdu_len; j++) {
-                apdu[j] = TSM_List[index].apdu[j];
-            }
-            npdu_copy_data(ndpu_data, &TSM_List[index].npci_data);
-            bacnet_address_copy(dest, &TSM_List[index].dest);
-            found = true;
+/* doubles the peer table, false if there is no memory for it */
+static bool tsm_peer_table_grow(
+    void)
+{
+    unsigned size = TSM_Peer_Table_Size ? TSM_Peer_Table_Size * 2 :
+        TSM_HASH_INITIAL;
+    TSM_PEER **table;
+    TSM_PEER *peer;
+    unsigned i;
+
+    table = (TSM_PEER **) calloc(size, sizeof(TSM_PEER *));
+    if (table == NULL) {
+        return false;
+    }
+    for (i = 0; i < TSM_Peer_Table_Size; i++) {
+        while ((peer = TSM_Peer_Table[i]) != NULL) {
+            TSM_Peer_Table[i] = peer->next;
+            peer->next = table[peer->hash & (size - 1)];
+            table[peer->hash & (size - 1)] = peer;
         }
     }
+    free(TSM_Peer_Table);
+    TSM_Peer_Table = table;
+    TSM_Peer_Table_Size = size;
 
-    return found;
+    return true;
 }
 
-/* called once a millisecond or slower */
-void tsm_timer_milliseconds(
-    uint16_t milliseconds)
+/* doubles the transaction table, false if there is no memory for it */
+static bool tsm_data_table_grow(
+    void)
 {
-    unsigned i ;     /* counter */
+    TSM_PEER_DATA **old_table = TSM_Data_Table;
+    unsigned old_size = TSM_Data_Table_Size;
+    unsigned size = old_size ? old_size * 2 : TSM_HASH_INITIAL;
+    TSM_PEER_DATA *pd;
+    unsigned bucket;
+    unsigned i;
 
-    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
-        if (TSM_List[i].state == TSM_STATE_AWAIT_CONFIRMATION) {
-            if (TSM_List[i].RequestTimer > milliseconds)
-                TSM_List[i].RequestTimer -= milliseconds;
-            else
-                TSM_List[i].RequestTimer = 0;
-            /* AWAIT_CONFIRMATION */
-            if (TSM_List[i].RequestTimer == 0) {
-                if (TSM_List[i].RetryCount < apdu_retries()) {
-                    TSM_List[i].RequestTimer = apdu_timeout();
-                    TSM_List[i].RetryCount++;
-                    datalink_send_pdu(&TSM_List[i].dest,
-                        &TSM_List[i].npci_data, &TSM_List[i].apdu[0],
-                        TSM_List[i].apdu_len);
-                } else {
-                    /* note: the invoke id has not been cleared yet
-                       and this indicates a failed message:
-                       IDLE and a valid invoke id */
-                    TSM_List[i].state = TSM_STATE_IDLE;
-                    if (TSM_List[i].InvokeID != 0) {
-                        if (Timeout_Function) {
-                            Timeout_Function(TSM_List[i].InvokeID);
-                        }
-                    }
-                }
-            }
+    TSM_Data_Table = (TSM_PEER_DATA **) calloc(size, sizeof(TSM_PEER_DATA *));
+    if (TSM_Data_Table == NULL) {
+        TSM_Data_Table = old_table;
+        return false;
+    }
+    TSM_Data_Table_Size = size;
+    for (i = 0; i < old_size; i++) {
+        while ((pd = old_table[i]) != NULL) {
+            old_table[i] = pd->next;
+            bucket = tsm_data_bucket(pd->peer, pd->data.InvokeID);
+            pd->next = TSM_Data_Table[bucket];
+            TSM_Data_Table[bucket] = pd;
         }
     }
+    free(old_table);
+
+    return true;
 }
 
-/* frees the invokeID and sets its state to IDLE */
-void tsm_free_invoke_id(
-    uint8_t invokeID)
+static TSM_PEER *tsm_peer_find(
+    BACNET_ADDRESS * address,
+    uint32_t hash)
 {
-    uint8_t index;
+    TSM_PEER *peer = NULL;
 
-    index = tsm_find_invokeID_index(invokeID);
-    if (index < MAX_TSM_TRANSACTIONS) {
-        TSM_List[index].state = TSM_STATE_IDLE;
-        TSM_List[index].InvokeID = 0;
+    if (TSM_Peer_Count) {
+        peer = TSM_Peer_Table[hash & (TSM_Peer_Table_Size - 1)];
+        while ((peer != NULL) && ((peer->hash != hash) ||
+                !bacnet_address_same(&peer->address, address))) {
+            peer = peer->next;
+        }
     }
+
+    return peer;
 }
 
-/** Check if the invoke ID has been made free by the Transaction State Machine.
- * @param invokeID [in] The invokeID to be checked, normally of last message sent.
- * @return True if it is free (done with), False if still pending in the TSM.
- */
-bool tsm_invoke_id_free(
-    uint8_t invokeID)
+/* what the address cache kept of the peer at address, with the window
+   guessed from where it is if there is none: one request at a time behind
+   a router or over MS/TP */
+static void tsm_peer_learned(
+    TSM_PEER * peer,
+    BACNET_ADDRESS * address)
 {
-    bool status = true;
-    uint8_t index;
-
-    index = tsm_find_invokeID_index(invokeID);
-    if (index < MAX_TSM_TRANSACTIONS)
-        status = false;
+    BACNET_ADDRESS_LEARNED learned = { 0 };
+    unsigned max_apdu = 0;
+    unsigned window;
+    bool bound;
 
-    return status;
+    bound = address_learned_get(address, &max_apdu, &learned);
+    window = learned.window;
+    if (window) {
+        if (window < TSM_WINDOW_ONE) {
+            window = TSM_WINDOW_ONE;
+        } else if (window > TSM_WINDOW_MAX * TSM_WINDOW_ONE) {
+            window = TSM_WINDOW_MAX * TSM_WINDOW_ONE;
+        }
+    } else if ((address->net != 0) || (bound &&
+            (max_apdu <= TSM_WINDOW_SMALL_APDU))) {
+        window = TSM_WINDOW_ONE;
+    } else {
+        window = TSM_WINDOW_INITIAL * TSM_WINDOW_ONE;
+    }
+    peer->window = window;
+    peer->srtt = learned.srtt;
+    peer->rttvar = learned.rttvar;
+    peer->backoff = (learned.backoff > TSM_BACKOFF_MAX) ? TSM_BACKOFF_MAX :
+        learned.backoff;
 }
 
-/** See if we failed get a confirmation for the message associated
- *  with this invoke ID.
- * @param invokeID [in] The invokeID to be checked, normally of last message sent.
- * @return True if already failed, False if done or segmented or still waiting
- *         for a confirmation.
- */
-bool tsm_invoke_id_failed(
-    uint8_t invokeID)
+static TSM_PEER *tsm_peer_add(
+    BACNET_ADDRESS * address,
+    uint32_t hash)
 {
-    bool status = false;
-    uint8_t index;
+    TSM_PEER *peer;
+    unsigned bucket;
 
-    index = tsm_find_invokeID_index(invokeID);
-    if (index < MAX_TSM_TRANSACTIONS) {
-        /* a valid invoke ID and the state is IDLE is a
-           message that failed to confirm */
-        if (TSM_List[index].state == TSM_STATE_IDLE)
-            status = true;
+    if ((TSM_Peer_Count >= TSM_Peer_Table_Size) && !tsm_peer_table_grow()) {
+        return NULL;
+    }
+    peer = TSM_Peer_Free;
+    if (peer != NULL) {
+        TSM_Peer_Free = peer->next;
+    } else {
+        peer = (TSM_PEER *) malloc(sizeof(TSM_PEER));
+        if (peer == NULL) {
+            return NULL;
+        }
     }
+    memset(peer, 0, sizeof(TSM_PEER));
+    bacnet_address_copy(&peer->address, address);
+    peer->hash = hash;
+    peer->Current_Invoke_ID = TSM_Peer_Invoke_ID;
+    tsm_peer_learned(peer, address);
+    bucket = hash & (TSM_Peer_Table_Size - 1);
+    peer->next = TSM_Peer_Table[bucket];
+    TSM_Peer_Table[bucket] = peer;
+    TSM_Peer_Count++;
 
-    return status;
+    return peer;
 }
 
+/* the peer has nothing in flight */
+static void tsm_peer_remove(
+    TSM_PEER * peer)
+{
+    TSM_PEER **link = &TSM_Peer_Table[peer->hash & (TSM_Peer_Table_Size - 1)];
+    BACNET_ADDRESS_LEARNED learned;
 
-#ifdef TEST
-#include <assert.h>
-#include <string.h>
-#include "ctest.h"
-
-/* flag to send an I-Am */
-bool I_Am_Request = true;
+    while (*link != peer) {
+        link = &(*link)->next;
+    }
+    *link = peer->next;
+    learned.window = peer->window;
+    learned.srtt = peer->srtt;
+    learned.rttvar = peer->rttvar;
+    learned.backoff = peer->backoff;
+    address_learned_set(&peer->address, &learned);
+    peer->next = TSM_Peer_Free;
+    TSM_Peer_Free = peer;
+    TSM_Peer_Count--;
+}
 
-/* dummy function stubs */
-int datalink_send_pdu(
-    BACNET_ADDRESS * dest,
-    BACNET_NPCI_DATA * npci_data,
-    uint8_t * pdu,
-    unsigned pdu_len)
+static TSM_PEER_DATA *tsm_peer_data_find(
+    BACNET_ADDRESS * address,
+    uint8_t invokeID)
 {
-    (void) dest;
-    (void) npci_data;
-    (void) pdu;
-    (void) pdu_len;
+    TSM_PEER *peer;
+    TSM_PEER_DATA *pd = NULL;
 
-    return 0;
+    if (TSM_Data_Count == 0) {
+        return NULL;
+    }
+    peer = tsm_peer_find(address, tsm_address_hash(address));
+    if ((peer != NULL) &&
+        (peer->Used[invokeID >> 6] & ((uint64_t) 1 << (invokeID & 63)))) {
+        pd = TSM_Data_Table[tsm_data_bucket(peer, invokeID)];
+        while ((pd != NULL) && ((pd->peer != peer) ||
+                (pd->data.InvokeID != invokeID))) {
+            pd = pd->next;
+        }
+    }
+
+    return pd;
 }
 
-/* dummy function stubs */
-void datalink_get_broadcast_address(
+/* reserves the next invoke ID of the peer at dest, NULL if none */
+static TSM_PEER_DATA *tsm_peer_data_alloc(
     BACNET_ADDRESS * dest)
 {
-    (void) dest;
+    uint32_t hash = tsm_address_hash(dest);
+    TSM_PEER *peer;
+    TSM_PEER_DATA *pd = NULL;
+    uint8_t invokeID;
+    unsigned bucket;
+
+    if ((TSM_Data_Count >= MAX_TSM_PEER_TRANSACTIONS) ||
+        ((TSM_Data_Count >= TSM_Data_Table_Size) && !tsm_data_table_grow())) {
+        return NULL;
+    }
+    peer = tsm_peer_find(dest, hash);
+    if (peer == NULL) {
+        peer = tsm_peer_add(dest, hash);
+        if (peer == NULL) {
+            return NULL;
+        }
+    }
+    invokeID =
+        tsm_next_unused_invokeID(peer->Used, TSM_Used,
+        peer->Current_Invoke_ID);
+    if (invokeID) {
+        pd = TSM_Data_Free;
+        if (pd != NULL) {
+            TSM_Data_Free = pd->next;
+        } else {
+            /* zeroed, which is a stopped timer */
+            pd = (TSM_PEER_DATA *) calloc(1, sizeof(TSM_PEER_DATA));
+        }
+    }
+    if (pd == NULL) {
+        if (peer->count == 0) {
+            tsm_peer_remove(peer);
+        }
+        return NULL;
+    }
+    pd->peer = peer;
+    pd->data.InvokeID = invokeID;
+    pd->data.state = TSM_STATE_IDLE;
+    pd->data.context = NULL;
+    pd->data.segment_data = NULL;
+    pd->data.segment_data_len = 0;
+    pd->in_flight = false;
+    pd->queue_next = NULL;
+    bacnet_address_copy(&pd->data.dest, dest);
+    bucket = tsm_data_bucket(peer, invokeID);
+    pd->next = TSM_Data_Table[bucket];
+    TSM_Data_Table[bucket] = pd;
+    TSM_Data_Count++;
+
+    peer->Used[invokeID >> 6] |= (uint64_t) 1 << (invokeID & 63);
+    peer->count++;
+    if (TSM_Peer_Users[invokeID]++ == 0) {
+        TSM_Peer_Used[invokeID >> 6] |= (uint64_t) 1 << (invokeID & 63);
+    }
+    /* skip zero - we treat that internally as invalid or no free */
+    peer->Current_Invoke_ID = (uint8_t) (invokeID + 1);
+    if (peer->Current_Invoke_ID == 0) {
+        peer->Current_Invoke_ID = 1;
+    }
+    TSM_Peer_Invoke_ID = peer->Current_Invoke_ID;
+
+    return pd;
 }
 
-void testTSM(
-    Test * pTest)
+static bool tsm_in_list(
+    BACNET_TSM_DATA * pTsm)
 {
-    /* FIXME: add some unit testing... */
+    return (pTsm >= &TSM_List[0]) && (pTsm < &TSM_List[MAX_TSM_TRANSACTIONS]);
 }
 
-#ifdef TEST_TSM
-int main(
-    void)
+/* a reply from the peer, rtt milliseconds after the request was sent.
+   Jacobson's estimator, as RFC 6298 has it for TCP */
+static void tsm_rtt_sample(
+    TSM_PEER * peer,
+    uint32_t rtt)
 {
-    Test *pTest;
-    bool rc;
+    int32_t delta;
 
-    pTest = ct_create("BACnet TSM", NULL);
-    /* individual tests */
-    rc = ct_addTestFunction(pTest, testTSM);
+    if (rtt > 65535UL) {
+        rtt = 65535UL;
+    } else if (rtt == 0) {
+        /* as fine as tsm_timer_milliseconds() is called */
+        rtt = 1;
+    }
+    if (peer->srtt == 0) {
+        peer->srtt = rtt << 3;
+        peer->rttvar = rtt << 1;
+    } else {
+        delta = (int32_t) rtt - (int32_t) (peer->srtt >> 3);
+        peer->srtt = (uint32_t) ((int32_t) peer->srtt + delta);
+        if (delta < 0) {
+            delta = -delta;
+        }
+        delta -= (int32_t) (peer->rttvar >> 2);
+        peer->rttvar = (uint32_t) ((int32_t) peer->rttvar + delta);
+    }
+}
+
+/* the smoothed round trip time plus four deviations, and a quarter of
+   the time at least for a device that always takes the same, within the
+   limits; apdu_timeout() until a reply has been timed. Doubled for each
+   timeout since the last reply that was timed. */
+static uint16_t tsm_peer_timeout(
+    TSM_PEER * peer)
+{
+    uint32_t timeout;
+    uint32_t margin;
+
+    if (peer->srtt == 0) {
+        timeout = apdu_timeout();
+    } else {
+        margin = peer->rttvar;
+        if (margin < (peer->srtt >> 5)) {
+            margin = peer->srtt >> 5;
+        }
+        timeout = (peer->srtt >> 3) + margin;
+        if (timeout < TSM_TIMEOUT_MIN) {
+            timeout = TSM_TIMEOUT_MIN;
+        } else if (timeout > TSM_TIMEOUT_MAX) {
+            timeout = TSM_TIMEOUT_MAX;
+        }
+    }
+    timeout <<= peer->backoff;
+    if (timeout > 65535UL) {
+        timeout = 65535UL;
+    }
+
+    return (uint16_t) timeout;
+}
+
+/* how long to wait for the reply to the request, each time it is sent */
+static uint16_t tsm_request_timeout(
+    BACNET_TSM_DATA * pTsm)
+{
+    if (tsm_in_list(pTsm)) {
+        return apdu_timeout();
+    }
+
+    return tsm_peer_timeout(((TSM_PEER_DATA *) pTsm)->peer);
+}
+
+/* the reply to a request in flight, which is timed if it is the whole
+   of it, rather than the first of its segments, and the request was only
+   sent once: the reply to one sent again could be to any of the sends
+   (Karn's rule) */
+static void tsm_reply_received(
+    TSM_PEER_DATA * pd)
+{
+    if (pd->in_flight && (pd->data.state == TSM_STATE_AWAIT_CONFIRMATION) &&
+        (pd->data.RetryCount == 0)) {
+        tsm_rtt_sample(pd->peer, TSM_Wheel.now - pd->sent);
+        pd->peer->backoff = 0;
+    }
+}
+
+static bool tsm_window_open(
+    TSM_PEER * peer)
+{
+    return ((peer->in_flight + 1) * TSM_WINDOW_ONE <= peer->window);
+}
+
+/* sent before the window was last cut, and answered since */
+static bool tsm_sent_before_cut(
+    TSM_PEER_DATA * pd)
+{
+    return pd->peer->recovering &&
+        ((int32_t) (pd->seq - pd->peer->recover) < 0);
+}
+
+/* the first timeout of the request, or an Abort from the peer. The
+   window is halved once for each loss: the other requests in flight
+   then are lost with it, and their timeouts cut it no further */
+static void tsm_window_shrink(
+    TSM_PEER_DATA * pd)
+{
+    TSM_PEER *peer = pd->peer;
+
+    if ((pd->data.RetryCount != 0) || tsm_sent_before_cut(pd)) {
+        return;
+    }
+    peer->window /= 2;
+    if (peer->window < TSM_WINDOW_ONE) {
+        peer->window = TSM_WINDOW_ONE;
+    }
+    peer->recover = peer->sends;
+    peer->recovering = true;
+}
+
+/* the request is in flight no more. If it was answered before it had to
+   be sent again, the window grows by a request for each window of them */
+static void tsm_window_release(
+    TSM_PEER_DATA * pd,
+    bool answered)
+{
+    TSM_PEER *peer = pd->peer;
+
+    if (!pd->in_flight) {
+        return;
+    }
+    pd->in_flight = false;
+    peer->in_flight--;
+    if (answered && !tsm_sent_before_cut(pd)) {
+        peer->recovering = false;
+    }
+    if (answered && (pd->data.RetryCount == 0)) {
+        peer->window += TSM_WINDOW_ONE * TSM_WINDOW_ONE / peer->window;
+        if (peer->window > TSM_WINDOW_MAX * TSM_WINDOW_ONE) {
+            peer->window = TSM_WINDOW_MAX * TSM_WINDOW_ONE;
+        }
+    }
+}
+
+/* the request is sent for the first time */
+static void tsm_peer_data_sent(
+    TSM_PEER_DATA * pd)
+{
+    pd->sent = TSM_Wheel.now;
+    pd->seq = pd->peer->sends++;
+}
+
+/* sends the request, and starts waiting for the reply */
+static int tsm_transaction_send(
+    BACNET_TSM_DATA * pTsm)
+{
+    pTsm->state = TSM_STATE_AWAIT_CONFIRMATION;
+    tsm_timer_start(pTsm, tsm_request_timeout(pTsm));
+    if (!tsm_in_list(pTsm)) {
+        tsm_peer_data_sent((TSM_PEER_DATA *) pTsm);
+    }
+
+    return tsm_send_pdu(&pTsm->dest, &pTsm->npci_data, &pTsm->apdu[0],
+        pTsm->apdu_len);
+}
+
+/* sends those waiting in the peer's queue, while its window has room */
+static void tsm_window_fill(
+    TSM_PEER * peer)
+{
+    TSM_PEER_DATA *pd;
+
+    while ((peer->queue_head != NULL) && tsm_window_open(peer)) {
+        pd = peer->queue_head;
+        peer->queue_head = pd->queue_next;
+        if (peer->queue_head == NULL) {
+            peer->queue_tail = NULL;
+        }
+        pd->queue_next = NULL;
+        peer->queued--;
+        pd->in_flight = true;
+        peer->in_flight++;
+        tsm_transaction_send(&pd->data);
+    }
+}
+
+static void tsm_queue_add(
+    TSM_PEER_DATA * pd)
+{
+    TSM_PEER *peer = pd->peer;
+
+    pd->data.state = TSM_STATE_QUEUED;
+    pd->queue_next = NULL;
+    if (peer->queue_tail != NULL) {
+        peer->queue_tail->queue_next = pd;
+    } else {
+        peer->queue_head = pd;
+    }
+    peer->queue_tail = pd;
+    peer->queued++;
+}
+
+/* a request that was given up on before its turn came */
+static void tsm_queue_remove(
+    TSM_PEER_DATA * pd)
+{
+    TSM_PEER *peer = pd->peer;
+    TSM_PEER_DATA **link = &peer->queue_head;
+    TSM_PEER_DATA *prior = NULL;
+
+    while (*link != pd) {
+        prior = *link;
+        link = &prior->queue_next;
+    }
+    *link = pd->queue_next;
+    if (peer->queue_tail == pd) {
+        peer->queue_tail = prior;
+    }
+    pd->queue_next = NULL;
+    peer->queued--;
+}
+
+static void tsm_peer_data_free(
+    TSM_PEER_DATA * pd)
+{
+    TSM_PEER *peer = pd->peer;
+    uint8_t invokeID = pd->data.InvokeID;
+    TSM_PEER_DATA **link = &TSM_Data_Table[tsm_data_bucket(peer, invokeID)];
+
+    if (pd->data.state == TSM_STATE_QUEUED) {
+        tsm_queue_remove(pd);
+    }
+    /* given up on, unless the reply or an Abort released it already */
+    tsm_window_release(pd, false);
+    while (*link != pd) {
+        link = &(*link)->next;
+    }
+    *link = pd->next;
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+    tsm_reassembly_free(&pd->data);
+#endif
+    tsm_timer_stop(&pd->data);
+    pd->data.state = TSM_STATE_IDLE;
+    pd->data.InvokeID = 0;
+    pd->data.context = NULL;
+    pd->peer = NULL;
+    pd->next = TSM_Data_Free;
+    TSM_Data_Free = pd;
+    TSM_Data_Count--;
+
+    peer->Used[invokeID >> 6] &= ~((uint64_t) 1 << (invokeID & 63));
+    if (--TSM_Peer_Users[invokeID] == 0) {
+        TSM_Peer_Used[invokeID >> 6] &= ~((uint64_t) 1 << (invokeID & 63));
+    }
+    if (--peer->count == 0) {
+        tsm_peer_remove(peer);
+    } else {
+        tsm_window_fill(peer);
+    }
+}
+
+/* the transaction a reply from address is to: the peer's, or failing
+   that the one in TSM_List with the invoke ID if it went to address;
+   NULL if neither */
+static BACNET_TSM_DATA *tsm_find_transaction(
+    BACNET_ADDRESS * address,
+    uint8_t invokeID)
+{
+    TSM_PEER_DATA *pd;
+    uint8_t index;
+
+    if (invokeID == 0) {
+        return NULL;
+    }
+    pd = tsm_peer_data_find(address, invokeID);
+    if (pd != NULL) {
+        return &pd->data;
+    }
+    index = tsm_find_invokeID_index(invokeID);
+    if ((index < MAX_TSM_TRANSACTIONS) &&
+        bacnet_address_same(&TSM_List[index].dest, address)) {
+        return &TSM_List[index];
+    }
+
+    return NULL;
+}
+
+/* the transaction of a request to dest, for whoever is sending it: the
+   one in TSM_List with the invoke ID if it went there or has not been
+   sent yet, or else the peer's; NULL if neither */
+static BACNET_TSM_DATA *tsm_find_request(
+    BACNET_ADDRESS * dest,
+    uint8_t invokeID)
+{
+    BACNET_ADDRESS unsent;
+    TSM_PEER_DATA *pd;
+    uint8_t index;
+
+    if (invokeID == 0) {
+        return NULL;
+    }
+    index = tsm_find_invokeID_index(invokeID);
+    if (index < MAX_TSM_TRANSACTIONS) {
+        memset(&unsent, 0, sizeof(BACNET_ADDRESS));
+        if (bacnet_address_same(&TSM_List[index].dest, dest) ||
+            bacnet_address_same(&TSM_List[index].dest, &unsent)) {
+            return &TSM_List[index];
+        }
+    }
+    pd = tsm_peer_data_find(dest, invokeID);
+    if (pd != NULL) {
+        return &pd->data;
+    }
+
+    return NULL;
+}
+
+/* frees the invokeID and sets its state to IDLE */
+static void tsm_transaction_free(
+    BACNET_TSM_DATA * pTsm)
+{
+    uint8_t invokeID = pTsm->InvokeID;
+
+    if (!tsm_in_list(pTsm)) {
+        tsm_peer_data_free((TSM_PEER_DATA *) pTsm);
+        return;
+    }
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+    tsm_reassembly_free(pTsm);
+#endif
+    tsm_timer_stop(pTsm);
+    pTsm->state = TSM_STATE_IDLE;
+    pTsm->InvokeID = 0;
+    pTsm->context = NULL;
+    tsm_index_free(invokeID);
+}
+
+/* a request of ours that was never answered, which is IDLE with a valid
+   invoke ID until it is freed. The handlers are told once the timers are
+   done, and may free it; with no memory to remember it they are not, and
+   tsm_invoke_id_failed() is all there is. */
+static void tsm_timed_out(
+    BACNET_TSM_DATA * pTsm)
+{
+    TSM_DEFERRED *work;
+    uint8_t invokeID = pTsm->InvokeID;
+
+    pTsm->state = TSM_STATE_IDLE;
+    if (invokeID == 0) {
+        return;
+    }
+    if (!tsm_in_list(pTsm)) {
+        tsm_window_release((TSM_PEER_DATA *) pTsm, false);
+        tsm_window_fill(((TSM_PEER_DATA *) pTsm)->peer);
+    }
+    work = tsm_defer(&pTsm->dest, 0);
+    if (work != NULL) {
+        work->invokeID = invokeID;
+        work->in_list = tsm_in_list(pTsm);
+    }
+}
+
+uint8_t tsm_next_free_invokeID_peer(
+    BACNET_ADDRESS * dest)
+{
+    TSM_PEER_DATA *pd;
+    uint8_t invokeID = 0;
+
+    if (dest) {
+        BACNET_LOCK(TSM_Lock);
+        pd = tsm_peer_data_alloc(dest);
+        if (pd != NULL) {
+            invokeID = pd->data.InvokeID;
+        }
+        BACNET_UNLOCK(TSM_Lock);
+    }
+
+    return invokeID;
+}
+
+void tsm_free_invoke_id_peer(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID)
+{
+    BACNET_TSM_DATA *pTsm;
+
+    BACNET_LOCK(TSM_Lock);
+    pTsm = tsm_find_transaction(src, invokeID);
+    if (pTsm != NULL) {
+        tsm_transaction_free(pTsm);
+    }
+    BACNET_UNLOCK(TSM_Lock);
+}
+
+void tsm_reply_invoke_id_peer(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID)
+{
+    BACNET_TSM_DATA *pTsm;
+    TSM_PEER_DATA *pd;
+
+    BACNET_LOCK(TSM_Lock);
+    pTsm = tsm_find_transaction(src, invokeID);
+    if (pTsm != NULL) {
+        if (!tsm_in_list(pTsm)) {
+            pd = (TSM_PEER_DATA *) pTsm;
+            tsm_reply_received(pd);
+            tsm_window_release(pd, true);
+        }
+        tsm_transaction_free(pTsm);
+    }
+    BACNET_UNLOCK(TSM_Lock);
+}
+
+void tsm_abort_invoke_id_peer(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID)
+{
+    BACNET_TSM_DATA *pTsm;
+    TSM_PEER_DATA *pd;
+
+    BACNET_LOCK(TSM_Lock);
+    pTsm = tsm_find_transaction(src, invokeID);
+    if (pTsm != NULL) {
+        if (!tsm_in_list(pTsm)) {
+            pd = (TSM_PEER_DATA *) pTsm;
+            if (pd->in_flight) {
+                tsm_reply_received(pd);
+                tsm_window_shrink(pd);
+                tsm_window_release(pd, false);
+            }
+        }
+        tsm_transaction_free(pTsm);
+    }
+    BACNET_UNLOCK(TSM_Lock);
+}
+
+bool tsm_invoke_id_free_peer(
+    BACNET_ADDRESS * dest,
+    uint8_t invokeID)
+{
+    bool status;
+
+    BACNET_LOCK(TSM_Lock);
+    status = (tsm_find_request(dest, invokeID) == NULL);
+    BACNET_UNLOCK(TSM_Lock);
+
+    return status;
+}
+
+bool tsm_invoke_id_failed_peer(
+    BACNET_ADDRESS * dest,
+    uint8_t invokeID)
+{
+    BACNET_TSM_DATA *pTsm;
+    bool status = false;
+
+    BACNET_LOCK(TSM_Lock);
+    pTsm = tsm_find_request(dest, invokeID);
+    if ((pTsm != NULL) && (pTsm->state == TSM_STATE_IDLE)) {
+        status = true;
+    }
+    BACNET_UNLOCK(TSM_Lock);
+
+    return status;
+}
+
+bool tsm_set_transaction_context(
+    BACNET_ADDRESS * dest,
+    uint8_t invokeID,
+    void *context)
+{
+    BACNET_TSM_DATA *pTsm;
+
+    BACNET_LOCK(TSM_Lock);
+    pTsm = tsm_find_request(dest, invokeID);
+    if (pTsm != NULL) {
+        pTsm->context = context;
+    }
+    BACNET_UNLOCK(TSM_Lock);
+
+    return (pTsm != NULL);
+}
+
+void *tsm_take_transaction_context(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID)
+{
+    BACNET_TSM_DATA *pTsm;
+    void *context = NULL;
+
+    BACNET_LOCK(TSM_Lock);
+    pTsm = tsm_find_transaction(src, invokeID);
+    if (pTsm != NULL) {
+        context = pTsm->context;
+        pTsm->context = NULL;
+    }
+    BACNET_UNLOCK(TSM_Lock);
+
+    return context;
+}
+
+/* a copy of the peer of the device, or of what there would be of it if
+   a request went to it now; false if it is not bound */
+static bool tsm_device_peer(
+    uint32_t device_id,
+    TSM_PEER * copy)
+{
+    BACNET_ADDRESS dest;
+    unsigned max_apdu = 0;
+    TSM_PEER *peer;
+
+    if (!address_get_by_device(device_id, &max_apdu, &dest)) {
+        return false;
+    }
+    BACNET_LOCK(TSM_Lock);
+    peer = tsm_peer_find(&dest, tsm_address_hash(&dest));
+    if (peer != NULL) {
+        *copy = *peer;
+    } else {
+        memset(copy, 0, sizeof(TSM_PEER));
+        tsm_peer_learned(copy, &dest);
+    }
+    BACNET_UNLOCK(TSM_Lock);
+
+    return true;
+}
+
+bool tsm_device_window(
+    uint32_t device_id,
+    unsigned *window,
+    unsigned *in_flight,
+    unsigned *queued)
+{
+    TSM_PEER peer;
+
+    if (!tsm_device_peer(device_id, &peer)) {
+        return false;
+    }
+    if (window) {
+        *window = peer.window / TSM_WINDOW_ONE;
+    }
+    if (in_flight) {
+        *in_flight = peer.in_flight;
+    }
+    if (queued) {
+        *queued = peer.queued;
+    }
+
+    return true;
+}
+
+bool tsm_device_timeout(
+    uint32_t device_id,
+    unsigned *srtt,
+    unsigned *rttvar,
+    unsigned *timeout)
+{
+    TSM_PEER peer;
+
+    if (!tsm_device_peer(device_id, &peer)) {
+        return false;
+    }
+    if (srtt) {
+        *srtt = peer.srtt >> 3;
+    }
+    if (rttvar) {
+        *rttvar = peer.rttvar >> 2;
+    }
+    if (timeout) {
+        *timeout = tsm_peer_timeout(&peer);
+    }
+
+    return true;
+}
+
+unsigned tsm_peer_transaction_count(
+    void)
+{
+    unsigned count;
+
+    BACNET_LOCK(TSM_Lock);
+    count = TSM_Data_Count;
+    BACNET_UNLOCK(TSM_Lock);
+
+    return count;
+}
+
+void tsm_set_confirmed_unsegmented_transaction(
+    uint8_t invokeID,
+    BACNET_ADDRESS * dest,
+    BACNET_NPCI_DATA * ndpu_data,
+    uint8_t * apdu,
+    uint16_t apdu_len)
+{
+    uint16_t j = 0;
+    BACNET_TSM_DATA *pTsm;
+
+    if (invokeID) {
+        BACNET_LOCK(TSM_Lock);
+        /* either of the invoke ID spaces */
+        pTsm = tsm_find_request(dest, invokeID);
+        if (pTsm != NULL) {
+            /* SendConfirmedUnsegmented */
+            pTsm->state = TSM_STATE_AWAIT_CONFIRMATION;
+            pTsm->RetryCount = 0;
+            /* start the timer */
+            tsm_timer_start(pTsm, tsm_request_timeout(pTsm));
+            /* copy the data */
+            for (j = 0; j < apdu_len; j++) {
+                pTsm->apdu[j] = apdu[j];
+            }
+            pTsm->apdu_len = apdu_len;
+            npdu_copy_data(&pTsm->npci_data, ndpu_data);
+            bacnet_address_copy(&pTsm->dest, dest);
+            /* the caller sends it, room in the window or not */
+            if (!tsm_in_list(pTsm) && !((TSM_PEER_DATA *) pTsm)->in_flight) {
+                ((TSM_PEER_DATA *) pTsm)->in_flight = true;
+                ((TSM_PEER_DATA *) pTsm)->peer->in_flight++;
+                tsm_peer_data_sent((TSM_PEER_DATA *) pTsm);
+            }
+        }
+        BACNET_UNLOCK(TSM_Lock);
+    }
+
+}
+
+int tsm_send_confirmed_unsegmented_transaction(
+    uint8_t invokeID,
+    BACNET_ADDRESS * dest,
+    BACNET_NPCI_DATA * ndpu_data,
+    uint8_t * apdu,
+    uint16_t apdu_len)
+{
+    BACNET_TSM_DATA *pTsm;
+    TSM_PEER_DATA *pd;
+    int bytes_sent = -1;
+
+    if ((invokeID == 0) || (apdu_len > MAX_PDU)) {
+        return -1;
+    }
+    BACNET_LOCK(TSM_Lock);
+    pTsm = tsm_find_request(dest, invokeID);
+    if ((pTsm != NULL) && tsm_in_list(pTsm) &&
+        (tsm_peer_data_find(dest, invokeID) != NULL)) {
+        /* shared with the peer, whose reply could not be told apart */
+        pTsm = NULL;
+    }
+    if ((pTsm != NULL) && (pTsm->state == TSM_STATE_IDLE)) {
+        memcpy(pTsm->apdu, apdu, apdu_len);
+        pTsm->apdu_len = apdu_len;
+        npdu_copy_data(&pTsm->npci_data, ndpu_data);
+        bacnet_address_copy(&pTsm->dest, dest);
+        pTsm->RetryCount = 0;
+        if (tsm_in_list(pTsm)) {
+            bytes_sent = tsm_transaction_send(pTsm);
+        } else {
+            pd = (TSM_PEER_DATA *) pTsm;
+            if (tsm_window_open(pd->peer)) {
+                pd->in_flight = true;
+                pd->peer->in_flight++;
+                bytes_sent = tsm_transaction_send(pTsm);
+            } else {
+                tsm_queue_add(pd);
+                bytes_sent = apdu_len;
+            }
+        }
+    }
+    BACNET_UNLOCK(TSM_Lock);
+
+    return bytes_sent;
+}
+
+/* used to retrieve the transaction payload */
+/* if we wanted to find out what we sent (i.e. when we get an ack) */
+bool tsm_get_transaction_pdu(
+    uint8_t invokeID,
+    BACNET_ADDRESS * dest,
+    BACNET_NPCI_DATA * ndpu_data,
+    uint8_t * apdu,
+    uint16_t * apdu_len)
+{
+    uint16_t j = 0;
+    uint8_t index;
+    bool found = false;
+
+    if (invokeID) {
+        BACNET_LOCK(TSM_Lock);
+        index = tsm_find_invokeID_index(invokeID);
+        /* how much checking is needed?  state?  dest match? just invokeID? */
+        if (index < MAX_TSM_TRANSACTIONS) {
+            /* FIXME: we may want to free the transaction so it doesn't timeout */
+            /* retrieve the transaction */
+            /* FIXME: bounds check the pdu_len? */
+            *apdu_len = (uint16_t) TSM_List[index].apdu_len;
+            for (j = 0; j < *apdu_len; j++) {
+                apdu[j] = TSM_List[index].apdu[j];
+            }
+            npdu_copy_data(ndpu_data, &TSM_List[index].npci_data);
+            bacnet_address_copy(dest, &TSM_List[index].dest);
+            found = true;
+        }
+        BACNET_UNLOCK(TSM_Lock);
+    }
+
+    return found;
+}
+
+/* AWAIT_CONFIRMATION, and the segmented states, ran out of time.
+   TSM_Lock is held, from tsm_timer_milliseconds(), so what is sent is
+   deferred until it is let go */
+static void tsm_timer_expired(
+    BACNET_TIMER * timer)
+{
+    BACNET_TSM_DATA *pTsm = (BACNET_TSM_DATA *) timer->context;
+    TSM_PEER *peer;
+
+    switch (pTsm->state) {
+        case TSM_STATE_AWAIT_CONFIRMATION:
+            if (!tsm_in_list(pTsm)) {
+                peer = ((TSM_PEER_DATA *) pTsm)->peer;
+                tsm_window_shrink((TSM_PEER_DATA *) pTsm);
+                /* the requests in flight together back off as one */
+                if (peer->backoff <= pTsm->RetryCount) {
+                    peer->backoff = pTsm->RetryCount + 1U;
+                    if (peer->backoff > TSM_BACKOFF_MAX) {
+                        peer->backoff = TSM_BACKOFF_MAX;
+                    }
+                }
+            }
+            if (pTsm->RetryCount < apdu_retries()) {
+                tsm_timer_start(pTsm, tsm_request_timeout(pTsm));
+                pTsm->RetryCount++;
+                tsm_send_pdu(&pTsm->dest, &pTsm->npci_data,
+                    &pTsm->apdu[0], pTsm->apdu_len);
+            } else {
+                /* note: the invoke id has not been cleared yet
+                   and this indicates a failed message:
+                   IDLE and a valid invoke id */
+                tsm_timed_out(pTsm);
+            }
+            break;
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+        case TSM_STATE_SEGMENTED_CONFIRMATION:
+            tsm_segmented_confirmation_timeout(pTsm);
+            break;
+#endif
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+        case TSM_STATE_SEGMENTED_RESPONSE:
+            tsm_segmented_response_timeout(pTsm);
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+/* the timeout of the request to dest, if it is still a failed one: the
+   handlers of those before it may have freed it, and the invoke ID gone
+   to another since */
+static bool tsm_timeout_pending(
+    BACNET_ADDRESS * dest,
+    uint8_t invokeID)
+{
+    BACNET_TSM_DATA *pTsm;
+    bool status;
+
+    BACNET_LOCK(TSM_Lock);
+    pTsm = tsm_find_transaction(dest, invokeID);
+    status = (pTsm != NULL) && (pTsm->state == TSM_STATE_IDLE) &&
+        bacnet_address_same(&pTsm->dest, dest);
+    BACNET_UNLOCK(TSM_Lock);
+
+    return status;
+}
+
+/* called once a millisecond or slower. The retries and timeouts are sent
+   and reported after TSM_Lock is let go, in the order they came due. */
+void tsm_timer_milliseconds(
+    uint16_t milliseconds)
+{
+    TSM_DEFERRED *work;
+    TSM_DEFERRED *next;
+    tsm_timeout_function timeout_function;
+    tsm_peer_timeout_function peer_timeout_function;
+
+    BACNET_LOCK(TSM_Lock);
+    TSM_Deferring = true;
+    timer_wheel_advance(&TSM_Wheel, milliseconds);
+    TSM_Deferring = false;
+    work = TSM_Deferred_Head;
+    TSM_Deferred_Head = NULL;
+    TSM_Deferred_Tail = NULL;
+    timeout_function = Timeout_Function;
+    peer_timeout_function = Peer_Timeout_Function;
+    BACNET_UNLOCK(TSM_Lock);
+
+    for (; work != NULL; work = next) {
+        next = work->next;
+        if (work->pdu_len) {
+            datalink_send_pdu(&work->dest, &work->npci_data, &work->pdu[0],
+                work->pdu_len);
+        } else if (tsm_timeout_pending(&work->dest, work->invokeID)) {
+            if (work->in_list && timeout_function) {
+                timeout_function(work->invokeID);
+            }
+            if (peer_timeout_function) {
+                peer_timeout_function(&work->dest, work->invokeID);
+            }
+        }
+        free(work);
+    }
+}
+
+uint32_t tsm_timer_next_milliseconds(
+    void)
+{
+    uint32_t milliseconds;
+
+    BACNET_LOCK(TSM_Lock);
+    milliseconds = timer_wheel_next(&TSM_Wheel);
+    BACNET_UNLOCK(TSM_Lock);
+
+    return milliseconds;
+}
+
+/* frees the invokeID and sets its state to IDLE */
+void tsm_free_invoke_id(
+    uint8_t invokeID)
+{
+    uint8_t index;
+
+    BACNET_LOCK(TSM_Lock);
+    index = tsm_find_invokeID_index(invokeID);
+    if (index < MAX_TSM_TRANSACTIONS) {
+        tsm_transaction_free(&TSM_List[index]);
+    }
+    BACNET_UNLOCK(TSM_Lock);
+}
+
+/** Check if the invoke ID has been made free by the Transaction State Machine.
+ * @param invokeID [in] The invokeID to be checked, normally of last message sent.
+ * @return True if it is free (done with), False if still pending in the TSM.
+ */
+bool tsm_invoke_id_free(
+    uint8_t invokeID)
+{
+    bool status = true;
+    uint8_t index;
+
+    BACNET_LOCK(TSM_Lock);
+    index = tsm_find_invokeID_index(invokeID);
+    if (index < MAX_TSM_TRANSACTIONS)
+        status = false;
+    BACNET_UNLOCK(TSM_Lock);
+
+    return status;
+}
+
+/** See if we failed get a confirmation for the message associated
+ *  with this invoke ID.
+ * @param invokeID [in] The invokeID to be checked, normally of last message sent.
+ * @return True if already failed, False if done or segmented or still waiting
+ *         for a confirmation.
+ */
+bool tsm_invoke_id_failed(
+    uint8_t invokeID)
+{
+    bool status = false;
+    uint8_t index;
+
+    BACNET_LOCK(TSM_Lock);
+    index = tsm_find_invokeID_index(invokeID);
+    if (index < MAX_TSM_TRANSACTIONS) {
+        /* a valid invoke ID and the state is IDLE is a
+           message that failed to confirm */
+        if (TSM_List[index].state == TSM_STATE_IDLE)
+            status = true;
+    }
+    BACNET_UNLOCK(TSM_Lock);
+
+    return status;
+}
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+static BACNET_TSM_DATA *tsm_find_segmented_response(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID)
+{
+    unsigned i;
+
+    for (i = 0; i < MAX_SEGMENTED_RESPONSES; i++) {
+        if ((TSM_Response_List[i].state == TSM_STATE_SEGMENTED_RESPONSE) &&
+            (TSM_Response_List[i].InvokeID == invokeID) &&
+            bacnet_address_same(&TSM_Response_List[i].dest, src)) {
+            return &TSM_Response_List[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* sends segment number 'segment' (not the sequence number, which wraps) */
+static void tsm_send_segment(
+    BACNET_TSM_DATA * pTsm,
+    unsigned segment)
+{
+    BACNET_ADDRESS my_address;
+    unsigned offset = segment * pTsm->segment_size;
+    unsigned len = pTsm->segment_data_len - offset;
+    int pdu_len;
+
+    if (len > pTsm->segment_size) {
+        len = pTsm->segment_size;
+    }
+    datalink_get_my_address(&my_address);
+    pdu_len =
+        npdu_encode_pdu(&pTsm->apdu[0], &pTsm->dest, &my_address,
+        &pTsm->npci_data);
+    pTsm->apdu[pdu_len] = PDU_TYPE_COMPLEX_ACK | BIT(3);
+    if ((segment + 1) < pTsm->segment_count) {
+        /* more follows */
+        pTsm->apdu[pdu_len] |= BIT(2);
+    }
+    pTsm->apdu[pdu_len + 1] = pTsm->InvokeID;
+    pTsm->apdu[pdu_len + 2] = (uint8_t) segment;
+    pTsm->apdu[pdu_len + 3] = pTsm->ProposedWindowSize;
+    pTsm->apdu[pdu_len + 4] = pTsm->service_choice;
+    memcpy(&pTsm->apdu[pdu_len + TSM_SEGMENT_HEADER_LEN],
+        &pTsm->segment_data[offset], len);
+    pTsm->apdu_len = pdu_len + TSM_SEGMENT_HEADER_LEN + len;
+    tsm_send_pdu(&pTsm->dest, &pTsm->npci_data, &pTsm->apdu[0],
+        pTsm->apdu_len);
+}
+
+/* 5.4.5.3 FillWindow - send the window starting at InitialSequenceNumber */
+static void tsm_fill_window(
+    BACNET_TSM_DATA * pTsm)
+{
+    unsigned ix;
+
+    for (ix = 0; (ix < pTsm->ActualWindowSize) &&
+        ((pTsm->segment_base + ix) < pTsm->segment_count); ix++) {
+        tsm_send_segment(pTsm, pTsm->segment_base + ix);
+        if ((pTsm->segment_base + ix + 1) == pTsm->segment_count) {
+            pTsm->SentAllSegments = true;
+        }
+    }
+}
+
+unsigned tsm_segmented_complex_ack_max(
+    uint8_t max_segs,
+    uint16_t max_resp)
+{
+    unsigned max_apdu = MAX_SEGMENTED_APDU;
+
+    if (max_resp > MAX_APDU) {
+        max_resp = MAX_APDU;
+    }
+    if ((max_segs > 0) && (max_segs <= 64) &&
+        (max_resp > TSM_SEGMENT_HEADER_LEN)) {
+        /* 0 is unspecified and 65 is more than 64, so only 2..64 limit us */
+        if ((max_segs * (unsigned) (max_resp - TSM_SEGMENT_HEADER_LEN) +
+                TSM_COMPLEX_ACK_HEADER_LEN) < MAX_SEGMENTED_APDU) {
+            max_apdu =
+                max_segs * (unsigned) (max_resp - TSM_SEGMENT_HEADER_LEN) +
+                TSM_COMPLEX_ACK_HEADER_LEN;
+        }
+    }
+
+    return max_apdu;
+}
+
+/* TSM_Lock is held */
+static bool tsm_set_segmented_complex_ack_locked(
+    BACNET_ADDRESS * dest,
+    BACNET_NPCI_DATA * npci_data,
+    uint8_t max_segs,
+    uint16_t max_resp,
+    uint8_t * apdu,
+    unsigned apdu_len,
+    BACNET_ABORT_REASON * abort_reason)
+{
+    BACNET_TSM_DATA *pTsm;
+    unsigned segment_size;
+    unsigned segment_count;
+    unsigned i;
+
+    if (max_resp > MAX_APDU) {
+        max_resp = MAX_APDU;
+    }
+    if ((apdu_len <= TSM_COMPLEX_ACK_HEADER_LEN) ||
+        (max_resp <= TSM_SEGMENT_HEADER_LEN) ||
+        ((apdu_len - TSM_COMPLEX_ACK_HEADER_LEN) > MAX_SEGMENTED_APDU)) {
+        *abort_reason = ABORT_REASON_BUFFER_OVERFLOW;
+        return false;
+    }
+    segment_size = max_resp - TSM_SEGMENT_HEADER_LEN;
+    segment_count =
+        (apdu_len - TSM_COMPLEX_ACK_HEADER_LEN + segment_size -
+        1) / segment_size;
+    /* 0 is unspecified and 65 is more than 64, so only 2..64 limit us */
+    if ((max_segs > 0) && (max_segs <= 64) && (segment_count > max_segs)) {
+        *abort_reason = ABORT_REASON_BUFFER_OVERFLOW;
+        return false;
+    }
+    /* a retried request replaces the reply already in progress */
+    pTsm = tsm_find_segmented_response(dest, apdu[1]);
+    for (i = 0; (pTsm == NULL) && (i < MAX_SEGMENTED_RESPONSES); i++) {
+        if (TSM_Response_List[i].state == TSM_STATE_IDLE) {
+            pTsm = &TSM_Response_List[i];
+            pTsm->segment_data = &TSM_Response_Data[i][0];
+        }
+    }
+    if (pTsm == NULL) {
+        *abort_reason = ABORT_REASON_PREEMPTED_BY_HIGHER_PRIORITY_TASK;
+        return false;
+    }
+
+    /* SendSegmentedComplexACK */
+    pTsm->InvokeID = apdu[1];
+    pTsm->service_choice = apdu[2];
+    memcpy(pTsm->segment_data, &apdu[TSM_COMPLEX_ACK_HEADER_LEN],
+        apdu_len - TSM_COMPLEX_ACK_HEADER_LEN);
+    pTsm->segment_data_len = apdu_len - TSM_COMPLEX_ACK_HEADER_LEN;
+    pTsm->segment_size = (uint16_t) segment_size;
+    pTsm->segment_count = segment_count;
+    pTsm->segment_base = 0;
+    pTsm->InitialSequenceNumber = 0;
+    pTsm->ActualWindowSize = 1;
+    pTsm->ProposedWindowSize = TSM_PROPOSED_WINDOW_SIZE;
+    pTsm->SegmentRetryCount = 0;
+    pTsm->SentAllSegments = false;
+    npdu_copy_data(&pTsm->npci_data, npci_data);
+    bacnet_address_copy(&pTsm->dest, dest);
+    pTsm->state = TSM_STATE_SEGMENTED_RESPONSE;
+    tsm_timer_start(pTsm, apdu_segment_timeout());
+    tsm_fill_window(pTsm);
+
+    return true;
+}
+
+bool tsm_set_segmented_complex_ack(
+    BACNET_ADDRESS * dest,
+    BACNET_NPCI_DATA * npci_data,
+    uint8_t max_segs,
+    uint16_t max_resp,
+    uint8_t * apdu,
+    unsigned apdu_len,
+    BACNET_ABORT_REASON * abort_reason)
+{
+    bool status;
+
+    BACNET_LOCK(TSM_Lock);
+    status =
+        tsm_set_segmented_complex_ack_locked(dest, npci_data, max_segs,
+        max_resp, apdu, apdu_len, abort_reason);
+    BACNET_UNLOCK(TSM_Lock);
+
+    return status;
+}
+
+/* TSM_Lock is held */
+static void tsm_segmentack_received_locked(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID,
+    uint8_t sequence_number,
+    uint8_t actual_window_size)
+{
+    BACNET_TSM_DATA *pTsm;
+    uint8_t acked;
+
+    pTsm = tsm_find_segmented_response(src, invokeID);
+    if (pTsm == NULL) {
+        return;
+    }
+    tsm_timer_start(pTsm, apdu_segment_timeout());
+    /* InWindow(sequence_number, InitialSequenceNumber) */
+    acked = (uint8_t) (sequence_number - pTsm->InitialSequenceNumber);
+    if (acked >= pTsm->ActualWindowSize) {
+        /* DuplicateACK_Received */
+        return;
+    }
+    pTsm->segment_base += acked + 1u;
+    if (pTsm->SentAllSegments &&
+        (pTsm->segment_base >= pTsm->segment_count)) {
+        /* FinalACK_Received */
+        tsm_timer_stop(pTsm);
+        pTsm->state = TSM_STATE_IDLE;
+        return;
+    }
+    /* NewACK_Received */
+    pTsm->InitialSequenceNumber = (uint8_t) (sequence_number + 1);
+    pTsm->ActualWindowSize = actual_window_size ? actual_window_size : 1;
+    if (pTsm->ActualWindowSize > 127) {
+        pTsm->ActualWindowSize = 127;
+    }
+    pTsm->SegmentRetryCount = 0;
+    tsm_fill_window(pTsm);
+}
+
+void tsm_segmentack_received(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID,
+    uint8_t sequence_number,
+    uint8_t actual_window_size)
+{
+    BACNET_LOCK(TSM_Lock);
+    tsm_segmentack_received_locked(src, invokeID, sequence_number,
+        actual_window_size);
+    BACNET_UNLOCK(TSM_Lock);
+}
+
+void tsm_segmented_response_abort(
+    BACNET_ADDRESS * src,
+    uint8_t invokeID)
+{
+    BACNET_TSM_DATA *pTsm;
+
+    BACNET_LOCK(TSM_Lock);
+    pTsm = tsm_find_segmented_response(src, invokeID);
+    if (pTsm != NULL) {
+        tsm_timer_stop(pTsm);
+        pTsm->state = TSM_STATE_IDLE;
+    }
+    BACNET_UNLOCK(TSM_Lock);
+}
+
+unsigned tsm_segmented_response_count(
+    void)
+{
+    unsigned i;
+    unsigned count = 0;
+
+    BACNET_LOCK(TSM_Lock);
+    for (i = 0; i < MAX_SEGMENTED_RESPONSES; i++) {
+        if (TSM_Response_List[i].state == TSM_STATE_SEGMENTED_RESPONSE) {
+            count++;
+        }
+    }
+    BACNET_UNLOCK(TSM_Lock);
+
+    return count;
+}
+
+/* TSM_Lock is held, from tsm_timer_expired() */
+static void tsm_segmented_response_timeout(
+    BACNET_TSM_DATA * pTsm)
+{
+    if (pTsm->SegmentRetryCount < apdu_retries()) {
+        /* Timeout: send the window again */
+        pTsm->SegmentRetryCount++;
+        tsm_timer_start(pTsm, apdu_segment_timeout());
+        tsm_fill_window(pTsm);
+    } else {
+        /* FinalTimeout: the client has gone */
+        pTsm->state = TSM_STATE_IDLE;
+    }
+}
+#endif
+
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+static bool tsm_reassembly_alloc(
+    BACNET_TSM_DATA * pTsm)
+{
+    unsigned i;
+
+    for (i = 0; i < MAX_SEGMENTED_REASSEMBLY; i++) {
+        if (TSM_Reassembly_Owner[i] == 0) {
+            TSM_Reassembly_Owner[i] = pTsm->InvokeID;
+            pTsm->segment_data = &TSM_Reassembly_Data[i][0];
+            pTsm->segment_data_len = 0;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void tsm_reassembly_free(
+    BACNET_TSM_DATA * pTsm)
+{
+    unsigned i;
+
+    for (i = 0; (pTsm->segment_data != NULL) &&
+        (i < MAX_SEGMENTED_REASSEMBLY); i++) {
+        if (pTsm->segment_data == &TSM_Reassembly_Data[i][0]) {
+            TSM_Reassembly_Owner[i] = 0;
+        }
+    }
+    pTsm->segment_data = NULL;
+    pTsm->segment_data_len = 0;
+}
+
+/* sends our Segment-ACK or Abort back to the server */
+static void tsm_send_to_server(
+    BACNET_TSM_DATA * pTsm,
+    uint8_t * apdu,
+    int apdu_len)
+{
+    BACNET_ADDRESS my_address;
+    BACNET_NPCI_DATA npci_data;
+    uint8_t pdu[MAX_NPDU + 4];
+    int pdu_len;
+
+    datalink_get_my_address(&my_address);
+    npdu_setup_npci_data(&npci_data, false, pTsm->npci_data.priority);
+    pdu_len = npdu_encode_pdu(&pdu[0], &pTsm->dest, &my_address, &npci_data);
+    memcpy(&pdu[pdu_len], apdu, apdu_len);
+    tsm_send_pdu(&pTsm->dest, &npci_data, &pdu[0], pdu_len + apdu_len);
+}
+
+static void tsm_send_segmentack(
+    BACNET_TSM_DATA * pTsm,
+    bool negative_ack)
+{
+    BACNET_SEGMENT_ACK_DATA ack_data;
+    uint8_t apdu[4];
+
+    ack_data.negative_ack = negative_ack;
+    ack_data.server = false;
+    ack_data.invoke_id = pTsm->InvokeID;
+    ack_data.sequence_number = pTsm->LastSequenceNumber;
+    ack_data.actual_window_size = pTsm->ActualWindowSize;
+    tsm_send_to_server(pTsm, apdu, segmentack_encode_apdu(apdu, &ack_data));
+}
+
+/* gives up on the reply. IDLE with a valid invoke ID is a failed request */
+static void tsm_segmented_confirmation_abort(
+    BACNET_TSM_DATA * pTsm,
+    BACNET_ABORT_REASON abort_reason)
+{
+    uint8_t apdu[3];
+
+    tsm_send_to_server(pTsm, apdu, abort_encode_apdu(apdu, pTsm->InvokeID,
+            abort_reason, false));
+    tsm_reassembly_free(pTsm);
+    tsm_timer_stop(pTsm);
+    pTsm->state = TSM_STATE_IDLE;
+}
+
+/* 5.4.4.4, Tseg times four between segments from the server */
+static uint16_t tsm_segment_wait_timeout(
+    void)
+{
+    uint32_t timeout = 4UL * apdu_segment_timeout();
+
+    return (uint16_t) ((timeout > 65535UL) ? 65535UL : timeout);
+}
+
+/* TSM_Lock is held */
+static uint16_t tsm_segmented_complex_ack_received_locked(
+    BACNET_ADDRESS * src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data,
+    uint8_t ** service_request,
+    uint16_t service_request_len)
+{
+    BACNET_TSM_DATA *pTsm;
+    uint8_t sequence_number = service_data->sequence_number;
+
+    /* invoke ID 0 is never used, and it marks the free spots */
+    pTsm = tsm_find_transaction(src, service_data->invoke_id);
+    if ((pTsm == NULL) || !bacnet_address_same(&pTsm->dest, src)) {
+        return 0;
+    }
+    if (pTsm->state == TSM_STATE_AWAIT_CONFIRMATION) {
+        if (sequence_number != 0) {
+            /* UnexpectedPDU_Received */
+            tsm_segmented_confirmation_abort(pTsm,
+                ABORT_REASON_INVALID_APDU_IN_THIS_STATE);
+            return 0;
+        }
+        if (!tsm_reassembly_alloc(pTsm)) {
+            tsm_segmented_confirmation_abort(pTsm,
+                ABORT_REASON_PREEMPTED_BY_HIGHER_PRIORITY_TASK);
+            return 0;
+        }
+        /* SegmentedComplexACK_Received */
+        pTsm->ActualWindowSize = service_data->proposed_window_number;
+        if (pTsm->ActualWindowSize > TSM_PROPOSED_WINDOW_SIZE) {
+            pTsm->ActualWindowSize = TSM_PROPOSED_WINDOW_SIZE;
+        }
+        if (pTsm->ActualWindowSize == 0) {
+            pTsm->ActualWindowSize = 1;
+        }
+        /* so that segment 0 is the next one, and ends the first window */
+        pTsm->LastSequenceNumber = 255;
+        pTsm->InitialSequenceNumber = (uint8_t) (256 - pTsm->ActualWindowSize);
+        pTsm->state = TSM_STATE_SEGMENTED_CONFIRMATION;
+    } else if (pTsm->state == TSM_STATE_SEGMENTED_COMPLETE) {
+        if ((sequence_number == pTsm->LastSequenceNumber) &&
+            !service_data->more_follows) {
+            /* DuplicateSegmentReceived: our last SegmentACK was lost */
+            tsm_send_segmentack(pTsm, false);
+        }
+        return 0;
+    } else if (pTsm->state != TSM_STATE_SEGMENTED_CONFIRMATION) {
+        return 0;
+    }
+    tsm_timer_start(pTsm, tsm_segment_wait_timeout());
+    if (sequence_number != (uint8_t) (pTsm->LastSequenceNumber + 1)) {
+        /* SegmentReceivedOutOfOrder, or a duplicate: ask for what follows
+           the last one we have */
+        pTsm->InitialSequenceNumber = pTsm->LastSequenceNumber;
+        tsm_send_segmentack(pTsm, true);
+        return 0;
+    }
+    if ((pTsm->segment_data_len + service_request_len) > MAX_SEGMENTED_APDU) {
+        tsm_segmented_confirmation_abort(pTsm, ABORT_REASON_BUFFER_OVERFLOW);
+        return 0;
+    }
+    memcpy(&pTsm->segment_data[pTsm->segment_data_len], *service_request,
+        service_request_len);
+    pTsm->segment_data_len += service_request_len;
+    pTsm->LastSequenceNumber = sequence_number;
+    if (!service_data->more_follows) {
+        /* LastSegmentOfComplexACK_Received: the data stays ours until the
+           ACK handler is done and the invoke ID is freed, and is not
+           IDLE, which would be a failed request */
+        tsm_send_segmentack(pTsm, false);
+        tsm_timer_stop(pTsm);
+        pTsm->state = TSM_STATE_SEGMENTED_COMPLETE;
+        *service_request = pTsm->segment_data;
+        return (uint16_t) pTsm->segment_data_len;
+    }
+    if (sequence_number ==
+        (uint8_t) (pTsm->InitialSequenceNumber + pTsm->ActualWindowSize)) {
+        /* LastSegmentOfGroupReceived */
+        pTsm->InitialSequenceNumber = sequence_number;
+        tsm_send_segmentack(pTsm, false);
+    }
+    /* else NewSegmentReceived */
+
+    return 0;
+}
+
+uint16_t tsm_segmented_complex_ack_received(
+    BACNET_ADDRESS * src,
+    BACNET_CONFIRMED_SERVICE_ACK_DATA * service_data,
+    uint8_t ** service_request,
+    uint16_t service_request_len)
+{
+    uint16_t len;
+
+    BACNET_LOCK(TSM_Lock);
+    len =
+        tsm_segmented_complex_ack_received_locked(src, service_data,
+        service_request, service_request_len);
+    BACNET_UNLOCK(TSM_Lock);
+
+    return len;
+}
+
+/* TSM_Lock is held, from tsm_timer_expired() */
+static void tsm_segmented_confirmation_timeout(
+    BACNET_TSM_DATA * pTsm)
+{
+    /* the server has gone, like a request that was never confirmed */
+    tsm_reassembly_free(pTsm);
+    tsm_timed_out(pTsm);
+}
+
+unsigned tsm_segmented_confirmation_count(
+    void)
+{
+    TSM_PEER_DATA *pd;
+    unsigned i;
+    unsigned count = 0;
+
+    BACNET_LOCK(TSM_Lock);
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        if (TSM_List[i].state == TSM_STATE_SEGMENTED_CONFIRMATION) {
+            count++;
+        }
+    }
+    for (i = 0; i < TSM_Data_Table_Size; i++) {
+        for (pd = TSM_Data_Table[i]; pd != NULL; pd = pd->next) {
+            if (pd->data.state == TSM_STATE_SEGMENTED_CONFIRMATION) {
+                count++;
+            }
+        }
+    }
+    BACNET_UNLOCK(TSM_Lock);
+
+    return count;
+}
+#endif
+
+
+#ifdef TEST
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include "ctest.h"
+
+/* flag to send an I-Am */
+bool I_Am_Request = true;
+
+/* dummy function stubs */
+void datalink_get_broadcast_address(
+    BACNET_ADDRESS * dest)
+{
+    (void) dest;
+}
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+/* what the client got */
+static uint8_t Test_Received[MAX_SEGMENTED_APDU];
+static unsigned Test_Received_Len;
+static unsigned Test_Sent;
+static uint8_t Test_Last_Sequence;
+static bool Test_More_Follows;
+#endif
+
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+/* what the server got back from us */
+static BACNET_SEGMENT_ACK_DATA Test_Segment_Ack;
+static unsigned Test_Segment_Acks;
+static uint8_t Test_Abort_Reason;
+static unsigned Test_Aborts;
+static unsigned Test_Timeouts;
+#endif
+
+/* confirmed requests sent, and the last one that timed out */
+static unsigned Test_Requests;
+static uint8_t Test_Timeout_Invoke_ID;
+/* sends and timeouts that came while the timers held TSM_Lock */
+static unsigned Test_Deferring;
+
+/* dummy function stubs */
+int datalink_send_pdu(
+    BACNET_ADDRESS * dest,
+    BACNET_NPCI_DATA * npci_data,
+    uint8_t * pdu,
+    unsigned pdu_len)
+{
+    /* the test addresses are local, so the NPDU is version and control */
+    int offset = 2;
+
+    (void) dest;
+    (void) npci_data;
+    (void) offset;
+    if (TSM_Deferring) {
+        Test_Deferring++;
+    }
+    if ((pdu[offset] & 0xF0) == PDU_TYPE_CONFIRMED_SERVICE_REQUEST) {
+        Test_Requests++;
+    }
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    if ((pdu[offset] & 0xF8) == (PDU_TYPE_COMPLEX_ACK | BIT(3))) {
+        unsigned len;
+
+        /* a segmented ComplexACK, the client keeps the in order ones */
+        Test_Sent++;
+        if (pdu[offset + 2] == (uint8_t) (Test_Last_Sequence + 1)) {
+            Test_Last_Sequence = pdu[offset + 2];
+            Test_More_Follows = (pdu[offset] & BIT(2)) ? true : false;
+            len = pdu_len - offset - TSM_SEGMENT_HEADER_LEN;
+            memcpy(&Test_Received[Test_Received_Len],
+                &pdu[offset + TSM_SEGMENT_HEADER_LEN], len);
+            Test_Received_Len += len;
+        }
+    }
+#endif
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+    if ((pdu[offset] & 0xF0) == PDU_TYPE_SEGMENT_ACK) {
+        Test_Segment_Acks++;
+        segmentack_decode_apdu(&pdu[offset], (unsigned) (pdu_len - offset),
+            &Test_Segment_Ack);
+    } else if ((pdu[offset] & 0xF0) == PDU_TYPE_ABORT) {
+        Test_Aborts++;
+        Test_Abort_Reason = pdu[offset + 2];
+    }
+#endif
+    (void) pdu;
+    (void) pdu_len;
+
+    return 0;
+}
+
+static void testTSMTimeout(
+    uint8_t invoke_id)
+{
+    if (TSM_Deferring) {
+        Test_Deferring++;
+    }
+    Test_Timeout_Invoke_ID = invoke_id;
+}
+
+/* retries and the final timeout, to the millisecond */
+void testTSM(
+    Test * pTest)
+{
+    BACNET_ADDRESS dest;
+    BACNET_NPCI_DATA npci_data;
+    uint8_t pdu[16] = { 0 };
+    int pdu_len;
+    uint8_t invoke_id;
+    unsigned retry;
+
+    memset(&dest, 0, sizeof(dest));
+    npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(&pdu[0], &dest, NULL, &npci_data);
+    pdu[pdu_len] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
+    tsm_set_timeout_handler(testTSMTimeout);
+    Test_Timeout_Invoke_ID = 0;
+    Test_Requests = 0;
+
+    ct_test(pTest, tsm_timer_next_milliseconds() == UINT32_MAX);
+    invoke_id = tsm_next_free_invokeID();
+    ct_test(pTest, invoke_id != 0);
+    /* nothing to time until it is sent */
+    ct_test(pTest, tsm_timer_next_milliseconds() == UINT32_MAX);
+    tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest, &npci_data,
+        pdu, (uint16_t) (pdu_len + 4));
+    ct_test(pTest, tsm_timer_next_milliseconds() <= apdu_timeout());
+    for (retry = 0; retry < apdu_retries(); retry++) {
+        tsm_timer_milliseconds(apdu_timeout() - 1);
+        ct_test(pTest, Test_Requests == retry);
+        tsm_timer_milliseconds(1);
+        ct_test(pTest, Test_Requests == (retry + 1));
+    }
+    tsm_timer_milliseconds(apdu_timeout() - 1);
+    ct_test(pTest, Test_Timeout_Invoke_ID == 0);
+    ct_test(pTest, !tsm_invoke_id_failed(invoke_id));
+    tsm_timer_milliseconds(1);
+    ct_test(pTest, Test_Timeout_Invoke_ID == invoke_id);
+    ct_test(pTest, tsm_invoke_id_failed(invoke_id));
+    ct_test(pTest, tsm_timer_next_milliseconds() == UINT32_MAX);
+    /* the retries and the timeout came after the timers were done */
+    ct_test(pTest, Test_Deferring == 0);
+    tsm_free_invoke_id(invoke_id);
+    ct_test(pTest, tsm_invoke_id_free(invoke_id));
+
+    /* a reply in time stops the timer */
+    invoke_id = tsm_next_free_invokeID();
+    tsm_set_confirmed_unsegmented_transaction(invoke_id, &dest, &npci_data,
+        pdu, (uint16_t) (pdu_len + 4));
+    tsm_timer_milliseconds(10);
+    tsm_free_invoke_id(invoke_id);
+    ct_test(pTest, tsm_timer_next_milliseconds() == UINT32_MAX);
+    Test_Requests = 0;
+    tsm_timer_milliseconds(apdu_timeout());
+    ct_test(pTest, Test_Requests == 0);
+    tsm_set_timeout_handler(NULL);
+}
+
+/* every invoke ID once, then round from where we left off */
+void testTSMInvokeIDs(
+    Test * pTest)
+{
+    static uint8_t ids[MAX_TSM_TRANSACTIONS];
+    static bool seen[256];
+    uint8_t invoke_id;
+    unsigned i;
+
+    memset(seen, 0, sizeof(seen));
+    tsm_invokeID_set(250);
+    ct_test(pTest, tsm_transaction_idle_count() == MAX_TSM_TRANSACTIONS);
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        ids[i] = tsm_next_free_invokeID();
+        ct_test(pTest, ids[i] != 0);
+        ct_test(pTest, !seen[ids[i]]);
+        seen[ids[i]] = true;
+        ct_test(pTest, !tsm_invoke_id_free(ids[i]));
+    }
+    ct_test(pTest, ids[0] == 250);
+    ct_test(pTest, ids[6] == 1);
+    ct_test(pTest, !tsm_transaction_available());
+    ct_test(pTest, tsm_transaction_idle_count() == 0);
+    ct_test(pTest, tsm_next_free_invokeID() == 0);
+    ct_test(pTest, tsm_invoke_id_free(0));
+
+    /* freed ones come back in turn, not the latest first */
+    tsm_free_invoke_id(ids[10]);
+    tsm_free_invoke_id(ids[3]);
+    ct_test(pTest, tsm_invoke_id_free(ids[10]));
+    ct_test(pTest, tsm_transaction_idle_count() == 2);
+    invoke_id = tsm_next_free_invokeID();
+    ct_test(pTest, invoke_id == ids[3]);
+    invoke_id = tsm_next_free_invokeID();
+    ct_test(pTest, invoke_id == ids[10]);
+    ct_test(pTest, tsm_next_free_invokeID() == 0);
+
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        tsm_free_invoke_id(ids[i]);
+    }
+    ct_test(pTest, tsm_transaction_idle_count() == MAX_TSM_TRANSACTIONS);
+    ct_test(pTest, tsm_invoke_id_free(ids[0]));
+    tsm_invokeID_set(1);
+}
+
+static BACNET_ADDRESS Test_Peer_Timeout_Address;
+static uint8_t Test_Peer_Timeout_Invoke_ID;
+
+static void testTSMPeerTimeout(
+    BACNET_ADDRESS * dest,
+    uint8_t invoke_id)
+{
+    bacnet_address_copy(&Test_Peer_Timeout_Address, dest);
+    Test_Peer_Timeout_Invoke_ID = invoke_id;
+}
+
+/* a B/IP device, n of them on the one network */
+static void testTSMPeerAddress(
+    BACNET_ADDRESS * address,
+    unsigned n)
+{
+    memset(address, 0, sizeof(*address));
+    address->mac_len = 6;
+    address->mac[0] = 10;
+    address->mac[1] = 0;
+    address->mac[2] = (uint8_t) (n >> 8);
+    address->mac[3] = (uint8_t) n;
+    address->mac[4] = 0xBA;
+    address->mac[5] = 0xC0;
+}
+
+/* each peer has all of the invoke IDs, and the stack wide ones are told
+   apart from theirs by where they went */
+void testTSMPeerInvokeIDs(
+    Test * pTest)
+{
+    static uint8_t ids[2][255];
+    BACNET_ADDRESS peer[3];
+    BACNET_NPCI_DATA npci_data;
+    uint8_t pdu[16] = { 0 };
+    int pdu_len;
+    uint8_t invoke_id;
+    unsigned i;
+
+    testTSMPeerAddress(&peer[0], 1);
+    testTSMPeerAddress(&peer[1], 2);
+    testTSMPeerAddress(&peer[2], 3);
+    npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(&pdu[0], &peer[1], NULL, &npci_data);
+    pdu[pdu_len] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
+    for (i = 0; i < 255; i++) {
+        ids[0][i] = tsm_next_free_invokeID_peer(&peer[0]);
+        ids[1][i] = tsm_next_free_invokeID_peer(&peer[1]);
+        ct_test(pTest, ids[0][i] != 0);
+        ct_test(pTest, ids[1][i] != 0);
+    }
+    ct_test(pTest, tsm_peer_transaction_count() == 510);
+    ct_test(pTest, TSM_Peer_Count == 2);
+    ct_test(pTest, tsm_next_free_invokeID_peer(&peer[0]) == 0);
+
+    /* the peers using them all does not starve the stack wide ones */
+    invoke_id = tsm_next_free_invokeID();
+    ct_test(pTest, invoke_id != 0);
+    /* but it is not sent where it is used already */
+    ct_test(pTest, tsm_send_confirmed_unsegmented_transaction(invoke_id,
+            &peer[0], &npci_data, pdu, (uint16_t) (pdu_len + 4)) < 0);
+    ct_test(pTest, tsm_send_confirmed_unsegmented_transaction(invoke_id,
+            &peer[2], &npci_data, pdu, (uint16_t) (pdu_len + 4)) >= 0);
+    /* a reply from a peer with it frees the peer's only */
+    tsm_free_invoke_id_peer(&peer[0], invoke_id);
+    ct_test(pTest, !tsm_invoke_id_free(invoke_id));
+    ct_test(pTest, tsm_invoke_id_free_peer(&peer[0], invoke_id));
+    ct_test(pTest, !tsm_invoke_id_free_peer(&peer[1], invoke_id));
+    tsm_free_invoke_id_peer(&peer[2], invoke_id);
+    ct_test(pTest, tsm_invoke_id_free(invoke_id));
+    ct_test(pTest, tsm_next_free_invokeID_peer(&peer[0]) == invoke_id);
+
+    /* a reply from one peer frees its own, not the other's */
+    invoke_id = ids[0][10];
+    ct_test(pTest, !tsm_invoke_id_free_peer(&peer[0], invoke_id));
+    tsm_free_invoke_id_peer(&peer[0], invoke_id);
+    ct_test(pTest, tsm_invoke_id_free_peer(&peer[0], invoke_id));
+    ct_test(pTest, !tsm_invoke_id_free_peer(&peer[1], invoke_id));
+    /* once no peer has it, a stack wide one takes it first, and then no
+       peer does */
+    tsm_free_invoke_id_peer(&peer[1], invoke_id);
+    ct_test(pTest, tsm_next_free_invokeID() == invoke_id);
+    ct_test(pTest, tsm_next_free_invokeID_peer(&peer[0]) == 0);
+    /* no reply is to it before it is sent, and then only from there */
+    tsm_free_invoke_id_peer(&peer[1], invoke_id);
+    ct_test(pTest, !tsm_invoke_id_free(invoke_id));
+    tsm_set_confirmed_unsegmented_transaction(invoke_id, &peer[1],
+        &npci_data, pdu, (uint16_t) (pdu_len + 4));
+    tsm_free_invoke_id_peer(&peer[0], invoke_id);
+    ct_test(pTest, !tsm_invoke_id_free(invoke_id));
+    ct_test(pTest, !tsm_invoke_id_free_peer(&peer[1], invoke_id));
+    tsm_free_invoke_id_peer(&peer[1], invoke_id);
+    ct_test(pTest, tsm_invoke_id_free(invoke_id));
+    ct_test(pTest, tsm_next_free_invokeID_peer(&peer[0]) == invoke_id);
+    ct_test(pTest, tsm_next_free_invokeID_peer(&peer[1]) == invoke_id);
+
+    /* the timeout says who it was */
+    tsm_set_timeout_handler(testTSMTimeout);
+    tsm_set_peer_timeout_handler(testTSMPeerTimeout);
+    Test_Timeout_Invoke_ID = 0;
+    Test_Peer_Timeout_Invoke_ID = 0;
+    tsm_free_invoke_id_peer(&peer[1], ids[1][20]);
+    invoke_id = tsm_next_free_invokeID_peer(&peer[1]);
+    ct_test(pTest, invoke_id == ids[1][20]);
+    tsm_set_confirmed_unsegmented_transaction(invoke_id, &peer[1],
+        &npci_data, pdu, (uint16_t) (pdu_len + 4));
+    ct_test(pTest, !tsm_invoke_id_failed_peer(&peer[1], invoke_id));
+    for (i = 0; i <= apdu_retries(); i++) {
+        /* as long as a retry can wait, backed off or not */
+        tsm_timer_milliseconds(UINT16_MAX);
+    }
+    ct_test(pTest, Test_Peer_Timeout_Invoke_ID == invoke_id);
+    ct_test(pTest, bacnet_address_same(&Test_Peer_Timeout_Address,
+            &peer[1]));
+    ct_test(pTest, Test_Timeout_Invoke_ID == 0);
+    ct_test(pTest, tsm_invoke_id_failed_peer(&peer[1], invoke_id));
+    tsm_set_timeout_handler(NULL);
+    tsm_set_peer_timeout_handler(NULL);
+
+    /* the context goes to one taker only */
+    ct_test(pTest, tsm_set_transaction_context(&peer[0], ids[0][0], ids));
+    ct_test(pTest, tsm_take_transaction_context(&peer[1], ids[0][0]) == NULL);
+    ct_test(pTest, tsm_take_transaction_context(&peer[0], ids[0][0]) == ids);
+    ct_test(pTest, tsm_take_transaction_context(&peer[0], ids[0][0]) == NULL);
+    ct_test(pTest, !tsm_set_transaction_context(&peer[0], 0, ids));
+
+    for (i = 0; i < 255; i++) {
+        tsm_free_invoke_id_peer(&peer[0], ids[0][i]);
+        tsm_free_invoke_id_peer(&peer[1], ids[1][i]);
+    }
+    ct_test(pTest, tsm_peer_transaction_count() == 0);
+    ct_test(pTest, TSM_Peer_Count == 0);
+    ct_test(pTest, tsm_timer_next_milliseconds() == UINT32_MAX);
+}
+
+#define TEST_PEERS 2000
+#define TEST_PEER_REQUESTS 2
+
+/* a head-end polling a couple of thousand controllers, two requests each */
+void testTSMPeerPolling(
+    Test * pTest)
+{
+    static uint8_t ids[TEST_PEERS][TEST_PEER_REQUESTS];
+    BACNET_ADDRESS peer;
+    bool found = true;
+    unsigned i, j;
+
+    for (i = 0; i < TEST_PEERS; i++) {
+        testTSMPeerAddress(&peer, i);
+        for (j = 0; j < TEST_PEER_REQUESTS; j++) {
+            ids[i][j] = tsm_next_free_invokeID_peer(&peer);
+            found &= (ids[i][j] != 0);
+        }
+    }
+    ct_test(pTest, found);
+    ct_test(pTest,
+        tsm_peer_transaction_count() == (TEST_PEERS * TEST_PEER_REQUESTS));
+    ct_test(pTest, TSM_Peer_Count == TEST_PEERS);
+    /* and the replies, last to first */
+    for (i = TEST_PEERS; i-- > 0;) {
+        testTSMPeerAddress(&peer, i);
+        for (j = 0; j < TEST_PEER_REQUESTS; j++) {
+            found &= !tsm_invoke_id_free_peer(&peer, ids[i][j]);
+            tsm_free_invoke_id_peer(&peer, ids[i][j]);
+            found &= tsm_invoke_id_free_peer(&peer, ids[i][j]);
+        }
+    }
+    ct_test(pTest, found);
+    ct_test(pTest, tsm_peer_transaction_count() == 0);
+    ct_test(pTest, TSM_Peer_Count == 0);
+    ct_test(pTest, tsm_transaction_idle_count() == MAX_TSM_TRANSACTIONS);
+}
+
+/* the address cache, as the window and timeout tests bind it */
+#define TEST_DEVICES 3
+static struct {
+    BACNET_ADDRESS address;
+    unsigned max_apdu;
+    BACNET_ADDRESS_LEARNED learned;
+} Test_Devices[TEST_DEVICES];
+
+/* a confirmed request to dest with invoke_id, sent the windowed way */
+static int testTSMWindowSend(
+    BACNET_ADDRESS * dest,
+    uint8_t invoke_id)
+{
+    BACNET_NPCI_DATA npci_data;
+    uint8_t pdu[16] = { 0 };
+    int pdu_len;
+
+    npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
+    pdu_len = npdu_encode_pdu(&pdu[0], dest, NULL, &npci_data);
+    pdu[pdu_len] = PDU_TYPE_CONFIRMED_SERVICE_REQUEST;
+    pdu[pdu_len + 2] = invoke_id;
+
+    return tsm_send_confirmed_unsegmented_transaction(invoke_id, dest,
+        &npci_data, pdu, (uint16_t) (pdu_len + 4));
+}
+
+#define TEST_WINDOW_REQUESTS 12
+
+/* requests beyond the window wait their turn, and the window follows
+   what the device does with them */
+void testTSMPeerWindow(
+    Test * pTest)
+{
+    uint8_t ids[TEST_WINDOW_REQUESTS];
+    unsigned window = 0;
+    unsigned in_flight = 0;
+    unsigned queued = 0;
+    unsigned sent;
+    unsigned timeout = 0;
+    unsigned i;
+
+    /* a B/IP device, an MS/TP one on the same port, and one behind a
+       router; the stub of address_get_by_device() has them by index */
+    memset(Test_Devices, 0, sizeof(Test_Devices));
+    testTSMPeerAddress(&Test_Devices[0].address, 3000);
+    Test_Devices[0].max_apdu = 1476;
+    testTSMPeerAddress(&Test_Devices[1].address, 3001);
+    Test_Devices[1].max_apdu = 480;
+    testTSMPeerAddress(&Test_Devices[2].address, 3002);
+    Test_Devices[2].max_apdu = 1476;
+    Test_Devices[2].address.net = 5;
+    Test_Devices[2].address.len = 1;
+    Test_Devices[2].address.adr[0] = 12;
+    ct_test(pTest, tsm_device_window(0, &window, &in_flight, &queued));
+    ct_test(pTest, window == TSM_WINDOW_INITIAL);
+    ct_test(pTest, (in_flight == 0) && (queued == 0));
+    ct_test(pTest, tsm_device_window(1, &window, NULL, NULL));
+    ct_test(pTest, window == 1);
+    ct_test(pTest, tsm_device_window(2, &window, NULL, NULL));
+    ct_test(pTest, window == 1);
+    ct_test(pTest, !tsm_device_window(TEST_DEVICES, &window, NULL,
+            NULL));
+
+    /* only the window goes out, the rest is queued in order */
+    Test_Requests = 0;
+    for (i = 0; i < TEST_WINDOW_REQUESTS; i++) {
+        ids[i] = tsm_next_free_invokeID_peer(&Test_Devices[0].address);
+        ct_test(pTest, ids[i] != 0);
+        ct_test(pTest, testTSMWindowSend(&Test_Devices[0].address,
+                ids[i]) >= 0);
+    }
+    ct_test(pTest, Test_Requests == TSM_WINDOW_INITIAL);
+    tsm_device_window(0, &window, &in_flight, &queued);
+    ct_test(pTest, in_flight == TSM_WINDOW_INITIAL);
+    ct_test(pTest, queued == TEST_WINDOW_REQUESTS - TSM_WINDOW_INITIAL);
+    ct_test(pTest, !tsm_invoke_id_failed_peer(&Test_Devices[0].address,
+            ids[TEST_WINDOW_REQUESTS - 1]));
+    /* a queued request that is given up on is never sent */
+    tsm_free_invoke_id_peer(&Test_Devices[0].address,
+        ids[TEST_WINDOW_REQUESTS - 1]);
+    tsm_device_window(0, NULL, NULL, &queued);
+    ct_test(pTest, queued == TEST_WINDOW_REQUESTS - TSM_WINDOW_INITIAL - 1);
+    ct_test(pTest, Test_Requests == TSM_WINDOW_INITIAL);
+
+    /* giving up on one in flight sends the next, and that is all */
+    sent = Test_Requests;
+    tsm_free_invoke_id_peer(&Test_Devices[0].address, ids[0]);
+    tsm_device_window(0, &window, &in_flight, NULL);
+    ct_test(pTest, window == TSM_WINDOW_INITIAL);
+    ct_test(pTest, in_flight == TSM_WINDOW_INITIAL);
+    ct_test(pTest, Test_Requests == sent + 1);
+
+    /* prompt replies send the next ones, and open the window up */
+    for (i = 1; i < 6; i++) {
+        tsm_reply_invoke_id_peer(&Test_Devices[0].address, ids[i]);
+    }
+    tsm_device_window(0, &window, &in_flight, &queued);
+    ct_test(pTest, window > TSM_WINDOW_INITIAL);
+    ct_test(pTest, in_flight == window);
+    ct_test(pTest, Test_Requests == sent + 6 + window - TSM_WINDOW_INITIAL);
+    ct_test(pTest, in_flight + queued == TEST_WINDOW_REQUESTS - 6 - 1);
+
+    /* a timeout halves it, and sends nothing new until there is room */
+    sent = Test_Requests;
+    i = window;
+    tsm_device_timeout(0, NULL, NULL, &timeout);
+    tsm_timer_milliseconds((uint16_t) timeout);
+    tsm_device_window(0, &window, &in_flight, &queued);
+    ct_test(pTest, window == 1);
+    ct_test(pTest, Test_Requests == sent + in_flight);
+    ct_test(pTest, in_flight == i);
+
+    /* an Abort of one sent before the timeout is the same loss, and the
+       window is one in flight at a time at the least */
+    tsm_abort_invoke_id_peer(&Test_Devices[0].address, ids[6]);
+    tsm_device_window(0, &window, &in_flight, NULL);
+    ct_test(pTest, (window == 1) && (in_flight == i - 1));
+    ct_test(pTest, tsm_invoke_id_free_peer(&Test_Devices[0].address,
+            ids[6]));
+
+    /* the window is kept with the binding while there is nothing in
+       flight, and the device picks up there the next time */
+    for (i = 7; i < TEST_WINDOW_REQUESTS - 1; i++) {
+        tsm_reply_invoke_id_peer(&Test_Devices[0].address, ids[i]);
+    }
+    ct_test(pTest, tsm_peer_transaction_count() == 0);
+    ct_test(pTest, TSM_Peer_Count == 0);
+    ct_test(pTest, tsm_timer_next_milliseconds() == UINT32_MAX);
+    ct_test(pTest, Test_Devices[0].learned.window != 0);
+    tsm_device_window(0, &window, &in_flight, &queued);
+    ct_test(pTest, window == Test_Devices[0].learned.window / TSM_WINDOW_ONE);
+    ct_test(pTest, (in_flight == 0) && (queued == 0));
+
+    /* requests lost together are one loss, which halves the window once,
+       and so are the retries of those sent before it */
+    while (window < 8) {
+        ids[0] = tsm_next_free_invokeID_peer(&Test_Devices[0].address);
+        testTSMWindowSend(&Test_Devices[0].address, ids[0]);
+        tsm_reply_invoke_id_peer(&Test_Devices[0].address, ids[0]);
+        tsm_device_window(0, &window, NULL, NULL);
+    }
+    for (i = 0; i < 8; i++) {
+        ids[i] = tsm_next_free_invokeID_peer(&Test_Devices[0].address);
+        testTSMWindowSend(&Test_Devices[0].address, ids[i]);
+    }
+    tsm_device_timeout(0, NULL, NULL, &timeout);
+    tsm_timer_milliseconds((uint16_t) timeout);
+    tsm_device_window(0, &window, &in_flight, NULL);
+    ct_test(pTest, (window == 4) && (in_flight == 8));
+    tsm_timer_milliseconds((uint16_t) (2 * timeout));
+    tsm_device_window(0, &window, NULL, NULL);
+    ct_test(pTest, window == 4);
+    /* until one sent after it is answered */
+    ids[8] = tsm_next_free_invokeID_peer(&Test_Devices[0].address);
+    testTSMWindowSend(&Test_Devices[0].address, ids[8]);
+    for (i = 0; i < 8; i++) {
+        tsm_reply_invoke_id_peer(&Test_Devices[0].address, ids[i]);
+    }
+    tsm_device_window(0, &window, &in_flight, &queued);
+    ct_test(pTest, (window == 4) && (in_flight == 1) && (queued == 0));
+    ids[9] = tsm_next_free_invokeID_peer(&Test_Devices[0].address);
+    testTSMWindowSend(&Test_Devices[0].address, ids[9]);
+    tsm_reply_invoke_id_peer(&Test_Devices[0].address, ids[8]);
+    tsm_timer_milliseconds(UINT16_MAX);
+    tsm_device_window(0, &window, NULL, NULL);
+    ct_test(pTest, window == 2);
+    tsm_free_invoke_id_peer(&Test_Devices[0].address, ids[9]);
+    ct_test(pTest, tsm_peer_transaction_count() == 0);
+
+    /* the device behind the router gets one at a time, and a request
+       that is never answered lets the next one go */
+    Test_Requests = 0;
+    ids[0] = tsm_next_free_invokeID_peer(&Test_Devices[2].address);
+    ids[1] = tsm_next_free_invokeID_peer(&Test_Devices[2].address);
+    testTSMWindowSend(&Test_Devices[2].address, ids[0]);
+    testTSMWindowSend(&Test_Devices[2].address, ids[1]);
+    ct_test(pTest, Test_Requests == 1);
+    for (i = 0; i <= apdu_retries(); i++) {
+        /* each retry waits twice as long as the one before */
+        tsm_timer_milliseconds((uint16_t) (apdu_timeout() << i));
+    }
+    ct_test(pTest, tsm_invoke_id_failed_peer(&Test_Devices[2].address,
+            ids[0]));
+    ct_test(pTest, !tsm_invoke_id_failed_peer(&Test_Devices[2].address,
+            ids[1]));
+    ct_test(pTest, Test_Requests == 1 + apdu_retries() + 1);
+    tsm_free_invoke_id_peer(&Test_Devices[2].address, ids[0]);
+    tsm_free_invoke_id_peer(&Test_Devices[2].address, ids[1]);
+    ct_test(pTest, tsm_peer_transaction_count() == 0);
+    ct_test(pTest, TSM_Peer_Count == 0);
+    ct_test(pTest, tsm_timer_next_milliseconds() == UINT32_MAX);
+}
+
+#define TEST_ROUND_TRIPS 20
+
+/* the reply timeout follows each device: short for one that answers
+   promptly, so a failure is found sooner, and long enough for a slow one
+   that it is not asked twice */
+void testTSMPeerTimeouts(
+    Test * pTest)
+{
+    BACNET_ADDRESS *dest;
+    uint8_t invoke_id;
+    unsigned srtt = 0;
+    unsigned rttvar = 0;
+    unsigned timeout = 0;
+    unsigned elapsed;
+    unsigned i;
+
+    memset(Test_Devices, 0, sizeof(Test_Devices));
+    testTSMPeerAddress(&Test_Devices[0].address, 3100);
+    Test_Devices[0].max_apdu = 1476;
+    testTSMPeerAddress(&Test_Devices[2].address, 3102);
+    Test_Devices[2].max_apdu = 1476;
+    Test_Devices[2].address.net = 7;
+    Test_Devices[2].address.len = 1;
+    Test_Devices[2].address.adr[0] = 3;
+    ct_test(pTest, tsm_device_timeout(0, &srtt, &rttvar, &timeout));
+    ct_test(pTest, (srtt == 0) && (rttvar == 0));
+    ct_test(pTest, timeout == apdu_timeout());
+
+    /* an IP device that answers in 20ms, one request after the other */
+    dest = &Test_Devices[0].address;
+    for (i = 0; i < TEST_ROUND_TRIPS; i++) {
+        invoke_id = tsm_next_free_invokeID_peer(dest);
+        testTSMWindowSend(dest, invoke_id);
+        tsm_timer_milliseconds(20);
+        tsm_reply_invoke_id_peer(dest, invoke_id);
+    }
+    ct_test(pTest, TSM_Peer_Count == 0);
+    tsm_device_timeout(0, &srtt, &rttvar, &timeout);
+    ct_test(pTest, srtt == 20);
+    ct_test(pTest, rttvar < 5);
+    ct_test(pTest, timeout == TSM_TIMEOUT_MIN);
+    /* one that is given up on is not timed */
+    invoke_id = tsm_next_free_invokeID_peer(dest);
+    testTSMWindowSend(dest, invoke_id);
+    tsm_timer_milliseconds(TSM_TIMEOUT_MIN - 100);
+    tsm_free_invoke_id_peer(dest, invoke_id);
+    tsm_device_timeout(0, &srtt, NULL, NULL);
+    ct_test(pTest, srtt == 20);
+    /* the reply to a request that was sent again is not timed, and the
+       timeout stays backed off until one is */
+    invoke_id = tsm_next_free_invokeID_peer(dest);
+    testTSMWindowSend(dest, invoke_id);
+    tsm_timer_milliseconds(TSM_TIMEOUT_MIN + 100);
+    tsm_reply_invoke_id_peer(dest, invoke_id);
+    tsm_device_timeout(0, &srtt, NULL, &timeout);
+    ct_test(pTest, srtt == 20);
+    ct_test(pTest, timeout == 2 * TSM_TIMEOUT_MIN);
+    invoke_id = tsm_next_free_invokeID_peer(dest);
+    testTSMWindowSend(dest, invoke_id);
+    tsm_timer_milliseconds(20);
+    tsm_reply_invoke_id_peer(dest, invoke_id);
+    tsm_device_timeout(0, &srtt, NULL, &timeout);
+    ct_test(pTest, srtt == 20);
+    ct_test(pTest, timeout == TSM_TIMEOUT_MIN);
+    /* so when it goes away, that is known after the retries of that */
+    invoke_id = tsm_next_free_invokeID_peer(dest);
+    testTSMWindowSend(dest, invoke_id);
+    elapsed = 0;
+    while (!tsm_invoke_id_failed_peer(dest, invoke_id) &&
+        (elapsed < (apdu_retries() + 1U) * apdu_timeout())) {
+        tsm_timer_milliseconds(10);
+        elapsed += 10;
+    }
+    ct_test(pTest, tsm_invoke_id_failed_peer(dest, invoke_id));
+    /* each retry waiting twice as long as the one before */
+    ct_test(pTest,
+        elapsed == ((2U << apdu_retries()) - 1U) * TSM_TIMEOUT_MIN);
+    fprintf(ct_getStream(pTest),
+        "\n  silent device found out in %ums, not %ums\n", elapsed,
+        (apdu_retries() + 1U) * apdu_timeout());
+    tsm_free_invoke_id_peer(dest, invoke_id);
+
+    /* a device three routers away that takes 4s, more than apdu_timeout():
+       it is asked again the first time, and not after that */
+    dest = &Test_Devices[2].address;
+    Test_Requests = 0;
+    for (i = 0; i < TEST_ROUND_TRIPS; i++) {
+        invoke_id = tsm_next_free_invokeID_peer(dest);
+        testTSMWindowSend(dest, invoke_id);
+        tsm_timer_milliseconds(4000);
+        ct_test(pTest, !tsm_invoke_id_failed_peer(dest, invoke_id));
+        tsm_reply_invoke_id_peer(dest, invoke_id);
+        tsm_device_timeout(2, NULL, NULL, &timeout);
+        ct_test(pTest, timeout > 4000);
+    }
+    ct_test(pTest, Test_Requests == TEST_ROUND_TRIPS + 1);
+    fprintf(ct_getStream(pTest),
+        "  slow device: %u requests sent for %u reads, %u with a fixed "
+        "timeout\n", Test_Requests, TEST_ROUND_TRIPS, 2 * TEST_ROUND_TRIPS);
+    tsm_device_timeout(2, &srtt, &rttvar, &timeout);
+    ct_test(pTest, srtt == 4000);
+    ct_test(pTest, timeout <= TSM_TIMEOUT_MAX);
+
+    ct_test(pTest, tsm_peer_transaction_count() == 0);
+    ct_test(pTest, TSM_Peer_Count == 0);
+    ct_test(pTest, tsm_timer_next_milliseconds() == UINT32_MAX);
+}
+
+#define BENCH_ROUNDS 20000
+
+/* tsm_next_free_invokeID() as it was, scanning a copy of the invoke IDs */
+static uint8_t Bench_IDs[MAX_TSM_TRANSACTIONS];
+static uint8_t Bench_Current = 1;
+
+static unsigned testTSMLinearFind(
+    uint8_t invokeID)
+{
+    unsigned i;
+
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        if (Bench_IDs[i] == invokeID) {
+            return i;
+        }
+    }
+    return MAX_TSM_TRANSACTIONS;
+}
+
+static uint8_t testTSMLinearNext(
+    void)
+{
+    uint8_t invokeID = 0;
+    unsigned index;
+
+    if (testTSMLinearFind(0) == MAX_TSM_TRANSACTIONS) {
+        return 0;
+    }
+    while (invokeID == 0) {
+        if (testTSMLinearFind(Bench_Current) == MAX_TSM_TRANSACTIONS) {
+            index = testTSMLinearFind(0);
+            Bench_IDs[index] = invokeID = Bench_Current;
+        }
+        Bench_Current++;
+        if (Bench_Current == 0) {
+            Bench_Current = 1;
+        }
+    }
+    return invokeID;
+}
+
+static void testTSMLinearFree(
+    uint8_t invokeID)
+{
+    unsigned index = testTSMLinearFind(invokeID);
+
+    if (index < MAX_TSM_TRANSACTIONS) {
+        Bench_IDs[index] = 0;
+    }
+}
+
+static double testTSMElapsedNs(
+    struct timespec *start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return ((end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec -
+            start->tv_nsec)) / BENCH_ROUNDS;
+}
+
+/* With the table full, one request or another completes and a new one
+   takes its place, as a busy client would: a lookup, a free and an
+   allocate */
+void testTSMInvokeIDBenchmark(
+    Test * pTest)
+{
+    static uint8_t ids[MAX_TSM_TRANSACTIONS];
+    FILE *stream = ct_getStream(pTest);
+    struct timespec start;
+    double linear_ns, map_ns;
+    bool found = true;
+    unsigned i, k = 0;
+
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        ids[i] = testTSMLinearNext();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        k = (i * 97) % MAX_TSM_TRANSACTIONS;
+        found &= (testTSMLinearFind(ids[k]) < MAX_TSM_TRANSACTIONS);
+        testTSMLinearFree(ids[k]);
+        ids[k] = testTSMLinearNext();
+    }
+    linear_ns = testTSMElapsedNs(&start);
+
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        ids[i] = tsm_next_free_invokeID();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        k = (i * 97) % MAX_TSM_TRANSACTIONS;
+        found &= !tsm_invoke_id_free(ids[k]);
+        tsm_free_invoke_id(ids[k]);
+        ids[k] = tsm_next_free_invokeID();
+    }
+    map_ns = testTSMElapsedNs(&start);
+    ct_test(pTest, found);
+    ct_test(pTest, ids[k] != 0);
+    for (i = 0; i < MAX_TSM_TRANSACTIONS; i++) {
+        tsm_free_invoke_id(ids[i]);
+    }
+    ct_test(pTest, tsm_transaction_idle_count() == MAX_TSM_TRANSACTIONS);
+
+    fprintf(stream, "\n  %u transactions in use, ns per lookup + free + "
+        "allocate\n", MAX_TSM_TRANSACTIONS);
+    fprintf(stream, "  %-12s %10.0f\n", "linear scan", linear_ns);
+    fprintf(stream, "  %-12s %10.0f\n", "direct map", map_ns);
+}
+
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+static void testSegmentedStart(
+    void)
+{
+    Test_Received_Len = 0;
+    Test_Sent = 0;
+    Test_Last_Sequence = 255;
+    Test_More_Follows = true;
+}
+
+/* builds the unsegmented ComplexACK the handlers would */
+static unsigned testSegmentedAck(
+    uint8_t * apdu,
+    uint8_t invoke_id,
+    unsigned service_len)
+{
+    unsigned i;
+
+    apdu[0] = PDU_TYPE_COMPLEX_ACK;
+    apdu[1] = invoke_id;
+    apdu[2] = SERVICE_CONFIRMED_READ_PROP_MULTIPLE;
+    for (i = 0; i < service_len; i++) {
+        apdu[TSM_COMPLEX_ACK_HEADER_LEN + i] = (uint8_t) (i * 7 + (i >> 8));
+    }
+
+    return TSM_COMPLEX_ACK_HEADER_LEN + service_len;
+}
+
+void testTSMSegmentedResponse(
+    Test * pTest)
+{
+    static uint8_t apdu[MAX_SEGMENTED_APDU];
+    BACNET_ADDRESS client = { 0 }, other = { 0 };
+    BACNET_NPCI_DATA npci_data;
+    BACNET_ABORT_REASON abort_reason = ABORT_REASON_OTHER;
+    unsigned apdu_len, sent;
+    unsigned i;
+    bool status;
+
+    client.mac_len = 1;
+    client.mac[0] = 0x21;
+    other.mac_len = 1;
+    other.mac[0] = 0x42;
+    npdu_setup_npci_data(&npci_data, false, MESSAGE_PRIORITY_NORMAL);
+
+    /* 3000 octets in 475 octet segments is 7 segments, 0..6 */
+    testSegmentedStart();
+    apdu_len = testSegmentedAck(apdu, 7, 3000);
+    status =
+        tsm_set_segmented_complex_ack(&client, &npci_data, 0, 480, apdu,
+        apdu_len, &abort_reason);
+    ct_test(pTest, status);
+    ct_test(pTest, tsm_segmented_response_count() == 1);
+    /* the first segment alone, until the client tells us its window */
+    ct_test(pTest, Test_Sent == 1);
+    ct_test(pTest, Test_Last_Sequence == 0);
+    tsm_segmentack_received(&client, 7, 0, 4);
+    ct_test(pTest, Test_Sent == 5);
+    ct_test(pTest, Test_Last_Sequence == 4);
+    /* not from the client, or a duplicate: nothing */
+    tsm_segmentack_received(&other, 7, 4, 4);
+    tsm_segmentack_received(&client, 8, 4, 4);
+    tsm_segmentack_received(&client, 7, 0, 4);
+    ct_test(pTest, Test_Sent == 5);
+    tsm_segmentack_received(&client, 7, 4, 4);
+    ct_test(pTest, Test_Sent == 7);
+    ct_test(pTest, Test_Last_Sequence == 6);
+    ct_test(pTest, !Test_More_Follows);
+    ct_test(pTest, tsm_segmented_response_count() == 1);
+    tsm_segmentack_received(&client, 7, 6, 4);
+    ct_test(pTest, tsm_segmented_response_count() == 0);
+    ct_test(pTest, Test_Received_Len == 3000);
+    ct_test(pTest, memcmp(Test_Received, &apdu[TSM_COMPLEX_ACK_HEADER_LEN],
+            3000) == 0);
+
+    /* a lost segment: the client acks what it got in order, we go on
+       from there */
+    testSegmentedStart();
+    status =
+        tsm_set_segmented_complex_ack(&client, &npci_data, 0, 480, apdu,
+        apdu_len, &abort_reason);
+    tsm_segmentack_received(&client, 7, 0, 2);
+    ct_test(pTest, Test_Last_Sequence == 2);
+    Test_Last_Sequence = 1;     /* lose segment 2 */
+    Test_Received_Len = 2 * 475;
+    tsm_segmentack_received(&client, 7, 1, 2);
+    ct_test(pTest, Test_Last_Sequence == 3);
+    tsm_segmentack_received(&client, 7, 3, 8);
+    ct_test(pTest, Test_Last_Sequence == 6);
+    tsm_segmentack_received(&client, 7, 6, 8);
+    ct_test(pTest, tsm_segmented_response_count() == 0);
+    ct_test(pTest, Test_Received_Len == 3000);
+    ct_test(pTest, memcmp(Test_Received, &apdu[TSM_COMPLEX_ACK_HEADER_LEN],
+            3000) == 0);
+
+    /* sequence numbers wrap: 50 octet APDUs, 45 octet segments */
+    testSegmentedStart();
+    apdu_len = testSegmentedAck(apdu, 9, MAX_SEGMENTED_APDU - 100);
+    status =
+        tsm_set_segmented_complex_ack(&client, &npci_data, 65, 50, apdu,
+        apdu_len, &abort_reason);
+    ct_test(pTest, status);
+    for (i = 0; (i < 1000) && tsm_segmented_response_count(); i++) {
+        tsm_segmentack_received(&client, 9, Test_Last_Sequence, 127);
+    }
+    ct_test(pTest, tsm_segmented_response_count() == 0);
+    ct_test(pTest, Test_Received_Len == (MAX_SEGMENTED_APDU - 100));
+    ct_test(pTest, memcmp(Test_Received, &apdu[TSM_COMPLEX_ACK_HEADER_LEN],
+            MAX_SEGMENTED_APDU - 100) == 0);
+
+    /* more segments than the client takes */
+    apdu_len = testSegmentedAck(apdu, 7, 3000);
+    status =
+        tsm_set_segmented_complex_ack(&client, &npci_data, 4, 480, apdu,
+        apdu_len, &abort_reason);
+    ct_test(pTest, !status);
+    ct_test(pTest, abort_reason == ABORT_REASON_BUFFER_OVERFLOW);
+    ct_test(pTest, tsm_segmented_complex_ack_max(4, 480) ==
+        (4 * 475 + TSM_COMPLEX_ACK_HEADER_LEN));
+    ct_test(pTest, tsm_segmented_complex_ack_max(0, 480) ==
+        MAX_SEGMENTED_APDU);
+
+    /* the client goes quiet: the window is sent again, then given up */
+    testSegmentedStart();
+    status =
+        tsm_set_segmented_complex_ack(&client, &npci_data, 0, 480, apdu,
+        apdu_len, &abort_reason);
+    for (i = 0; i < apdu_retries(); i++) {
+        sent = Test_Sent;
+        tsm_timer_milliseconds(apdu_segment_timeout());
+        ct_test(pTest, Test_Sent == (sent + 1));
+        ct_test(pTest, tsm_segmented_response_count() == 1);
+    }
+    tsm_timer_milliseconds(apdu_segment_timeout());
+    ct_test(pTest, tsm_segmented_response_count() == 0);
+
+    /* the client aborts */
+    status =
+        tsm_set_segmented_complex_ack(&client, &npci_data, 0, 480, apdu,
+        apdu_len, &abort_reason);
+    tsm_segmented_response_abort(&other, 7);
+    ct_test(pTest, tsm_segmented_response_count() == 1);
+    tsm_segmented_response_abort(&client, 7);
+    ct_test(pTest, tsm_segmented_response_count() == 0);
+
+    /* all busy, and a retried request takes over its own transaction */
+    for (i = 0; i < MAX_SEGMENTED_RESPONSES; i++) {
+        apdu[1] = (uint8_t) i;
+        status =
+            tsm_set_segmented_complex_ack(&client, &npci_data, 0, 480, apdu,
+            apdu_len, &abort_reason);
+        ct_test(pTest, status);
+    }
+    apdu[1] = (uint8_t) i;
+    status =
+        tsm_set_segmented_complex_ack(&client, &npci_data, 0, 480, apdu,
+        apdu_len, &abort_reason);
+    ct_test(pTest, !status);
+    ct_test(pTest,
+        abort_reason == ABORT_REASON_PREEMPTED_BY_HIGHER_PRIORITY_TASK);
+    apdu[1] = 0;
+    status =
+        tsm_set_segmented_complex_ack(&client, &npci_data, 0, 480, apdu,
+        apdu_len, &abort_reason);
+    ct_test(pTest, status);
+    ct_test(pTest, tsm_segmented_response_count() == MAX_SEGMENTED_RESPONSES);
+    for (i = 0; i < MAX_SEGMENTED_RESPONSES; i++) {
+        tsm_segmented_response_abort(&client, (uint8_t) i);
+    }
+    ct_test(pTest, tsm_segmented_response_count() == 0);
+}
+#endif
+
+
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+static void testTimeoutHandler(
+    uint8_t invoke_id)
+{
+    (void) invoke_id;
+    Test_Timeouts++;
+}
+
+/* a request of ours to server, for the segments to answer */
+static uint8_t testSegmentedRequest(
+    BACNET_ADDRESS * server)
+{
+    BACNET_NPCI_DATA npci_data;
+    uint8_t request[8] = { 0 };
+    uint8_t invoke_id;
+
+    npdu_setup_npci_data(&npci_data, true, MESSAGE_PRIORITY_NORMAL);
+    invoke_id = tsm_next_free_invokeID();
+    tsm_set_confirmed_unsegmented_transaction(invoke_id, server, &npci_data,
+        request, sizeof(request));
+
+    return invoke_id;
+}
+
+/* segment number 'segment' of segment_size pieces of data, as the server
+   would send it */
+static uint16_t testSegmentReceived(
+    BACNET_ADDRESS * server,
+    uint8_t invoke_id,
+    unsigned segment,
+    uint8_t * data,
+    unsigned data_len,
+    unsigned segment_size,
+    uint8_t proposed_window,
+    uint8_t ** ack)
+{
+    BACNET_CONFIRMED_SERVICE_ACK_DATA ack_data = { 0 };
+    unsigned offset = segment * segment_size;
+    unsigned len = data_len - offset;
+
+    if (len > segment_size) {
+        len = segment_size;
+    }
+    ack_data.segmented_message = true;
+    ack_data.more_follows = ((offset + len) < data_len);
+    ack_data.invoke_id = invoke_id;
+    ack_data.sequence_number = (uint8_t) segment;
+    ack_data.proposed_window_number = proposed_window;
+    *ack = &data[offset];
+
+    return tsm_segmented_complex_ack_received(server, &ack_data, ack,
+        (uint16_t) len);
+}
+
+void testTSMSegmentedConfirmation(
+    Test * pTest)
+{
+    static uint8_t data[MAX_SEGMENTED_APDU + 1000];
+    BACNET_ADDRESS server = { 0 }, other = { 0 };
+    uint8_t invoke_ids[MAX_SEGMENTED_REASSEMBLY + 1];
+    uint8_t invoke_id;
+    uint8_t *ack = NULL;
+    uint16_t ack_len;
+    unsigned acks;
+    unsigned i;
+
+    server.mac_len = 1;
+    server.mac[0] = 0x63;
+    other.mac_len = 1;
+    other.mac[0] = 0x42;
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t) (i * 13 + (i >> 8));
+    }
+    tsm_set_timeout_handler(testTimeoutHandler);
+
+    /* 1000 octets in ten 100 octet segments, a window of 4 */
+    invoke_id = testSegmentedRequest(&server);
+    ct_test(pTest, invoke_id != 0);
+    Test_Segment_Acks = 0;
+    ack_len = testSegmentReceived(&server, invoke_id, 0, data, 1000, 100, 4,
+        &ack);
+    ct_test(pTest, ack_len == 0);
+    ct_test(pTest, tsm_segmented_confirmation_count() == 1);
+    /* the first segment is acked at once, with our window */
+    ct_test(pTest, Test_Segment_Acks == 1);
+    ct_test(pTest, Test_Segment_Ack.sequence_number == 0);
+    ct_test(pTest, Test_Segment_Ack.actual_window_size == 4);
+    ct_test(pTest, !Test_Segment_Ack.negative_ack);
+    ct_test(pTest, !Test_Segment_Ack.server);
+    ct_test(pTest, Test_Segment_Ack.invoke_id == invoke_id);
+    /* not from the server: dropped */
+    ct_test(pTest, testSegmentReceived(&other, invoke_id, 1, data, 1000, 100,
+            4, &ack) == 0);
+    ct_test(pTest, Test_Segment_Acks == 1);
+    for (i = 1; i < 4; i++) {
+        testSegmentReceived(&server, invoke_id, i, data, 1000, 100, 4, &ack);
+    }
+    ct_test(pTest, Test_Segment_Acks == 1);
+    /* the last of the window */
+    testSegmentReceived(&server, invoke_id, 4, data, 1000, 100, 4, &ack);
+    ct_test(pTest, Test_Segment_Acks == 2);
+    ct_test(pTest, Test_Segment_Ack.sequence_number == 4);
+    /* 5 is lost: 6 is dropped, and we ask for what follows 4 */
+    testSegmentReceived(&server, invoke_id, 6, data, 1000, 100, 4, &ack);
+    ct_test(pTest, Test_Segment_Acks == 3);
+    ct_test(pTest, Test_Segment_Ack.negative_ack);
+    ct_test(pTest, Test_Segment_Ack.sequence_number == 4);
+    for (i = 5; i < 9; i++) {
+        testSegmentReceived(&server, invoke_id, i, data, 1000, 100, 4, &ack);
+    }
+    ct_test(pTest, Test_Segment_Acks == 4);
+    ct_test(pTest, Test_Segment_Ack.sequence_number == 8);
+    ct_test(pTest, !Test_Segment_Ack.negative_ack);
+    ack_len = testSegmentReceived(&server, invoke_id, 9, data, 1000, 100, 4,
+        &ack);
+    ct_test(pTest, Test_Segment_Acks == 5);
+    ct_test(pTest, Test_Segment_Ack.sequence_number == 9);
+    ct_test(pTest, ack_len == 1000);
+    ct_test(pTest, memcmp(ack, data, 1000) == 0);
+    ct_test(pTest, tsm_segmented_confirmation_count() == 0);
+    /* answered, while the ACK handler has it */
+    ct_test(pTest, !tsm_invoke_id_failed(invoke_id));
+    ct_test(pTest, !tsm_invoke_id_free(invoke_id));
+    /* our SegmentACK was lost, and the server sends the last one again */
+    ack_len = testSegmentReceived(&server, invoke_id, 9, data, 1000, 100, 4,
+        &ack);
+    ct_test(pTest, ack_len == 0);
+    ct_test(pTest, Test_Segment_Acks == 6);
+    ct_test(pTest, Test_Segment_Ack.sequence_number == 9);
+    ct_test(pTest, !Test_Segment_Ack.negative_ack);
+    ct_test(pTest, !tsm_invoke_id_failed(invoke_id));
+    tsm_free_invoke_id(invoke_id);
+    ct_test(pTest, tsm_invoke_id_free(invoke_id));
+
+    /* sequence numbers wrap, and our window is the most we take */
+    invoke_id = testSegmentedRequest(&server);
+    Test_Segment_Acks = 0;
+    for (i = 0; i < 300; i++) {
+        ack_len = testSegmentReceived(&server, invoke_id, i, data, 3000, 10,
+            127, &ack);
+        ct_test(pTest, (ack_len == 0) == (i < 299));
+    }
+    ct_test(pTest, Test_Segment_Ack.actual_window_size ==
+        TSM_PROPOSED_WINDOW_SIZE);
+    /* the first, one per window, and the last */
+    ct_test(pTest, Test_Segment_Acks ==
+        (1 + 299 / TSM_PROPOSED_WINDOW_SIZE + 1));
+    ct_test(pTest, ack_len == 3000);
+    ct_test(pTest, memcmp(ack, data, 3000) == 0);
+    tsm_free_invoke_id(invoke_id);
+
+    /* more than fits: we abort, and the request has failed */
+    invoke_id = testSegmentedRequest(&server);
+    Test_Aborts = 0;
+    for (i = 0; (i < 100) && (Test_Aborts == 0); i++) {
+        testSegmentReceived(&server, invoke_id, i, data, sizeof(data), 1000,
+            16, &ack);
+    }
+    ct_test(pTest, Test_Aborts == 1);
+    ct_test(pTest, Test_Abort_Reason == ABORT_REASON_BUFFER_OVERFLOW);
+    ct_test(pTest, i == (MAX_SEGMENTED_APDU / 1000 + 1));
+    ct_test(pTest, tsm_invoke_id_failed(invoke_id));
+    tsm_free_invoke_id(invoke_id);
+
+    /* a reply that does not start at segment 0 */
+    invoke_id = testSegmentedRequest(&server);
+    testSegmentReceived(&server, invoke_id, 1, data, 1000, 100, 4, &ack);
+    ct_test(pTest, Test_Aborts == 2);
+    ct_test(pTest,
+        Test_Abort_Reason == ABORT_REASON_INVALID_APDU_IN_THIS_STATE);
+    ct_test(pTest, tsm_invoke_id_failed(invoke_id));
+    tsm_free_invoke_id(invoke_id);
+
+    /* the server goes quiet */
+    invoke_id = testSegmentedRequest(&server);
+    Test_Timeouts = 0;
+    testSegmentReceived(&server, invoke_id, 0, data, 1000, 100, 4, &ack);
+    tsm_timer_milliseconds(apdu_segment_timeout());
+    ct_test(pTest, tsm_segmented_confirmation_count() == 1);
+    tsm_timer_milliseconds(3 * apdu_segment_timeout());
+    ct_test(pTest, tsm_segmented_confirmation_count() == 0);
+    ct_test(pTest, Test_Timeouts == 1);
+    ct_test(pTest, tsm_invoke_id_failed(invoke_id));
+    tsm_free_invoke_id(invoke_id);
+
+    /* the pool is bounded, buffers come back when the invoke ID is freed */
+    acks = Test_Aborts;
+    for (i = 0; i <= MAX_SEGMENTED_REASSEMBLY; i++) {
+        invoke_ids[i] = testSegmentedRequest(&server);
+        testSegmentReceived(&server, invoke_ids[i], 0, data, 1000, 100, 4,
+            &ack);
+    }
+    ct_test(pTest, tsm_segmented_confirmation_count() ==
+        MAX_SEGMENTED_REASSEMBLY);
+    ct_test(pTest, Test_Aborts == (acks + 1));
+    ct_test(pTest,
+        Test_Abort_Reason == ABORT_REASON_PREEMPTED_BY_HIGHER_PRIORITY_TASK);
+    ct_test(pTest, tsm_invoke_id_failed(invoke_ids[MAX_SEGMENTED_REASSEMBLY]));
+    for (i = 0; i <= MAX_SEGMENTED_REASSEMBLY; i++) {
+        tsm_free_invoke_id(invoke_ids[i]);
+    }
+    invoke_id = testSegmentedRequest(&server);
+    testSegmentReceived(&server, invoke_id, 0, data, 1000, 100, 4, &ack);
+    ct_test(pTest, tsm_segmented_confirmation_count() == 1);
+    tsm_free_invoke_id(invoke_id);
+    ct_test(pTest, tsm_segmented_confirmation_count() == 0);
+    tsm_set_timeout_handler(NULL);
+}
+#endif
+
+#ifdef TEST_TSM
+void sys_panic(
+    const char *file,
+    const int line)
+{
+    (void) file;
+    (void) line;
+}
+
+void datalink_get_my_address(
+    BACNET_ADDRESS * my_address)
+{
+    memset(my_address, 0, sizeof(*my_address));
+}
+
+bool address_get_by_device(
+    uint32_t device_id,
+    unsigned *max_apdu,
+    BACNET_ADDRESS * src)
+{
+    if (device_id >= TEST_DEVICES) {
+        return false;
+    }
+    if (max_apdu) {
+        *max_apdu = Test_Devices[device_id].max_apdu;
+    }
+    if (src) {
+        bacnet_address_copy(src, &Test_Devices[device_id].address);
+    }
+    return true;
+}
+
+bool address_learned_get(
+    BACNET_ADDRESS * src,
+    unsigned *max_apdu,
+    BACNET_ADDRESS_LEARNED * learned)
+{
+    unsigned i;
+
+    for (i = 0; i < TEST_DEVICES; i++) {
+        if (bacnet_address_same(&Test_Devices[i].address, src)) {
+            *max_apdu = Test_Devices[i].max_apdu;
+            *learned = Test_Devices[i].learned;
+            return true;
+        }
+    }
+    return false;
+}
+
+void address_learned_set(
+    BACNET_ADDRESS * src,
+    BACNET_ADDRESS_LEARNED * learned)
+{
+    unsigned i;
+
+    for (i = 0; i < TEST_DEVICES; i++) {
+        if (bacnet_address_same(&Test_Devices[i].address, src)) {
+            Test_Devices[i].learned = *learned;
+        }
+    }
+}
+
+uint16_t apdu_timeout(
+    void)
+{
+    return 3000;
+}
+
+uint8_t apdu_retries(
+    void)
+{
+    return 3;
+}
+
+uint16_t apdu_segment_timeout(
+    void)
+{
+    return 2000;
+}
+
+int main(
+    void)
+{
+    Test *pTest;
+    bool rc;
+
+    tsm_init();
+    pTest = ct_create("BACnet TSM", NULL);
+    /* individual tests */
+    rc = ct_addTestFunction(pTest, testTSM);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTSMInvokeIDs);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTSMInvokeIDBenchmark);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTSMPeerInvokeIDs);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTSMPeerPolling);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTSMPeerWindow);
+    assert(rc);
+    rc = ct_addTestFunction(pTest, testTSMPeerTimeouts);
+    assert(rc);
+#if (BACNET_SEGMENTATION_TRANSMIT == 1)
+    rc = ct_addTestFunction(pTest, testTSMSegmentedResponse);
+    assert(rc);
+#endif
+#if (BACNET_SEGMENTATION_RECEIVE == 1)
+    rc = ct_addTestFunction(pTest, testTSMSegmentedConfirmation);
     assert(rc);
+#endif
 
     ct_setStream(pTest, stdout);
     ct_run(pTest);
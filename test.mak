@@ -9,11 +9,11 @@
 
 LOGFILE = test.log
 
-all: abort address arf awf bvlc6 bacapp bacdcode bacerror bacint bacstr \
-	cov crc datetime dcc event filename fifo getevent iam ihave \
-	indtext keylist key memcopy npdu proplist ptransfer \
-	rd reject ringbuf rp rpm sbuf timesync vmac \
-	whohas whois wp objects lighting
+all: abort address arf awf bvlc6 bacapp bacdcode bacerror bacint bacnetobject bacstr \
+	client_async client_poll cov crc datetime dcc decode_arena emm encode_cursor event eventloop filename fifo getevent iam ihave \
+	indtext keylist key memcopy npdu npduworkers propertycache proplist ptransfer \
+	rd reject ringbuf rp rpm rpm_ack sbuf segmentack snapshot stackstress stringpool timer_wheel \
+	timesync tsm txbuf vmac whohas whois wp objects lighting
 
 clean: logfile
 	rm ${LOGFILE}
@@ -61,6 +61,11 @@ bacint: logfile test/bacint.mak
 	( ./test/bacint >> ${LOGFILE} )
 	$(MAKE) -s -C test -f bacint.mak clean
 
+bacnetobject: logfile test/bacnetobject.mak
+	$(MAKE) -s -C test -f bacnetobject.mak clean all
+	( ./test/bacnetobject >> ${LOGFILE} )
+	$(MAKE) -s -C test -f bacnetobject.mak clean
+
 bacstr: logfile test/bacstr.mak
 	$(MAKE) -s -C test -f bacstr.mak clean all
 	( ./test/bacstr >> ${LOGFILE} )
@@ -71,6 +76,16 @@ bvlc6: logfile test/bvlc6.mak
 	( ./test/bvlc6 >> ${LOGFILE} )
 	$(MAKE) -s -C test -f bvlc6.mak clean
 
+client_async: logfile test/client_async.mak
+	$(MAKE) -s -C test -f client_async.mak clean all
+	( ./test/client_async >> ${LOGFILE} )
+	$(MAKE) -s -C test -f client_async.mak clean
+
+client_poll: logfile test/client_poll.mak
+	$(MAKE) -s -C test -f client_poll.mak clean all
+	( ./test/client_poll >> ${LOGFILE} )
+	$(MAKE) -s -C test -f client_poll.mak clean
+
 cov: logfile test/cov.mak
 	$(MAKE) -s -C test -f cov.mak clean all
 	( ./test/cov >> ${LOGFILE} )
@@ -91,11 +106,31 @@ dcc: logfile test/dcc.mak
 	( ./test/dcc >> ${LOGFILE} )
 	$(MAKE) -s -C test -f dcc.mak clean
 
+decode_arena: logfile test/decode_arena.mak
+	$(MAKE) -s -C test -f decode_arena.mak clean all
+	( ./test/decode_arena >> ${LOGFILE} )
+	$(MAKE) -s -C test -f decode_arena.mak clean
+
+emm: logfile test/emm.mak
+	$(MAKE) -s -C test -f emm.mak clean all
+	( ./test/emm >> ${LOGFILE} )
+	$(MAKE) -s -C test -f emm.mak clean
+
+encode_cursor: logfile test/encode_cursor.mak
+	$(MAKE) -s -C test -f encode_cursor.mak clean all
+	( ./test/encode_cursor >> ${LOGFILE} )
+	$(MAKE) -s -C test -f encode_cursor.mak clean
+
 event: logfile test/event.mak
 	$(MAKE) -s -C test -f event.mak clean all
 	( ./test/event >> ${LOGFILE} )
 	$(MAKE) -s -C test -f event.mak clean
 
+eventloop: logfile test/eventloop.mak
+	$(MAKE) -s -C test -f eventloop.mak clean all
+	( ./test/eventloop >> ${LOGFILE} )
+	$(MAKE) -s -C test -f eventloop.mak clean
+
 filename: logfile test/filename.mak
 	$(MAKE) -s -C test -f filename.mak clean all
 	( ./test/filename >> ${LOGFILE} )
@@ -151,6 +186,16 @@ npdu: logfile test/npdu.mak
 	( ./test/npdu >> ${LOGFILE} )
 	$(MAKE) -s -C test -f npdu.mak clean
 
+npduworkers: logfile test/npduworkers.mak
+	$(MAKE) -s -C test -f npduworkers.mak clean all
+	( ./test/npduworkers >> ${LOGFILE} )
+	$(MAKE) -s -C test -f npduworkers.mak clean
+
+propertycache: logfile test/propertycache.mak
+	$(MAKE) -s -C test -f propertycache.mak clean all
+	( ./test/propertycache >> ${LOGFILE} )
+	$(MAKE) -s -C test -f propertycache.mak clean
+
 proplist: logfile test/proplist.mak
 	$(MAKE) -s -C test -f proplist.mak clean all
 	( ./test/proplist >> ${LOGFILE} )
@@ -186,16 +231,56 @@ rpm: logfile test/rpm.mak
 	( ./test/rpm >> ${LOGFILE} )
 	$(MAKE) -s -C test -f rpm.mak clean
 
+rpm_ack: logfile test/rpm_ack.mak
+	$(MAKE) -s -C test -f rpm_ack.mak clean all
+	( ./test/rpm_ack >> ${LOGFILE} )
+	$(MAKE) -s -C test -f rpm_ack.mak clean
+
 sbuf: logfile test/sbuf.mak
 	$(MAKE) -s -C test -f sbuf.mak clean all
 	( ./test/sbuf >> ${LOGFILE} )
 	$(MAKE) -s -C test -f sbuf.mak clean
 
+segmentack: logfile test/segmentack.mak
+	$(MAKE) -s -C test -f segmentack.mak clean all
+	( ./test/segmentack >> ${LOGFILE} )
+	$(MAKE) -s -C test -f segmentack.mak clean
+
+snapshot: logfile test/snapshot.mak
+	$(MAKE) -s -C test -f snapshot.mak clean all
+	( ./test/snapshot >> ${LOGFILE} )
+	$(MAKE) -s -C test -f snapshot.mak clean
+
+stackstress: logfile test/stackstress.mak
+	$(MAKE) -s -C test -f stackstress.mak clean all
+	( ./test/stackstress >> ${LOGFILE} )
+	$(MAKE) -s -C test -f stackstress.mak clean
+
+stringpool: logfile test/stringpool.mak
+	$(MAKE) -s -C test -f stringpool.mak clean all
+	( ./test/stringpool >> ${LOGFILE} )
+	$(MAKE) -s -C test -f stringpool.mak clean
+
+timer_wheel: logfile test/timer_wheel.mak
+	$(MAKE) -s -C test -f timer_wheel.mak clean all
+	( ./test/timer_wheel >> ${LOGFILE} )
+	$(MAKE) -s -C test -f timer_wheel.mak clean
+
 timesync: logfile test/timesync.mak
 	$(MAKE) -s -C test -f timesync.mak clean all
 	( ./test/timesync >> ${LOGFILE} )
 	$(MAKE) -s -C test -f timesync.mak clean
 
+tsm: logfile test/tsm.mak
+	$(MAKE) -s -C test -f tsm.mak clean all
+	( ./test/tsm >> ${LOGFILE} )
+	$(MAKE) -s -C test -f tsm.mak clean
+
+txbuf: logfile test/txbuf.mak
+	$(MAKE) -s -C test -f txbuf.mak clean all
+	( ./test/txbuf >> ${LOGFILE} )
+	$(MAKE) -s -C test -f txbuf.mak clean
+
 vmac: logfile test/vmac.mak
 	$(MAKE) -s -C test -f vmac.mak clean all
 	( ./test/vmac >> ${LOGFILE} )
@@ -7,6 +7,7 @@ DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_ADDRESS -DBACNET_ADDRESS_CACHE_FILE
 CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
 
 SRCS = $(SRC_DIR)/address.c \
+	$(SRC_DIR)/timer_wheel.c \
 	$(SRC_DIR)/bacaddr.c \
 	$(SRC_DIR)/bacdcode.c \
 	$(SRC_DIR)/bacint.c \
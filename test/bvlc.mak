@@ -11,6 +11,7 @@ SRCS = $(SRC_DIR)/bacdcode.c \
 	$(SRC_DIR)/bacstr.c \
 	$(SRC_DIR)/bacreal.c \
 	$(SRC_DIR)/bvlc.c \
+	$(SRC_DIR)/timer_wheel.c \
 	ctest.c
 
 OBJS = ${SRCS:.c=.o}
@@ -0,0 +1,56 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../src
+HANDLER_DIR = ../demo/handler
+INCLUDES = -I../include -I../bits -I../bits/util -I../bits/osLayer/linux -I../ports/linux -I../demo/object -I.
+DEFINES = -DBIG_ENDIAN=0 -DBACDL_TEST -DTEST -DTEST_CLIENT_ASYNC -DBACNET_CLIENT=1
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
+
+SRCS = $(HANDLER_DIR)/client_async.c \
+	$(HANDLER_DIR)/s_rp.c \
+	$(HANDLER_DIR)/txbuf.c \
+	$(SRC_DIR)/apdu.c \
+	$(SRC_DIR)/tsm.c \
+	$(SRC_DIR)/timer_wheel.c \
+	$(SRC_DIR)/npdu.c \
+	$(SRC_DIR)/dcc.c \
+	$(SRC_DIR)/rp.c \
+	$(SRC_DIR)/bacerror.c \
+	$(SRC_DIR)/abort.c \
+	$(SRC_DIR)/reject.c \
+	$(SRC_DIR)/segmentack.c \
+	$(SRC_DIR)/bacaddr.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/bacreal.c \
+	ctest.c
+
+TARGET = client_async
+
+all: ${TARGET}
+
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} -lpthread
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+# the modules other than the one under test are built without TEST
+$(SRC_DIR)/%.o: $(SRC_DIR)/%.c
+	${CC} -c -Wall $(INCLUDES) -DBIG_ENDIAN=0 -DBACDL_TEST -DBACNET_CLIENT=1 -g $< -o $@
+
+$(HANDLER_DIR)/s_rp.o $(HANDLER_DIR)/txbuf.o: %.o: %.c
+	${CC} -c -Wall $(INCLUDES) -DBIG_ENDIAN=0 -DBACDL_TEST -DBACNET_CLIENT=1 -g $< -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
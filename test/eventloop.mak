@@ -0,0 +1,32 @@
+#Makefile to build test case
+CC      = gcc
+OS_DIR = ../bits/osLayer/linux
+INCLUDES = -I../include -I../bits/util -I../bits -I../bits/logging -I$(OS_DIR) -I../ports/linux -I.
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_EVENT_LOOP
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g -O2
+
+SRCS = $(OS_DIR)/eventLoop.c \
+	$(OS_DIR)/osLayer.c \
+	ctest.c
+
+OBJS = ${SRCS:.c=.o}
+
+TARGET = eventloop
+
+all: ${TARGET}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} -lpthread
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
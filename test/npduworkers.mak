@@ -0,0 +1,39 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../src
+UTIL_DIR = ../bits/util
+OS_DIR = ../bits/osLayer/linux
+INCLUDES = -I../include -I$(UTIL_DIR) -I../bits -I../bits/logging -I$(OS_DIR) -I../ports/linux -I.
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_NPDU_WORKERS
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g -O2
+
+SRCS = $(UTIL_DIR)/npduWorkers.c \
+	$(OS_DIR)/osLayer.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/rp.c \
+	ctest.c
+
+OBJS = ${SRCS:.c=.o}
+
+TARGET = npduworkers
+
+all: ${TARGET}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} -lpthread
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
@@ -0,0 +1,37 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../src
+UTIL_DIR = ../bits/util
+INCLUDES = -I../include -I$(UTIL_DIR) -I../bits/osLayer/linux -I.
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_PROPERTY_CACHE
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g -O2
+
+SRCS = $(UTIL_DIR)/propertyCache.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/datetime.c \
+	ctest.c
+
+OBJS = ${SRCS:.c=.o}
+
+TARGET = propertycache
+
+all: ${TARGET}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} -lpthread
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
@@ -13,7 +13,6 @@ SRCS = $(SRC_DIR)/proplist.c \
 	$(SRC_DIR)/bacreal.c \
 	$(SRC_DIR)/bacstr.c \
 	$(SRC_DIR)/datetime.c \
-	$(SRC_DIR)/lighting.c \
 	ctest.c
 
 TARGET = proplist
@@ -0,0 +1,58 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../src
+HANDLER_DIR = ../demo/handler
+INCLUDES = -I../include -I../bits -I../bits/util -I../bits/osLayer/linux -I../ports/linux -I../demo/object -I.
+DEFINES = -DBIG_ENDIAN=0 -DBACDL_TEST -DTEST -DTEST_RPM_ACK -DBACAPP_ALL
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
+
+SRCS = $(HANDLER_DIR)/h_rpm_a.c \
+	$(HANDLER_DIR)/h_rp_a.c \
+	$(SRC_DIR)/decode_arena.c \
+	$(SRC_DIR)/rp.c \
+	$(SRC_DIR)/rpm.c \
+	$(SRC_DIR)/bacapp.c \
+	$(SRC_DIR)/bacdevobjpropref.c \
+	$(SRC_DIR)/bactext.c \
+	$(SRC_DIR)/indtext.c \
+	$(SRC_DIR)/datetime.c \
+	$(SRC_DIR)/lighting.c \
+	$(SRC_DIR)/memcopy.c \
+	$(SRC_DIR)/encode_cursor.c \
+	$(SRC_DIR)/bacerror.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/bacreal.c \
+	ctest.c
+
+TARGET = rpm_ack
+
+all: ${TARGET}
+
+OBJS = ${SRCS:.c=.o}
+
+# every calloc the decoders and the arena make is counted by the test
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} -Wl,--wrap=calloc
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+# the modules other than the ones under test are built without TEST,
+# except bacapp.c for bacapp_same_value()
+$(SRC_DIR)/%.o: $(SRC_DIR)/%.c
+	${CC} -c -Wall $(INCLUDES) -DBIG_ENDIAN=0 -DBACDL_TEST -DBACAPP_ALL -g $< -o $@
+
+$(SRC_DIR)/bacapp.o: $(SRC_DIR)/bacapp.c
+	${CC} -c ${CFLAGS} $< -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
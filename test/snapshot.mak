@@ -0,0 +1,42 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../src
+UTIL_DIR = ../bits/util
+INCLUDES = -I../include -I$(UTIL_DIR) -I../bits/osLayer/linux -I.
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_SNAPSHOT
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g -O2
+
+SRCS = $(UTIL_DIR)/BACnetSnapshot.c \
+	$(UTIL_DIR)/stringPool.c \
+	$(UTIL_DIR)/emm.c \
+	$(UTIL_DIR)/BACnetObject.c \
+	$(UTIL_DIR)/llist.c \
+	$(UTIL_DIR)/propertyCache.c \
+	$(SRC_DIR)/bacstr.c \
+	ctest.c
+
+OBJS = ${SRCS:.c=.o}
+
+TARGET = snapshot
+
+all: ${TARGET}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS} -lpthread
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+# the property cache is not under test, it is built without TEST
+$(UTIL_DIR)/propertyCache.o: $(UTIL_DIR)/propertyCache.c
+	${CC} -c -Wall $(INCLUDES) -DBIG_ENDIAN=0 -g -O2 $< -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
@@ -0,0 +1,55 @@
+#Makefile to build test case
+# The receive path and the tick against each other, under ThreadSanitizer
+CC      = gcc
+SRC_DIR = ../src
+UTIL_DIR = ../bits/util
+OS_DIR = ../bits/osLayer/linux
+INCLUDES = -I../include -I$(UTIL_DIR) -I../bits -I../bits/logging -I$(OS_DIR) -I../ports/linux -I../demo/object -I.
+DEFINES = -DBIG_ENDIAN=0 -DBACNET_STACK_LOCKS=1
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g -O1 -fsanitize=thread
+
+SRCS = $(UTIL_DIR)/npduWorkers.c \
+	$(OS_DIR)/osLayer.c \
+	$(SRC_DIR)/tsm.c \
+	$(SRC_DIR)/timer_wheel.c \
+	$(SRC_DIR)/npdu.c \
+	$(SRC_DIR)/abort.c \
+	$(SRC_DIR)/segmentack.c \
+	$(SRC_DIR)/address.c \
+	$(SRC_DIR)/dcc.c \
+	$(SRC_DIR)/bacaddr.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacreal.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/rp.c \
+	ctest.c
+
+OBJS = ${SRCS:.c=.o}
+
+TARGET = stackstress
+
+all: ${TARGET}
+
+${TARGET}: ${OBJS}
+	${CC} -fsanitize=thread -o $@ ${OBJS} -lpthread
+
+# only the stress test is built with its test code, the stack as it ships
+$(UTIL_DIR)/npduWorkers.o: $(UTIL_DIR)/npduWorkers.c
+	${CC} -c ${CFLAGS} -DTEST -DTEST_STACK_STRESS $< -o $@
+
+ctest.o: ctest.c
+	${CC} -c ${CFLAGS} -DTEST $< -o $@
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend
@@ -0,0 +1,44 @@
+#Makefile to build test case
+CC      = gcc
+SRC_DIR = ../src
+INCLUDES = -I../include -I../bits -I../bits/util -I../bits/osLayer/linux -I../ports/linux -I../demo/object -I.
+DEFINES = -DBIG_ENDIAN=0 -DTEST -DTEST_TSM
+
+CFLAGS  = -Wall $(INCLUDES) $(DEFINES) -g
+
+SRCS = $(SRC_DIR)/tsm.c \
+	$(SRC_DIR)/timer_wheel.c \
+	$(SRC_DIR)/npdu.c \
+	$(SRC_DIR)/abort.c \
+	$(SRC_DIR)/segmentack.c \
+	$(SRC_DIR)/bacaddr.c \
+	$(SRC_DIR)/bacdcode.c \
+	$(SRC_DIR)/bacint.c \
+	$(SRC_DIR)/bacstr.c \
+	$(SRC_DIR)/bacreal.c \
+	ctest.c
+
+TARGET = tsm
+
+all: ${TARGET}
+
+OBJS = ${SRCS:.c=.o}
+
+${TARGET}: ${OBJS}
+	${CC} -o $@ ${OBJS}
+
+.c.o:
+	${CC} -c ${CFLAGS} $*.c -o $@
+
+# npdu.c's own test does not build, so without TEST
+$(SRC_DIR)/npdu.o: $(SRC_DIR)/npdu.c
+	${CC} -c -Wall $(INCLUDES) -DBIG_ENDIAN=0 -g $< -o $@
+
+depend:
+	rm -f .depend
+	${CC} -MM ${CFLAGS} *.c >> .depend
+
+clean:
+	rm -rf ${TARGET} $(OBJS)
+
+include: .depend